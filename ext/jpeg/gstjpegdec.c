@@ -41,6 +41,7 @@
 #include "gstjpeg.h"
 #include <gst/video/video.h>
 #include "gst/gst-i18n-plugin.h"
+#include "gst/glib-compat-private.h"
 #include <jerror.h>
 
 #define MIN_WIDTH  1
@@ -53,14 +54,51 @@
 
 #define JPEG_DEFAULT_IDCT_METHOD	JDCT_FASTEST
 #define JPEG_DEFAULT_MAX_ERRORS 	0
+#define JPEG_DEFAULT_SCALE		GST_JPEG_DEC_SCALE_AUTO
+#define JPEG_DEFAULT_THREADS		1
+#define JPEG_DEFAULT_MAX_IN_FLIGHT	0
+
+/* size of the scaled IDCT output of a component, in raw mode jpeglib may
+ * scale chroma components less than luma */
+#if JPEG_LIB_VERSION >= 70
+#define COMP_DCT_H_SIZE(compptr) ((compptr)->DCT_h_scaled_size)
+#define COMP_DCT_V_SIZE(compptr) ((compptr)->DCT_v_scaled_size)
+#else
+#define COMP_DCT_H_SIZE(compptr) ((compptr)->DCT_scaled_size)
+#define COMP_DCT_V_SIZE(compptr) ((compptr)->DCT_scaled_size)
+#endif
 
 enum
 {
   PROP_0,
   PROP_IDCT_METHOD,
-  PROP_MAX_ERRORS
+  PROP_MAX_ERRORS,
+  PROP_SCALE,
+  PROP_THREADS,
+  PROP_MAX_IN_FLIGHT
 };
 
+#define GST_TYPE_JPEG_DEC_SCALE (gst_jpeg_dec_scale_get_type ())
+static GType
+gst_jpeg_dec_scale_get_type (void)
+{
+  static GType scale_type = 0;
+  static const GEnumValue scale[] = {
+    {GST_JPEG_DEC_SCALE_AUTO,
+        "Scale down if downstream requires a smaller size", "auto"},
+    {GST_JPEG_DEC_SCALE_FULL, "Full size", "full"},
+    {GST_JPEG_DEC_SCALE_HALF, "Half size", "half"},
+    {GST_JPEG_DEC_SCALE_QUARTER, "Quarter size", "quarter"},
+    {GST_JPEG_DEC_SCALE_EIGHTH, "Eighth size", "eighth"},
+    {0, NULL, NULL},
+  };
+
+  if (!scale_type) {
+    scale_type = g_enum_register_static ("GstJpegDecScale", scale);
+  }
+  return scale_type;
+}
+
 /* *INDENT-OFF* */
 static GstStaticPadTemplate gst_jpeg_dec_src_pad_template =
 GST_STATIC_PAD_TEMPLATE ("src",
@@ -118,6 +156,7 @@ static gboolean gst_jpeg_dec_setcaps (GstPad * pad, GstCaps * caps);
 static GstCaps *gst_jpeg_dec_getcaps (GstPad * pad);
 static gboolean gst_jpeg_dec_sink_event (GstPad * pad, GstEvent * event);
 static gboolean gst_jpeg_dec_src_event (GstPad * pad, GstEvent * event);
+static gboolean gst_jpeg_dec_src_query (GstPad * pad, GstQuery * query);
 static GstStateChangeReturn gst_jpeg_dec_change_state (GstElement * element,
     GstStateChange transition);
 static void gst_jpeg_dec_update_qos (GstJpegDec * dec, gdouble proportion,
@@ -155,9 +194,11 @@ gst_jpeg_dec_finalize (GObject * object)
 {
   GstJpegDec *dec = GST_JPEG_DEC (object);
 
-  jpeg_destroy_decompress (&dec->cinfo);
+  jpeg_destroy_decompress (&dec->ctx.cinfo);
 
   g_object_unref (dec->adapter);
+  g_mutex_free (dec->frame_lock);
+  g_cond_free (dec->frame_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -212,6 +253,55 @@ gst_jpeg_dec_class_init (GstJpegDecClass * klass)
           -1, G_MAXINT, JPEG_DEFAULT_MAX_ERRORS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstJpegDec:scale
+   *
+   * Decode pictures at a fraction of their size with a scaled IDCT, which is
+   * a lot faster than decoding at full size and scaling down afterwards.
+   * In auto mode the picture is scaled down if downstream only accepts
+   * exactly the half, quarter or eighth size.
+   *
+   * Since: 0.10.32
+   **/
+  g_object_class_install_property (gobject_class, PROP_SCALE,
+      g_param_spec_enum ("scale", "Scale",
+          "Size to decode the pictures at", GST_TYPE_JPEG_DEC_SCALE,
+          JPEG_DEFAULT_SCALE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstJpegDec:threads
+   *
+   * Number of threads that decode pictures in parallel, 0 selects the number
+   * of CPUs. Only used for packetized input like MJPEG streams, where every
+   * buffer contains a whole picture. The pictures are still pushed in the
+   * order they came in. Takes effect when going from READY to PAUSED.
+   *
+   * Since: 0.10.32
+   **/
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Number of threads decoding pictures in parallel "
+          "(0 = number of CPUs)", 0, GST_MAX_THREADS,
+          JPEG_DEFAULT_THREADS, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstJpegDec:max-in-flight
+   *
+   * Maximum number of pictures being decoded at the same time when decoding
+   * with more than one thread. Each of them adds one frame of latency.
+   * 0 allows twice as many pictures as there are threads.
+   *
+   * Since: 0.10.32
+   **/
+  g_object_class_install_property (gobject_class, PROP_MAX_IN_FLIGHT,
+      g_param_spec_uint ("max-in-flight", "Max in flight",
+          "Maximum number of pictures decoded in parallel "
+          "(0 = twice the number of threads)", 0, G_MAXUINT,
+          JPEG_DEFAULT_MAX_IN_FLIGHT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_jpeg_dec_change_state);
 
@@ -397,6 +487,51 @@ METHODDEF (void)
   longjmp (err_mgr->setjmp_buffer, 1);
 }
 
+/* The decoding threads have the whole picture in memory */
+static boolean
+gst_jpeg_dec_mem_fill_input_buffer (j_decompress_ptr cinfo)
+{
+  static const JOCTET eoi[2] = { 0xff, JPEG_EOI };
+
+  /* the picture is truncated, insert an EOI marker like jdatasrc.c does */
+  GST_DEBUG_OBJECT (CINFO_GET_JPEGDEC (cinfo), "Out of data");
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+static void
+gst_jpeg_dec_mem_skip_input_data (j_decompress_ptr cinfo, glong num_bytes)
+{
+  if (num_bytes <= 0)
+    return;
+
+  num_bytes = MIN (num_bytes, cinfo->src->bytes_in_buffer);
+  cinfo->src->next_input_byte += (size_t) num_bytes;
+  cinfo->src->bytes_in_buffer -= (size_t) num_bytes;
+}
+
+static void
+gst_jpeg_dec_context_init (GstJpegDec * dec, GstJpegDecContext * ctx)
+{
+  memset (ctx, 0, sizeof (GstJpegDecContext));
+  ctx->cinfo.err = jpeg_std_error (&ctx->jerr.pub);
+  ctx->jerr.pub.output_message = gst_jpeg_dec_my_output_message;
+  ctx->jerr.pub.emit_message = gst_jpeg_dec_my_emit_message;
+  ctx->jerr.pub.error_exit = gst_jpeg_dec_my_error_exit;
+
+  jpeg_create_decompress (&ctx->cinfo);
+
+  ctx->cinfo.src = (struct jpeg_source_mgr *) &ctx->jsrc;
+  ctx->cinfo.src->init_source = gst_jpeg_dec_init_source;
+  ctx->cinfo.src->fill_input_buffer = gst_jpeg_dec_fill_input_buffer;
+  ctx->cinfo.src->skip_input_data = gst_jpeg_dec_skip_input_data;
+  ctx->cinfo.src->resync_to_restart = gst_jpeg_dec_resync_to_restart;
+  ctx->cinfo.src->term_source = gst_jpeg_dec_term_source;
+  ctx->jsrc.dec = dec;
+}
+
 static void
 gst_jpeg_dec_init (GstJpegDec * dec)
 {
@@ -420,32 +555,27 @@ gst_jpeg_dec_init (GstJpegDec * dec)
       gst_pad_new_from_static_template (&gst_jpeg_dec_src_pad_template, "src");
   gst_pad_set_event_function (dec->srcpad,
       GST_DEBUG_FUNCPTR (gst_jpeg_dec_src_event));
+  gst_pad_set_query_function (dec->srcpad,
+      GST_DEBUG_FUNCPTR (gst_jpeg_dec_src_query));
   gst_pad_use_fixed_caps (dec->srcpad);
   gst_element_add_pad (GST_ELEMENT (dec), dec->srcpad);
 
   /* setup jpeglib */
-  memset (&dec->cinfo, 0, sizeof (dec->cinfo));
-  memset (&dec->jerr, 0, sizeof (dec->jerr));
-  dec->cinfo.err = jpeg_std_error (&dec->jerr.pub);
-  dec->jerr.pub.output_message = gst_jpeg_dec_my_output_message;
-  dec->jerr.pub.emit_message = gst_jpeg_dec_my_emit_message;
-  dec->jerr.pub.error_exit = gst_jpeg_dec_my_error_exit;
-
-  jpeg_create_decompress (&dec->cinfo);
-
-  dec->cinfo.src = (struct jpeg_source_mgr *) &dec->jsrc;
-  dec->cinfo.src->init_source = gst_jpeg_dec_init_source;
-  dec->cinfo.src->fill_input_buffer = gst_jpeg_dec_fill_input_buffer;
-  dec->cinfo.src->skip_input_data = gst_jpeg_dec_skip_input_data;
-  dec->cinfo.src->resync_to_restart = gst_jpeg_dec_resync_to_restart;
-  dec->cinfo.src->term_source = gst_jpeg_dec_term_source;
-  dec->jsrc.dec = dec;
+  gst_jpeg_dec_context_init (dec, &dec->ctx);
 
   /* init properties */
   dec->idct_method = JPEG_DEFAULT_IDCT_METHOD;
   dec->max_errors = JPEG_DEFAULT_MAX_ERRORS;
+  dec->scale = JPEG_DEFAULT_SCALE;
+  dec->scale_width = -1;
+  dec->threads = JPEG_DEFAULT_THREADS;
+  dec->max_in_flight = JPEG_DEFAULT_MAX_IN_FLIGHT;
 
   dec->adapter = gst_adapter_new ();
+  dec->frame_lock = g_mutex_new ();
+  dec->frame_cond = g_cond_new ();
+  g_queue_init (&dec->frames);
+  dec->frames_ret = GST_FLOW_OK;
 }
 
 static gboolean
@@ -758,9 +888,30 @@ gst_jpeg_dec_setcaps (GstPad * pad, GstCaps * caps)
   s = gst_caps_get_structure (caps, 0);
 
   if ((framerate = gst_structure_get_value (s, "framerate")) != NULL) {
-    dec->framerate_numerator = gst_value_get_fraction_numerator (framerate);
-    dec->framerate_denominator = gst_value_get_fraction_denominator (framerate);
+    gint num, den;
+
+    num = gst_value_get_fraction_numerator (framerate);
+    den = gst_value_get_fraction_denominator (framerate);
+
+    /* the latency of the decoding threads depends on the framerate */
+    if (dec->pool && num * dec->framerate_denominator !=
+        den * dec->framerate_numerator)
+      gst_element_post_message (GST_ELEMENT (dec),
+          gst_message_new_latency (GST_OBJECT (dec)));
+
+    dec->framerate_numerator = num;
+    dec->framerate_denominator = den;
     dec->packetized = TRUE;
+
+    /* every picture in flight delays the output by one frame, the latency
+     * query reads this from the application thread */
+    GST_OBJECT_LOCK (dec);
+    if (dec->pool && num > 0)
+      dec->latency = gst_util_uint64_scale (dec->n_in_flight * GST_SECOND,
+          den, num);
+    else
+      dec->latency = 0;
+    GST_OBJECT_UNLOCK (dec);
     GST_DEBUG ("got framerate of %d/%d fps => packetized mode",
         dec->framerate_numerator, dec->framerate_denominator);
   }
@@ -774,6 +925,56 @@ gst_jpeg_dec_setcaps (GstPad * pad, GstCaps * caps)
   return TRUE;
 }
 
+/* Replaces a width or height field of downstream caps with the range of
+ * sizes that decode to it at 1/d size */
+static gboolean
+gst_jpeg_dec_scale_up_dimension (GstStructure * s, const gchar * field, gint d)
+{
+  const GValue *val;
+  gint min, max;
+
+  val = gst_structure_get_value (s, field);
+  if (val == NULL)
+    return TRUE;
+
+  if (G_VALUE_HOLDS_INT (val)) {
+    min = max = g_value_get_int (val);
+  } else if (GST_VALUE_HOLDS_INT_RANGE (val)) {
+    min = gst_value_get_int_range_min (val);
+    max = gst_value_get_int_range_max (val);
+  } else {
+    return FALSE;
+  }
+
+  /* jpeglib rounds the scaled size up */
+  min = CLAMP (min, 1, MAX_WIDTH);
+  max = CLAMP (max, 1, MAX_WIDTH);
+  gst_structure_set (s, field, GST_TYPE_INT_RANGE, (min - 1) * d + 1, max * d,
+      NULL);
+
+  return TRUE;
+}
+
+/* Appends the caps of the pictures that can be decoded to the sizes in caps
+ * with a scaled IDCT */
+static void
+gst_jpeg_dec_append_scaled_caps (GstCaps * caps, GstCaps * sizes, gint d)
+{
+  guint i, n;
+
+  n = gst_caps_get_size (sizes);
+  for (i = 0; i < n; i++) {
+    GstStructure *s;
+
+    s = gst_structure_copy (gst_caps_get_structure (sizes, i));
+    if (gst_jpeg_dec_scale_up_dimension (s, "width", d) &&
+        gst_jpeg_dec_scale_up_dimension (s, "height", d))
+      gst_caps_append_structure (caps, s);
+    else
+      gst_structure_free (s);
+  }
+}
+
 static GstCaps *
 gst_jpeg_dec_getcaps (GstPad * pad)
 {
@@ -805,6 +1006,23 @@ gst_jpeg_dec_getcaps (GstPad * pad)
       gst_structure_set_name (s, "image/jpeg");
     }
 
+    /* with a scaled IDCT bigger pictures are decoded to the sizes
+     * downstream accepts */
+    if (dec->scale == GST_JPEG_DEC_SCALE_AUTO) {
+      GstCaps *sizes = gst_caps_copy (peer_caps);
+      gint d;
+
+      for (d = GST_JPEG_DEC_SCALE_HALF; d <= GST_JPEG_DEC_SCALE_EIGHTH; d *= 2)
+        gst_jpeg_dec_append_scaled_caps (peer_caps, sizes, d);
+      gst_caps_unref (sizes);
+    } else if (dec->scale != GST_JPEG_DEC_SCALE_FULL) {
+      GstCaps *sizes = peer_caps;
+
+      peer_caps = gst_caps_new_empty ();
+      gst_jpeg_dec_append_scaled_caps (peer_caps, sizes, dec->scale);
+      gst_caps_unref (sizes);
+    }
+
     templ_caps = gst_pad_get_pad_template_caps (pad);
     caps = gst_caps_intersect_full (peer_caps, templ_caps,
         GST_CAPS_INTERSECT_FIRST);
@@ -834,68 +1052,133 @@ hresamplecpy1 (guint8 * dest, const guint8 * src, guint len)
 }
 
 static void
-gst_jpeg_dec_free_buffers (GstJpegDec * dec)
+gst_jpeg_dec_free_buffers (GstJpegDecContext * ctx)
 {
   gint i;
 
+  g_free (ctx->idr_block);
+  ctx->idr_block = NULL;
+
   for (i = 0; i < 16; i++) {
-    g_free (dec->idr_y[i]);
-    g_free (dec->idr_u[i]);
-    g_free (dec->idr_v[i]);
-    dec->idr_y[i] = NULL;
-    dec->idr_u[i] = NULL;
-    dec->idr_v[i] = NULL;
+    ctx->idr_y[i] = NULL;
+    ctx->idr_u[i] = NULL;
+    ctx->idr_v[i] = NULL;
   }
 
-  dec->idr_width_allocated = 0;
+  ctx->idr_width_allocated = 0;
+}
+
+static GstJpegDecContext *
+gst_jpeg_dec_context_new (GstJpegDec * dec)
+{
+  GstJpegDecContext *ctx;
+
+  ctx = g_slice_new (GstJpegDecContext);
+  gst_jpeg_dec_context_init (dec, ctx);
+  ctx->cinfo.src->fill_input_buffer = gst_jpeg_dec_mem_fill_input_buffer;
+  ctx->cinfo.src->skip_input_data = gst_jpeg_dec_mem_skip_input_data;
+
+  return ctx;
+}
+
+static void
+gst_jpeg_dec_context_free (GstJpegDecContext * ctx)
+{
+  jpeg_destroy_decompress (&ctx->cinfo);
+  gst_jpeg_dec_free_buffers (ctx);
+  g_slice_free (GstJpegDecContext, ctx);
 }
 
 static inline gboolean
-gst_jpeg_dec_ensure_buffers (GstJpegDec * dec, guint maxrowbytes)
+gst_jpeg_dec_ensure_buffers (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guint maxrowbytes)
 {
   gint i;
 
-  if (G_LIKELY (dec->idr_width_allocated == maxrowbytes))
+  if (G_LIKELY (ctx->idr_width_allocated == maxrowbytes))
     return TRUE;
 
-  /* FIXME: maybe just alloc one or three blocks altogether? */
-  for (i = 0; i < 16; i++) {
-    dec->idr_y[i] = g_try_realloc (dec->idr_y[i], maxrowbytes);
-    dec->idr_u[i] = g_try_realloc (dec->idr_u[i], maxrowbytes);
-    dec->idr_v[i] = g_try_realloc (dec->idr_v[i], maxrowbytes);
+  gst_jpeg_dec_free_buffers (ctx);
 
-    if (G_UNLIKELY (!dec->idr_y[i] || !dec->idr_u[i] || !dec->idr_v[i])) {
-      GST_WARNING_OBJECT (dec, "out of memory, i=%d, bytes=%u", i, maxrowbytes);
-      return FALSE;
-    }
+  /* all rows in one block, the scan arrays pointing into it are set up
+   * here once and then passed to jpeglib as they are */
+  ctx->idr_block = g_try_malloc (3 * 16 * maxrowbytes);
+  if (G_UNLIKELY (!ctx->idr_block)) {
+    GST_WARNING_OBJECT (dec, "out of memory, bytes=%u", 3 * 16 * maxrowbytes);
+    return FALSE;
   }
 
-  dec->idr_width_allocated = maxrowbytes;
+  for (i = 0; i < 16; i++) {
+    ctx->idr_y[i] = ctx->idr_block + i * maxrowbytes;
+    ctx->idr_u[i] = ctx->idr_block + (16 + i) * maxrowbytes;
+    ctx->idr_v[i] = ctx->idr_block + (32 + i) * maxrowbytes;
+  }
+
+  ctx->idr_width_allocated = maxrowbytes;
   GST_LOG_OBJECT (dec, "allocated temp memory, %u bytes/row", maxrowbytes);
   return TRUE;
 }
 
+/* GRAY8 without extra padding, jpeglib writes whole lines into the output
+ * buffer. Lines below the picture go to a scratch row */
 static void
-gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, guchar * base[1],
-    guint width, guint height, guint pstride, guint rstride)
+gst_jpeg_dec_decode_grayscale_direct (GstJpegDec * dec,
+    GstJpegDecContext * ctx, guchar * base, guint width, guint height,
+    guint rstride)
 {
-  guchar *rows[16];
+  guchar *rows[2 * DCTSIZE];
   guchar **scanarray[1] = { rows };
+  guchar *last;
+  gint i, j, n;
+
+  GST_DEBUG_OBJECT (dec, "decoding grayscale directly into output buffer");
+
+  n = ctx->cinfo.max_v_samp_factor *
+      COMP_DCT_V_SIZE (&ctx->cinfo.comp_info[0]);
+  last = base + (height - 1) * rstride;
+
+  for (i = 0; i < height; i += n) {
+    for (j = 0; j < n; j++) {
+      rows[j] = base + (i + j) * rstride;
+      if (G_UNLIKELY (rows[j] > last))
+        rows[j] = ctx->idr_y[0];
+    }
+    if (G_UNLIKELY (!jpeg_read_raw_data (&ctx->cinfo, scanarray, n)))
+      GST_INFO_OBJECT (dec, "jpeg_read_raw_data() returned 0");
+  }
+}
+
+static void
+gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guchar * base[1], guint width, guint height, guint pstride, guint rstride)
+{
+  guchar **rows;
+  guchar **scanarray[1];
   gint i, j, k;
   gint lines;
 
-  GST_DEBUG_OBJECT (dec, "indirect decoding of grayscale");
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
+    return;
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (pstride == 1 && ctx->cinfo.max_v_samp_factor <= 2 &&
+      width % COMP_DCT_H_SIZE (&ctx->cinfo.comp_info[0]) == 0) {
+    gst_jpeg_dec_decode_grayscale_direct (dec, ctx, base[0], width, height,
+        rstride);
     return;
+  }
+
+  GST_DEBUG_OBJECT (dec, "indirect decoding of grayscale");
 
-  memcpy (rows, dec->idr_y, 16 * sizeof (gpointer));
+  rows = ctx->idr_y;
+  scanarray[0] = rows;
 
   i = 0;
   while (i < height) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
+    /* fewer lines than requested with a scaled IDCT */
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
-      for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
+      for (j = 0; (j < lines) && (i < height); j++, i++) {
         gint p;
 
         p = 0;
@@ -912,28 +1195,30 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, guchar * base[1],
 }
 
 static void
-gst_jpeg_dec_decode_rgb (GstJpegDec * dec, guchar * base[3],
-    guint width, guint height, guint pstride, guint rstride)
+gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guchar * base[3], guint width, guint height, guint pstride, guint rstride)
 {
-  guchar *r_rows[16], *g_rows[16], *b_rows[16];
-  guchar **scanarray[3] = { r_rows, g_rows, b_rows };
+  guchar **r_rows, **g_rows, **b_rows;
+  guchar **scanarray[3];
   gint i, j, k;
   gint lines;
 
   GST_DEBUG_OBJECT (dec, "indirect decoding of RGB");
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
     return;
 
-  memcpy (r_rows, dec->idr_y, 16 * sizeof (gpointer));
-  memcpy (g_rows, dec->idr_u, 16 * sizeof (gpointer));
-  memcpy (b_rows, dec->idr_v, 16 * sizeof (gpointer));
+  scanarray[0] = r_rows = ctx->idr_y;
+  scanarray[1] = g_rows = ctx->idr_u;
+  scanarray[2] = b_rows = ctx->idr_v;
 
   i = 0;
   while (i < height) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
+    /* fewer lines than requested with a scaled IDCT */
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
-      for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
+      for (j = 0; (j < lines) && (i < height); j++, i++) {
         gint p;
 
         p = 0;
@@ -953,38 +1238,42 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, guchar * base[3],
   }
 }
 
+/* r_v and r_h are the ratios between the luma and chroma lines and columns
+ * jpeglib outputs, rows the number of luma lines it outputs at once */
 static void
-gst_jpeg_dec_decode_indirect (GstJpegDec * dec, guchar * base[3],
-    guchar * last[3], guint width, guint height, gint r_v, gint r_h, gint comp)
+gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guchar * base[3], guchar * last[3], guint width, guint height, gint r_v,
+    gint r_h, gint rows, gint comp)
 {
-  guchar *y_rows[16], *u_rows[16], *v_rows[16];
-  guchar **scanarray[3] = { y_rows, u_rows, v_rows };
+  guchar **y_rows, **u_rows, **v_rows;
+  guchar **scanarray[3];
   gint i, j, k;
   gint lines;
 
   GST_DEBUG_OBJECT (dec,
       "unadvantageous width or r_h, taking slow route involving memcpy");
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
     return;
 
-  memcpy (y_rows, dec->idr_y, 16 * sizeof (gpointer));
-  memcpy (u_rows, dec->idr_u, 16 * sizeof (gpointer));
-  memcpy (v_rows, dec->idr_v, 16 * sizeof (gpointer));
+  scanarray[0] = y_rows = ctx->idr_y;
+  scanarray[1] = u_rows = ctx->idr_u;
+  scanarray[2] = v_rows = ctx->idr_v;
 
   /* fill chroma components for grayscale */
   if (comp == 1) {
     GST_DEBUG_OBJECT (dec, "grayscale, filling chroma");
     for (i = 0; i < 16; i++) {
-      memset (u_rows[i], GST_ROUND_UP_32 (width), 0x80);
-      memset (v_rows[i], GST_ROUND_UP_32 (width), 0x80);
+      memset (u_rows[i], 0x80, GST_ROUND_UP_32 (width));
+      memset (v_rows[i], 0x80, GST_ROUND_UP_32 (width));
     }
   }
 
-  for (i = 0; i < height; i += r_v * DCTSIZE) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, r_v * DCTSIZE);
+  for (i = 0; i < height; i += rows) {
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, rows);
     if (G_LIKELY (lines > 0)) {
-      for (j = 0, k = 0; j < (r_v * DCTSIZE); j += r_v, k++) {
+      for (j = 0, k = 0; j < rows; j += r_v, k++) {
         if (G_LIKELY (base[0] <= last[0])) {
           memcpy (base[0], y_rows[j], I420_Y_ROWSTRIDE (width));
           base[0] += I420_Y_ROWSTRIDE (width);
@@ -1007,7 +1296,8 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, guchar * base[3],
           }
         }
 
-        if (r_v == 2 || (k & 1) != 0) {
+        /* with a 1/8 IDCT there may be a single line per call */
+        if (r_v == 2 || ((i + j) & 1) != 0) {
           base[1] += I420_U_ROWSTRIDE (width);
           base[2] += I420_V_ROWSTRIDE (width);
         }
@@ -1036,70 +1326,105 @@ dump_lines (guchar * base[3], guchar ** line[3], int v_samp0, int width)
 }
 #endif
 
+/* Luma, and chroma with r_h == 2, are decoded into the output buffer
+ * directly. Full width chroma goes through the scratch rows to be subsampled
+ * horizontally. Lines below the picture are sent to a scratch row so the
+ * padding jpeglib outputs doesn't overwrite the last lines */
 static GstFlowReturn
-gst_jpeg_dec_decode_direct (GstJpegDec * dec, guchar * base[3],
-    guchar * last[3], guint width, guint height)
+gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guchar * base[3], guchar * last[3], guint width, guint height, gint r_v,
+    gint r_h, gint rows)
 {
   guchar **line[3];             /* the jpeg line buffer         */
   guchar *y[4 * DCTSIZE] = { NULL, };   /* alloc enough for the lines   */
   guchar *u[4 * DCTSIZE] = { NULL, };   /* r_v will be <4               */
   guchar *v[4 * DCTSIZE] = { NULL, };
-  gint i, j;
+  guchar *trash;
+  gint i, j, k;
   gint lines, v_samp[3];
 
   line[0] = y;
   line[1] = u;
   line[2] = v;
 
-  v_samp[0] = dec->cinfo.comp_info[0].v_samp_factor;
-  v_samp[1] = dec->cinfo.comp_info[1].v_samp_factor;
-  v_samp[2] = dec->cinfo.comp_info[2].v_samp_factor;
+  v_samp[0] = ctx->cinfo.comp_info[0].v_samp_factor;
+  v_samp[1] = ctx->cinfo.comp_info[1].v_samp_factor;
+  v_samp[2] = ctx->cinfo.comp_info[2].v_samp_factor;
 
   if (G_UNLIKELY (v_samp[0] > 2 || v_samp[1] > 2 || v_samp[2] > 2))
     goto format_not_supported;
 
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
+    return GST_FLOW_ERROR;
+
+  /* the luma scratch rows are unused here */
+  trash = ctx->idr_y[0];
+
   /* let jpeglib decode directly into our final buffer */
   GST_DEBUG_OBJECT (dec, "decoding directly into output buffer");
 
-  for (i = 0; i < height; i += v_samp[0] * DCTSIZE) {
-    for (j = 0; j < (v_samp[0] * DCTSIZE); ++j) {
-      /* Y */
+  for (i = 0; i < height; i += rows) {
+    for (j = 0; j < rows; ++j) {
       line[0][j] = base[0] + (i + j) * I420_Y_ROWSTRIDE (width);
       if (G_UNLIKELY (line[0][j] > last[0]))
-        line[0][j] = last[0];
-      /* U */
-      if (v_samp[1] == v_samp[0]) {
-        line[1][j] = base[1] + ((i + j) / 2) * I420_U_ROWSTRIDE (width);
-      } else if (j < (v_samp[1] * DCTSIZE)) {
-        line[1][j] = base[1] + ((i / 2) + j) * I420_U_ROWSTRIDE (width);
+        line[0][j] = trash;
+    }
+    for (j = 0; j < rows / r_v; ++j) {
+      if (r_h == 1) {
+        line[1][j] = ctx->idr_u[j];
+        line[2][j] = ctx->idr_v[j];
+        continue;
       }
-      if (G_UNLIKELY (line[1][j] > last[1]))
-        line[1][j] = last[1];
-      /* V */
-      if (v_samp[2] == v_samp[0]) {
-        line[2][j] = base[2] + ((i + j) / 2) * I420_V_ROWSTRIDE (width);
-      } else if (j < (v_samp[2] * DCTSIZE)) {
-        line[2][j] = base[2] + ((i / 2) + j) * I420_V_ROWSTRIDE (width);
+      /* with r_v == 1 the odd line overwrites the even one before it */
+      k = (r_v == 2) ? (i / 2) + j : (i + j) / 2;
+      line[1][j] = base[1] + k * I420_U_ROWSTRIDE (width);
+      line[2][j] = base[2] + k * I420_V_ROWSTRIDE (width);
+      if (G_UNLIKELY (line[1][j] > last[1] || (r_v == 1 && i + j >= height))) {
+        line[1][j] = trash;
+        line[2][j] = trash;
       }
-      if (G_UNLIKELY (line[2][j] > last[2]))
-        line[2][j] = last[2];
     }
 
     /* dump_lines (base, line, v_samp[0], width); */
 
-    lines = jpeg_read_raw_data (&dec->cinfo, line, v_samp[0] * DCTSIZE);
+    lines = jpeg_read_raw_data (&ctx->cinfo, line, rows);
     if (G_UNLIKELY (!lines)) {
       GST_INFO_OBJECT (dec, "jpeg_read_raw_data() returned 0");
+      continue;
+    }
+
+    if (r_h == 2)
+      continue;
+
+    for (j = 0; j < rows / r_v; ++j) {
+      guchar *u_out, *v_out;
+
+      if (r_v == 2) {
+        k = (i / 2) + j;
+      } else {
+        /* skip even lines that the next line replaces anyway */
+        if (i + j >= height || (((i + j) & 1) == 0 && i + j + 1 < height))
+          continue;
+        k = (i + j) / 2;
+      }
+      u_out = base[1] + k * I420_U_ROWSTRIDE (width);
+      v_out = base[2] + k * I420_V_ROWSTRIDE (width);
+      if (G_UNLIKELY (u_out > last[1]))
+        break;
+      hresamplecpy1 (u_out, ctx->idr_u[j], I420_U_ROWSTRIDE (width));
+      hresamplecpy1 (v_out, ctx->idr_v[j], I420_V_ROWSTRIDE (width));
     }
   }
   return GST_FLOW_OK;
 
 format_not_supported:
   {
-    gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__,
+    /* may run in a decoding thread, the caller sets the error */
+    GST_WARNING_OBJECT (dec,
         "Unsupported subsampling schema: v_samp factors: %u %u %u",
         v_samp[0], v_samp[1], v_samp[2]);
-    return GST_FLOW_ERROR;
+    return GST_FLOW_NOT_SUPPORTED;
   }
 }
 
@@ -1205,7 +1530,7 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
   }
   GST_OBJECT_UNLOCK (dec);
 
-  if (dec->cinfo.jpeg_color_space == JCS_RGB) {
+  if (dec->ctx.cinfo.jpeg_color_space == JCS_RGB) {
     gint i;
     GstCaps *allowed_caps;
 
@@ -1256,7 +1581,7 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
     /* equal for all components */
     dec->stride = gst_video_format_get_row_stride (format, 0, width);
     dec->inc = gst_video_format_get_pixel_stride (format, 0);
-  } else if (dec->cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+  } else if (dec->ctx.cinfo.jpeg_color_space == JCS_GRAYSCALE) {
     /* TODO is anything else then 8bit supported in jpeg? */
     format = GST_VIDEO_FORMAT_GRAY8;
     caps = gst_video_format_new_caps (format, width, height,
@@ -1278,8 +1603,10 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
   }
 
   GST_DEBUG_OBJECT (dec, "setting caps %" GST_PTR_FORMAT, caps);
-  GST_DEBUG_OBJECT (dec, "max_v_samp_factor=%d", dec->cinfo.max_v_samp_factor);
-  GST_DEBUG_OBJECT (dec, "max_h_samp_factor=%d", dec->cinfo.max_h_samp_factor);
+  GST_DEBUG_OBJECT (dec, "max_v_samp_factor=%d",
+      dec->ctx.cinfo.max_v_samp_factor);
+  GST_DEBUG_OBJECT (dec, "max_h_samp_factor=%d",
+      dec->ctx.cinfo.max_h_samp_factor);
 
   gst_pad_set_caps (dec->srcpad, caps);
   gst_caps_unref (caps);
@@ -1290,6 +1617,434 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
   dec->caps_framerate_denominator = dec->framerate_denominator;
 }
 
+/* Returns the largest of the supported scale factors that results in a size
+ * downstream requires exactly, or 1 */
+static gint
+gst_jpeg_dec_get_auto_scale (GstJpegDec * dec, gint width, gint height)
+{
+  GstCaps *caps;
+  gint i, d, scale = 1;
+
+  caps = gst_pad_peer_get_caps (dec->srcpad);
+  if (caps == NULL)
+    return 1;
+
+  for (i = 0; i < gst_caps_get_size (caps) && scale == 1; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+    gint w, h;
+
+    /* ranges tell us nothing, any size is accepted then */
+    if (!gst_structure_get_int (s, "width", &w) ||
+        !gst_structure_get_int (s, "height", &h))
+      continue;
+
+    for (d = GST_JPEG_DEC_SCALE_EIGHTH; d > 1; d /= 2) {
+      /* jpeglib rounds the scaled size up */
+      if (w == (width + d - 1) / d && h == (height + d - 1) / d) {
+        scale = d;
+        break;
+      }
+    }
+  }
+  gst_caps_unref (caps);
+
+  return scale;
+}
+
+/* Returns the denominator of the scale factor to decode the current picture
+ * with */
+static gint
+gst_jpeg_dec_get_scale (GstJpegDec * dec)
+{
+  gint width = dec->ctx.cinfo.image_width;
+  gint height = dec->ctx.cinfo.image_height;
+
+  if (dec->scale != GST_JPEG_DEC_SCALE_AUTO)
+    return dec->scale;
+
+  /* only ask downstream again when the picture size changes */
+  if (width != dec->scale_width || height != dec->scale_height) {
+    dec->auto_scale = gst_jpeg_dec_get_auto_scale (dec, width, height);
+    dec->scale_width = width;
+    dec->scale_height = height;
+    GST_DEBUG_OBJECT (dec, "decoding %dx%d pictures at 1/%d size", width,
+        height, dec->auto_scale);
+  }
+
+  return dec->auto_scale;
+}
+
+static void
+gst_jpeg_dec_prepare_raw_output (GstJpegDecContext * ctx, gint idct_method,
+    gint scale)
+{
+  ctx->cinfo.do_fancy_upsampling = FALSE;
+  ctx->cinfo.do_block_smoothing = FALSE;
+  ctx->cinfo.out_color_space = ctx->cinfo.jpeg_color_space;
+  ctx->cinfo.dct_method = idct_method;
+  ctx->cinfo.raw_data_out = TRUE;
+  ctx->cinfo.scale_num = 1;
+  ctx->cinfo.scale_denom = scale;
+}
+
+static inline gboolean
+gst_jpeg_dec_same_sampling (jpeg_component_info * a, jpeg_component_info * b)
+{
+  return a->h_samp_factor == b->h_samp_factor &&
+      a->v_samp_factor == b->v_samp_factor &&
+      COMP_DCT_H_SIZE (a) == COMP_DCT_H_SIZE (b) &&
+      COMP_DCT_V_SIZE (a) == COMP_DCT_V_SIZE (b);
+}
+
+/* Decodes the picture ctx has started decompressing into outdata, which has
+ * the layout given by offset, stride and inc for RGB and grayscale or I420.
+ * Runs in the streaming thread or in one of the decoding threads */
+static GstFlowReturn
+gst_jpeg_dec_decode_picture (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guchar * outdata, const gint offset[3], gint stride, gint inc)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  guchar *base[3], *last[3];
+  gint width, height;
+  gint r_h, r_v;
+  gint y_rows, y_cols, c_rows, c_cols;
+
+  width = ctx->cinfo.output_width;
+  height = ctx->cinfo.output_height;
+  r_h = ctx->cinfo.comp_info[0].h_samp_factor;
+  r_v = ctx->cinfo.comp_info[0].v_samp_factor;
+
+  if (ctx->cinfo.jpeg_color_space == JCS_RGB) {
+    base[0] = outdata + offset[0];
+    base[1] = outdata + offset[1];
+    base[2] = outdata + offset[2];
+    gst_jpeg_dec_decode_rgb (dec, ctx, base, width, height, inc, stride);
+  } else if (ctx->cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+    base[0] = outdata + offset[0];
+    gst_jpeg_dec_decode_grayscale (dec, ctx, base, width, height, inc, stride);
+  } else {
+    /* mind the swap, jpeglib outputs blue chroma first
+     * ensonic: I see no swap?
+     */
+    base[0] = outdata + I420_Y_OFFSET (width, height);
+    base[1] = outdata + I420_U_OFFSET (width, height);
+    base[2] = outdata + I420_V_OFFSET (width, height);
+
+    /* make sure we don't make jpeglib write beyond our buffer,
+     * which might happen if (height % (r_v*DCTSIZE)) != 0 */
+    last[0] = base[0] + (I420_Y_ROWSTRIDE (width) * (height - 1));
+    last[1] =
+        base[1] + (I420_U_ROWSTRIDE (width) * ((GST_ROUND_UP_2 (height) / 2) -
+            1));
+    last[2] =
+        base[2] + (I420_V_ROWSTRIDE (width) * ((GST_ROUND_UP_2 (height) / 2) -
+            1));
+
+    GST_LOG_OBJECT (dec, "decompressing (reqired scanline buffer height = %u)",
+        ctx->cinfo.rec_outbuf_height);
+
+    /* Lines and columns jpeglib outputs per iMCU for luma and chroma. With
+     * a scaled IDCT it may scale chroma less than luma, which changes the
+     * subsampling of the output */
+    y_rows = r_v * COMP_DCT_V_SIZE (&ctx->cinfo.comp_info[0]);
+    y_cols = r_h * COMP_DCT_H_SIZE (&ctx->cinfo.comp_info[0]);
+    c_rows = ctx->cinfo.comp_info[1].v_samp_factor *
+        COMP_DCT_V_SIZE (&ctx->cinfo.comp_info[1]);
+    c_cols = ctx->cinfo.comp_info[1].h_samp_factor *
+        COMP_DCT_H_SIZE (&ctx->cinfo.comp_info[1]);
+
+    /* For some widths jpeglib requires more horizontal padding than I420 
+     * provides. In those cases we need to decode into separate buffers and then
+     * copy over the data into our final picture buffer, otherwise jpeglib might
+     * write over the end of a line into the beginning of the next line,
+     * resulting in blocky artifacts on the left side of the picture. The same
+     * goes for subsampling we can't convert to I420 line by line. */
+    if (G_UNLIKELY (width % y_cols != 0
+            || ctx->cinfo.num_components != 3
+            || (y_cols != c_cols && y_cols != 2 * c_cols)
+            || (y_rows != c_rows && y_rows != 2 * c_rows)
+            || !gst_jpeg_dec_same_sampling (&ctx->cinfo.comp_info[1],
+                &ctx->cinfo.comp_info[2]))) {
+      GST_CAT_LOG_OBJECT (GST_CAT_PERFORMANCE, dec,
+          "indirect decoding using extra buffer copy");
+      gst_jpeg_dec_decode_indirect (dec, ctx, base, last, width, height,
+          y_rows / c_rows, y_cols / c_cols, y_rows, ctx->cinfo.num_components);
+    } else {
+      ret = gst_jpeg_dec_decode_direct (dec, ctx, base, last, width, height,
+          y_rows / c_rows, y_cols / c_cols, y_rows);
+    }
+  }
+
+  return ret;
+}
+
+/* Clips the timestamps of outbuf to the segment, returns FALSE if it is
+ * completely outside */
+static gboolean
+gst_jpeg_dec_clip_buffer (GstJpegDec * dec, GstBuffer * outbuf)
+{
+  gint64 start, stop, clip_start, clip_stop;
+
+  if (dec->segment.format != GST_FORMAT_TIME)
+    return TRUE;
+
+  GST_LOG_OBJECT (dec, "Attempting clipping");
+
+  start = GST_BUFFER_TIMESTAMP (outbuf);
+  if (GST_BUFFER_DURATION (outbuf) == GST_CLOCK_TIME_NONE)
+    stop = start;
+  else
+    stop = start + GST_BUFFER_DURATION (outbuf);
+
+  if (!gst_segment_clip (&dec->segment, GST_FORMAT_TIME,
+          start, stop, &clip_start, &clip_stop))
+    return FALSE;
+
+  GST_LOG_OBJECT (dec, "Clipping start to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (clip_start));
+  GST_BUFFER_TIMESTAMP (outbuf) = clip_start;
+  if (GST_BUFFER_DURATION (outbuf) != GST_CLOCK_TIME_NONE) {
+    GST_LOG_OBJECT (dec, "Clipping duration to %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (clip_stop - clip_start));
+    GST_BUFFER_DURATION (outbuf) = clip_stop - clip_start;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_jpeg_dec_frame_free (GstJpegDecFrame * frame)
+{
+  gst_buffer_unref (frame->input);
+  if (frame->output)
+    gst_buffer_unref (frame->output);
+  g_free (frame->error_msg);
+  g_slice_free (GstJpegDecFrame, frame);
+}
+
+/* Decodes a queued picture with one of the idle decompressors, in a decoding
+ * thread */
+static void
+gst_jpeg_dec_decode_frame (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstJpegDecFrame * frame)
+{
+  ctx->cinfo.src->next_input_byte = GST_BUFFER_DATA (frame->input);
+  ctx->cinfo.src->bytes_in_buffer = GST_BUFFER_SIZE (frame->input);
+
+  if (setjmp (ctx->jerr.setjmp_buffer)) {
+    gchar err_msg[JMSG_LENGTH_MAX];
+
+    ctx->jerr.pub.format_message ((j_common_ptr) (&ctx->cinfo), err_msg);
+    frame->error_msg = g_strdup_printf ("Decode error #%u: %s",
+        ctx->jerr.pub.msg_code, err_msg);
+    frame->ret = GST_FLOW_ERROR;
+    jpeg_abort_decompress (&ctx->cinfo);
+    return;
+  }
+
+  /* the header was already checked in the streaming thread */
+  jpeg_read_header (&ctx->cinfo, TRUE);
+  gst_jpeg_dec_prepare_raw_output (ctx, frame->idct_method, frame->scale);
+  guarantee_huff_tables (&ctx->cinfo);
+  jpeg_start_decompress (&ctx->cinfo);
+
+  frame->ret = gst_jpeg_dec_decode_picture (dec, ctx,
+      GST_BUFFER_DATA (frame->output), frame->offset, frame->stride,
+      frame->inc);
+  if (G_UNLIKELY (frame->ret != GST_FLOW_OK)) {
+    frame->error_msg = g_strdup ("Unsupported subsampling schema");
+    frame->ret = GST_FLOW_ERROR;
+    jpeg_abort_decompress (&ctx->cinfo);
+    return;
+  }
+
+  jpeg_finish_decompress (&ctx->cinfo);
+}
+
+/* Pushes the decoded pictures at the head of the queue in order, from
+ * whichever thread finished one. Called with frame_lock, only one thread
+ * pushes at a time. Pictures that failed to decode are left to the
+ * streaming thread, which owns the error state. */
+static void
+gst_jpeg_dec_push_decoded (GstJpegDec * dec)
+{
+  GstJpegDecFrame *frame;
+  GstFlowReturn ret;
+
+  if (dec->pushing)
+    return;
+  dec->pushing = TRUE;
+
+  while ((frame = g_queue_peek_head (&dec->frames)) != NULL && frame->done &&
+      frame->ret == GST_FLOW_OK) {
+    g_queue_pop_head (&dec->frames);
+
+    /* drop the following pictures if downstream doesn't want them */
+    if (dec->frames_ret != GST_FLOW_OK) {
+      g_mutex_unlock (dec->frame_lock);
+      gst_jpeg_dec_frame_free (frame);
+      g_mutex_lock (dec->frame_lock);
+      continue;
+    }
+    g_mutex_unlock (dec->frame_lock);
+
+    GST_LOG_OBJECT (dec, "pushing buffer (ts=%" GST_TIME_FORMAT ", dur=%"
+        GST_TIME_FORMAT, GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (frame->output)),
+        GST_TIME_ARGS (GST_BUFFER_DURATION (frame->output)));
+
+    ret = gst_pad_push (dec->srcpad, frame->output);
+    frame->output = NULL;
+    gst_jpeg_dec_frame_free (frame);
+
+    g_mutex_lock (dec->frame_lock);
+    if (ret == GST_FLOW_OK)
+      dec->frames_pushed++;
+    else
+      dec->frames_ret = ret;
+  }
+
+  dec->pushing = FALSE;
+  g_cond_broadcast (dec->frame_cond);
+}
+
+static void
+gst_jpeg_dec_decode_worker (gpointer data, gpointer user_data)
+{
+  GstJpegDec *dec = user_data;
+  GstJpegDecFrame *frame = data;
+  GstJpegDecContext *ctx;
+
+  /* there is one decompressor per thread */
+  ctx = g_async_queue_pop (dec->contexts);
+  gst_jpeg_dec_decode_frame (dec, ctx, frame);
+  g_async_queue_push (dec->contexts, ctx);
+
+  g_mutex_lock (dec->frame_lock);
+  frame->done = TRUE;
+  /* don't wait for the next input buffer, a live source might not send
+   * one for a while */
+  gst_jpeg_dec_push_decoded (dec);
+  g_cond_broadcast (dec->frame_cond);
+  g_mutex_unlock (dec->frame_lock);
+}
+
+/* Hands a picture to the decoding threads, takes ownership of the buffers */
+static void
+gst_jpeg_dec_queue_frame (GstJpegDec * dec, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstJpegDecFrame *frame;
+
+  frame = g_slice_new0 (GstJpegDecFrame);
+  frame->input = inbuf;
+  frame->output = outbuf;
+  frame->idct_method = dec->ctx.cinfo.dct_method;
+  frame->scale = dec->ctx.cinfo.scale_denom;
+  memcpy (frame->offset, dec->offset, sizeof (dec->offset));
+  frame->stride = dec->stride;
+  frame->inc = dec->inc;
+  frame->ret = GST_FLOW_OK;
+
+  g_mutex_lock (dec->frame_lock);
+  g_queue_push_tail (&dec->frames, frame);
+  g_mutex_unlock (dec->frame_lock);
+
+  g_thread_pool_push (dec->pool, frame, NULL);
+}
+
+/* Accounts for the pictures the decoding threads pushed, called with
+ * frame_lock from the streaming thread */
+static void
+gst_jpeg_dec_update_counts (GstJpegDec * dec)
+{
+  if (dec->frames_pushed == 0)
+    return;
+
+  /* reset error count on successful decode */
+  dec->error_count = 0;
+
+  dec->good_count += dec->frames_pushed;
+  dec->frames_pushed = 0;
+}
+
+/* Waits for the decoding threads until at most max_frames pictures are left
+ * in flight, pushing decoded pictures in the order they were queued and
+ * handling the errors of the ones that failed. Called from the streaming
+ * thread. */
+static GstFlowReturn
+gst_jpeg_dec_push_frames (GstJpegDec * dec, guint max_frames)
+{
+  GstJpegDecFrame *frame;
+  GstFlowReturn ret;
+
+  g_mutex_lock (dec->frame_lock);
+  for (;;) {
+    frame = g_queue_peek_head (&dec->frames);
+
+    if (frame && frame->done && !dec->pushing) {
+      if (frame->ret == GST_FLOW_OK) {
+        gst_jpeg_dec_push_decoded (dec);
+        continue;
+      }
+
+      g_queue_pop_head (&dec->frames);
+      gst_jpeg_dec_update_counts (dec);
+      ret = dec->frames_ret;
+      g_mutex_unlock (dec->frame_lock);
+
+      if (ret == GST_FLOW_OK) {
+        gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__, "%s",
+            frame->error_msg);
+        ret = gst_jpeg_dec_post_error_or_warning (dec);
+      }
+      gst_jpeg_dec_frame_free (frame);
+
+      g_mutex_lock (dec->frame_lock);
+      if (dec->frames_ret == GST_FLOW_OK)
+        dec->frames_ret = ret;
+      continue;
+    }
+
+    /* with nothing left in flight, also wait for the last push to finish
+     * so that events can't overtake it */
+    if (g_queue_get_length (&dec->frames) <= max_frames &&
+        (max_frames > 0 || !dec->pushing))
+      break;
+
+    g_cond_wait (dec->frame_cond, dec->frame_lock);
+  }
+  gst_jpeg_dec_update_counts (dec);
+  /* the following pictures are tried again */
+  ret = dec->frames_ret;
+  dec->frames_ret = GST_FLOW_OK;
+  g_mutex_unlock (dec->frame_lock);
+
+  return ret;
+}
+
+/* Waits for the decoding threads and drops all queued pictures */
+static void
+gst_jpeg_dec_flush_frames (GstJpegDec * dec)
+{
+  GstJpegDecFrame *frame;
+  GQueue frames;
+
+  g_mutex_lock (dec->frame_lock);
+  /* take all pictures at once so the decoding threads can't push any */
+  frames = dec->frames;
+  g_queue_init (&dec->frames);
+  while ((frame = g_queue_pop_head (&frames)) != NULL) {
+    while (!frame->done)
+      g_cond_wait (dec->frame_cond, dec->frame_lock);
+    gst_jpeg_dec_frame_free (frame);
+  }
+  while (dec->pushing)
+    g_cond_wait (dec->frame_cond, dec->frame_lock);
+  dec->frames_ret = GST_FLOW_OK;
+  dec->frames_pushed = 0;
+  g_mutex_unlock (dec->frame_lock);
+}
+
 static GstFlowReturn
 gst_jpeg_dec_chain (GstPad * pad, GstBuffer * buf)
 {
@@ -1299,8 +2054,8 @@ gst_jpeg_dec_chain (GstPad * pad, GstBuffer * buf)
 #ifndef GST_DISABLE_GST_DEBUG
   guchar *data;
 #endif
+  GstBuffer *inbuf = NULL;
   guchar *outdata;
-  guchar *base[3], *last[3];
   gint img_len;
   guint outsize;
   gint width, height;
@@ -1377,10 +2132,19 @@ again:
       data[2], data[3]);
 #endif
 
-  gst_jpeg_dec_fill_input_buffer (&dec->cinfo);
+  if (dec->pool && dec->packetized) {
+    /* the decoding threads get the whole picture, here we only read the
+     * header to negotiate and allocate the output buffer */
+    inbuf = gst_adapter_take_buffer (dec->adapter, img_len);
+    dec->rem_img_len = 0;
+    dec->ctx.cinfo.src->next_input_byte = GST_BUFFER_DATA (inbuf);
+    dec->ctx.cinfo.src->bytes_in_buffer = GST_BUFFER_SIZE (inbuf);
+  } else {
+    gst_jpeg_dec_fill_input_buffer (&dec->ctx.cinfo);
+  }
 
-  if (setjmp (dec->jerr.setjmp_buffer)) {
-    code = dec->jerr.pub.msg_code;
+  if (setjmp (dec->ctx.jerr.setjmp_buffer)) {
+    code = dec->ctx.jerr.pub.msg_code;
 
     if (code == JERR_INPUT_EOF) {
       GST_DEBUG ("jpeg input EOF error, we probably need more data");
@@ -1390,74 +2154,81 @@ again:
   }
 
   /* read header */
-  hdr_ok = jpeg_read_header (&dec->cinfo, TRUE);
-  if (G_UNLIKELY (hdr_ok != JPEG_HEADER_OK)) {
+  hdr_ok = jpeg_read_header (&dec->ctx.cinfo, TRUE);
+  if (G_UNLIKELY (hdr_ok == JPEG_SUSPENDED && inbuf)) {
+    GST_DEBUG_OBJECT (dec, "header is truncated, we probably need more data");
+    goto need_more_data;
+  } else if (G_UNLIKELY (hdr_ok != JPEG_HEADER_OK)) {
     GST_WARNING_OBJECT (dec, "reading the header failed, %d", hdr_ok);
   }
 
-  GST_LOG_OBJECT (dec, "num_components=%d", dec->cinfo.num_components);
-  GST_LOG_OBJECT (dec, "jpeg_color_space=%d", dec->cinfo.jpeg_color_space);
+  GST_LOG_OBJECT (dec, "num_components=%d", dec->ctx.cinfo.num_components);
+  GST_LOG_OBJECT (dec, "jpeg_color_space=%d", dec->ctx.cinfo.jpeg_color_space);
 
-  if (!dec->cinfo.num_components || !dec->cinfo.comp_info)
+  if (!dec->ctx.cinfo.num_components || !dec->ctx.cinfo.comp_info)
     goto components_not_supported;
 
-  r_h = dec->cinfo.comp_info[0].h_samp_factor;
-  r_v = dec->cinfo.comp_info[0].v_samp_factor;
+  r_h = dec->ctx.cinfo.comp_info[0].h_samp_factor;
+  r_v = dec->ctx.cinfo.comp_info[0].v_samp_factor;
 
   GST_LOG_OBJECT (dec, "r_h = %d, r_v = %d", r_h, r_v);
 
-  if (dec->cinfo.num_components > 3)
+  if (dec->ctx.cinfo.num_components > 3)
     goto components_not_supported;
 
   /* verify color space expectation to avoid going *boom* or bogus output */
-  if (dec->cinfo.jpeg_color_space != JCS_YCbCr &&
-      dec->cinfo.jpeg_color_space != JCS_GRAYSCALE &&
-      dec->cinfo.jpeg_color_space != JCS_RGB)
+  if (dec->ctx.cinfo.jpeg_color_space != JCS_YCbCr &&
+      dec->ctx.cinfo.jpeg_color_space != JCS_GRAYSCALE &&
+      dec->ctx.cinfo.jpeg_color_space != JCS_RGB)
     goto unsupported_colorspace;
 
 #ifndef GST_DISABLE_GST_DEBUG
   {
     gint i;
 
-    for (i = 0; i < dec->cinfo.num_components; ++i) {
+    for (i = 0; i < dec->ctx.cinfo.num_components; ++i) {
       GST_LOG_OBJECT (dec, "[%d] h_samp_factor=%d, v_samp_factor=%d, cid=%d",
-          i, dec->cinfo.comp_info[i].h_samp_factor,
-          dec->cinfo.comp_info[i].v_samp_factor,
-          dec->cinfo.comp_info[i].component_id);
+          i, dec->ctx.cinfo.comp_info[i].h_samp_factor,
+          dec->ctx.cinfo.comp_info[i].v_samp_factor,
+          dec->ctx.cinfo.comp_info[i].component_id);
     }
   }
 #endif
 
   /* prepare for raw output */
-  dec->cinfo.do_fancy_upsampling = FALSE;
-  dec->cinfo.do_block_smoothing = FALSE;
-  dec->cinfo.out_color_space = dec->cinfo.jpeg_color_space;
-  dec->cinfo.dct_method = dec->idct_method;
-  dec->cinfo.raw_data_out = TRUE;
+  gst_jpeg_dec_prepare_raw_output (&dec->ctx, dec->idct_method,
+      gst_jpeg_dec_get_scale (dec));
 
-  GST_LOG_OBJECT (dec, "starting decompress");
-  guarantee_huff_tables (&dec->cinfo);
-  if (!jpeg_start_decompress (&dec->cinfo)) {
-    GST_WARNING_OBJECT (dec, "failed to start decompression cycle");
+  if (inbuf) {
+    /* only need the output size */
+    jpeg_calc_output_dimensions (&dec->ctx.cinfo);
+  } else {
+    GST_LOG_OBJECT (dec, "starting decompress");
+    guarantee_huff_tables (&dec->ctx.cinfo);
+    if (!jpeg_start_decompress (&dec->ctx.cinfo)) {
+      GST_WARNING_OBJECT (dec, "failed to start decompression cycle");
+    }
   }
 
   /* sanity checks to get safe and reasonable output */
-  switch (dec->cinfo.jpeg_color_space) {
+  switch (dec->ctx.cinfo.jpeg_color_space) {
     case JCS_GRAYSCALE:
-      if (dec->cinfo.num_components != 1)
+      if (dec->ctx.cinfo.num_components != 1)
         goto invalid_yuvrgbgrayscale;
       break;
     case JCS_RGB:
-      if (dec->cinfo.num_components != 3 || dec->cinfo.max_v_samp_factor > 1 ||
-          dec->cinfo.max_h_samp_factor > 1)
+      if (dec->ctx.cinfo.num_components != 3 ||
+          dec->ctx.cinfo.max_v_samp_factor > 1 ||
+          dec->ctx.cinfo.max_h_samp_factor > 1)
         goto invalid_yuvrgbgrayscale;
       break;
     case JCS_YCbCr:
-      if (dec->cinfo.num_components != 3 ||
-          r_v > 2 || r_v < dec->cinfo.comp_info[0].v_samp_factor ||
-          r_v < dec->cinfo.comp_info[1].v_samp_factor ||
-          r_h < dec->cinfo.comp_info[0].h_samp_factor ||
-          r_h < dec->cinfo.comp_info[1].h_samp_factor)
+      if (dec->ctx.cinfo.num_components != 3 ||
+          r_v > 2 || r_v < dec->ctx.cinfo.comp_info[0].v_samp_factor ||
+          r_v < dec->ctx.cinfo.comp_info[1].v_samp_factor ||
+          r_v < dec->ctx.cinfo.comp_info[2].v_samp_factor ||
+          r_h < dec->ctx.cinfo.comp_info[0].h_samp_factor ||
+          r_h < dec->ctx.cinfo.comp_info[1].h_samp_factor)
         goto invalid_yuvrgbgrayscale;
       break;
     default:
@@ -1465,14 +2236,14 @@ again:
       break;
   }
 
-  width = dec->cinfo.output_width;
-  height = dec->cinfo.output_height;
+  width = dec->ctx.cinfo.output_width;
+  height = dec->ctx.cinfo.output_height;
 
   if (G_UNLIKELY (width < MIN_WIDTH || width > MAX_WIDTH ||
           height < MIN_HEIGHT || height > MAX_HEIGHT))
     goto wrong_size;
 
-  gst_jpeg_dec_negotiate (dec, width, height, dec->cinfo.jpeg_color_space);
+  gst_jpeg_dec_negotiate (dec, width, height, dec->ctx.cinfo.jpeg_color_space);
 
   ret = gst_pad_alloc_buffer_and_set_caps (dec->srcpad, GST_BUFFER_OFFSET_NONE,
       dec->outsize, GST_PAD_CAPS (dec->srcpad), &outbuf);
@@ -1505,91 +2276,41 @@ again:
   }
   GST_BUFFER_DURATION (outbuf) = duration;
 
-  if (dec->cinfo.jpeg_color_space == JCS_RGB) {
-    base[0] = outdata + dec->offset[0];
-    base[1] = outdata + dec->offset[1];
-    base[2] = outdata + dec->offset[2];
-    gst_jpeg_dec_decode_rgb (dec, base, width, height, dec->inc, dec->stride);
-  } else if (dec->cinfo.jpeg_color_space == JCS_GRAYSCALE) {
-    base[0] = outdata + dec->offset[0];
-    gst_jpeg_dec_decode_grayscale (dec, base, width, height, dec->inc,
-        dec->stride);
-  } else {
-    /* mind the swap, jpeglib outputs blue chroma first
-     * ensonic: I see no swap?
-     */
-    base[0] = outdata + I420_Y_OFFSET (width, height);
-    base[1] = outdata + I420_U_OFFSET (width, height);
-    base[2] = outdata + I420_V_OFFSET (width, height);
+  if (inbuf) {
+    jpeg_abort_decompress (&dec->ctx.cinfo);
 
-    /* make sure we don't make jpeglib write beyond our buffer,
-     * which might happen if (height % (r_v*DCTSIZE)) != 0 */
-    last[0] = base[0] + (I420_Y_ROWSTRIDE (width) * (height - 1));
-    last[1] =
-        base[1] + (I420_U_ROWSTRIDE (width) * ((GST_ROUND_UP_2 (height) / 2) -
-            1));
-    last[2] =
-        base[2] + (I420_V_ROWSTRIDE (width) * ((GST_ROUND_UP_2 (height) / 2) -
-            1));
+    /* no need to decode pictures outside of the segment */
+    if (!gst_jpeg_dec_clip_buffer (dec, outbuf))
+      goto drop_buffer;
 
-    GST_LOG_OBJECT (dec, "decompressing (reqired scanline buffer height = %u)",
-        dec->cinfo.rec_outbuf_height);
+    gst_jpeg_dec_queue_frame (dec, inbuf, outbuf);
+    inbuf = NULL;
+    outbuf = NULL;
 
-    /* For some widths jpeglib requires more horizontal padding than I420 
-     * provides. In those cases we need to decode into separate buffers and then
-     * copy over the data into our final picture buffer, otherwise jpeglib might
-     * write over the end of a line into the beginning of the next line,
-     * resulting in blocky artifacts on the left side of the picture. */
-    if (G_UNLIKELY (width % (dec->cinfo.max_h_samp_factor * DCTSIZE) != 0
-            || dec->cinfo.comp_info[0].h_samp_factor != 2
-            || dec->cinfo.comp_info[1].h_samp_factor != 1
-            || dec->cinfo.comp_info[2].h_samp_factor != 1)) {
-      GST_CAT_LOG_OBJECT (GST_CAT_PERFORMANCE, dec,
-          "indirect decoding using extra buffer copy");
-      gst_jpeg_dec_decode_indirect (dec, base, last, width, height, r_v, r_h,
-          dec->cinfo.num_components);
-    } else {
-      ret = gst_jpeg_dec_decode_direct (dec, base, last, width, height);
-
-      if (G_UNLIKELY (ret != GST_FLOW_OK))
-        goto decode_direct_failed;
-    }
+    /* errors of the decoding threads are already handled here */
+    return gst_jpeg_dec_push_frames (dec, dec->n_in_flight - 1);
   }
 
-  GST_LOG_OBJECT (dec, "decompressing finished");
-  jpeg_finish_decompress (&dec->cinfo);
-
-  /* Clipping */
-  if (dec->segment.format == GST_FORMAT_TIME) {
-    gint64 start, stop, clip_start, clip_stop;
+  ret = gst_jpeg_dec_decode_picture (dec, &dec->ctx, outdata, dec->offset,
+      dec->stride, dec->inc);
+  if (G_UNLIKELY (ret != GST_FLOW_OK))
+    goto decode_direct_failed;
 
-    GST_LOG_OBJECT (dec, "Attempting clipping");
+  GST_LOG_OBJECT (dec, "decompressing finished");
+  jpeg_finish_decompress (&dec->ctx.cinfo);
 
-    start = GST_BUFFER_TIMESTAMP (outbuf);
-    if (GST_BUFFER_DURATION (outbuf) == GST_CLOCK_TIME_NONE)
-      stop = start;
-    else
-      stop = start + GST_BUFFER_DURATION (outbuf);
-
-    if (gst_segment_clip (&dec->segment, GST_FORMAT_TIME,
-            start, stop, &clip_start, &clip_stop)) {
-      GST_LOG_OBJECT (dec, "Clipping start to %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (clip_start));
-      GST_BUFFER_TIMESTAMP (outbuf) = clip_start;
-      if (GST_BUFFER_DURATION (outbuf) != GST_CLOCK_TIME_NONE) {
-        GST_LOG_OBJECT (dec, "Clipping duration to %" GST_TIME_FORMAT,
-            GST_TIME_ARGS (clip_stop - clip_start));
-        GST_BUFFER_DURATION (outbuf) = clip_stop - clip_start;
-      }
-    } else
-      goto drop_buffer;
-  }
+  if (!gst_jpeg_dec_clip_buffer (dec, outbuf))
+    goto drop_buffer;
 
   /* reset error count on successful decode */
   dec->error_count = 0;
 
   ++dec->good_count;
 
+  /* pictures still being decoded by the threads go first */
+  if (dec->pool)
+    gst_jpeg_dec_push_frames (dec, 0);
+
   GST_LOG_OBJECT (dec, "pushing buffer (ts=%" GST_TIME_FORMAT ", dur=%"
       GST_TIME_FORMAT, GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)),
       GST_TIME_ARGS (GST_BUFFER_DURATION (outbuf)));
@@ -1601,9 +2322,11 @@ done:
   gst_adapter_flush (dec->adapter, dec->rem_img_len);
 
 exit:
+  if (inbuf)
+    gst_buffer_unref (inbuf);
 
   if (G_UNLIKELY (ret == GST_FLOW_ERROR)) {
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     ret = gst_jpeg_dec_post_error_or_warning (dec);
   }
 
@@ -1617,6 +2340,14 @@ need_more_data:
       gst_buffer_unref (outbuf);
       outbuf = NULL;
     }
+    /* for the decoding threads the picture was taken from the adapter
+     * already, put it back so it is completed by the next buffer like in
+     * the serial path, and restart reading the header then */
+    if (inbuf) {
+      jpeg_abort_decompress (&dec->ctx.cinfo);
+      gst_adapter_push (dec->adapter, inbuf);
+      inbuf = NULL;
+    }
     ret = GST_FLOW_OK;
     goto exit;
   }
@@ -1632,7 +2363,8 @@ decode_error:
   {
     gchar err_msg[JMSG_LENGTH_MAX];
 
-    dec->jerr.pub.format_message ((j_common_ptr) (&dec->cinfo), err_msg);
+    dec->ctx.jerr.pub.format_message ((j_common_ptr) (&dec->ctx.cinfo),
+        err_msg);
 
     gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__,
         "Decode error #%u: %s", code, err_msg);
@@ -1646,9 +2378,11 @@ decode_error:
   }
 decode_direct_failed:
   {
-    /* already posted an error message */
-    jpeg_abort_decompress (&dec->cinfo);
+    gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__,
+        "Unsupported subsampling schema");
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     gst_buffer_replace (&outbuf, NULL);
+    ret = GST_FLOW_ERROR;
     goto done;
   }
 alloc_failed:
@@ -1659,7 +2393,7 @@ alloc_failed:
 
     GST_DEBUG_OBJECT (dec, "failed to alloc buffer, reason %s", reason);
     /* Reset for next time */
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     if (ret != GST_FLOW_UNEXPECTED && ret != GST_FLOW_WRONG_STATE &&
         ret != GST_FLOW_NOT_LINKED) {
       gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__,
@@ -1678,7 +2412,7 @@ components_not_supported:
   {
     gst_jpeg_dec_set_error (dec, GST_FUNCTION, __LINE__,
         "number of components not supported: %d (max 3)",
-        dec->cinfo.num_components);
+        dec->ctx.cinfo.num_components);
     ret = GST_FLOW_ERROR;
     goto done;
   }
@@ -1730,6 +2464,49 @@ gst_jpeg_dec_src_event (GstPad * pad, GstEvent * event)
   return res;
 }
 
+static gboolean
+gst_jpeg_dec_src_query (GstPad * pad, GstQuery * query)
+{
+  GstJpegDec *dec;
+  gboolean res;
+
+  dec = GST_JPEG_DEC (gst_pad_get_parent (pad));
+  if (G_UNLIKELY (dec == NULL))
+    return FALSE;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_LATENCY:{
+      gboolean live;
+      GstClockTime min, max, latency;
+
+      if (!(res = gst_pad_peer_query (dec->sinkpad, query)))
+        break;
+
+      gst_query_parse_latency (query, &live, &min, &max);
+
+      GST_OBJECT_LOCK (dec);
+      latency = dec->latency;
+      GST_OBJECT_UNLOCK (dec);
+
+      GST_DEBUG_OBJECT (dec, "our latency: %" GST_TIME_FORMAT
+          ", upstream: min %" GST_TIME_FORMAT ", max %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (latency), GST_TIME_ARGS (min), GST_TIME_ARGS (max));
+
+      min += latency;
+      if (max != GST_CLOCK_TIME_NONE)
+        max += latency;
+      gst_query_set_latency (query, live, min, max);
+      break;
+    }
+    default:
+      res = gst_pad_query_default (pad, query);
+      break;
+  }
+
+  gst_object_unref (dec);
+  return res;
+}
+
 static gboolean
 gst_jpeg_dec_sink_event (GstPad * pad, GstEvent * event)
 {
@@ -1738,10 +2515,17 @@ gst_jpeg_dec_sink_event (GstPad * pad, GstEvent * event)
 
   GST_DEBUG_OBJECT (dec, "event : %s", GST_EVENT_TYPE_NAME (event));
 
+  /* pictures still being decoded go before serialized events */
+  if (dec->pool && GST_EVENT_IS_SERIALIZED (event) &&
+      GST_EVENT_TYPE (event) != GST_EVENT_FLUSH_STOP)
+    gst_jpeg_dec_push_frames (dec, 0);
+
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       GST_DEBUG_OBJECT (dec, "Aborting decompress");
-      jpeg_abort_decompress (&dec->cinfo);
+      if (dec->pool)
+        gst_jpeg_dec_flush_frames (dec);
+      jpeg_abort_decompress (&dec->ctx.cinfo);
       gst_segment_init (&dec->segment, GST_FORMAT_UNDEFINED);
       gst_adapter_clear (dec->adapter);
       g_free (dec->cur_buf);
@@ -1794,6 +2578,20 @@ gst_jpeg_dec_set_property (GObject * object, guint prop_id,
     case PROP_MAX_ERRORS:
       g_atomic_int_set (&dec->max_errors, g_value_get_int (value));
       break;
+    case PROP_SCALE:
+      dec->scale = g_value_get_enum (value);
+      dec->scale_width = -1;
+      break;
+    case PROP_THREADS:
+      GST_OBJECT_LOCK (dec);
+      dec->threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_MAX_IN_FLIGHT:
+      GST_OBJECT_LOCK (dec);
+      dec->max_in_flight = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dec);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1816,6 +2614,19 @@ gst_jpeg_dec_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_MAX_ERRORS:
       g_value_set_int (value, g_atomic_int_get (&dec->max_errors));
       break;
+    case PROP_SCALE:
+      g_value_set_enum (value, dec->scale);
+      break;
+    case PROP_THREADS:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_uint (value, dec->threads);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_MAX_IN_FLIGHT:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_uint (value, dec->max_in_flight);
+      GST_OBJECT_UNLOCK (dec);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1823,6 +2634,63 @@ gst_jpeg_dec_get_property (GObject * object, guint prop_id, GValue * value,
   }
 }
 
+static gboolean
+gst_jpeg_dec_start_pool (GstJpegDec * dec)
+{
+  GError *err = NULL;
+  guint i;
+
+  GST_OBJECT_LOCK (dec);
+  dec->n_threads = dec->threads;
+  dec->n_in_flight = dec->max_in_flight;
+  GST_OBJECT_UNLOCK (dec);
+
+  dec->n_threads = gst_get_n_threads (dec->n_threads);
+  if (dec->n_in_flight == 0)
+    dec->n_in_flight = 2 * dec->n_threads;
+
+  GST_DEBUG_OBJECT (dec, "using %u decoding threads, %u pictures in flight",
+      dec->n_threads, dec->n_in_flight);
+  if (dec->n_threads == 1)
+    return TRUE;
+
+  dec->pool = g_thread_pool_new (gst_jpeg_dec_decode_worker, dec,
+      dec->n_threads, TRUE, &err);
+  if (dec->pool == NULL) {
+    GST_ELEMENT_ERROR (dec, RESOURCE, FAILED,
+        ("Failed to start the decoding threads"), ("%s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  dec->contexts = g_async_queue_new ();
+  for (i = 0; i < dec->n_threads; i++)
+    g_async_queue_push (dec->contexts, gst_jpeg_dec_context_new (dec));
+
+  return TRUE;
+}
+
+static void
+gst_jpeg_dec_stop_pool (GstJpegDec * dec)
+{
+  GstJpegDecContext *ctx;
+
+  if (dec->pool == NULL)
+    return;
+
+  gst_jpeg_dec_flush_frames (dec);
+  g_thread_pool_free (dec->pool, FALSE, TRUE);
+  dec->pool = NULL;
+  GST_OBJECT_LOCK (dec);
+  dec->latency = 0;
+  GST_OBJECT_UNLOCK (dec);
+
+  while ((ctx = g_async_queue_try_pop (dec->contexts)) != NULL)
+    gst_jpeg_dec_context_free (ctx);
+  g_async_queue_unref (dec->contexts);
+  dec->contexts = NULL;
+}
+
 static GstStateChangeReturn
 gst_jpeg_dec_change_state (GstElement * element, GstStateChange transition)
 {
@@ -1833,14 +2701,20 @@ gst_jpeg_dec_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_jpeg_dec_start_pool (dec))
+        return GST_STATE_CHANGE_FAILURE;
       dec->error_count = 0;
       dec->good_count = 0;
       dec->framerate_numerator = 0;
       dec->framerate_denominator = 1;
       dec->caps_framerate_numerator = dec->caps_framerate_denominator = 0;
+      GST_OBJECT_LOCK (dec);
+      dec->latency = 0;
+      GST_OBJECT_UNLOCK (dec);
       dec->caps_width = -1;
       dec->caps_height = -1;
       dec->clrspc = -1;
+      dec->scale_width = -1;
       dec->packetized = FALSE;
       dec->next_ts = 0;
       dec->discont = TRUE;
@@ -1863,7 +2737,8 @@ gst_jpeg_dec_change_state (GstElement * element, GstStateChange transition)
       gst_adapter_clear (dec->adapter);
       g_free (dec->cur_buf);
       dec->cur_buf = NULL;
-      gst_jpeg_dec_free_buffers (dec);
+      gst_jpeg_dec_free_buffers (&dec->ctx);
+      gst_jpeg_dec_stop_pool (dec);
       break;
     default:
       break;
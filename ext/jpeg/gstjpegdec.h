@@ -47,8 +47,18 @@ G_BEGIN_DECLS
 #define GST_IS_JPEG_DEC_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_JPEG_DEC))
 
+typedef enum {
+  GST_JPEG_DEC_SCALE_AUTO = 0,
+  GST_JPEG_DEC_SCALE_FULL = 1,
+  GST_JPEG_DEC_SCALE_HALF = 2,
+  GST_JPEG_DEC_SCALE_QUARTER = 4,
+  GST_JPEG_DEC_SCALE_EIGHTH = 8
+} GstJpegDecScale;
+
 typedef struct _GstJpegDec           GstJpegDec;
 typedef struct _GstJpegDecClass      GstJpegDecClass;
+typedef struct _GstJpegDecContext    GstJpegDecContext;
+typedef struct _GstJpegDecFrame      GstJpegDecFrame;
 
 struct GstJpegDecErrorMgr {
   struct jpeg_error_mgr    pub;   /* public fields */
@@ -60,6 +70,38 @@ struct GstJpegDecSourceMgr {
   GstJpegDec              *dec;
 };
 
+/* jpeglib state for decompressing pictures, the element has one for the
+ * streaming thread and one per decoding thread */
+struct _GstJpegDecContext {
+  struct jpeg_decompress_struct cinfo;
+  struct GstJpegDecErrorMgr     jerr;
+  struct GstJpegDecSourceMgr    jsrc;
+
+  /* scratch rows for the lines that can't be decoded into the output
+   * buffer directly, kept as long as the row size doesn't change */
+  guint   idr_width_allocated;
+  guchar *idr_block;
+  guchar *idr_y[16],*idr_u[16],*idr_v[16];
+};
+
+/* a picture queued for the decoding threads */
+struct _GstJpegDecFrame {
+  GstBuffer *input;
+  GstBuffer *output;
+
+  /* decoding parameters and output layout */
+  gint       idct_method;
+  gint       scale;
+  gint       offset[3];
+  gint       stride;
+  gint       inc;
+
+  /* result, with frame_lock */
+  gboolean      done;
+  GstFlowReturn ret;
+  gchar        *error_msg;
+};
+
 /* Can't use GstBaseTransform, because GstBaseTransform
  * doesn't handle the N buffers in, 1 buffer out case,
  * but only the 1-in 1-out case */
@@ -114,6 +156,14 @@ struct _GstJpegDec {
   /* properties */
   gint     idct_method;
   gint     max_errors;  /* ATOMIC */
+  GstJpegDecScale scale;
+  guint    threads;
+  guint    max_in_flight;
+
+  /* scale picked in auto mode for pictures of scale_width x scale_height */
+  gint     auto_scale;
+  gint     scale_width;
+  gint     scale_height;
 
   /* current error (the message is the debug message) */
   gchar       *error_msg;
@@ -126,15 +176,23 @@ struct _GstJpegDec {
   /* number of successfully decoded images since start */
   guint     good_count;
 
-  struct jpeg_decompress_struct cinfo;
-  struct GstJpegDecErrorMgr     jerr;
-  struct GstJpegDecSourceMgr    jsrc;
+  GstJpegDecContext ctx;
 
-  /* arrays for indirect decoding */
-  gboolean idr_width_allocated;
-  guchar *idr_y[16],*idr_u[16],*idr_v[16];
   /* current (parsed) image size */
   guint    rem_img_len;
+
+  /* frame-parallel decoding of packetized input */
+  guint        n_threads;
+  guint        n_in_flight;
+  GThreadPool *pool;
+  GAsyncQueue *contexts;        /* idle GstJpegDecContext for the threads */
+  GMutex      *frame_lock;
+  GCond       *frame_cond;
+  GQueue       frames;          /* GstJpegDecFrame in decoding order */
+  gboolean     pushing;         /* a thread is pushing decoded pictures */
+  GstFlowReturn frames_ret;     /* first failed push of the decoded pictures */
+  guint        frames_pushed;   /* pushed since the streaming thread checked */
+  GstClockTime latency;         /* of the pictures in flight, object lock */
 };
 
 struct _GstJpegDecClass {
@@ -38,6 +38,7 @@
 #include "gstjpegenc.h"
 #include "gstjpeg.h"
 #include <gst/video/video.h>
+#include "gst/glib-compat-private.h"
 
 /* experimental */
 /* setting smoothig seems to have no effect in libjepeg
@@ -50,6 +51,7 @@ GST_DEBUG_CATEGORY_STATIC (jpegenc_debug);
 #define JPEG_DEFAULT_QUALITY 85
 #define JPEG_DEFAULT_SMOOTHING 0
 #define JPEG_DEFAULT_IDCT_METHOD	JDCT_FASTEST
+#define JPEG_DEFAULT_THREADS 1
 
 /* JpegEnc signals and args */
 enum
@@ -64,7 +66,8 @@ enum
   PROP_0,
   PROP_QUALITY,
   PROP_SMOOTHING,
-  PROP_IDCT_METHOD
+  PROP_IDCT_METHOD,
+  PROP_THREADS
 };
 
 static void gst_jpegenc_reset (GstJpegEnc * enc);
@@ -190,6 +193,24 @@ gst_jpegenc_class_init (GstJpegEnc * klass)
           JPEG_DEFAULT_IDCT_METHOD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstJpegEnc:threads
+   *
+   * Number of threads that encode a picture, 0 selects the number of CPUs.
+   * With more than one thread the picture is cut into horizontal bands that
+   * are compressed in parallel and joined with restart markers, which makes
+   * the output slightly bigger. Takes effect when going from READY to
+   * PAUSED.
+   *
+   * Since: 0.10.32
+   **/
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Number of threads encoding slices of a picture in parallel "
+          "(0 = number of CPUs)", 0, GST_MAX_THREADS,
+          JPEG_DEFAULT_THREADS, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_jpegenc_change_state;
 
   gobject_class->finalize = gst_jpegenc_finalize;
@@ -198,6 +219,17 @@ gst_jpegenc_class_init (GstJpegEnc * klass)
       "JPEG encoding element");
 }
 
+/* Compressed frames of a stream have similar sizes. Allocating a bit more
+ * than the last one needed avoids allocating the size of a raw frame, which
+ * is many times bigger, while a frame that doesn't fit only costs growing
+ * the buffer once */
+static void
+gst_jpegenc_update_predicted_size (GstJpegEnc * enc, guint size)
+{
+  enc->predicted_size = GST_ROUND_UP_4 (size + size / 4 + 4096);
+  enc->predicted_size = MIN (enc->predicted_size, enc->bufsize);
+}
+
 static void
 gst_jpegenc_init_destination (j_compress_ptr cinfo)
 {
@@ -255,6 +287,8 @@ gst_jpegenc_term_destination (j_compress_ptr cinfo)
   /* Trim the buffer size and push it. */
   GST_BUFFER_SIZE (jpegenc->output_buffer) =
       GST_BUFFER_SIZE (jpegenc->output_buffer) - jpegenc->jdest.free_in_buffer;
+  gst_jpegenc_update_predicted_size (jpegenc,
+      GST_BUFFER_SIZE (jpegenc->output_buffer));
 
   g_signal_emit (G_OBJECT (jpegenc), gst_jpegenc_signals[FRAME_ENCODED], 0);
 
@@ -301,6 +335,10 @@ gst_jpegenc_init (GstJpegEnc * jpegenc)
   jpegenc->quality = JPEG_DEFAULT_QUALITY;
   jpegenc->smoothing = JPEG_DEFAULT_SMOOTHING;
   jpegenc->idct_method = JPEG_DEFAULT_IDCT_METHOD;
+  jpegenc->threads = JPEG_DEFAULT_THREADS;
+
+  jpegenc->slice_lock = g_mutex_new ();
+  jpegenc->slice_cond = g_cond_new ();
 
   gst_jpegenc_reset (jpegenc);
 }
@@ -328,6 +366,7 @@ gst_jpegenc_reset (GstJpegEnc * enc)
   enc->format = GST_VIDEO_FORMAT_UNKNOWN;
   enc->fps_den = enc->par_den = 0;
   enc->height = enc->width = 0;
+  enc->predicted_size = 0;
 }
 
 static void
@@ -336,6 +375,8 @@ gst_jpegenc_finalize (GObject * object)
   GstJpegEnc *filter = GST_JPEGENC (object);
 
   jpeg_destroy_compress (&filter->cinfo);
+  g_mutex_free (filter->slice_lock);
+  g_cond_free (filter->slice_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -485,135 +526,136 @@ refuse_caps:
   }
 }
 
+/* Sets up cinfo for compressing the negotiated format from line, which
+ * points to row for formats that need copying */
 static void
-gst_jpegenc_resync (GstJpegEnc * jpegenc)
+gst_jpegenc_setup_compress (GstJpegEnc * jpegenc, j_compress_ptr cinfo,
+    guchar ** line[3], guchar * row[3][4 * DCTSIZE])
 {
-  gint width, height;
   gint i, j;
 
-  GST_DEBUG_OBJECT (jpegenc, "resync");
-
-  jpegenc->cinfo.image_width = width = jpegenc->width;
-  jpegenc->cinfo.image_height = height = jpegenc->height;
-  jpegenc->cinfo.input_components = jpegenc->channels;
-
-  GST_DEBUG_OBJECT (jpegenc, "width %d, height %d", width, height);
-  GST_DEBUG_OBJECT (jpegenc, "format %d", jpegenc->format);
+  cinfo->image_width = jpegenc->width;
+  cinfo->image_height = jpegenc->height;
+  cinfo->input_components = jpegenc->channels;
 
   if (gst_video_format_is_rgb (jpegenc->format)) {
     GST_DEBUG_OBJECT (jpegenc, "RGB");
-    jpegenc->cinfo.in_color_space = JCS_RGB;
+    cinfo->in_color_space = JCS_RGB;
   } else if (gst_video_format_is_gray (jpegenc->format)) {
     GST_DEBUG_OBJECT (jpegenc, "gray");
-    jpegenc->cinfo.in_color_space = JCS_GRAYSCALE;
+    cinfo->in_color_space = JCS_GRAYSCALE;
   } else {
     GST_DEBUG_OBJECT (jpegenc, "YUV");
-    jpegenc->cinfo.in_color_space = JCS_YCbCr;
+    cinfo->in_color_space = JCS_YCbCr;
   }
 
-  /* input buffer size as max output */
-  jpegenc->bufsize = gst_video_format_get_size (jpegenc->format, width, height);
-  jpeg_set_defaults (&jpegenc->cinfo);
-  jpegenc->cinfo.raw_data_in = TRUE;
+  jpeg_set_defaults (cinfo);
+  cinfo->raw_data_in = TRUE;
   /* duh, libjpeg maps RGB to YUV ... and don't expect some conversion */
-  if (jpegenc->cinfo.in_color_space == JCS_RGB)
-    jpeg_set_colorspace (&jpegenc->cinfo, JCS_RGB);
+  if (cinfo->in_color_space == JCS_RGB)
+    jpeg_set_colorspace (cinfo, JCS_RGB);
 
-  GST_DEBUG_OBJECT (jpegenc, "h_max_samp=%d, v_max_samp=%d",
-      jpegenc->h_max_samp, jpegenc->v_max_samp);
   /* image dimension info */
   for (i = 0; i < jpegenc->channels; i++) {
     GST_DEBUG_OBJECT (jpegenc, "comp %i: h_samp=%d, v_samp=%d", i,
         jpegenc->h_samp[i], jpegenc->v_samp[i]);
-    jpegenc->cinfo.comp_info[i].h_samp_factor = jpegenc->h_samp[i];
-    jpegenc->cinfo.comp_info[i].v_samp_factor = jpegenc->v_samp[i];
-    g_free (jpegenc->line[i]);
-    jpegenc->line[i] = g_new (guchar *, jpegenc->v_max_samp * DCTSIZE);
+    cinfo->comp_info[i].h_samp_factor = jpegenc->h_samp[i];
+    cinfo->comp_info[i].v_samp_factor = jpegenc->v_samp[i];
+    g_free (line[i]);
+    line[i] = g_new (guchar *, jpegenc->v_max_samp * DCTSIZE);
     if (!jpegenc->planar) {
       for (j = 0; j < jpegenc->v_max_samp * DCTSIZE; j++) {
-        g_free (jpegenc->row[i][j]);
-        jpegenc->row[i][j] = g_malloc (width);
-        jpegenc->line[i][j] = jpegenc->row[i][j];
+        g_free (row[i][j]);
+        row[i][j] = g_malloc (jpegenc->width);
+        line[i][j] = row[i][j];
       }
     }
   }
-
-  /* guard against a potential error in gst_jpegenc_term_destination
-     which occurs iff bufsize % 4 < free_space_remaining */
-  jpegenc->bufsize = GST_ROUND_UP_4 (jpegenc->bufsize);
-
-  jpeg_suppress_tables (&jpegenc->cinfo, TRUE);
-
-  GST_DEBUG_OBJECT (jpegenc, "resync done");
 }
 
-static GstFlowReturn
-gst_jpegenc_chain (GstPad * pad, GstBuffer * buf)
+static void
+gst_jpegenc_resync (GstJpegEnc * jpegenc)
 {
-  GstFlowReturn ret;
-  GstJpegEnc *jpegenc;
-  guchar *data;
-  gulong size;
-  guint height;
-  guchar *base[3], *end[3];
-  gint i, j, k;
+  gint i;
 
-  jpegenc = GST_JPEGENC (GST_OBJECT_PARENT (pad));
+  GST_DEBUG_OBJECT (jpegenc, "resync");
 
-  if (G_UNLIKELY (jpegenc->width <= 0 || jpegenc->height <= 0))
-    goto not_negotiated;
+  GST_DEBUG_OBJECT (jpegenc, "width %d, height %d", jpegenc->width,
+      jpegenc->height);
+  GST_DEBUG_OBJECT (jpegenc, "format %d", jpegenc->format);
+  GST_DEBUG_OBJECT (jpegenc, "h_max_samp=%d, v_max_samp=%d",
+      jpegenc->h_max_samp, jpegenc->v_max_samp);
 
-  data = GST_BUFFER_DATA (buf);
-  size = GST_BUFFER_SIZE (buf);
+  /* input buffer size as max output */
+  jpegenc->bufsize = gst_video_format_get_size (jpegenc->format,
+      jpegenc->width, jpegenc->height);
 
-  GST_LOG_OBJECT (jpegenc, "got buffer of %lu bytes", size);
+  gst_jpegenc_setup_compress (jpegenc, &jpegenc->cinfo, jpegenc->line,
+      jpegenc->row);
 
-  ret =
-      gst_pad_alloc_buffer_and_set_caps (jpegenc->srcpad,
-      GST_BUFFER_OFFSET_NONE, jpegenc->bufsize, GST_PAD_CAPS (jpegenc->srcpad),
-      &jpegenc->output_buffer);
-
-  if (ret != GST_FLOW_OK)
-    goto done;
+  /* every slice starts with a restart marker */
+  for (i = 0; jpegenc->slices && i < jpegenc->n_threads; i++) {
+    GstJpegEncSlice *slice = &jpegenc->slices[i];
 
-  gst_buffer_copy_metadata (jpegenc->output_buffer, buf,
-      GST_BUFFER_COPY_TIMESTAMPS);
+    gst_jpegenc_setup_compress (jpegenc, &slice->cinfo, slice->line,
+        slice->row);
+    slice->cinfo.restart_in_rows = 1;
+  }
 
-  height = jpegenc->height;
+  /* guard against a potential error in gst_jpegenc_term_destination
+     which occurs iff bufsize % 4 < free_space_remaining */
+  jpegenc->bufsize = GST_ROUND_UP_4 (jpegenc->bufsize);
+  jpegenc->predicted_size = jpegenc->bufsize;
 
-  for (i = 0; i < jpegenc->channels; i++) {
-    base[i] = data + jpegenc->offset[i];
-    end[i] = base[i] + jpegenc->cheight[i] * jpegenc->stride[i];
-  }
+  jpeg_suppress_tables (&jpegenc->cinfo, TRUE);
 
-  jpegenc->jdest.next_output_byte = GST_BUFFER_DATA (jpegenc->output_buffer);
-  jpegenc->jdest.free_in_buffer = GST_BUFFER_SIZE (jpegenc->output_buffer);
+  GST_DEBUG_OBJECT (jpegenc, "resync done");
+}
 
+/* Sets the per frame parameters, called from the streaming thread so all
+ * slices of a frame use the same quantization tables */
+static void
+gst_jpegenc_prepare_compress (GstJpegEnc * jpegenc, j_compress_ptr cinfo,
+    gint quality, gint smoothing, gint idct_method)
+{
   /* prepare for raw input */
 #if JPEG_LIB_VERSION >= 70
-  jpegenc->cinfo.do_fancy_downsampling = FALSE;
+  cinfo->do_fancy_downsampling = FALSE;
 #endif
-  jpegenc->cinfo.smoothing_factor = jpegenc->smoothing;
-  jpegenc->cinfo.dct_method = jpegenc->idct_method;
-  jpeg_set_quality (&jpegenc->cinfo, jpegenc->quality, TRUE);
-  jpeg_start_compress (&jpegenc->cinfo, TRUE);
+  cinfo->smoothing_factor = smoothing;
+  cinfo->dct_method = idct_method;
+  jpeg_set_quality (cinfo, quality, TRUE);
+}
 
-  GST_LOG_OBJECT (jpegenc, "compressing");
+/* Hands n_rows lines of the frame in data, starting at first_row, to
+ * jpeglib. first_row is a multiple of the MCU height */
+static void
+gst_jpegenc_write_lines (GstJpegEnc * jpegenc, j_compress_ptr cinfo,
+    guchar ** line[3], guchar * data, gint first_row, gint n_rows)
+{
+  guchar *base[3], *end[3];
+  gint i, j, k;
+
+  for (i = 0; i < jpegenc->channels; i++) {
+    base[i] = data + jpegenc->offset[i] + (first_row * jpegenc->v_samp[i] /
+        jpegenc->v_max_samp) * jpegenc->stride[i];
+    end[i] = data + jpegenc->offset[i] +
+        jpegenc->cheight[i] * jpegenc->stride[i];
+  }
 
   if (jpegenc->planar) {
-    for (i = 0; i < height; i += jpegenc->v_max_samp * DCTSIZE) {
+    for (i = 0; i < n_rows; i += jpegenc->v_max_samp * DCTSIZE) {
       for (k = 0; k < jpegenc->channels; k++) {
         for (j = 0; j < jpegenc->v_samp[k] * DCTSIZE; j++) {
-          jpegenc->line[k][j] = base[k];
+          line[k][j] = base[k];
           if (base[k] + jpegenc->stride[k] < end[k])
             base[k] += jpegenc->stride[k];
         }
       }
-      jpeg_write_raw_data (&jpegenc->cinfo, jpegenc->line,
-          jpegenc->v_max_samp * DCTSIZE);
+      jpeg_write_raw_data (cinfo, line, jpegenc->v_max_samp * DCTSIZE);
     }
   } else {
-    for (i = 0; i < height; i += jpegenc->v_max_samp * DCTSIZE) {
+    for (i = 0; i < n_rows; i += jpegenc->v_max_samp * DCTSIZE) {
       for (k = 0; k < jpegenc->channels; k++) {
         for (j = 0; j < jpegenc->v_samp[k] * DCTSIZE; j++) {
           guchar *src, *dst;
@@ -621,7 +663,7 @@ gst_jpegenc_chain (GstPad * pad, GstBuffer * buf)
 
           /* ouch, copy line */
           src = base[k];
-          dst = jpegenc->line[k][j];
+          dst = line[k][j];
           for (l = jpegenc->cwidth[k]; l > 0; l--) {
             *dst = *src;
             src += jpegenc->inc[k];
@@ -631,16 +673,318 @@ gst_jpegenc_chain (GstPad * pad, GstBuffer * buf)
             base[k] += jpegenc->stride[k];
         }
       }
-      jpeg_write_raw_data (&jpegenc->cinfo, jpegenc->line,
-          jpegenc->v_max_samp * DCTSIZE);
+      jpeg_write_raw_data (cinfo, line, jpegenc->v_max_samp * DCTSIZE);
     }
   }
+}
+
+static void
+gst_jpegenc_slice_init_destination (j_compress_ptr cinfo)
+{
+  GstJpegEncSlice *slice = (GstJpegEncSlice *) (cinfo->client_data);
+
+  slice->jdest.next_output_byte = slice->out;
+  slice->jdest.free_in_buffer = slice->out_alloc;
+}
+
+static boolean
+gst_jpegenc_slice_empty_output_buffer (j_compress_ptr cinfo)
+{
+  GstJpegEncSlice *slice = (GstJpegEncSlice *) (cinfo->client_data);
+  guint used = slice->out_alloc;
+
+  /* the whole buffer is in use, grow it and keep it for the next frames */
+  slice->out_alloc *= 2;
+  slice->out = g_realloc (slice->out, slice->out_alloc);
+  slice->jdest.next_output_byte = slice->out + used;
+  slice->jdest.free_in_buffer = slice->out_alloc - used;
+
+  return TRUE;
+}
+
+static void
+gst_jpegenc_slice_term_destination (j_compress_ptr cinfo)
+{
+  GstJpegEncSlice *slice = (GstJpegEncSlice *) (cinfo->client_data);
+
+  slice->out_size = slice->out_alloc - slice->jdest.free_in_buffer;
+}
+
+static void
+gst_jpegenc_slice_output_message (j_common_ptr cinfo)
+{
+  return;                       /* do nothing */
+}
+
+static void
+gst_jpegenc_slice_error_exit (j_common_ptr cinfo)
+{
+  struct GstJpegEncErrorMgr *err_mgr = (struct GstJpegEncErrorMgr *) cinfo->err;
+
+  longjmp (err_mgr->setjmp_buffer, 1);
+}
+
+/* Runs in the encoding threads, so errors are only recorded in the slice
+ * and reported by the streaming thread */
+static void
+gst_jpegenc_encode_slice (GstJpegEncSlice * slice)
+{
+  slice->failed = FALSE;
+  if (setjmp (slice->jerr.setjmp_buffer)) {
+    (*slice->cinfo.err->format_message) ((j_common_ptr) & slice->cinfo,
+        slice->error);
+    jpeg_abort_compress (&slice->cinfo);
+    slice->failed = TRUE;
+    return;
+  }
+
+  gst_jpegenc_prepare_compress (slice->enc, &slice->cinfo, slice->quality,
+      slice->smoothing, slice->idct_method);
+  slice->cinfo.image_height = slice->n_rows;
+  jpeg_start_compress (&slice->cinfo, TRUE);
+  gst_jpegenc_write_lines (slice->enc, &slice->cinfo, slice->line,
+      slice->data, slice->first_row, slice->n_rows);
+  jpeg_finish_compress (&slice->cinfo);
+}
+
+static void
+gst_jpegenc_slice_worker (gpointer data, gpointer user_data)
+{
+  GstJpegEnc *jpegenc = user_data;
+
+  gst_jpegenc_encode_slice (data);
+
+  g_mutex_lock (jpegenc->slice_lock);
+  if (--jpegenc->slices_pending == 0)
+    g_cond_signal (jpegenc->slice_cond);
+  g_mutex_unlock (jpegenc->slice_lock);
+}
+
+/* Returns the offset of the entropy coded data in an image written by
+ * jpeglib, which follows the SOS segment. If sof is not NULL the offset of
+ * the frame header is stored there */
+static guint
+gst_jpegenc_find_scan_data (const guchar * data, guint size, guint * sof)
+{
+  guint pos = 2;
+
+  while (pos + 4 <= size && data[pos] == 0xff) {
+    guint marker = data[pos + 1];
+
+    if (sof && marker >= 0xc0 && marker <= 0xc2)
+      *sof = pos;
+    pos += 2 + GST_READ_UINT16_BE (data + pos + 2);
+    if (marker == 0xda)
+      return pos;
+  }
+
+  return 0;
+}
+
+/* Joins the compressed slices into one image. The header of the first slice
+ * gets the height of the whole picture, and the data of every further slice
+ * follows a restart marker. jpeglib numbers the markers of every slice from
+ * 0, so they are renumbered by the MCU row the slice starts at */
+static GstFlowReturn
+gst_jpegenc_join_slices (GstJpegEnc * jpegenc, guint n_slices,
+    GstBuffer * buf)
+{
+  GstBuffer *outbuf;
+  GstFlowReturn ret;
+  guint start[GST_MAX_THREADS];
+  guint sof = 0, size, i;
+  gint mcu_rows = jpegenc->v_max_samp * DCTSIZE;
+  guchar *out;
+
+  /* header of the first slice, the data of all slices without EOI, and
+   * a restart marker between slices */
+  size = 2;
+  for (i = 0; i < n_slices; i++) {
+    GstJpegEncSlice *slice = &jpegenc->slices[i];
+
+    start[i] = gst_jpegenc_find_scan_data (slice->out, slice->out_size,
+        i == 0 ? &sof : NULL);
+    if (G_UNLIKELY (start[i] == 0 || slice->out_size < start[i] + 2 ||
+            (i == 0 && sof == 0)))
+      goto invalid_slice;
+    size += slice->out_size - 2 - start[i] + (i == 0 ? start[i] : 2);
+  }
+
+  ret = gst_pad_alloc_buffer_and_set_caps (jpegenc->srcpad,
+      GST_BUFFER_OFFSET_NONE, size, GST_PAD_CAPS (jpegenc->srcpad), &outbuf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  gst_buffer_copy_metadata (outbuf, buf, GST_BUFFER_COPY_TIMESTAMPS);
+
+  out = GST_BUFFER_DATA (outbuf);
+  for (i = 0; i < n_slices; i++) {
+    GstJpegEncSlice *slice = &jpegenc->slices[i];
+    guint len = slice->out_size - 2 - start[i];
+    guint shift = slice->first_row / mcu_rows;
+    guchar *p, *data_end;
+
+    if (i == 0) {
+      memcpy (out, slice->out, start[0]);
+      GST_WRITE_UINT16_BE (out + sof + 5, jpegenc->height);
+      out += start[0];
+    } else {
+      out[0] = 0xff;
+      out[1] = 0xd0 + ((shift - 1) & 7);
+      out += 2;
+    }
+
+    memcpy (out, slice->out + start[i], len);
+    data_end = out + len;
+    /* 0xff in entropy coded data is followed by 0x00, the only markers are
+     * the restarts */
+    p = out;
+    while (shift != 0 && (p = memchr (p, 0xff, data_end - p)) != NULL &&
+        p + 1 < data_end) {
+      if (p[1] >= 0xd0 && p[1] <= 0xd7)
+        p[1] = 0xd0 + ((p[1] - 0xd0 + shift) & 7);
+      p += 2;
+    }
+    out = data_end;
+  }
+  out[0] = 0xff;
+  out[1] = 0xd9;
+
+  g_signal_emit (G_OBJECT (jpegenc), gst_jpegenc_signals[FRAME_ENCODED], 0);
+
+  return gst_pad_push (jpegenc->srcpad, outbuf);
+
+  /* ERRORS */
+invalid_slice:
+  {
+    GST_ELEMENT_ERROR (jpegenc, STREAM, ENCODE, (NULL),
+        ("Could not find the compressed data of slice %u", i));
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* Compresses bands of MCU rows of buf in parallel, the streaming thread
+ * does the first one */
+static GstFlowReturn
+gst_jpegenc_encode_slices (GstJpegEnc * jpegenc, GstBuffer * buf,
+    gint quality, gint smoothing, gint idct_method)
+{
+  gint mcu_rows = jpegenc->v_max_samp * DCTSIZE;
+  gint lines, n_slices, i;
+
+  lines = (jpegenc->height + jpegenc->n_threads - 1) / jpegenc->n_threads;
+  lines = (lines + mcu_rows - 1) / mcu_rows * mcu_rows;
+  n_slices = (jpegenc->height + lines - 1) / lines;
+
+  for (i = 0; i < n_slices; i++) {
+    GstJpegEncSlice *slice = &jpegenc->slices[i];
+
+    slice->data = GST_BUFFER_DATA (buf);
+    slice->first_row = i * lines;
+    slice->n_rows = MIN (lines, jpegenc->height - slice->first_row);
+    if (slice->out_alloc == 0) {
+      slice->out_alloc = MAX (jpegenc->bufsize / n_slices / 4, 4096);
+      slice->out = g_malloc (slice->out_alloc);
+    }
+    slice->quality = quality;
+    slice->smoothing = smoothing;
+    slice->idct_method = idct_method;
+  }
+
+  GST_LOG_OBJECT (jpegenc, "compressing %d slices of %d lines", n_slices,
+      lines);
+
+  jpegenc->slices_pending = n_slices - 1;
+  for (i = 1; i < n_slices; i++)
+    g_thread_pool_push (jpegenc->pool, &jpegenc->slices[i], NULL);
+
+  gst_jpegenc_encode_slice (&jpegenc->slices[0]);
+
+  g_mutex_lock (jpegenc->slice_lock);
+  while (jpegenc->slices_pending > 0)
+    g_cond_wait (jpegenc->slice_cond, jpegenc->slice_lock);
+  g_mutex_unlock (jpegenc->slice_lock);
+
+  GST_LOG_OBJECT (jpegenc, "compressing done");
+
+  /* only this frame is lost, the slices can be used again for the next */
+  for (i = 0; i < n_slices; i++) {
+    if (G_UNLIKELY (jpegenc->slices[i].failed))
+      goto slice_failed;
+  }
+
+  return gst_jpegenc_join_slices (jpegenc, n_slices, buf);
+
+  /* ERRORS */
+slice_failed:
+  {
+    GST_ELEMENT_ERROR (jpegenc, STREAM, ENCODE, (NULL),
+        ("Failed to compress slice %d: %s", i, jpegenc->slices[i].error));
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_jpegenc_chain (GstPad * pad, GstBuffer * buf)
+{
+  GstFlowReturn ret;
+  GstJpegEnc *jpegenc;
+  gulong size;
+  gint quality, smoothing, idct_method;
+
+  jpegenc = GST_JPEGENC (GST_OBJECT_PARENT (pad));
+
+  if (G_UNLIKELY (jpegenc->width <= 0 || jpegenc->height <= 0))
+    goto not_negotiated;
+
+  size = GST_BUFFER_SIZE (buf);
+
+  GST_LOG_OBJECT (jpegenc, "got buffer of %lu bytes", size);
+
+  GST_OBJECT_LOCK (jpegenc);
+  quality = jpegenc->quality;
+  smoothing = jpegenc->smoothing;
+  idct_method = jpegenc->idct_method;
+  GST_OBJECT_UNLOCK (jpegenc);
+
+  /* slices are only worth it with more than one MCU row each */
+  if (jpegenc->pool &&
+      jpegenc->height >= 2 * jpegenc->v_max_samp * DCTSIZE) {
+    ret = gst_jpegenc_encode_slices (jpegenc, buf, quality, smoothing,
+        idct_method);
+    goto done;
+  }
+
+  ret =
+      gst_pad_alloc_buffer_and_set_caps (jpegenc->srcpad,
+      GST_BUFFER_OFFSET_NONE, jpegenc->predicted_size,
+      GST_PAD_CAPS (jpegenc->srcpad), &jpegenc->output_buffer);
+
+  if (ret != GST_FLOW_OK)
+    goto done;
+
+  gst_buffer_copy_metadata (jpegenc->output_buffer, buf,
+      GST_BUFFER_COPY_TIMESTAMPS);
+
+  jpegenc->jdest.next_output_byte = GST_BUFFER_DATA (jpegenc->output_buffer);
+  jpegenc->jdest.free_in_buffer = GST_BUFFER_SIZE (jpegenc->output_buffer);
+
+  gst_jpegenc_prepare_compress (jpegenc, &jpegenc->cinfo, quality, smoothing,
+      idct_method);
+  jpeg_start_compress (&jpegenc->cinfo, TRUE);
+
+  GST_LOG_OBJECT (jpegenc, "compressing");
+
+  gst_jpegenc_write_lines (jpegenc, &jpegenc->cinfo, jpegenc->line,
+      GST_BUFFER_DATA (buf), 0, jpegenc->height);
 
   /* This will ensure that gst_jpegenc_term_destination is called; we push
      the final output buffer from there */
   jpeg_finish_compress (&jpegenc->cinfo);
   GST_LOG_OBJECT (jpegenc, "compressing done");
 
+  ret = jpegenc->last_ret;
+
 done:
   gst_buffer_unref (buf);
 
@@ -675,6 +1019,9 @@ gst_jpegenc_set_property (GObject * object, guint prop_id,
     case PROP_IDCT_METHOD:
       jpegenc->idct_method = g_value_get_enum (value);
       break;
+    case PROP_THREADS:
+      jpegenc->threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -703,6 +1050,9 @@ gst_jpegenc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_IDCT_METHOD:
       g_value_set_enum (value, jpegenc->idct_method);
       break;
+    case PROP_THREADS:
+      g_value_set_uint (value, jpegenc->threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -711,6 +1061,80 @@ gst_jpegenc_get_property (GObject * object, guint prop_id, GValue * value,
   GST_OBJECT_UNLOCK (jpegenc);
 }
 
+static gboolean
+gst_jpegenc_start_pool (GstJpegEnc * jpegenc)
+{
+  GError *err = NULL;
+  guint i;
+
+  GST_OBJECT_LOCK (jpegenc);
+  jpegenc->n_threads = jpegenc->threads;
+  GST_OBJECT_UNLOCK (jpegenc);
+
+  jpegenc->n_threads = gst_get_n_threads (jpegenc->n_threads);
+
+  GST_DEBUG_OBJECT (jpegenc, "using %u encoding threads", jpegenc->n_threads);
+  if (jpegenc->n_threads == 1)
+    return TRUE;
+
+  /* the streaming thread encodes the first slice itself */
+  jpegenc->pool = g_thread_pool_new (gst_jpegenc_slice_worker, jpegenc,
+      jpegenc->n_threads - 1, TRUE, &err);
+  if (jpegenc->pool == NULL) {
+    GST_ELEMENT_ERROR (jpegenc, RESOURCE, FAILED,
+        ("Failed to start the encoding threads"), ("%s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  jpegenc->slices = g_new0 (GstJpegEncSlice, jpegenc->n_threads);
+  for (i = 0; i < jpegenc->n_threads; i++) {
+    GstJpegEncSlice *slice = &jpegenc->slices[i];
+
+    slice->enc = jpegenc;
+    /* the default error_exit would terminate the whole process */
+    slice->cinfo.err = jpeg_std_error (&slice->jerr.pub);
+    slice->jerr.pub.output_message = gst_jpegenc_slice_output_message;
+    slice->jerr.pub.error_exit = gst_jpegenc_slice_error_exit;
+    jpeg_create_compress (&slice->cinfo);
+
+    slice->jdest.init_destination = gst_jpegenc_slice_init_destination;
+    slice->jdest.empty_output_buffer = gst_jpegenc_slice_empty_output_buffer;
+    slice->jdest.term_destination = gst_jpegenc_slice_term_destination;
+    slice->cinfo.dest = &slice->jdest;
+    slice->cinfo.client_data = slice;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_jpegenc_stop_pool (GstJpegEnc * jpegenc)
+{
+  guint i, j, k;
+
+  if (jpegenc->pool) {
+    g_thread_pool_free (jpegenc->pool, FALSE, TRUE);
+    jpegenc->pool = NULL;
+  }
+
+  if (jpegenc->slices) {
+    for (i = 0; i < jpegenc->n_threads; i++) {
+      GstJpegEncSlice *slice = &jpegenc->slices[i];
+
+      jpeg_destroy_compress (&slice->cinfo);
+      for (j = 0; j < 3; j++) {
+        g_free (slice->line[j]);
+        for (k = 0; k < 4 * DCTSIZE; k++)
+          g_free (slice->row[j][k]);
+      }
+      g_free (slice->out);
+    }
+    g_free (jpegenc->slices);
+    jpegenc->slices = NULL;
+  }
+}
+
 static GstStateChangeReturn
 gst_jpegenc_change_state (GstElement * element, GstStateChange transition)
 {
@@ -724,6 +1148,10 @@ gst_jpegenc_change_state (GstElement * element, GstStateChange transition)
       filter->line[1] = NULL;
       filter->line[2] = NULL;
       break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_jpegenc_start_pool (filter))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
     default:
       break;
   }
@@ -734,6 +1162,7 @@ gst_jpegenc_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_jpegenc_stop_pool (filter);
       gst_jpegenc_reset (filter);
       break;
     default:
@@ -29,6 +29,7 @@
 # undef HAVE_STDLIB_H
 #endif
 #include <stdio.h>
+#include <setjmp.h>
 #include <jpeglib.h>
 
 G_BEGIN_DECLS
@@ -45,9 +46,50 @@ G_BEGIN_DECLS
 
 typedef struct _GstJpegEnc GstJpegEnc;
 typedef struct _GstJpegEncClass GstJpegEncClass;
+typedef struct _GstJpegEncSlice GstJpegEncSlice;
 
 #define GST_JPEG_ENC_MAX_COMPONENT  4
 
+struct GstJpegEncErrorMgr {
+  struct jpeg_error_mgr    pub;   /* public fields */
+  jmp_buf                  setjmp_buffer;
+};
+
+/* a band of MCU rows that is compressed as an image of its own, the bands
+ * are joined into one JPEG with restart markers */
+struct _GstJpegEncSlice
+{
+  GstJpegEnc *enc;
+
+  struct jpeg_compress_struct cinfo;
+  struct GstJpegEncErrorMgr jerr;
+  struct jpeg_destination_mgr jdest;
+
+  /* settings of the current frame */
+  gint quality;
+  gint smoothing;
+  gint idct_method;
+
+  /* the jpeg line buffer */
+  guchar **line[3];
+  /* indirect encoding line buffers */
+  guchar *row[3][4 * DCTSIZE];
+
+  /* lines of the current frame */
+  guchar *data;
+  gint first_row;
+  gint n_rows;
+
+  /* compressed data, the memory is kept between frames */
+  guchar *out;
+  guint out_size;
+  guint out_alloc;
+
+  /* set when jpeglib failed on the slice of the current frame */
+  gboolean failed;
+  gchar error[JMSG_LENGTH_MAX];
+};
+
 struct _GstJpegEnc
 {
   GstElement element;
@@ -93,6 +135,17 @@ struct _GstJpegEnc
   GstFlowReturn last_ret;
 
   GstBuffer *output_buffer;
+  /* expected size of the next output buffer */
+  guint predicted_size;
+
+  /* encoding of horizontal slices in parallel */
+  guint threads;
+  guint n_threads;
+  GThreadPool *pool;
+  GstJpegEncSlice *slices;
+  GMutex *slice_lock;
+  GCond *slice_cond;
+  guint slices_pending;
 };
 
 struct _GstJpegEncClass
@@ -71,6 +71,7 @@ GST_DEBUG_CATEGORY_EXTERN (pulse_debug);
 #define DEFAULT_DEVICE_NAME     NULL
 #define DEFAULT_VOLUME          1.0
 #define DEFAULT_MUTE            FALSE
+#define DEFAULT_COALESCE_SEGMENTS 0
 #define MAX_VOLUME              10.0
 
 enum
@@ -83,6 +84,9 @@ enum
   PROP_MUTE,
   PROP_CLIENT,
   PROP_STREAM_PROPERTIES,
+  PROP_COALESCE_SEGMENTS,
+  PROP_UNDERFLOWS,
+  PROP_STREAM_LATENCY,
   PROP_LAST
 };
 
@@ -104,29 +108,13 @@ enum
 typedef struct _GstPulseRingBuffer GstPulseRingBuffer;
 typedef struct _GstPulseRingBufferClass GstPulseRingBufferClass;
 
-typedef struct _GstPulseContext GstPulseContext;
-
-/* Store the PA contexts in a hash table to allow easy sharing among
- * multiple instances of the sink. Keys are $context_name@$server_name
- * (strings) and values should be GstPulseContext pointers.
- */
-struct _GstPulseContext
-{
-  pa_context *context;
-  GSList *ring_buffers;
-};
-
-static GHashTable *gst_pulse_shared_contexts = NULL;
-
-/* use one static main-loop for all instances
- * this is needed to make the context sharing work as the contexts are
- * released when releasing their parent main-loop
- */
+/* the mainloop shared with all pulsesink and pulsesrc instances, see
+ * gst_pulse_shared_mainloop_ref(). It is only set while a pulsesink holds a
+ * reference, so the property accessors of sinks in the NULL state can check
+ * it. */
 static pa_threaded_mainloop *mainloop = NULL;
 static guint mainloop_ref_ct = 0;
-
-/* lock for access to shared resources */
-static GMutex *pa_shared_resource_mutex = NULL;
+G_LOCK_DEFINE_STATIC (mainloop_ref);
 
 /* We keep a custom ringbuffer that is backed up by data allocated by
  * pulseaudio. We must also overide the commit function to write into
@@ -135,7 +123,6 @@ struct _GstPulseRingBuffer
 {
   GstRingBuffer object;
 
-  gchar *context_name;
   gchar *stream_name;
 
   pa_context *context;
@@ -155,6 +142,14 @@ struct _GstPulseRingBuffer
   gint64 m_offset;
   gint64 m_lastoffset;
 
+  /* max number of segments we collect in PulseAudio memory before writing
+   * them to the server, 0 writes out every commit */
+  guint coalesce;
+
+  /* statistics, protected by the mainloop lock */
+  guint underflows;
+  pa_usec_t latency;
+
   gboolean corked:1;
   gboolean in_commit:1;
   gboolean paused:1;
@@ -181,18 +176,11 @@ static void gst_pulseringbuffer_clear (GstRingBuffer * buf);
 static guint gst_pulseringbuffer_commit (GstRingBuffer * buf,
     guint64 * sample, guchar * data, gint in_samples, gint out_samples,
     gint * accum);
+static gboolean gst_pulsering_coalesce_due (GstPulseRingBuffer * pbuf);
+static void gst_pulsering_flush (GstPulseRingBuffer * pbuf);
 
 G_DEFINE_TYPE (GstPulseRingBuffer, gst_pulseringbuffer, GST_TYPE_RING_BUFFER);
 
-static void
-gst_pulsesink_init_contexts (void)
-{
-  g_assert (pa_shared_resource_mutex == NULL);
-  pa_shared_resource_mutex = g_mutex_new ();
-  gst_pulse_shared_contexts = g_hash_table_new_full (g_str_hash, g_str_equal,
-      g_free, NULL);
-}
-
 static void
 gst_pulseringbuffer_class_init (GstPulseRingBufferClass * klass)
 {
@@ -245,27 +233,38 @@ gst_pulseringbuffer_init (GstPulseRingBuffer * pbuf)
   pbuf->m_offset = 0;
   pbuf->m_lastoffset = 0;
 
+  pbuf->coalesce = DEFAULT_COALESCE_SEGMENTS;
+  pbuf->underflows = 0;
+  pbuf->latency = 0;
+
   pbuf->corked = TRUE;
   pbuf->in_commit = FALSE;
   pbuf->paused = FALSE;
 }
 
+/* drops the samples of a begin_write block that are not written yet, called
+ * with the mainloop lock */
 static void
-gst_pulsering_destroy_stream (GstPulseRingBuffer * pbuf)
+gst_pulsering_cancel_write (GstPulseRingBuffer * pbuf)
 {
-  if (pbuf->stream) {
+  if (pbuf->m_data) {
+    /* drop shm memory buffer */
+    pa_stream_cancel_write (pbuf->stream);
 
-    if (pbuf->m_data) {
-      /* drop shm memory buffer */
-      pa_stream_cancel_write (pbuf->stream);
+    /* reset internal variables */
+    pbuf->m_data = NULL;
+    pbuf->m_towrite = 0;
+    pbuf->m_writable = 0;
+    pbuf->m_offset = 0;
+    pbuf->m_lastoffset = 0;
+  }
+}
 
-      /* reset internal variables */
-      pbuf->m_data = NULL;
-      pbuf->m_towrite = 0;
-      pbuf->m_writable = 0;
-      pbuf->m_offset = 0;
-      pbuf->m_lastoffset = 0;
-    }
+static void
+gst_pulsering_destroy_stream (GstPulseRingBuffer * pbuf)
+{
+  if (pbuf->stream) {
+    gst_pulsering_cancel_write (pbuf);
 #ifdef HAVE_PULSE_1_0
     if (pbuf->format) {
       pa_format_info_free (pbuf->format);
@@ -294,48 +293,15 @@ gst_pulsering_destroy_stream (GstPulseRingBuffer * pbuf)
 static void
 gst_pulsering_destroy_context (GstPulseRingBuffer * pbuf)
 {
-  g_mutex_lock (pa_shared_resource_mutex);
-
   GST_DEBUG_OBJECT (pbuf, "destroying ringbuffer %p", pbuf);
 
   gst_pulsering_destroy_stream (pbuf);
 
   if (pbuf->context) {
-    pa_context_unref (pbuf->context);
+    GST_DEBUG_OBJECT (pbuf, "releasing context %p", pbuf->context);
+    gst_pulse_shared_context_release (pbuf->context, pbuf);
     pbuf->context = NULL;
   }
-
-  if (pbuf->context_name) {
-    GstPulseContext *pctx;
-
-    pctx = g_hash_table_lookup (gst_pulse_shared_contexts, pbuf->context_name);
-
-    GST_DEBUG_OBJECT (pbuf, "releasing context with name %s, pbuf=%p, pctx=%p",
-        pbuf->context_name, pbuf, pctx);
-
-    if (pctx) {
-      pctx->ring_buffers = g_slist_remove (pctx->ring_buffers, pbuf);
-      if (pctx->ring_buffers == NULL) {
-        GST_DEBUG_OBJECT (pbuf,
-            "destroying final context with name %s, pbuf=%p, pctx=%p",
-            pbuf->context_name, pbuf, pctx);
-
-        pa_context_disconnect (pctx->context);
-
-        /* Make sure we don't get any further callbacks */
-        pa_context_set_state_callback (pctx->context, NULL, NULL);
-        pa_context_set_subscribe_callback (pctx->context, NULL, NULL);
-
-        g_hash_table_remove (gst_pulse_shared_contexts, pbuf->context_name);
-
-        pa_context_unref (pctx->context);
-        g_slice_free (GstPulseContext, pctx);
-      }
-    }
-    g_free (pbuf->context_name);
-    pbuf->context_name = NULL;
-  }
-  g_mutex_unlock (pa_shared_resource_mutex);
 }
 
 static void
@@ -375,85 +341,55 @@ error:
   }
 }
 
-static void
-gst_pulsering_context_state_cb (pa_context * c, void *userdata)
-{
-  pa_context_state_t state;
-  pa_threaded_mainloop *mainloop = (pa_threaded_mainloop *) userdata;
-
-  state = pa_context_get_state (c);
-
-  GST_LOG ("got new context state %d", state);
-
-  switch (state) {
-    case PA_CONTEXT_READY:
-    case PA_CONTEXT_TERMINATED:
-    case PA_CONTEXT_FAILED:
-      GST_LOG ("signaling");
-      pa_threaded_mainloop_signal (mainloop, 0);
-      break;
-
-    case PA_CONTEXT_UNCONNECTED:
-    case PA_CONTEXT_CONNECTING:
-    case PA_CONTEXT_AUTHORIZING:
-    case PA_CONTEXT_SETTING_NAME:
-      break;
-  }
-}
-
 static void
 gst_pulsering_context_subscribe_cb (pa_context * c,
     pa_subscription_event_type_t t, uint32_t idx, void *userdata)
 {
   GstPulseSink *psink;
-  GstPulseContext *pctx = (GstPulseContext *) userdata;
-  GSList *walk;
+  GstPulseRingBuffer *pbuf = GST_PULSERING_BUFFER_CAST (userdata);
 
   if (t != (PA_SUBSCRIPTION_EVENT_SINK_INPUT | PA_SUBSCRIPTION_EVENT_CHANGE) &&
       t != (PA_SUBSCRIPTION_EVENT_SINK_INPUT | PA_SUBSCRIPTION_EVENT_NEW))
     return;
 
-  for (walk = pctx->ring_buffers; walk; walk = g_slist_next (walk)) {
-    GstPulseRingBuffer *pbuf = (GstPulseRingBuffer *) walk->data;
-    psink = GST_PULSESINK_CAST (GST_OBJECT_PARENT (pbuf));
+  psink = GST_PULSESINK_CAST (GST_OBJECT_PARENT (pbuf));
 
-    GST_LOG_OBJECT (psink, "type %d, idx %u", t, idx);
+  GST_LOG_OBJECT (psink, "type %d, idx %u", t, idx);
 
-    if (!pbuf->stream)
-      continue;
+  if (!pbuf->stream)
+    return;
 
-    if (idx != pa_stream_get_index (pbuf->stream))
-      continue;
+  if (idx != pa_stream_get_index (pbuf->stream))
+    return;
 
 #ifdef HAVE_PULSE_1_0
-    if (psink->device && pbuf->is_pcm &&
-        !g_str_equal (psink->device,
-            pa_stream_get_device_name (pbuf->stream))) {
-      /* Underlying sink changed. And this is not a passthrough stream. Let's
-       * see if someone upstream wants to try to renegotiate. */
-      GstEvent *renego;
+  if (psink->device && pbuf->is_pcm &&
+      !g_str_equal (psink->device,
+          pa_stream_get_device_name (pbuf->stream))) {
+    /* Underlying sink changed. And this is not a passthrough stream. Let's
+     * see if someone upstream wants to try to renegotiate. */
+    GstEvent *renego;
 
-      g_free (psink->device);
-      psink->device = g_strdup (pa_stream_get_device_name (pbuf->stream));
+    g_free (psink->device);
+    psink->device = g_strdup (pa_stream_get_device_name (pbuf->stream));
 
-      GST_INFO_OBJECT (psink, "emitting sink-changed");
+    GST_INFO_OBJECT (psink, "emitting sink-changed");
 
-      renego = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
-          gst_structure_new ("pulse-sink-changed", NULL));
+    renego = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+        gst_structure_new ("pulse-sink-changed", NULL));
 
-      if (!gst_pad_push_event (GST_BASE_SINK (psink)->sinkpad, renego))
-        GST_DEBUG_OBJECT (psink, "Emitted sink-changed - nobody was listening");
-    }
+    if (!gst_pad_push_event (GST_BASE_SINK (psink)->sinkpad, renego))
+      GST_DEBUG_OBJECT (psink, "Emitted sink-changed - nobody was listening");
+  }
 #endif
 
-    /* Actually this event is also triggered when other properties of
-     * the stream change that are unrelated to the volume. However it is
-     * probably cheaper to signal the change here and check for the
-     * volume when the GObject property is read instead of querying it always. */
+  /* Actually this event is also triggered when other properties of
+   * the stream change that are unrelated to the volume. However it is
+   * probably cheaper to signal the change here and check for the
+   * volume when the GObject property is read instead of querying it always. */
 
-    /* inform streaming thread to notify */
-    g_atomic_int_compare_and_exchange (&psink->notify, 0, 1);
-  }
+  /* inform streaming thread to notify */
+  g_atomic_int_compare_and_exchange (&psink->notify, 0, 1);
 }
 
 /* will be called when the device should be opened. In this case we will connect
@@ -463,9 +399,6 @@ gst_pulseringbuffer_open_device (GstRingBuffer * buf)
 {
   GstPulseSink *psink;
   GstPulseRingBuffer *pbuf;
-  GstPulseContext *pctx;
-  pa_mainloop_api *api;
-  gboolean need_unlock_shared;
 
   psink = GST_PULSESINK_CAST (GST_OBJECT_PARENT (buf));
   pbuf = GST_PULSERING_BUFFER_CAST (buf);
@@ -473,56 +406,16 @@ gst_pulseringbuffer_open_device (GstRingBuffer * buf)
   g_assert (!pbuf->stream);
   g_assert (psink->client_name);
 
-  if (psink->server)
-    pbuf->context_name = g_strdup_printf ("%s@%s", psink->client_name,
-        psink->server);
-  else
-    pbuf->context_name = g_strdup (psink->client_name);
-
   pa_threaded_mainloop_lock (mainloop);
 
-  g_mutex_lock (pa_shared_resource_mutex);
-  need_unlock_shared = TRUE;
-
-  pctx = g_hash_table_lookup (gst_pulse_shared_contexts, pbuf->context_name);
-  if (pctx == NULL) {
-    pctx = g_slice_new0 (GstPulseContext);
-
-    /* get the mainloop api and create a context */
-    GST_INFO_OBJECT (psink, "new context with name %s, pbuf=%p, pctx=%p",
-        pbuf->context_name, pbuf, pctx);
-    api = pa_threaded_mainloop_get_api (mainloop);
-    if (!(pctx->context = pa_context_new (api, pbuf->context_name)))
-      goto create_failed;
-
-    pctx->ring_buffers = g_slist_prepend (pctx->ring_buffers, pbuf);
-    g_hash_table_insert (gst_pulse_shared_contexts,
-        g_strdup (pbuf->context_name), (gpointer) pctx);
-    /* register some essential callbacks */
-    pa_context_set_state_callback (pctx->context,
-        gst_pulsering_context_state_cb, mainloop);
-    pa_context_set_subscribe_callback (pctx->context,
-        gst_pulsering_context_subscribe_cb, pctx);
-
-    /* try to connect to the server and wait for completion, we don't want to
-     * autospawn a deamon */
-    GST_LOG_OBJECT (psink, "connect to server %s",
-        GST_STR_NULL (psink->server));
-    if (pa_context_connect (pctx->context, psink->server,
-            PA_CONTEXT_NOAUTOSPAWN, NULL) < 0)
-      goto connect_failed;
-  } else {
-    GST_INFO_OBJECT (psink,
-        "reusing shared context with name %s, pbuf=%p, pctx=%p",
-        pbuf->context_name, pbuf, pctx);
-    pctx->ring_buffers = g_slist_prepend (pctx->ring_buffers, pbuf);
-  }
-
-  g_mutex_unlock (pa_shared_resource_mutex);
-  need_unlock_shared = FALSE;
-
-  /* context created or shared okay */
-  pbuf->context = pa_context_ref (pctx->context);
+  /* get the context shared with all elements using the same client name and
+   * server, we don't want to autospawn a deamon */
+  GST_LOG_OBJECT (psink, "getting context for server %s",
+      GST_STR_NULL (psink->server));
+  if (!(pbuf->context = gst_pulse_shared_context_acquire (psink->client_name,
+              psink->server, PA_CONTEXT_NOAUTOSPAWN,
+              gst_pulsering_context_subscribe_cb, pbuf)))
+    goto create_failed;
 
   for (;;) {
     pa_context_state_t state;
@@ -551,8 +444,6 @@ gst_pulseringbuffer_open_device (GstRingBuffer * buf)
   /* ERRORS */
 unlock_and_fail:
   {
-    if (need_unlock_shared)
-      g_mutex_unlock (pa_shared_resource_mutex);
     gst_pulsering_destroy_context (pbuf);
     pa_threaded_mainloop_unlock (mainloop);
     return FALSE;
@@ -561,13 +452,12 @@ create_failed:
   {
     GST_ELEMENT_ERROR (psink, RESOURCE, FAILED,
         ("Failed to create context"), (NULL));
-    g_slice_free (GstPulseContext, pctx);
     goto unlock_and_fail;
   }
 connect_failed:
   {
     GST_ELEMENT_ERROR (psink, RESOURCE, FAILED, ("Failed to connect: %s",
-            pa_strerror (pa_context_errno (pctx->context))), (NULL));
+            pa_strerror (pa_context_errno (pbuf->context))), (NULL));
     goto unlock_and_fail;
   }
 }
@@ -637,6 +527,10 @@ gst_pulsering_stream_request_cb (pa_stream * s, size_t length, void *userdata)
      * and got request for atleast a segment */
     pa_threaded_mainloop_signal (mainloop, 0);
   }
+
+  /* the server is running low, write out the samples collected so far */
+  if (!pbuf->in_commit && gst_pulsering_coalesce_due (pbuf))
+    gst_pulsering_flush (pbuf);
 }
 
 static void
@@ -648,7 +542,9 @@ gst_pulsering_stream_underflow_cb (pa_stream * s, void *userdata)
   pbuf = GST_PULSERING_BUFFER_CAST (userdata);
   psink = GST_PULSESINK_CAST (GST_OBJECT_PARENT (pbuf));
 
-  GST_WARNING_OBJECT (psink, "Got underflow");
+  pbuf->underflows++;
+
+  GST_WARNING_OBJECT (psink, "Got underflow (%u)", pbuf->underflows);
 }
 
 static void
@@ -670,12 +566,18 @@ gst_pulsering_stream_latency_cb (pa_stream * s, void *userdata)
   GstPulseRingBuffer *pbuf;
   const pa_timing_info *info;
   pa_usec_t sink_usec;
+  pa_usec_t latency;
+  int negative;
 
   info = pa_stream_get_timing_info (s);
 
   pbuf = GST_PULSERING_BUFFER_CAST (userdata);
   psink = GST_PULSESINK_CAST (GST_OBJECT_PARENT (pbuf));
 
+  /* keep the total playback latency around for the stream-latency property */
+  if (pa_stream_get_latency (s, &latency, &negative) == 0)
+    pbuf->latency = negative ? 0 : latency;
+
   if (!info) {
     GST_LOG_OBJECT (psink, "latency update (information unknown)");
     return;
@@ -840,8 +742,8 @@ gst_pulseringbuffer_acquire (GstRingBuffer * buf, GstRingBufferSpec * spec)
 
   /* enable event notifications */
   GST_LOG_OBJECT (psink, "subscribing to context events");
-  if (!(o = pa_context_subscribe (pbuf->context,
-              PA_SUBSCRIPTION_MASK_SINK_INPUT, NULL, NULL)))
+  if (!(o = gst_pulse_shared_context_subscribe (pbuf->context, pbuf,
+              PA_SUBSCRIPTION_MASK_SINK_INPUT)))
     goto subscribe_failed;
 
   pa_operation_unref (o);
@@ -935,6 +837,11 @@ gst_pulseringbuffer_acquire (GstRingBuffer * buf, GstRingBufferSpec * spec)
   /* we always start corked (see flags above) */
   pbuf->corked = TRUE;
 
+  /* reset statistics and pick up the coalescing configuration */
+  pbuf->coalesce = psink->coalesce_segments;
+  pbuf->underflows = 0;
+  pbuf->latency = 0;
+
   /* try to connect now */
   GST_LOG_OBJECT (psink, "connect for playback to device %s",
       GST_STR_NULL (psink->device));
@@ -1121,6 +1028,8 @@ gst_pulseringbuffer_clear (GstRingBuffer * buf)
   pa_threaded_mainloop_lock (mainloop);
   GST_DEBUG_OBJECT (psink, "clearing");
   if (pbuf->stream) {
+    /* samples coalesced before the flush must not be written after it */
+    gst_pulsering_cancel_write (pbuf);
     /* don't wait for the flush to complete */
     if ((o = pa_stream_flush (pbuf->stream, NULL, pbuf)))
       pa_operation_unref (o);
@@ -1366,6 +1275,33 @@ G_STMT_START {                                  \
   GST_DEBUG ("rev_down end %d/%d",*accum,*toprocess);   \
 } G_STMT_END
 
+/* Check if a partially filled block must be written out now. When
+ * coalescing, samples are kept in the block across commits until it is full,
+ * but never longer than the server can play from what it already has queued:
+ * once less than one segment is left at the server, the block is due. Must be
+ * called with the mainloop lock. */
+static gboolean
+gst_pulsering_coalesce_due (GstPulseRingBuffer * pbuf)
+{
+  GstRingBuffer *buf = GST_RING_BUFFER_CAST (pbuf);
+  const pa_buffer_attr *attr;
+  size_t writable;
+
+  if (pbuf->m_data == NULL || pbuf->m_towrite == 0)
+    return FALSE;
+
+  /* without coalescing blocks only span one commit */
+  if (pbuf->coalesce == 0 || pbuf->corked)
+    return FALSE;
+
+  attr = pa_stream_get_buffer_attr (pbuf->stream);
+  writable = pa_stream_writable_size (pbuf->stream);
+  if (attr == NULL || writable == (size_t) - 1)
+    return TRUE;
+
+  return writable + buf->spec.segsize >= attr->tlength;
+}
+
 /* our custom commit function because we write into the buffer of pulseaudio
  * instead of keeping our own buffer */
 static guint
@@ -1475,7 +1411,11 @@ gst_pulseringbuffer_commit (GstRingBuffer * buf, guint64 * sample,
                 pbuf->m_towrite, NULL, pbuf->m_offset, PA_SEEK_ABSOLUTE) < 0) {
           goto write_failed;
         }
+      } else if (pbuf->m_data != NULL) {
+        /* nothing was written in the block, give it back */
+        pa_stream_cancel_write (pbuf->stream);
       }
+      pbuf->m_data = NULL;
       pbuf->m_towrite = 0;
       pbuf->m_offset = offset;  /* keep track of current offset */
 
@@ -1513,8 +1453,12 @@ gst_pulseringbuffer_commit (GstRingBuffer * buf, guint64 * sample,
           goto was_paused;
       }
 
-      /* Recalculate what we can write in the next chunk */
+      /* Recalculate what we can write in the next chunk. When coalescing on a
+       * running stream, ask for room for more segments so that the following
+       * commits can fill the same block. */
       towrite = out_samples * bps;
+      if (pbuf->coalesce > 0 && !pbuf->corked)
+        towrite = MAX (towrite, pbuf->coalesce * buf->spec.segsize);
       if (pbuf->m_writable > towrite)
         pbuf->m_writable = towrite;
 
@@ -1598,6 +1542,7 @@ gst_pulseringbuffer_commit (GstRingBuffer * buf, guint64 * sample,
               pbuf->m_towrite, NULL, pbuf->m_offset, PA_SEEK_ABSOLUTE) < 0) {
         goto write_failed;
       }
+      pbuf->m_data = NULL;
       pbuf->m_towrite = 0;
       pbuf->m_offset = offset + towrite;        /* keep track of current offset */
     }
@@ -1627,6 +1572,10 @@ gst_pulseringbuffer_commit (GstRingBuffer * buf, guint64 * sample,
     }
   }
 
+  /* don't hold back samples the server needs to keep playing */
+  if (gst_pulsering_coalesce_due (pbuf))
+    gst_pulsering_flush (pbuf);
+
 #ifdef HAVE_PULSE_1_0
 fake_done:
 #endif
@@ -1715,8 +1664,12 @@ gst_pulsering_flush (GstPulseRingBuffer * pbuf)
       goto write_failed;
     }
 
-    pbuf->m_towrite = 0;
+    /* the block is consumed by pa_stream_write(), make sure the commit
+     * function requests a new one */
     pbuf->m_offset += pbuf->m_towrite;  /* keep track of current offset */
+    pbuf->m_data = NULL;
+    pbuf->m_towrite = 0;
+    pbuf->m_writable = 0;
   }
 
 done:
@@ -1748,7 +1701,6 @@ static void gst_pulsesink_init_interfaces (GType type);
 GST_IMPLEMENT_PULSEPROBE_METHODS (GstPulseSink, gst_pulsesink);
 
 #define _do_init(type) \
-  gst_pulsesink_init_contexts (); \
   gst_pulsesink_init_interfaces (type);
 
 GST_BOILERPLATE_FULL (GstPulseSink, gst_pulsesink, GstBaseAudioSink,
@@ -1954,6 +1906,55 @@ gst_pulsesink_class_init (GstPulseSinkClass * klass)
       g_param_spec_boxed ("stream-properties", "stream properties",
           "list of pulseaudio stream properties",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstPulseSink:coalesce-segments
+   *
+   * Maximum number of ringbuffer segments to collect in one block of
+   * PulseAudio memory before writing them to the server. Several segments
+   * are then handed over per pa_stream_write() call, which reduces the
+   * per-write overhead when many low-latency streams are active. A block is
+   * written out early when the server has less than one segment left to
+   * play. 0 writes out the samples of every segment immediately.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_COALESCE_SEGMENTS,
+      g_param_spec_uint ("coalesce-segments", "Coalesce segments",
+          "Maximum number of segments to collect before writing them to the "
+          "server (0 = write every commit)", 0, G_MAXINT / 2,
+          DEFAULT_COALESCE_SEGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstPulseSink:underflows
+   *
+   * Number of underflows reported by the server since the stream was
+   * created.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_UNDERFLOWS,
+      g_param_spec_uint ("underflows", "Underflows",
+          "Number of underflows reported by the server for this stream",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstPulseSink:stream-latency
+   *
+   * The total playback latency of the stream, in nanoseconds, as of the
+   * last timing update from the server.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_STREAM_LATENCY,
+      g_param_spec_uint64 ("stream-latency", "Stream latency",
+          "Last reported playback latency of the stream in nanoseconds",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 /* returns the current time of the sink ringbuffer */
@@ -2204,6 +2205,8 @@ gst_pulsesink_init (GstPulseSink * pulsesink, GstPulseSinkClass * klass)
   pulsesink->mute = DEFAULT_MUTE;
   pulsesink->mute_set = FALSE;
 
+  pulsesink->coalesce_segments = DEFAULT_COALESCE_SEGMENTS;
+
   pulsesink->notify = 0;
 
 #ifdef HAVE_PULSE_1_0
@@ -2629,6 +2632,28 @@ info_failed:
   }
 }
 
+/* read the stream statistics collected by the ringbuffer */
+static void
+gst_pulsesink_get_stats (GstPulseSink * psink, guint * underflows,
+    GstClockTime * latency)
+{
+  GstPulseRingBuffer *pbuf;
+
+  *underflows = 0;
+  *latency = 0;
+
+  if (!mainloop)
+    return;
+
+  pa_threaded_mainloop_lock (mainloop);
+  pbuf = GST_PULSERING_BUFFER_CAST (GST_BASE_AUDIO_SINK (psink)->ringbuffer);
+  if (pbuf != NULL && pbuf->stream != NULL) {
+    *underflows = pbuf->underflows;
+    *latency = pbuf->latency * GST_USECOND;
+  }
+  pa_threaded_mainloop_unlock (mainloop);
+}
+
 static void
 gst_pulsesink_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
@@ -2670,6 +2695,9 @@ gst_pulsesink_set_property (GObject * object,
         pa_proplist_free (pulsesink->proplist);
       pulsesink->proplist = gst_pulse_make_proplist (pulsesink->properties);
       break;
+    case PROP_COALESCE_SEGMENTS:
+      pulsesink->coalesce_segments = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2705,6 +2733,25 @@ gst_pulsesink_get_property (GObject * object,
     case PROP_STREAM_PROPERTIES:
       gst_value_set_structure (value, pulsesink->properties);
       break;
+    case PROP_COALESCE_SEGMENTS:
+      g_value_set_uint (value, pulsesink->coalesce_segments);
+      break;
+    case PROP_UNDERFLOWS:{
+      guint underflows;
+      GstClockTime latency;
+
+      gst_pulsesink_get_stats (pulsesink, &underflows, &latency);
+      g_value_set_uint (value, underflows);
+      break;
+    }
+    case PROP_STREAM_LATENCY:{
+      guint underflows;
+      GstClockTime latency;
+
+      gst_pulsesink_get_stats (pulsesink, &underflows, &latency);
+      g_value_set_uint64 (value, latency);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2933,15 +2980,26 @@ gst_pulsesink_release_mainloop (GstPulseSink * psink)
   }
   pa_threaded_mainloop_unlock (mainloop);
 
-  g_mutex_lock (pa_shared_resource_mutex);
-  mainloop_ref_ct--;
-  if (!mainloop_ref_ct) {
-    GST_INFO_OBJECT (psink, "terminating pa main loop thread");
-    pa_threaded_mainloop_stop (mainloop);
-    pa_threaded_mainloop_free (mainloop);
+  G_LOCK (mainloop_ref);
+  if (--mainloop_ref_ct == 0)
     mainloop = NULL;
+  gst_pulse_shared_mainloop_unref ();
+  G_UNLOCK (mainloop_ref);
+}
+
+static gboolean
+gst_pulsesink_acquire_mainloop (GstPulseSink * psink)
+{
+  pa_threaded_mainloop *m;
+
+  G_LOCK (mainloop_ref);
+  if ((m = gst_pulse_shared_mainloop_ref ())) {
+    mainloop = m;
+    mainloop_ref_ct++;
   }
-  g_mutex_unlock (pa_shared_resource_mutex);
+  G_UNLOCK (mainloop_ref);
+
+  return m != NULL;
 }
 
 static GstStateChangeReturn
@@ -2952,22 +3010,8 @@ gst_pulsesink_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
-      g_mutex_lock (pa_shared_resource_mutex);
-      if (!mainloop_ref_ct) {
-        GST_INFO_OBJECT (element, "new pa main loop thread");
-        if (!(mainloop = pa_threaded_mainloop_new ()))
-          goto mainloop_failed;
-        if (pa_threaded_mainloop_start (mainloop) < 0) {
-          pa_threaded_mainloop_free (mainloop);
-          goto mainloop_start_failed;
-        }
-        mainloop_ref_ct = 1;
-        g_mutex_unlock (pa_shared_resource_mutex);
-      } else {
-        GST_INFO_OBJECT (element, "reusing pa main loop thread");
-        mainloop_ref_ct++;
-        g_mutex_unlock (pa_shared_resource_mutex);
-      }
+      if (!gst_pulsesink_acquire_mainloop (pulsesink))
+        goto mainloop_failed;
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       gst_element_post_message (element,
@@ -3002,16 +3046,8 @@ gst_pulsesink_change_state (GstElement * element, GstStateChange transition)
   /* ERRORS */
 mainloop_failed:
   {
-    g_mutex_unlock (pa_shared_resource_mutex);
-    GST_ELEMENT_ERROR (pulsesink, RESOURCE, FAILED,
-        ("pa_threaded_mainloop_new() failed"), (NULL));
-    return GST_STATE_CHANGE_FAILURE;
-  }
-mainloop_start_failed:
-  {
-    g_mutex_unlock (pa_shared_resource_mutex);
     GST_ELEMENT_ERROR (pulsesink, RESOURCE, FAILED,
-        ("pa_threaded_mainloop_start() failed"), (NULL));
+        ("Failed to start the PulseAudio mainloop"), (NULL));
     return GST_STATE_CHANGE_FAILURE;
   }
 state_failure:
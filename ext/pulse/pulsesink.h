@@ -70,6 +70,8 @@ struct _GstPulseSink
 
   guint defer_pending;
 
+  guint coalesce_segments;
+
   gint notify; /* atomic */
 
   const gchar *pa_version;
@@ -415,6 +415,15 @@ gst_pulsesrc_destroy_stream (GstPulseSrc * pulsesrc)
 {
   if (pulsesrc->stream) {
     pa_stream_disconnect (pulsesrc->stream);
+
+    /* Make sure we don't get any further callbacks, the mainloop keeps
+     * running for the other elements sharing it */
+    pa_stream_set_state_callback (pulsesrc->stream, NULL, NULL);
+    pa_stream_set_read_callback (pulsesrc->stream, NULL, NULL);
+    pa_stream_set_underflow_callback (pulsesrc->stream, NULL, NULL);
+    pa_stream_set_overflow_callback (pulsesrc->stream, NULL, NULL);
+    pa_stream_set_latency_update_callback (pulsesrc->stream, NULL, NULL);
+
     pa_stream_unref (pulsesrc->stream);
     pulsesrc->stream = NULL;
     pulsesrc->source_output_idx = PA_INVALID_INDEX;
@@ -432,16 +441,7 @@ gst_pulsesrc_destroy_context (GstPulseSrc * pulsesrc)
   gst_pulsesrc_destroy_stream (pulsesrc);
 
   if (pulsesrc->context) {
-    pa_context_disconnect (pulsesrc->context);
-
-    /* Make sure we don't get any further callbacks */
-    pa_context_set_state_callback (pulsesrc->context, NULL, NULL);
-#ifdef HAVE_PULSE_1_0
-    pa_context_set_subscribe_callback (pulsesrc->context, NULL, NULL);
-#endif
-
-    pa_context_unref (pulsesrc->context);
-
+    gst_pulse_shared_context_release (pulsesrc->context, pulsesrc);
     pulsesrc->context = NULL;
   }
 }
@@ -903,26 +903,6 @@ gst_pulsesrc_get_property (GObject * object,
   }
 }
 
-static void
-gst_pulsesrc_context_state_cb (pa_context * c, void *userdata)
-{
-  GstPulseSrc *pulsesrc = GST_PULSESRC_CAST (userdata);
-
-  switch (pa_context_get_state (c)) {
-    case PA_CONTEXT_READY:
-    case PA_CONTEXT_TERMINATED:
-    case PA_CONTEXT_FAILED:
-      pa_threaded_mainloop_signal (pulsesrc->mainloop, 0);
-      break;
-
-    case PA_CONTEXT_UNCONNECTED:
-    case PA_CONTEXT_CONNECTING:
-    case PA_CONTEXT_AUTHORIZING:
-    case PA_CONTEXT_SETTING_NAME:
-      break;
-  }
-}
-
 static void
 gst_pulsesrc_stream_state_cb (pa_stream * s, void *userdata)
 {
@@ -1026,27 +1006,22 @@ gst_pulsesrc_open (GstAudioSrc * asrc)
 
   GST_DEBUG_OBJECT (pulsesrc, "opening device");
 
-  if (!(pulsesrc->context =
-          pa_context_new (pa_threaded_mainloop_get_api (pulsesrc->mainloop),
-              pulsesrc->client_name))) {
-    GST_ELEMENT_ERROR (pulsesrc, RESOURCE, FAILED, ("Failed to create context"),
-        (NULL));
-    goto unlock_and_fail;
-  }
+  /* get the context shared with all elements using the same client name and
+   * server */
+  GST_DEBUG_OBJECT (pulsesrc, "getting context for server %s",
+      GST_STR_NULL (pulsesrc->server));
 
-  pa_context_set_state_callback (pulsesrc->context,
-      gst_pulsesrc_context_state_cb, pulsesrc);
+  if (!(pulsesrc->context =
+          gst_pulse_shared_context_acquire (pulsesrc->client_name,
+              pulsesrc->server, PA_CONTEXT_NOFLAGS,
 #ifdef HAVE_PULSE_1_0
-  pa_context_set_subscribe_callback (pulsesrc->context,
-      gst_pulsesrc_context_subscribe_cb, pulsesrc);
+              gst_pulsesrc_context_subscribe_cb,
+#else
+              NULL,
 #endif
-
-  GST_DEBUG_OBJECT (pulsesrc, "connect to server %s",
-      GST_STR_NULL (pulsesrc->server));
-
-  if (pa_context_connect (pulsesrc->context, pulsesrc->server, 0, NULL) < 0) {
-    GST_ELEMENT_ERROR (pulsesrc, RESOURCE, FAILED, ("Failed to connect: %s",
-            pa_strerror (pa_context_errno (pulsesrc->context))), (NULL));
+              pulsesrc))) {
+    GST_ELEMENT_ERROR (pulsesrc, RESOURCE, FAILED, ("Failed to create context"),
+        (NULL));
     goto unlock_and_fail;
   }
 
@@ -1438,8 +1413,8 @@ gst_pulsesrc_prepare (GstAudioSrc * asrc, GstRingBufferSpec * spec)
 #ifdef HAVE_PULSE_1_0
   /* enable event notifications */
   GST_LOG_OBJECT (pulsesrc, "subscribing to context events");
-  if (!(o = pa_context_subscribe (pulsesrc->context,
-              PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT, NULL, NULL))) {
+  if (!(o = gst_pulse_shared_context_subscribe (pulsesrc->context, pulsesrc,
+              PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT))) {
     GST_ELEMENT_ERROR (pulsesrc, RESOURCE, FAILED,
         ("pa_context_subscribe() failed: %s",
             pa_strerror (pa_context_errno (pulsesrc->context))), (NULL));
@@ -1692,13 +1667,8 @@ gst_pulsesrc_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
-      if (!(this->mainloop = pa_threaded_mainloop_new ()))
+      if (!(this->mainloop = gst_pulse_shared_mainloop_ref ()))
         goto mainloop_failed;
-      if (pa_threaded_mainloop_start (this->mainloop) < 0) {
-        pa_threaded_mainloop_free (this->mainloop);
-        this->mainloop = NULL;
-        goto mainloop_start_failed;
-      }
 
       if (!this->mixer)
         this->mixer =
@@ -1738,13 +1708,12 @@ gst_pulsesrc_change_state (GstElement * element, GstStateChange transition)
         this->mixer = NULL;
       }
 
-      if (this->mainloop)
-        pa_threaded_mainloop_stop (this->mainloop);
-
-      gst_pulsesrc_destroy_context (this);
-
       if (this->mainloop) {
-        pa_threaded_mainloop_free (this->mainloop);
+        pa_threaded_mainloop_lock (this->mainloop);
+        gst_pulsesrc_destroy_context (this);
+        pa_threaded_mainloop_unlock (this->mainloop);
+
+        gst_pulse_shared_mainloop_unref ();
         this->mainloop = NULL;
       }
       break;
@@ -1764,13 +1733,7 @@ gst_pulsesrc_change_state (GstElement * element, GstStateChange transition)
 mainloop_failed:
   {
     GST_ELEMENT_ERROR (this, RESOURCE, FAILED,
-        ("pa_threaded_mainloop_new() failed"), (NULL));
-    return GST_STATE_CHANGE_FAILURE;
-  }
-mainloop_start_failed:
-  {
-    GST_ELEMENT_ERROR (this, RESOURCE, FAILED,
-        ("pa_threaded_mainloop_start() failed"), (NULL));
+        ("Failed to start the PulseAudio mainloop"), (NULL));
     return GST_STATE_CHANGE_FAILURE;
   }
 }
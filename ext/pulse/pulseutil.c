@@ -33,6 +33,9 @@
 # include <process.h>           /* getpid on win32 */
 #endif
 
+GST_DEBUG_CATEGORY_EXTERN (pulse_debug);
+#define GST_CAT_DEFAULT pulse_debug
+
 static const pa_channel_position_t gst_pos_to_pa[GST_AUDIO_CHANNEL_POSITION_NUM]
     = {
   [GST_AUDIO_CHANNEL_POSITION_FRONT_MONO] = PA_CHANNEL_POSITION_MONO,
@@ -335,3 +338,362 @@ gst_pulse_make_proplist (const GstStructure * properties)
   gst_structure_foreach (properties, make_proplist_item, proplist);
   return proplist;
 }
+
+/* Use one static main-loop for all pulsesink and pulsesrc instances of the
+ * process. This is needed to make the context sharing work as the contexts are
+ * released when releasing their parent main-loop. */
+static pa_threaded_mainloop *shared_mainloop = NULL;
+static guint shared_mainloop_ref_ct = 0;
+
+/* Store the PA contexts in a hash table to allow easy sharing among
+ * multiple element instances. Keys are $client_name@$server_name#$flags
+ * (strings) and values GstPulseContext pointers, so elements that connect
+ * with different flags don't share. Every user of a context registers a
+ * subscriber to get the subscription events it is interested in. Contexts
+ * that failed are moved from the table to a list until their last user
+ * releases them, so they are not handed out again. */
+typedef struct
+{
+  GstPulseSubscribeFunc func;
+  gpointer user_data;
+  pa_subscription_mask_t mask;
+} GstPulseSubscriber;
+
+typedef struct
+{
+  pa_context *context;
+  GSList *subscribers;
+} GstPulseContext;
+
+static GHashTable *shared_contexts = NULL;
+static GSList *failed_contexts = NULL;
+
+/* lock for access to the shared mainloop and the context table */
+G_LOCK_DEFINE_STATIC (shared_resources);
+
+/**
+ * gst_pulse_shared_mainloop_ref:
+ *
+ * Get a reference to the threaded mainloop shared by all elements of the
+ * process, creating and starting it when needed.
+ *
+ * Returns: the shared mainloop or %NULL when it could not be started.
+ */
+pa_threaded_mainloop *
+gst_pulse_shared_mainloop_ref (void)
+{
+  pa_threaded_mainloop *m = NULL;
+
+  G_LOCK (shared_resources);
+  if (shared_mainloop_ref_ct == 0) {
+    GST_INFO ("new pa main loop thread");
+    if (!(shared_mainloop = pa_threaded_mainloop_new ()))
+      goto done;
+    if (pa_threaded_mainloop_start (shared_mainloop) < 0) {
+      pa_threaded_mainloop_free (shared_mainloop);
+      shared_mainloop = NULL;
+      goto done;
+    }
+  } else {
+    GST_INFO ("reusing pa main loop thread");
+  }
+  shared_mainloop_ref_ct++;
+  m = shared_mainloop;
+
+done:
+  G_UNLOCK (shared_resources);
+
+  return m;
+}
+
+/**
+ * gst_pulse_shared_mainloop_unref:
+ *
+ * Release a reference obtained with gst_pulse_shared_mainloop_ref(). The
+ * mainloop thread is stopped when the last reference is released. Must be
+ * called without the mainloop lock.
+ */
+void
+gst_pulse_shared_mainloop_unref (void)
+{
+  G_LOCK (shared_resources);
+  g_assert (shared_mainloop_ref_ct > 0);
+  shared_mainloop_ref_ct--;
+  if (shared_mainloop_ref_ct == 0) {
+    GST_INFO ("terminating pa main loop thread");
+    pa_threaded_mainloop_stop (shared_mainloop);
+    pa_threaded_mainloop_free (shared_mainloop);
+    shared_mainloop = NULL;
+  }
+  G_UNLOCK (shared_resources);
+}
+
+static void
+gst_pulse_shared_context_state_cb (pa_context * c, void *userdata)
+{
+  pa_context_state_t state;
+
+  state = pa_context_get_state (c);
+
+  GST_LOG ("got new context state %d", state);
+
+  switch (state) {
+    case PA_CONTEXT_READY:
+    case PA_CONTEXT_TERMINATED:
+    case PA_CONTEXT_FAILED:
+      GST_LOG ("signaling");
+      pa_threaded_mainloop_signal (shared_mainloop, 0);
+      break;
+
+    case PA_CONTEXT_UNCONNECTED:
+    case PA_CONTEXT_CONNECTING:
+    case PA_CONTEXT_AUTHORIZING:
+    case PA_CONTEXT_SETTING_NAME:
+      break;
+  }
+}
+
+static void
+gst_pulse_shared_context_subscribe_cb (pa_context * c,
+    pa_subscription_event_type_t t, uint32_t idx, void *userdata)
+{
+  GstPulseContext *pctx = (GstPulseContext *) userdata;
+  GSList *walk;
+
+  for (walk = pctx->subscribers; walk; walk = g_slist_next (walk)) {
+    GstPulseSubscriber *sub = (GstPulseSubscriber *) walk->data;
+
+    if (sub->func && pa_subscription_match_flags (sub->mask, t))
+      sub->func (c, t, idx, sub->user_data);
+  }
+}
+
+static gboolean
+find_context (gpointer key, gpointer value, gpointer user_data)
+{
+  return ((GstPulseContext *) value)->context == (pa_context *) user_data;
+}
+
+/* called with the shared_resources lock */
+static GstPulseContext *
+gst_pulse_shared_context_find (pa_context * context)
+{
+  GstPulseContext *pctx = NULL;
+  GSList *walk;
+
+  if (shared_contexts)
+    pctx = g_hash_table_find (shared_contexts, find_context, context);
+
+  for (walk = failed_contexts; pctx == NULL && walk; walk = walk->next) {
+    if (((GstPulseContext *) walk->data)->context == context)
+      pctx = walk->data;
+  }
+
+  return pctx;
+}
+
+/* stop handing out a context that can't connect anymore, called with the
+ * shared_resources lock */
+static void
+gst_pulse_shared_context_fail (GstPulseContext * pctx)
+{
+  if (g_hash_table_foreach_remove (shared_contexts, find_context,
+          pctx->context) > 0)
+    failed_contexts = g_slist_prepend (failed_contexts, pctx);
+}
+
+static GstPulseSubscriber *
+find_subscriber (GstPulseContext * pctx, gpointer user_data)
+{
+  GSList *walk;
+
+  for (walk = pctx->subscribers; walk; walk = g_slist_next (walk)) {
+    GstPulseSubscriber *sub = (GstPulseSubscriber *) walk->data;
+
+    if (sub->user_data == user_data)
+      return sub;
+  }
+  return NULL;
+}
+
+/**
+ * gst_pulse_shared_context_acquire:
+ * @client_name: the PulseAudio client name
+ * @server: the server to connect to or %NULL for the default server
+ * @flags: connection flags, contexts are only shared between users passing
+ *     the same flags
+ * @func: function called for subscription events of this user or %NULL
+ * @user_data: identifies the user of the context, passed to @func
+ *
+ * Get the context connected to @server for @client_name, creating it and
+ * starting the connection when no other element uses it yet. The caller
+ * should wait for the context to become ready. Must be called with the
+ * shared mainloop lock.
+ *
+ * Returns: a new reference to the context or %NULL when it could not be
+ * created. Release it with gst_pulse_shared_context_release().
+ */
+pa_context *
+gst_pulse_shared_context_acquire (const gchar * client_name,
+    const gchar * server, pa_context_flags_t flags,
+    GstPulseSubscribeFunc func, gpointer user_data)
+{
+  GstPulseContext *pctx;
+  GstPulseSubscriber *sub;
+  gchar *name;
+
+  g_return_val_if_fail (client_name != NULL, NULL);
+  g_return_val_if_fail (shared_mainloop != NULL, NULL);
+
+  name = g_strdup_printf ("%s@%s#%d", client_name, GST_STR_NULL (server),
+      (gint) flags);
+
+  G_LOCK (shared_resources);
+  if (shared_contexts == NULL)
+    shared_contexts = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, NULL);
+
+  pctx = g_hash_table_lookup (shared_contexts, name);
+  if (pctx && !PA_CONTEXT_IS_GOOD (pa_context_get_state (pctx->context))) {
+    GST_INFO ("shared context with name %s failed, replacing it", name);
+    gst_pulse_shared_context_fail (pctx);
+    pctx = NULL;
+  }
+
+  if (pctx == NULL) {
+    pa_context *context;
+
+    GST_INFO ("new context with name %s", name);
+    context = pa_context_new (pa_threaded_mainloop_get_api (shared_mainloop),
+        client_name);
+    if (context == NULL)
+      goto create_failed;
+
+    pctx = g_slice_new0 (GstPulseContext);
+    pctx->context = context;
+    g_hash_table_insert (shared_contexts, name, pctx);
+    name = NULL;
+
+    /* register some essential callbacks */
+    pa_context_set_state_callback (context,
+        gst_pulse_shared_context_state_cb, NULL);
+    pa_context_set_subscribe_callback (context,
+        gst_pulse_shared_context_subscribe_cb, pctx);
+
+    /* try to connect to the server, a failure shows up in the context state
+     * the caller waits for */
+    GST_LOG ("connect to server %s", GST_STR_NULL (server));
+    if (pa_context_connect (context, server, flags, NULL) < 0) {
+      GST_WARNING ("failed to connect: %s",
+          pa_strerror (pa_context_errno (context)));
+      gst_pulse_shared_context_fail (pctx);
+    }
+  } else {
+    GST_INFO ("reusing shared context with name %s", name);
+  }
+
+  sub = g_slice_new0 (GstPulseSubscriber);
+  sub->func = func;
+  sub->user_data = user_data;
+  pctx->subscribers = g_slist_prepend (pctx->subscribers, sub);
+  G_UNLOCK (shared_resources);
+
+  g_free (name);
+
+  return pa_context_ref (pctx->context);
+
+  /* ERRORS */
+create_failed:
+  {
+    G_UNLOCK (shared_resources);
+    GST_WARNING ("failed to create context %s", name);
+    g_free (name);
+    return NULL;
+  }
+}
+
+/**
+ * gst_pulse_shared_context_subscribe:
+ * @context: a context from gst_pulse_shared_context_acquire()
+ * @user_data: the user passed to gst_pulse_shared_context_acquire()
+ * @mask: the events this user is interested in
+ *
+ * Enable the subscription events in @mask for this user. The server is
+ * asked for the union of the events of all users of the context. Must be
+ * called with the shared mainloop lock.
+ *
+ * Returns: the pa_operation of the subscription request or %NULL on
+ * failure.
+ */
+pa_operation *
+gst_pulse_shared_context_subscribe (pa_context * context, gpointer user_data,
+    pa_subscription_mask_t mask)
+{
+  GstPulseContext *pctx;
+  GstPulseSubscriber *sub;
+  pa_subscription_mask_t all = PA_SUBSCRIPTION_MASK_NULL;
+  GSList *walk;
+
+  G_LOCK (shared_resources);
+  pctx = gst_pulse_shared_context_find (context);
+  if (pctx && (sub = find_subscriber (pctx, user_data)))
+    sub->mask = mask;
+  G_UNLOCK (shared_resources);
+
+  if (pctx == NULL)
+    return pa_context_subscribe (context, mask, NULL, NULL);
+
+  /* the subscriber list only changes with the mainloop lock */
+  for (walk = pctx->subscribers; walk; walk = g_slist_next (walk))
+    all |= ((GstPulseSubscriber *) walk->data)->mask;
+
+  return pa_context_subscribe (context, all, NULL, NULL);
+}
+
+/**
+ * gst_pulse_shared_context_release:
+ * @context: a context from gst_pulse_shared_context_acquire()
+ * @user_data: the user passed to gst_pulse_shared_context_acquire()
+ *
+ * Drop the reference and subscription of this user. The connection is closed
+ * when the last user releases the context. Must be called with the shared
+ * mainloop lock.
+ */
+void
+gst_pulse_shared_context_release (pa_context * context, gpointer user_data)
+{
+  GstPulseContext *pctx;
+  GstPulseSubscriber *sub;
+
+  G_LOCK (shared_resources);
+  pctx = gst_pulse_shared_context_find (context);
+  if (pctx == NULL)
+    goto done;
+
+  if ((sub = find_subscriber (pctx, user_data))) {
+    pctx->subscribers = g_slist_remove (pctx->subscribers, sub);
+    g_slice_free (GstPulseSubscriber, sub);
+  }
+
+  if (pctx->subscribers == NULL) {
+    GST_DEBUG ("destroying final context %p", context);
+
+    pa_context_disconnect (pctx->context);
+
+    /* Make sure we don't get any further callbacks */
+    pa_context_set_state_callback (pctx->context, NULL, NULL);
+    pa_context_set_subscribe_callback (pctx->context, NULL, NULL);
+
+    if (g_hash_table_foreach_remove (shared_contexts, find_context,
+            context) == 0)
+      failed_contexts = g_slist_remove (failed_contexts, pctx);
+
+    pa_context_unref (pctx->context);
+    g_slice_free (GstPulseContext, pctx);
+  }
+
+done:
+  G_UNLOCK (shared_resources);
+
+  pa_context_unref (context);
+}
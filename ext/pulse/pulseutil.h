@@ -49,4 +49,18 @@ void gst_pulse_cvolume_from_linear (pa_cvolume *v, unsigned channels, gdouble vo
 
 pa_proplist *gst_pulse_make_proplist (const GstStructure *properties);
 
+typedef void (*GstPulseSubscribeFunc) (pa_context * c,
+    pa_subscription_event_type_t t, uint32_t idx, gpointer user_data);
+
+pa_threaded_mainloop *gst_pulse_shared_mainloop_ref (void);
+void gst_pulse_shared_mainloop_unref (void);
+
+pa_context *gst_pulse_shared_context_acquire (const gchar * client_name,
+    const gchar * server, pa_context_flags_t flags,
+    GstPulseSubscribeFunc func, gpointer user_data);
+pa_operation *gst_pulse_shared_context_subscribe (pa_context * context,
+    gpointer user_data, pa_subscription_mask_t mask);
+void gst_pulse_shared_context_release (pa_context * context,
+    gpointer user_data);
+
 #endif
@@ -24,6 +24,9 @@
 #define __GLIB_COMPAT_PRIVATE_H__
 
 #include <glib.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 G_BEGIN_DECLS
 
@@ -130,6 +133,29 @@ gst_g_cond_timed_wait (GCond *cond, GMutex *mutex, GTimeVal *abs_time)
 
 /* adaptations */
 
+/* upper limit for the threads properties of the elements that process in
+ * parallel */
+#define GST_MAX_THREADS 64
+
+/* Resolves the value of a threads property, 0 means one thread per CPU */
+static inline guint
+gst_get_n_threads (guint threads)
+{
+  if (threads == 0) {
+#if GLIB_CHECK_VERSION (2, 36, 0)
+    threads = g_get_num_processors ();
+#elif defined (_SC_NPROCESSORS_ONLN)
+    glong n = sysconf (_SC_NPROCESSORS_ONLN);
+
+    threads = (n > 0) ? n : 1;
+#else
+    threads = 1;
+#endif
+  }
+
+  return CLAMP (threads, 1, GST_MAX_THREADS);
+}
+
 G_END_DECLS
 
 #endif
@@ -338,6 +338,9 @@ gst_alpha_finalize (GObject * object)
 {
   GstAlpha *alpha = GST_ALPHA (object);
 
+  g_free (alpha->chroma_lut);
+  alpha->chroma_lut = NULL;
+
 #if !GLIB_CHECK_VERSION (2, 31, 0)
   g_static_mutex_free (&alpha->lock);
 #else
@@ -685,6 +688,28 @@ chroma_keying_yuv (gint a, gint * y, gint * u,
   return b_alpha;
 }
 
+/* Same as chroma_keying_yuv() with the result for the chroma value looked
+ * up in the table calculated by gst_alpha_init_chroma_lut(). u and v must
+ * be in [-128,127] */
+static inline gint
+chroma_keying_yuv_lut (const GstAlphaChromaKey * lut, gint a, gint * y,
+    gint * u, gint * v, gint smin, gint smax)
+{
+  const GstAlphaChromaKey *key;
+
+  /* too dark or too bright, keep alpha */
+  if (*y < smin || *y > smax)
+    return a;
+
+  key = &lut[((*u + 128) << 8) | (*v + 128)];
+
+  *y = (*y < key->y) ? 0 : *y - key->y;
+  *u = key->u - 128;
+  *v = key->v - 128;
+
+  return (a * key->alpha) >> 8;
+}
+
 #define APPLY_MATRIX(m,o,v1,v2,v3) ((m[o*4] * v1 + m[o*4+1] * v2 + m[o*4+2] * v3 + m[o*4+3]) >> 8)
 
 static void
@@ -741,13 +766,7 @@ gst_alpha_chroma_key_argb_ayuv (const guint8 * src, guint8 * dest, gint width,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12];
   gint o[4];
 
@@ -782,9 +801,7 @@ gst_alpha_chroma_key_argb_ayuv (const guint8 * src, guint8 * dest, gint width,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -857,13 +874,7 @@ gst_alpha_chroma_key_argb_argb (const guint8 * src, guint8 * dest, gint width,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12], matrix2[12];
   gint p[4], o[4];
 
@@ -910,9 +921,7 @@ gst_alpha_chroma_key_argb_argb (const guint8 * src, guint8 * dest, gint width,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -986,13 +995,7 @@ gst_alpha_chroma_key_ayuv_argb (const guint8 * src, guint8 * dest, gint width,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12];
   gint p[4];
 
@@ -1023,9 +1026,7 @@ gst_alpha_chroma_key_ayuv_argb (const guint8 * src, guint8 * dest, gint width,
       u = src[2] - 128;
       v = src[3] - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -1100,6 +1101,7 @@ gst_alpha_chroma_key_ayuv_ayuv (const guint8 * src, guint8 * dest,
   guint8 one_over_kc = alpha->one_over_kc;
   guint8 kfgy_scale = alpha->kfgy_scale;
   guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
 
   smin = 128 - alpha->black_sensitivity;
   smax = 128 + alpha->white_sensitivity;
@@ -1112,9 +1114,7 @@ gst_alpha_chroma_key_ayuv_ayuv (const guint8 * src, guint8 * dest,
         u = src[2] - 128;
         v = src[3] - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
         u += 128;
         v += 128;
@@ -1215,13 +1215,7 @@ gst_alpha_chroma_key_rgb_ayuv (const guint8 * src, guint8 * dest, gint width,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12];
   gint o[3];
   gint bpp;
@@ -1256,9 +1250,7 @@ gst_alpha_chroma_key_rgb_ayuv (const guint8 * src, guint8 * dest, gint width,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -1331,13 +1323,7 @@ gst_alpha_chroma_key_rgb_argb (const guint8 * src, guint8 * dest, gint width,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12], matrix2[12];
   gint p[4], o[3];
   gint bpp;
@@ -1384,9 +1370,7 @@ gst_alpha_chroma_key_rgb_argb (const guint8 * src, guint8 * dest, gint width,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -1536,6 +1520,7 @@ gst_alpha_chroma_key_planar_yuv_ayuv (const guint8 * src, guint8 * dest,
   guint8 one_over_kc = alpha->one_over_kc;
   guint8 kfgy_scale = alpha->kfgy_scale;
   guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
 
   y_stride = gst_video_format_get_row_stride (alpha->in_format, 0, width);
   uv_stride = gst_video_format_get_row_stride (alpha->in_format, 1, width);
@@ -1577,9 +1562,7 @@ gst_alpha_chroma_key_planar_yuv_ayuv (const guint8 * src, guint8 * dest,
         u = srcU[0] - 128;
         v = srcV[0] - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb, smin,
-            smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
         u += 128;
         v += 128;
@@ -1763,13 +1746,7 @@ gst_alpha_chroma_key_planar_yuv_argb (const guint8 * src, guint8 * dest,
   gint v_subs, h_subs;
   gint smin = 128 - alpha->black_sensitivity;
   gint smax = 128 + alpha->white_sensitivity;
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint matrix[12];
   gint p[4];
 
@@ -1829,9 +1806,7 @@ gst_alpha_chroma_key_planar_yuv_argb (const guint8 * src, guint8 * dest,
       u = srcU[0] - 128;
       v = srcV[0] - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb, smin,
-          smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, a, &y, &u, &v, smin, smax);
 
       u += 128;
       v += 128;
@@ -1997,6 +1972,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const guint8 * src, guint8 * dest,
   guint8 one_over_kc = alpha->one_over_kc;
   guint8 kfgy_scale = alpha->kfgy_scale;
   guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint p[4];                    /* Y U Y V */
   gint src_stride;
   const guint8 *src_tmp;
@@ -2086,9 +2062,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const guint8 * src, guint8 * dest,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
 
         dest[0] = a;
         dest[1] = y;
@@ -2099,9 +2073,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const guint8 * src, guint8 * dest,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
 
         dest[4] = a;
         dest[5] = y;
@@ -2117,9 +2089,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const guint8 * src, guint8 * dest,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
 
         dest[0] = a;
         dest[1] = y;
@@ -2228,13 +2198,7 @@ gst_alpha_chroma_key_packed_422_argb (const guint8 * src, guint8 * dest,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaChromaKey *lut = alpha->chroma_lut;
   gint p[4], o[4];
   gint src_stride;
   const guint8 *src_tmp;
@@ -2281,9 +2245,7 @@ gst_alpha_chroma_key_packed_422_argb (const guint8 * src, guint8 * dest,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
       u += 128;
       v += 128;
 
@@ -2300,9 +2262,7 @@ gst_alpha_chroma_key_packed_422_argb (const guint8 * src, guint8 * dest,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
       u += 128;
       v += 128;
 
@@ -2324,9 +2284,7 @@ gst_alpha_chroma_key_packed_422_argb (const guint8 * src, guint8 * dest,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv_lut (lut, pa, &y, &u, &v, smin, smax);
       u += 128;
       v += 128;
 
@@ -2347,6 +2305,56 @@ gst_alpha_chroma_key_packed_422_argb (const guint8 * src, guint8 * dest,
 }
 
 /* Protected with the alpha lock */
+/* Runs chroma_keying_yuv() once for every chroma value. The alpha and luma
+ * arguments are chosen so that the scale for alpha and the amount luma is
+ * reduced by can be read from the result. Only recalculated if one of the
+ * parameters changed, as this is called for every buffer when a controller
+ * is used */
+static void
+gst_alpha_init_chroma_lut (GstAlpha * alpha)
+{
+  gint u, v;
+
+  if (alpha->chroma_lut && alpha->lut_cb == alpha->cb
+      && alpha->lut_cr == alpha->cr && alpha->lut_kg == alpha->kg
+      && alpha->lut_accept_angle_tg == alpha->accept_angle_tg
+      && alpha->lut_accept_angle_ctg == alpha->accept_angle_ctg
+      && alpha->lut_one_over_kc == alpha->one_over_kc
+      && alpha->lut_kfgy_scale == alpha->kfgy_scale
+      && alpha->lut_noise_level2 == alpha->noise_level2)
+    return;
+
+  GST_DEBUG_OBJECT (alpha, "Calculating chroma keying table");
+
+  if (!alpha->chroma_lut)
+    alpha->chroma_lut = g_new (GstAlphaChromaKey, 256 * 256);
+
+  for (u = -128; u < 128; u++) {
+    for (v = -128; v < 128; v++) {
+      GstAlphaChromaKey *key = &alpha->chroma_lut[((u + 128) << 8) | (v +
+              128)];
+      gint y = 255, ku = u, kv = v;
+
+      key->alpha = chroma_keying_yuv (256, &y, &ku, &kv, alpha->cr, alpha->cb,
+          0, 255, alpha->accept_angle_tg, alpha->accept_angle_ctg,
+          alpha->one_over_kc, alpha->kfgy_scale, alpha->kg,
+          alpha->noise_level2);
+      key->y = 255 - y;
+      key->u = ku + 128;
+      key->v = kv + 128;
+    }
+  }
+
+  alpha->lut_cb = alpha->cb;
+  alpha->lut_cr = alpha->cr;
+  alpha->lut_kg = alpha->kg;
+  alpha->lut_accept_angle_tg = alpha->accept_angle_tg;
+  alpha->lut_accept_angle_ctg = alpha->accept_angle_ctg;
+  alpha->lut_one_over_kc = alpha->one_over_kc;
+  alpha->lut_kfgy_scale = alpha->kfgy_scale;
+  alpha->lut_noise_level2 = alpha->noise_level2;
+}
+
 static void
 gst_alpha_init_params (GstAlpha * alpha)
 {
@@ -2412,6 +2420,9 @@ gst_alpha_init_params (GstAlpha * alpha)
   alpha->kg = MIN (kgl, 127);
 
   alpha->noise_level2 = alpha->noise_level * alpha->noise_level;
+
+  if (alpha->method != ALPHA_METHOD_SET)
+    gst_alpha_init_chroma_lut (alpha);
 }
 
 /* Protected with the alpha lock */
@@ -60,6 +60,14 @@ typedef enum
 }
 GstAlphaMethod;
 
+/* Chroma keying result for one chroma value, see chroma_keying_yuv() */
+typedef struct
+{
+  guint16 alpha;                /* scale for alpha, 256 keeps it unchanged */
+  guint8 y;                     /* subtracted from luma */
+  guint8 u, v;                  /* new chroma, with offset */
+} GstAlphaChromaKey;
+
 GST_DEBUG_CATEGORY_STATIC (gst_alpha_debug);
 #define GST_CAT_DEFAULT gst_alpha_debug
 
@@ -107,6 +115,17 @@ struct _GstAlpha
   guint8 one_over_kc;
   guint8 kfgy_scale;
   guint noise_level2;
+
+  /* chroma keying of all 256x256 chroma values for the above, indexed
+   * by u << 8 | v, and the values it was calculated for */
+  GstAlphaChromaKey *chroma_lut;
+  gint8 lut_cb, lut_cr;
+  gint8 lut_kg;
+  guint8 lut_accept_angle_tg;
+  guint8 lut_accept_angle_ctg;
+  guint8 lut_one_over_kc;
+  guint8 lut_kfgy_scale;
+  guint lut_noise_level2;
 };
 
 struct _GstAlphaClass
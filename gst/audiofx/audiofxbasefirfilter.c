@@ -60,11 +60,13 @@ enum
 {
   PROP_0 = 0,
   PROP_LOW_LATENCY,
-  PROP_DRAIN_ON_CHANGES
+  PROP_DRAIN_ON_CHANGES,
+  PROP_PARTITION_LENGTH
 };
 
 #define DEFAULT_LOW_LATENCY FALSE
 #define DEFAULT_DRAIN_ON_CHANGES TRUE
+#define DEFAULT_PARTITION_LENGTH 0
 
 GST_BOILERPLATE_FULL (GstAudioFXBaseFIRFilter, gst_audio_fx_base_fir_filter,
     GstAudioFilter, GST_TYPE_AUDIO_FILTER, DEBUG_INIT);
@@ -235,14 +237,98 @@ DEFINE_PROCESS_FUNC_FIXED_CHANNELS (64, 2, double);
  *   (  N log N  )
  * O ( --------- ) compared to O (M) for the direct calculation.
  *   ( N - M + 1 )
+ *
+ * The drawback is a latency of N - M + 1 samples, which is several
+ * times the kernel length. For long kernels the kernel can instead be
+ * split into P partitions h_p of length L (uniformly partitioned
+ * convolution):
+ *
+ * y[t] = \sum_{p=0}^{P-1} \sum_{u=0}^{L-1} x[t - pL - u] * h_p[u]
+ *
+ * Every pass then takes only L new input samples, i.e. the input
+ * blocks of two passes are shifted by L samples and the block from p
+ * passes ago is the input delayed by pL samples. The spectra of the
+ * last P input blocks are kept in a frequency-domain delay line and
+ * one pass calculates
+ *
+ * y = IFFT (\sum_{p=0}^{P-1} FFT(x_{k-p}) * FFT(h_p))
+ *
+ * with one FFT and one inverse FFT of length N >= 2L - 1, of which the
+ * last L samples are the output. The latency is L samples and the
+ * runtime complexity per sample is O (log L + M / L).
+ *
+ * The single block algorithm from above is the case P == 1.
  */
+
+/* Complex multiplication of two spectra. Two bins are handled per iteration,
+ * which allows the compiler to put them into one SIMD register */
+#define DEFINE_COMPLEX_MULTIPLY_FUNCS(width,ctype) \
+static void \
+complex_multiply_f##width (GstFFTF##width##Complex * out, \
+    const GstFFTF##width##Complex * a, const GstFFTF##width##Complex * b, \
+    guint len) \
+{ \
+  guint i; \
+  \
+  for (i = 0; i + 1 < len; i += 2) { \
+    g##ctype ar0 = a[i].r, ai0 = a[i].i, br0 = b[i].r, bi0 = b[i].i; \
+    g##ctype ar1 = a[i + 1].r, ai1 = a[i + 1].i; \
+    g##ctype br1 = b[i + 1].r, bi1 = b[i + 1].i; \
+    \
+    out[i].r = ar0 * br0 - ai0 * bi0; \
+    out[i].i = ar0 * bi0 + ai0 * br0; \
+    out[i + 1].r = ar1 * br1 - ai1 * bi1; \
+    out[i + 1].i = ar1 * bi1 + ai1 * br1; \
+  } \
+  for (; i < len; i++) { \
+    g##ctype ar0 = a[i].r, ai0 = a[i].i, br0 = b[i].r, bi0 = b[i].i; \
+    \
+    out[i].r = ar0 * br0 - ai0 * bi0; \
+    out[i].i = ar0 * bi0 + ai0 * br0; \
+  } \
+} \
+\
+static void \
+complex_multiply_accumulate_f##width (GstFFTF##width##Complex * out, \
+    const GstFFTF##width##Complex * a, const GstFFTF##width##Complex * b, \
+    guint len) \
+{ \
+  guint i; \
+  \
+  for (i = 0; i + 1 < len; i += 2) { \
+    g##ctype ar0 = a[i].r, ai0 = a[i].i, br0 = b[i].r, bi0 = b[i].i; \
+    g##ctype ar1 = a[i + 1].r, ai1 = a[i + 1].i; \
+    g##ctype br1 = b[i + 1].r, bi1 = b[i + 1].i; \
+    \
+    out[i].r += ar0 * br0 - ai0 * bi0; \
+    out[i].i += ar0 * bi0 + ai0 * br0; \
+    out[i + 1].r += ar1 * br1 - ai1 * bi1; \
+    out[i + 1].i += ar1 * bi1 + ai1 * br1; \
+  } \
+  for (; i < len; i++) { \
+    g##ctype ar0 = a[i].r, ai0 = a[i].i, br0 = b[i].r, bi0 = b[i].i; \
+    \
+    out[i].r += ar0 * br0 - ai0 * bi0; \
+    out[i].i += ar0 * bi0 + ai0 * br0; \
+  } \
+}
+
+DEFINE_COMPLEX_MULTIPLY_FUNCS (32, float);
+DEFINE_COMPLEX_MULTIPLY_FUNCS (64, double);
+
+#undef DEFINE_COMPLEX_MULTIPLY_FUNCS
+
+/* The FFT data of the width 64 path has no suffix */
+#define FFT_DATA_32(self,field) ((self)->field##_f32)
+#define FFT_DATA_64(self,field) ((self)->field)
+
 #define DEFINE_FFT_PROCESS_FUNC(width,ctype) \
 static guint \
 process_fft_##width (GstAudioFXBaseFIRFilter * self, const g##ctype * src, \
     g##ctype * dst, guint input_samples) \
 { \
   gint channels = GST_AUDIO_FILTER_CAST (self)->format.channels; \
-  FFT_CONVOLUTION_BODY (channels); \
+  FFT_CONVOLUTION_BODY (channels, width, ctype); \
 }
 
 #define DEFINE_FFT_PROCESS_FUNC_FIXED_CHANNELS(width,channels,ctype) \
@@ -250,57 +336,67 @@ static guint \
 process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype * src, \
     g##ctype * dst, guint input_samples) \
 { \
-  FFT_CONVOLUTION_BODY (channels); \
+  FFT_CONVOLUTION_BODY (channels, width, ctype); \
 }
 
-#define FFT_CONVOLUTION_BODY(channels) G_STMT_START { \
+#define FFT_CONVOLUTION_BODY(channels,width,ctype) G_STMT_START { \
   gint i, j; \
-  guint pass; \
-  guint kernel_length = self->kernel_length; \
+  guint p, pass; \
   guint block_length = self->block_length; \
-  guint buffer_length = self->buffer_length; \
-  guint real_buffer_length = buffer_length + kernel_length - 1; \
+  guint hop_length = self->hop_length; \
+  guint history = block_length - hop_length; \
+  guint real_buffer_length = block_length + history; \
   guint buffer_fill = self->buffer_fill; \
-  GstFFTF64 *fft = self->fft; \
-  GstFFTF64 *ifft = self->ifft; \
-  GstFFTF64Complex *frequency_response = self->frequency_response; \
-  GstFFTF64Complex *fft_buffer = self->fft_buffer; \
+  guint partitions = self->partitions; \
+  guint fdl_position = self->fdl_position; \
+  GstFFTF##width *fft = FFT_DATA_##width (self, fft); \
+  GstFFTF##width *ifft = FFT_DATA_##width (self, ifft); \
+  GstFFTF##width##Complex *frequency_response = \
+      FFT_DATA_##width (self, frequency_response); \
+  GstFFTF##width##Complex *fft_buffer = FFT_DATA_##width (self, fft_buffer); \
   guint frequency_response_length = self->frequency_response_length; \
-  gdouble *buffer = self->buffer; \
+  GstFFTF##width##Complex *fdl; \
+  g##ctype *buffer = self->buffer; \
   guint generated = 0; \
-  gdouble re, im; \
   \
   if (!fft_buffer) \
-    self->fft_buffer = fft_buffer = \
-        g_new (GstFFTF64Complex, frequency_response_length); \
+    FFT_DATA_##width (self, fft_buffer) = fft_buffer = \
+        g_new (GstFFTF##width##Complex, frequency_response_length); \
   \
   /* Buffer contains the time domain samples of input data for one chunk \
-   * plus some more space for the inverse FFT below. \
+   * plus some more space for the inverse FFT below, followed by the \
+   * frequency-domain delay line. Both are allocated together so they \
+   * are always reset together. \
    * \
-   * The samples are put at offset kernel_length, the inverse FFT \
-   * overwrites everthing from offset 0 to length-kernel_length+1, keeping \
-   * the last kernel_length-1 samples for copying to the next processing \
+   * The samples are put at offset history, the inverse FFT \
+   * overwrites everthing from offset 0 to block_length, keeping \
+   * the last history samples for copying to the next processing \
    * step. \
    */ \
   if (!buffer) { \
-    self->buffer_length = buffer_length = block_length; \
-    real_buffer_length = buffer_length + kernel_length - 1; \
+    self->buffer_length = block_length; \
     \
-    self->buffer = buffer = g_new0 (gdouble, real_buffer_length * channels); \
+    self->buffer = buffer = \
+        g_malloc0 (channels * (real_buffer_length * sizeof (g##ctype) + \
+            partitions * frequency_response_length * \
+            sizeof (GstFFTF##width##Complex))); \
     \
-    /* Beginning has kernel_length-1 zeroes at the beginning */ \
-    self->buffer_fill = buffer_fill = kernel_length - 1; \
+    /* Beginning has history zeroes at the beginning */ \
+    self->buffer_fill = buffer_fill = history; \
+    self->fdl_position = fdl_position = 0; \
   } \
   \
   g_assert (self->buffer_length == block_length); \
   \
+  fdl = (GstFFTF##width##Complex *) (buffer + real_buffer_length * channels); \
+  \
   while (input_samples) { \
-    pass = MIN (buffer_length - buffer_fill, input_samples); \
+    pass = MIN (block_length - buffer_fill, input_samples); \
     \
     /* Deinterleave channels */ \
     for (i = 0; i < pass; i++) { \
       for (j = 0; j < channels; j++) { \
-        buffer[real_buffer_length * j + buffer_fill + kernel_length - 1 + i] = \
+        buffer[real_buffer_length * j + buffer_fill + history + i] = \
             src[i * channels + j]; \
       } \
     } \
@@ -309,53 +405,58 @@ process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype
     input_samples -= pass; \
     \
     /* If we don't have a complete buffer go out */ \
-    if (buffer_fill < buffer_length) \
+    if (buffer_fill < block_length) \
       break; \
     \
     for (j = 0; j < channels; j++) { \
-      /* Calculate FFT of input block */ \
-      gst_fft_f64_fft (fft, \
-          buffer + real_buffer_length * j + kernel_length - 1, fft_buffer); \
+      g##ctype *samples = buffer + real_buffer_length * j; \
+      GstFFTF##width##Complex *spectra = \
+          fdl + partitions * frequency_response_length * j; \
+      \
+      /* Calculate FFT of input block into the delay line */ \
+      gst_fft_f##width##_fft (fft, samples + history, \
+          spectra + fdl_position * frequency_response_length); \
       \
-      /* Complex multiplication of input and filter spectrum */ \
-      for (i = 0; i < frequency_response_length; i++) { \
-	re = fft_buffer[i].r; \
-	im = fft_buffer[i].i; \
+      /* Complex multiplication of the input spectra with the filter \
+       * spectra, the input block from p passes ago goes with partition p */ \
+      complex_multiply_f##width (fft_buffer, \
+          spectra + fdl_position * frequency_response_length, \
+          frequency_response, frequency_response_length); \
+      for (p = 1; p < partitions; p++) { \
+        guint slot = (fdl_position + partitions - p) % partitions; \
         \
-        fft_buffer[i].r = \
-            re * frequency_response[i].r - \
-            im * frequency_response[i].i; \
-        fft_buffer[i].i = \
-            re * frequency_response[i].i + \
-            im * frequency_response[i].r; \
+        complex_multiply_accumulate_f##width (fft_buffer, \
+            spectra + slot * frequency_response_length, \
+            frequency_response + p * frequency_response_length, \
+            frequency_response_length); \
       } \
       \
       /* Calculate inverse FFT of the result */ \
-      gst_fft_f64_inverse_fft (ifft, fft_buffer, \
-          buffer + real_buffer_length * j); \
+      gst_fft_f##width##_inverse_fft (ifft, fft_buffer, samples); \
       \
-      /* Copy all except the first kernel_length-1 samples to the output */ \
-      for (i = 0; i < buffer_length - kernel_length + 1; i++) { \
-        dst[i * channels + j] = \
-            buffer[real_buffer_length * j + kernel_length - 1 + i]; \
+      /* Copy the last hop_length samples to the output */ \
+      for (i = 0; i < hop_length; i++) { \
+        dst[i * channels + j] = samples[history + i]; \
       } \
       \
-      /* Copy the last kernel_length-1 samples to the beginning for the next block */ \
-      for (i = 0; i < kernel_length - 1; i++) { \
-        buffer[real_buffer_length * j + kernel_length - 1 + i] = \
-            buffer[real_buffer_length * j + buffer_length + i]; \
-      } \
+      /* Copy the last history samples to the beginning for the next block */ \
+      memmove (samples + history, samples + block_length, \
+          history * sizeof (g##ctype)); \
     } \
     \
-    generated += buffer_length - kernel_length + 1; \
-    dst += channels * (buffer_length - kernel_length + 1); \
+    if (++fdl_position == partitions) \
+      fdl_position = 0; \
+    \
+    generated += hop_length; \
+    dst += channels * hop_length; \
     \
-    /* The the first kernel_length-1 samples are there already */ \
-    buffer_fill = kernel_length - 1; \
+    /* The the first history samples are there already */ \
+    buffer_fill = history; \
   } \
   \
-  /* Write back cached buffer_fill value */ \
+  /* Write back cached buffer_fill and delay line position */ \
   self->buffer_fill = buffer_fill; \
+  self->fdl_position = fdl_position; \
   \
   return generated; \
 } G_STMT_END
@@ -372,6 +473,8 @@ DEFINE_FFT_PROCESS_FUNC_FIXED_CHANNELS (64, 2, double);
 #undef FFT_CONVOLUTION_BODY
 #undef DEFINE_FFT_PROCESS_FUNC
 #undef DEFINE_FFT_PROCESS_FUNC_FIXED_CHANNELS
+#undef FFT_DATA_32
+#undef FFT_DATA_64
 
 /* Element class */
 static void
@@ -383,35 +486,78 @@ static void
   gst_fft_f64_free (self->ifft);
   self->ifft = NULL;
   g_free (self->frequency_response);
+  self->frequency_response = NULL;
   self->frequency_response_length = 0;
   g_free (self->fft_buffer);
   self->fft_buffer = NULL;
 
+  gst_fft_f32_free (self->fft_f32);
+  self->fft_f32 = NULL;
+  gst_fft_f32_free (self->ifft_f32);
+  self->ifft_f32 = NULL;
+  g_free (self->frequency_response_f32);
+  self->frequency_response_f32 = NULL;
+  g_free (self->fft_buffer_f32);
+  self->fft_buffer_f32 = NULL;
+
   if (self->kernel && self->kernel_length >= FFT_THRESHOLD
       && !self->low_latency) {
-    guint block_length, i;
+    guint block_length, partition_length, length, i, p;
     gdouble *kernel_tmp, *kernel = self->kernel;
-
-    /* We process 4 * kernel_length samples per pass in FFT mode */
-    block_length = 4 * self->kernel_length;
-    block_length = gst_fft_next_fast_length (block_length);
+    GstFFTF64Complex *frequency_response;
+
+    if (self->partition_length > 0
+        && self->partition_length < self->kernel_length) {
+      /* Every pass takes one partition length of new samples and needs
+       * FFTs of at least twice that length */
+      partition_length = self->partition_length;
+      block_length = gst_fft_next_fast_length (2 * partition_length);
+      self->hop_length = partition_length;
+    } else {
+      /* We process 4 * kernel_length samples per pass in FFT mode */
+      partition_length = self->kernel_length;
+      block_length = gst_fft_next_fast_length (4 * partition_length);
+      self->hop_length = block_length - partition_length + 1;
+    }
     self->block_length = block_length;
-
-    kernel_tmp = g_new0 (gdouble, block_length);
-    memcpy (kernel_tmp, kernel, self->kernel_length * sizeof (gdouble));
+    self->partitions =
+        (self->kernel_length + partition_length - 1) / partition_length;
 
     self->fft = gst_fft_f64_new (block_length, FALSE);
     self->ifft = gst_fft_f64_new (block_length, TRUE);
     self->frequency_response_length = block_length / 2 + 1;
-    self->frequency_response =
-        g_new (GstFFTF64Complex, self->frequency_response_length);
-    gst_fft_f64_fft (self->fft, kernel_tmp, self->frequency_response);
+    length = self->partitions * self->frequency_response_length;
+    self->frequency_response = frequency_response =
+        g_new (GstFFTF64Complex, length);
+
+    kernel_tmp = g_new (gdouble, block_length);
+    for (p = 0; p < self->partitions; p++) {
+      guint offset = p * partition_length;
+
+      memset (kernel_tmp, 0, block_length * sizeof (gdouble));
+      memcpy (kernel_tmp, kernel + offset,
+          MIN (partition_length, self->kernel_length - offset) *
+          sizeof (gdouble));
+      gst_fft_f64_fft (self->fft, kernel_tmp,
+          frequency_response + p * self->frequency_response_length);
+    }
     g_free (kernel_tmp);
 
     /* Normalize to make sure IFFT(FFT(x)) == x */
-    for (i = 0; i < self->frequency_response_length; i++) {
-      self->frequency_response[i].r /= block_length;
-      self->frequency_response[i].i /= block_length;
+    for (i = 0; i < length; i++) {
+      frequency_response[i].r /= block_length;
+      frequency_response[i].i /= block_length;
+    }
+
+    /* Single precision samples are convolved with single precision FFTs */
+    if (GST_AUDIO_FILTER_CAST (self)->format.width == 32) {
+      self->fft_f32 = gst_fft_f32_new (block_length, FALSE);
+      self->ifft_f32 = gst_fft_f32_new (block_length, TRUE);
+      self->frequency_response_f32 = g_new (GstFFTF32Complex, length);
+      for (i = 0; i < length; i++) {
+        self->frequency_response_f32[i].r = frequency_response[i].r;
+        self->frequency_response_f32[i].i = frequency_response[i].i;
+      }
     }
   }
 }
@@ -477,6 +623,17 @@ gst_audio_fx_base_fir_filter_dispose (GObject * object)
   g_free (self->fft_buffer);
   self->fft_buffer = NULL;
 
+  gst_fft_f32_free (self->fft_f32);
+  self->fft_f32 = NULL;
+  gst_fft_f32_free (self->ifft_f32);
+  self->ifft_f32 = NULL;
+
+  g_free (self->frequency_response_f32);
+  self->frequency_response_f32 = NULL;
+
+  g_free (self->fft_buffer_f32);
+  self->fft_buffer_f32 = NULL;
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -515,6 +672,28 @@ gst_audio_fx_base_fir_filter_set_property (GObject * object, guint prop_id,
       GST_BASE_TRANSFORM_UNLOCK (self);
       break;
     }
+    case PROP_PARTITION_LENGTH:{
+      guint partition_length;
+
+      if (GST_STATE (self) >= GST_STATE_PAUSED) {
+        g_warning ("Changing the \"partition-length\" property "
+            "is only allowed in states < PAUSED");
+        return;
+      }
+
+      GST_BASE_TRANSFORM_LOCK (self);
+      partition_length = g_value_get_uint (value);
+
+      if (self->partition_length != partition_length) {
+        self->partition_length = partition_length;
+        gst_audio_fx_base_fir_filter_calculate_frequency_response (self);
+        gst_audio_fx_base_fir_filter_select_process_function (self,
+            GST_AUDIO_FILTER_CAST (self)->format.width,
+            GST_AUDIO_FILTER_CAST (self)->format.channels);
+      }
+      GST_BASE_TRANSFORM_UNLOCK (self);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -534,6 +713,9 @@ gst_audio_fx_base_fir_filter_get_property (GObject * object, guint prop_id,
     case PROP_DRAIN_ON_CHANGES:
       g_value_set_boolean (value, self->drain_on_changes);
       break;
+    case PROP_PARTITION_LENGTH:
+      g_value_set_uint (value, self->partition_length);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -593,6 +775,26 @@ gst_audio_fx_base_fir_filter_class_init (GstAudioFXBaseFIRFilterClass * klass)
           DEFAULT_DRAIN_ON_CHANGES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioFXBaseFIRFilter::partition-length:
+   *
+   * Split long filter kernels into partitions of this many samples for the
+   * FFT convolution. The latency is then only the partition length instead
+   * of several times the kernel length, which makes long kernels like room
+   * impulse responses usable in live pipelines. Smaller partitions need
+   * more operations per sample. 0 processes the kernel as one block.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_PARTITION_LENGTH,
+      g_param_spec_uint ("partition-length", "Partition length",
+          "Length of the filter kernel partitions in samples for FFT "
+          "convolution, the latency is one partition length "
+          "(0 = one partition). "
+          "Can only be changed in states < PAUSED!", 0, G_MAXINT,
+          DEFAULT_PARTITION_LENGTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   trans_class->transform =
       GST_DEBUG_FUNCPTR (gst_audio_fx_base_fir_filter_transform);
   trans_class->start = GST_DEBUG_FUNCPTR (gst_audio_fx_base_fir_filter_start);
@@ -618,6 +820,7 @@ gst_audio_fx_base_fir_filter_init (GstAudioFXBaseFIRFilter * self,
 
   self->low_latency = DEFAULT_LOW_LATENCY;
   self->drain_on_changes = DEFAULT_DRAIN_ON_CHANGES;
+  self->partition_length = DEFAULT_PARTITION_LENGTH;
 
   gst_pad_set_query_function (GST_BASE_TRANSFORM (self)->srcpad,
       gst_audio_fx_base_fir_filter_query);
@@ -697,14 +900,14 @@ gst_audio_fx_base_fir_filter_push_residue (GstAudioFXBaseFIRFilter * self)
     while (gensamples < outsamples) {
       guint step_insamples = self->block_length - self->buffer_fill;
       guint8 *zeroes = g_new0 (guint8, step_insamples * channels * width);
-      guint8 *out = g_new (guint8, self->block_length * channels * width);
+      guint8 *out = g_new (guint8, self->hop_length * channels * width);
       guint step_gensamples;
 
       step_gensamples = self->process (self, zeroes, out, step_insamples);
       g_free (zeroes);
 
-      memcpy (data + gensamples * width, out, MIN (step_gensamples,
-              outsamples - gensamples) * width);
+      memcpy (data + gensamples * channels * width, out, MIN (step_gensamples,
+              outsamples - gensamples) * channels * width);
       gensamples += MIN (step_gensamples, outsamples - gensamples);
 
       g_free (out);
@@ -768,6 +971,8 @@ gst_audio_fx_base_fir_filter_setup (GstAudioFilter * base,
     self->nsamples_in = 0;
   }
 
+  /* The precision of the FFT convolution depends on the width */
+  gst_audio_fx_base_fir_filter_calculate_frequency_response (self);
   gst_audio_fx_base_fir_filter_select_process_function (self, format->width,
       format->channels);
 
@@ -800,7 +1005,7 @@ gst_audio_fx_base_fir_filter_transform_size (GstBaseTransform * base,
 
   size /= width * channels;
 
-  blocklen = self->block_length - self->kernel_length + 1;
+  blocklen = self->hop_length;
   *othersize = ((size + blocklen - 1) / blocklen) * blocklen;
 
   *othersize *= width * channels;
@@ -975,7 +1180,7 @@ gst_audio_fx_base_fir_filter_query (GstPad * pad, GstQuery * query)
               GST_TIME_ARGS (min), GST_TIME_ARGS (max));
 
           if (self->fft && !self->low_latency)
-            latency = self->block_length - self->kernel_length + 1;
+            latency = self->hop_length;
           else
             latency = self->latency;
 
@@ -1042,7 +1247,7 @@ void
 gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
     gdouble * kernel, guint kernel_length, guint64 latency)
 {
-  gboolean latency_changed;
+  gboolean latency_changed, buffers_changed;
 
   g_return_if_fail (kernel != NULL);
   g_return_if_fail (self != NULL);
@@ -1055,9 +1260,14 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
       || (!self->low_latency && self->kernel_length >= FFT_THRESHOLD
           && kernel_length < FFT_THRESHOLD));
 
-  /* FIXME: If the latency changes, the buffer size changes too and we
-   * have to drain in any case until this is fixed in the future */
-  if (self->buffer && (!self->drain_on_changes || latency_changed)) {
+  /* The block and partition sizes of the FFT convolution, and with them the
+   * size of the buffer, depend on the kernel length */
+  buffers_changed = latency_changed || (self->fft
+      && self->kernel_length != kernel_length);
+
+  /* FIXME: If the buffer size changes we have to drain in any case until
+   * this is fixed in the future */
+  if (self->buffer && (!self->drain_on_changes || buffers_changed)) {
     gst_audio_fx_base_fir_filter_push_residue (self);
     self->start_ts = GST_CLOCK_TIME_NONE;
     self->start_off = GST_BUFFER_OFFSET_NONE;
@@ -1067,7 +1277,7 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
   }
 
   g_free (self->kernel);
-  if (!self->drain_on_changes || latency_changed) {
+  if (!self->drain_on_changes || buffers_changed) {
     g_free (self->buffer);
     self->buffer = NULL;
     self->buffer_fill = 0;
@@ -1082,8 +1292,8 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
       GST_AUDIO_FILTER_CAST (self)->format.width,
       GST_AUDIO_FILTER_CAST (self)->format.channels);
 
-  if (latency_changed) {
-    self->latency = latency;
+  self->latency = latency;
+  if (buffers_changed) {
     gst_element_post_message (GST_ELEMENT (self),
         gst_message_new_latency (GST_OBJECT (self)));
   }
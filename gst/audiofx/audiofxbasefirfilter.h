@@ -27,6 +27,7 @@
 
 #include <gst/gst.h>
 #include <gst/audio/gstaudiofilter.h>
+#include <gst/fft/gstfftf32.h>
 #include <gst/fft/gstfftf64.h>
 
 G_BEGIN_DECLS
@@ -61,6 +62,8 @@ struct _GstAudioFXBaseFIRFilter {
 
   guint64 latency;              /* pre-latency of the filter kernel */
   gboolean low_latency;         /* work in slower low latency mode */
+  guint partition_length;       /* length of the kernel partitions in FFT
+                                 * mode, 0 for one partition */
 
   gboolean drain_on_changes;    /* If the filter should be drained when
                                  * coeficients change */
@@ -68,17 +71,27 @@ struct _GstAudioFXBaseFIRFilter {
   /* < private > */
   GstAudioFXBaseFIRFilterProcessFunc process;
 
-  gdouble *buffer;              /* buffer for storing samples of previous buffers */
+  gpointer buffer;              /* buffer for storing samples of previous buffers,
+                                 * the sample type depends on processing mode */
   guint buffer_fill;            /* fill level of buffer */
   guint buffer_length;          /* length of the buffer -- meaning depends on processing mode */
 
   /* FFT convolution specific data */
   GstFFTF64 *fft;
   GstFFTF64 *ifft;
-  GstFFTF64Complex *frequency_response;  /* filter kernel -- frequency domain */
-  guint frequency_response_length;       /* length of filter kernel -- frequency domain */
-  GstFFTF64Complex *fft_buffer;          /* FFT buffer, has the length of the frequency response */
+  GstFFTF64Complex *frequency_response;  /* filter kernel partitions -- frequency domain */
+  guint frequency_response_length;       /* length of one partition -- frequency domain */
+  GstFFTF64Complex *fft_buffer;          /* FFT buffer, has the length of one partition */
   guint block_length;                    /* Length of the processing blocks -- time domain */
+  guint hop_length;                      /* New input samples per block -- time domain */
+  guint partitions;                      /* Number of kernel partitions */
+  guint fdl_position;                    /* Newest block in the frequency-domain delay line */
+
+  /* Single precision FFT convolution, used for width 32 */
+  GstFFTF32 *fft_f32;
+  GstFFTF32 *ifft_f32;
+  GstFFTF32Complex *frequency_response_f32;
+  GstFFTF32Complex *fft_buffer_f32;
 
   GstClockTime start_ts;        /* start timestamp after a discont */
   guint64 start_off;            /* start offset after a discont */
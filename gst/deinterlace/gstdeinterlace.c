@@ -43,6 +43,8 @@
 
 #include <string.h>
 
+#include "gst/glib-compat-private.h"
+
 #if HAVE_ORC
 #include <orc/orc.h>
 #endif
@@ -59,6 +61,7 @@ GST_DEBUG_CATEGORY_STATIC (deinterlace_debug);
 #define DEFAULT_LOCKING         GST_DEINTERLACE_LOCKING_NONE
 #define DEFAULT_IGNORE_OBSCURE  TRUE
 #define DEFAULT_DROP_ORPHANS    TRUE
+#define DEFAULT_THREADS         1
 
 enum
 {
@@ -70,6 +73,7 @@ enum
   PROP_LOCKING,
   PROP_IGNORE_OBSCURE,
   PROP_DROP_ORPHANS,
+  PROP_THREADS,
   PROP_LAST
 };
 
@@ -150,6 +154,8 @@ static const GEnumValue methods_types[] = {
       "weavetff"},
   {GST_DEINTERLACE_WEAVE_BFF, "Progressive: Bottom Field First (Do Not Use)",
       "weavebff"},
+  {GST_DEINTERLACE_AUTO_QUALITY, "Adaptive: Best quality that runs in real-time",
+      "auto-quality"},
   {0, NULL, NULL},
 };
 
@@ -340,9 +346,84 @@ static const struct
   gst_deinterlace_method_scaler_bob_get_type}, {
   gst_deinterlace_method_weave_get_type}, {
   gst_deinterlace_method_weave_tff_get_type}, {
-  gst_deinterlace_method_weave_bff_get_type}
+  gst_deinterlace_method_weave_bff_get_type}, {
+  /* auto-quality, resolved by gst_deinterlace_get_user_method() */
+  NULL}
+};
+
+/* The methods auto-quality steps between, best quality first */
+static const GstDeinterlaceMethods auto_quality_methods[] = {
+  GST_DEINTERLACE_GREEDY_H,
+  GST_DEINTERLACE_VFIR,
+  GST_DEINTERLACE_LINEAR
 };
 
+/* Frames to run a method before the processing time is judged */
+#define AUTO_QUALITY_SETTLE_FRAMES  16
+/* Upper limit for waiting before a better method is tried again */
+#define AUTO_QUALITY_MAX_BACKOFF    (64 * AUTO_QUALITY_SETTLE_FRAMES)
+/* Output frames between two statistics messages */
+#define AUTO_QUALITY_STATS_INTERVAL 100
+
+static void
+gst_deinterlace_stop_thread_pool (GstDeinterlace * self)
+{
+  if (self->method)
+    gst_deinterlace_method_set_thread_pool (self->method, NULL);
+  if (self->thread_pool) {
+    g_thread_pool_free (self->thread_pool, FALSE, TRUE);
+    self->thread_pool = NULL;
+  }
+}
+
+/* Creates the thread pool that is shared by all methods. Only called when
+ * going to PAUSED, the streaming thread uses the pool without any lock */
+static void
+gst_deinterlace_start_thread_pool (GstDeinterlace * self)
+{
+  guint n_threads = gst_get_n_threads (self->threads);
+  GError *err = NULL;
+
+  gst_deinterlace_stop_thread_pool (self);
+
+  GST_DEBUG_OBJECT (self, "Using %u threads", n_threads);
+  if (n_threads == 1)
+    return;
+
+  self->thread_pool = gst_deinterlace_method_thread_pool_new (n_threads, &err);
+  if (self->thread_pool == NULL) {
+    GST_WARNING_OBJECT (self, "Failed to create thread pool: %s",
+        err->message);
+    g_error_free (err);
+    return;
+  }
+
+  if (self->method)
+    gst_deinterlace_method_set_thread_pool (self->method, self->thread_pool);
+}
+
+/* Returns the method selected by the method property, auto-quality is
+ * resolved to the method it currently uses */
+static GstDeinterlaceMethods
+gst_deinterlace_get_user_method (GstDeinterlace * self)
+{
+  if (self->user_set_method_id == GST_DEINTERLACE_AUTO_QUALITY)
+    return auto_quality_methods[self->auto_quality_level];
+
+  return self->user_set_method_id;
+}
+
+static void
+gst_deinterlace_reset_auto_quality (GstDeinterlace * self)
+{
+  self->auto_quality_level = 0;
+  self->auto_quality_avg = 0;
+  self->auto_quality_frames = 0;
+  self->auto_quality_backoff = AUTO_QUALITY_SETTLE_FRAMES;
+  self->auto_quality_probing = FALSE;
+  self->auto_quality_switches = 0;
+}
+
 static void
 gst_deinterlace_set_method (GstDeinterlace * self, GstDeinterlaceMethods method)
 {
@@ -350,6 +431,8 @@ gst_deinterlace_set_method (GstDeinterlace * self, GstDeinterlaceMethods method)
 
   GST_DEBUG_OBJECT (self, "Setting new method %d", method);
 
+  self->using_user_method = (method == gst_deinterlace_get_user_method (self));
+
   if (self->method) {
     if (self->method_id == method &&
         gst_deinterlace_method_supported (G_TYPE_FROM_INSTANCE (self->method),
@@ -398,9 +481,11 @@ gst_deinterlace_set_method (GstDeinterlace * self, GstDeinterlaceMethods method)
   gst_object_set_parent (GST_OBJECT (self->method), GST_OBJECT (self));
   gst_child_proxy_child_added (GST_OBJECT (self), GST_OBJECT (self->method));
 
-  if (self->method)
+  if (self->method) {
     gst_deinterlace_method_setup (self->method, self->format, self->width,
         self->height);
+    gst_deinterlace_method_set_thread_pool (self->method, self->thread_pool);
+  }
 }
 
 static gboolean
@@ -560,6 +645,15 @@ gst_deinterlace_class_init (GstDeinterlaceClass * klass)
    * Progressive: Bottom Field First.  Bad quality, do not use.
    * </para>
    * </listitem>
+   * <listitem>
+   * <para>
+   * auto-quality
+   * Adaptive: Measures the processing time per frame and the QoS
+   * proportion reported downstream and steps between greedyh, vfir and
+   * linear to keep up with real-time. Posts "deinterlace-auto-quality"
+   * element messages with the statistics. Since: 0.10.32
+   * </para>
+   * </listitem>
    * </itemizedlist>
    */
   g_object_class_install_property (gobject_class, PROP_METHOD,
@@ -644,6 +738,23 @@ gst_deinterlace_class_init (GstDeinterlaceClass * klass)
           "active locking mode.", DEFAULT_DROP_ORPHANS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstDeinterlace:threads
+   *
+   * This selects the number of threads used for deinterlacing. Every frame
+   * is split into ranges of lines that are processed in parallel, 0 uses
+   * one thread per CPU. Changes take effect when going to PAUSED.
+   *
+   * Since: 0.10.32
+   *
+   */
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "threads",
+          "Number of threads used for deinterlacing (0 = number of CPUs)",
+          0, GST_MAX_THREADS, DEFAULT_THREADS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_deinterlace_change_state);
 }
@@ -707,8 +818,10 @@ gst_deinterlace_init (GstDeinterlace * self, GstDeinterlaceClass * klass)
   gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
 
   self->mode = DEFAULT_MODE;
+  self->threads = DEFAULT_THREADS;
   self->user_set_method_id = DEFAULT_METHOD;
-  gst_deinterlace_set_method (self, self->user_set_method_id);
+  gst_deinterlace_reset_auto_quality (self);
+  gst_deinterlace_set_method (self, gst_deinterlace_get_user_method (self));
   self->fields = DEFAULT_FIELDS;
   self->field_layout = DEFAULT_FIELD_LAYOUT;
   self->locking = DEFAULT_LOCKING;
@@ -807,6 +920,7 @@ gst_deinterlace_reset (GstDeinterlace * self)
   gst_deinterlace_reset_history (self, TRUE);
 
   gst_deinterlace_reset_qos (self);
+  gst_deinterlace_reset_auto_quality (self);
 
   self->need_more = FALSE;
   self->have_eos = FALSE;
@@ -839,7 +953,8 @@ gst_deinterlace_set_property (GObject * object, guint prop_id,
     }
     case PROP_METHOD:
       self->user_set_method_id = g_value_get_enum (value);
-      gst_deinterlace_set_method (self, self->user_set_method_id);
+      gst_deinterlace_reset_auto_quality (self);
+      gst_deinterlace_set_method (self, gst_deinterlace_get_user_method (self));
       break;
     case PROP_FIELDS:{
       gint new_fields;
@@ -867,6 +982,9 @@ gst_deinterlace_set_property (GObject * object, guint prop_id,
     case PROP_DROP_ORPHANS:
       self->drop_orphans = g_value_get_boolean (value);
       break;
+    case PROP_THREADS:
+      self->threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -904,6 +1022,9 @@ gst_deinterlace_get_property (GObject * object, guint prop_id,
     case PROP_DROP_ORPHANS:
       g_value_set_boolean (value, self->drop_orphans);
       break;
+    case PROP_THREADS:
+      g_value_set_uint (value, self->threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -921,6 +1042,11 @@ gst_deinterlace_finalize (GObject * object)
     self->method = NULL;
   }
 
+  if (self->thread_pool) {
+    g_thread_pool_free (self->thread_pool, FALSE, TRUE);
+    self->thread_pool = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1292,6 +1418,125 @@ keep_frame:
   return TRUE;
 }
 
+static void
+gst_deinterlace_post_auto_quality (GstDeinterlace * self, GstClockTime budget,
+    gdouble proportion, gboolean switched)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("deinterlace-auto-quality",
+      "method", G_TYPE_STRING,
+      methods_types[auto_quality_methods[self->auto_quality_level]].value_nick,
+      "switched", G_TYPE_BOOLEAN, switched,
+      "processing-time", G_TYPE_UINT64, (guint64) self->auto_quality_avg,
+      "budget", G_TYPE_UINT64, (guint64) budget,
+      "proportion", G_TYPE_DOUBLE, proportion,
+      "switches", G_TYPE_UINT64, self->auto_quality_switches,
+      "processed", G_TYPE_UINT64, (guint64) self->processed,
+      "dropped", G_TYPE_UINT64, (guint64) self->dropped, NULL);
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+}
+
+/* Judges the processing time of the method auto-quality currently uses
+ * against the duration of an output frame and the QoS proportion, and
+ * selects a cheaper or better method for the next frames if needed */
+static void
+gst_deinterlace_update_auto_quality (GstDeinterlace * self,
+    GstClockTime elapsed)
+{
+  GstClockTime budget, earliest_time;
+  gdouble proportion;
+  guint level = self->auto_quality_level;
+  gboolean too_slow;
+
+  /* flushing and telecine temporarily use other methods, don't count them.
+   * The method of the level itself might have been replaced by one that
+   * supports the format, that one is judged instead */
+  if (!self->using_user_method)
+    return;
+
+  if (self->fields == GST_DEINTERLACE_ALL)
+    budget = self->field_duration;
+  else
+    budget = 2 * self->field_duration;
+
+  gst_deinterlace_read_qos (self, &proportion, &earliest_time);
+
+  if (self->auto_quality_frames == 0)
+    self->auto_quality_avg = elapsed;
+  else
+    self->auto_quality_avg = (7 * self->auto_quality_avg + elapsed) / 8;
+  self->auto_quality_frames++;
+
+  if (self->auto_quality_frames < AUTO_QUALITY_SETTLE_FRAMES)
+    return;
+
+  too_slow = proportion > 1.0 || (budget > 0
+      && self->auto_quality_avg > budget / 10 * 8);
+
+  if (too_slow) {
+    if (level + 1 < G_N_ELEMENTS (auto_quality_methods)) {
+      /* the better method we tried could not keep up, wait longer before
+       * trying it again */
+      if (self->auto_quality_probing)
+        self->auto_quality_backoff = MIN (2 * self->auto_quality_backoff,
+            AUTO_QUALITY_MAX_BACKOFF);
+      self->auto_quality_probing = FALSE;
+      level++;
+    }
+  } else {
+    if (self->auto_quality_probing) {
+      self->auto_quality_probing = FALSE;
+      self->auto_quality_backoff = AUTO_QUALITY_SETTLE_FRAMES;
+    }
+
+    if (level > 0 && proportion < 1.0
+        && self->auto_quality_frames >= self->auto_quality_backoff
+        && (budget == 0 || self->auto_quality_avg < budget / 10 * 4)) {
+      self->auto_quality_probing = TRUE;
+      level--;
+    }
+  }
+
+  if (level != self->auto_quality_level) {
+    GST_INFO_OBJECT (self, "Switching from %s to %s: processing time %"
+        GST_TIME_FORMAT ", budget %" GST_TIME_FORMAT ", proportion %lf",
+        methods_types[auto_quality_methods[self->auto_quality_level]].
+        value_nick, methods_types[auto_quality_methods[level]].value_nick,
+        GST_TIME_ARGS (self->auto_quality_avg), GST_TIME_ARGS (budget),
+        proportion);
+
+    /* the new method is set before the next frame is deinterlaced */
+    self->auto_quality_level = level;
+    self->auto_quality_frames = 0;
+    self->auto_quality_switches++;
+    gst_deinterlace_post_auto_quality (self, budget, proportion, TRUE);
+  } else if (self->auto_quality_frames % AUTO_QUALITY_STATS_INTERVAL == 0) {
+    gst_deinterlace_post_auto_quality (self, budget, proportion, FALSE);
+  }
+}
+
+static void
+gst_deinterlace_deinterlace_frame (GstDeinterlace * self, GstBuffer * outbuf)
+{
+  GstClockTime start;
+
+  if (self->user_set_method_id != GST_DEINTERLACE_AUTO_QUALITY) {
+    gst_deinterlace_method_deinterlace_frame (self->method,
+        self->field_history, self->history_count, outbuf,
+        self->cur_field_idx);
+    return;
+  }
+
+  start = gst_util_get_timestamp ();
+  gst_deinterlace_method_deinterlace_frame (self->method,
+      self->field_history, self->history_count, outbuf, self->cur_field_idx);
+  gst_deinterlace_update_auto_quality (self,
+      gst_util_get_timestamp () - start);
+}
+
 static gboolean
 gst_deinterlace_fix_timestamps (GstDeinterlace * self,
     GstDeinterlaceField * field1, GstDeinterlaceField * field2)
@@ -1624,7 +1869,7 @@ restart:
           && interlacing_method == GST_DEINTERLACE_TELECINE && same_buffer
           && !GST_BUFFER_FLAG_IS_SET (field1->buf,
               GST_VIDEO_BUFFER_PROGRESSIVE))) {
-    gst_deinterlace_set_method (self, self->user_set_method_id);
+    gst_deinterlace_set_method (self, gst_deinterlace_get_user_method (self));
     fields_required = gst_deinterlace_method_get_fields_required (self->method);
     if (flushing && self->history_count < fields_required) {
       /* note: we already checked for flushing with history count == 1 above
@@ -1768,9 +2013,7 @@ restart:
       }
 
       /* do magic calculus */
-      gst_deinterlace_method_deinterlace_frame (self->method,
-          self->field_history, self->history_count, outbuf,
-          self->cur_field_idx);
+      gst_deinterlace_deinterlace_frame (self, outbuf);
 
       self->cur_field_idx--;
       if (self->cur_field_idx + 1 +
@@ -1894,9 +2137,7 @@ restart:
       ret = GST_FLOW_OK;
     } else {
       /* do magic calculus */
-      gst_deinterlace_method_deinterlace_frame (self->method,
-          self->field_history, self->history_count, outbuf,
-          self->cur_field_idx);
+      gst_deinterlace_deinterlace_frame (self, outbuf);
 
       self->cur_field_idx--;
       if (self->cur_field_idx + 1 +
@@ -2484,6 +2725,7 @@ gst_deinterlace_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_NULL_TO_READY:
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_deinterlace_start_thread_pool (self);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
@@ -2500,6 +2742,7 @@ gst_deinterlace_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_deinterlace_reset (self);
+      gst_deinterlace_stop_thread_pool (self);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
     default:
@@ -54,7 +54,8 @@ typedef enum
   GST_DEINTERLACE_SCALER_BOB,
   GST_DEINTERLACE_WEAVE,
   GST_DEINTERLACE_WEAVE_TFF,
-  GST_DEINTERLACE_WEAVE_BFF
+  GST_DEINTERLACE_WEAVE_BFF,
+  GST_DEINTERLACE_AUTO_QUALITY
 } GstDeinterlaceMethods;
 
 typedef enum
@@ -127,7 +128,13 @@ struct _GstDeinterlace
   GstDeinterlaceMethods method_id;
   /* property value */
   GstDeinterlaceMethods user_set_method_id;
+  /* FALSE while flushing/inverse telecine, even if the method of the
+   * property could not be used and another one was chosen instead */
+  gboolean using_user_method;
   GstDeinterlaceMethod *method;
+  /* number of threads, 0 for one per CPU */
+  guint threads;
+  GThreadPool *thread_pool;
 
   GstVideoFormat format;
   gint width, height; /* frame width & height */
@@ -165,6 +172,16 @@ struct _GstDeinterlace
   gint64 processed;
   gint64 dropped;
 
+  /* auto-quality method: index into the list of methods, running average
+   * of the processing time per output frame and the number of frames
+   * since the last switch / before trying a better method again */
+  guint auto_quality_level;
+  GstClockTime auto_quality_avg;
+  guint auto_quality_frames;
+  guint auto_quality_backoff;
+  gboolean auto_quality_probing;
+  guint64 auto_quality_switches;
+
   GstCaps *request_caps;
 
   gboolean reconfigure;
@@ -192,9 +192,24 @@ gst_deinterlace_method_setup_impl (GstDeinterlaceMethod * self,
   }
 }
 
+static void
+gst_deinterlace_method_finalize (GObject * object)
+{
+  GstDeinterlaceMethod *self = GST_DEINTERLACE_METHOD (object);
+
+  g_mutex_free (self->slice_lock);
+  g_cond_free (self->slice_cond);
+
+  G_OBJECT_CLASS (gst_deinterlace_method_parent_class)->finalize (object);
+}
+
 static void
 gst_deinterlace_method_class_init (GstDeinterlaceMethodClass * klass)
 {
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->finalize = gst_deinterlace_method_finalize;
+
   klass->setup = gst_deinterlace_method_setup_impl;
   klass->supported = gst_deinterlace_method_supported_impl;
 }
@@ -203,6 +218,93 @@ static void
 gst_deinterlace_method_init (GstDeinterlaceMethod * self)
 {
   self->format = GST_VIDEO_FORMAT_UNKNOWN;
+
+  self->n_threads = 1;
+  self->slice_lock = g_mutex_new ();
+  self->slice_cond = g_cond_new ();
+}
+
+/* Slice threading: the lines of a frame are split into ranges, all but the
+ * first are processed by the thread pool and the first one by the calling
+ * thread. The pool is owned by the element and shared by all its methods, so
+ * that switching methods doesn't create new threads. */
+
+/* Don't bother with slices that are smaller than this many lines */
+#define MIN_SLICE_LINES 8
+
+typedef struct
+{
+  GstDeinterlaceMethod *method;
+  GstDeinterlaceMethodSliceFunction func;
+  gpointer user_data;
+  gint start, end;
+} GstDeinterlaceSlice;
+
+static void
+gst_deinterlace_method_slice_worker (gpointer data, gpointer user_data)
+{
+  GstDeinterlaceSlice *slice = data;
+  GstDeinterlaceMethod *self = slice->method;
+
+  slice->func (self, slice->user_data, slice->start, slice->end);
+
+  g_mutex_lock (self->slice_lock);
+  if (--self->slices_pending == 0)
+    g_cond_signal (self->slice_cond);
+  g_mutex_unlock (self->slice_lock);
+}
+
+/* Creates a pool for gst_deinterlace_method_set_thread_pool() that together
+ * with the streaming thread allows n_threads slices to run in parallel */
+GThreadPool *
+gst_deinterlace_method_thread_pool_new (guint n_threads, GError ** error)
+{
+  g_return_val_if_fail (n_threads > 1, NULL);
+
+  return g_thread_pool_new (gst_deinterlace_method_slice_worker, NULL,
+      n_threads - 1, TRUE, error);
+}
+
+void
+gst_deinterlace_method_set_thread_pool (GstDeinterlaceMethod * self,
+    GThreadPool * pool)
+{
+  self->pool = pool;
+  self->n_threads = pool ? g_thread_pool_get_max_threads (pool) + 1 : 1;
+}
+
+void
+gst_deinterlace_method_run_slices (GstDeinterlaceMethod * self,
+    GstDeinterlaceMethodSliceFunction func, gpointer user_data, gint n_lines)
+{
+  GstDeinterlaceSlice *slices;
+  gint n_slices, i;
+
+  n_slices = CLAMP (n_lines / MIN_SLICE_LINES, 1, (gint) self->n_threads);
+  if (self->pool == NULL || n_slices == 1) {
+    func (self, user_data, 0, n_lines);
+    return;
+  }
+
+  slices = g_newa (GstDeinterlaceSlice, n_slices);
+  for (i = 0; i < n_slices; i++) {
+    slices[i].method = self;
+    slices[i].func = func;
+    slices[i].user_data = user_data;
+    slices[i].start = (i * n_lines) / n_slices;
+    slices[i].end = ((i + 1) * n_lines) / n_slices;
+  }
+
+  self->slices_pending = n_slices - 1;
+  for (i = 1; i < n_slices; i++)
+    g_thread_pool_push (self->pool, &slices[i], NULL);
+
+  func (self, user_data, slices[0].start, slices[0].end);
+
+  g_mutex_lock (self->slice_lock);
+  while (self->slices_pending > 0)
+    g_cond_wait (self->slice_cond, self->slice_lock);
+  g_mutex_unlock (self->slice_lock);
 }
 
 void
@@ -317,94 +419,6 @@ gst_deinterlace_simple_method_copy_scanline_packed (GstDeinterlaceSimpleMethod *
   memcpy (out, scanlines->m0, self->parent.row_stride[0]);
 }
 
-static void
-gst_deinterlace_simple_method_deinterlace_frame_packed (GstDeinterlaceMethod *
-    method, const GstDeinterlaceField * history, guint history_count,
-    GstBuffer * outbuf, gint cur_field_idx)
-{
-  GstDeinterlaceSimpleMethod *self = GST_DEINTERLACE_SIMPLE_METHOD (method);
-  GstDeinterlaceMethodClass *dm_class = GST_DEINTERLACE_METHOD_GET_CLASS (self);
-  GstDeinterlaceScanlineData scanlines;
-  guint8 *dest;
-  const guint8 *field0, *field1, *field2, *fieldp;
-  guint cur_field_flags = history[cur_field_idx].flags;
-  gint i;
-  gint frame_height = self->parent.frame_height;
-  gint stride = self->parent.row_stride[0];
-
-  g_assert (self->interpolate_scanline_packed != NULL);
-  g_assert (self->copy_scanline_packed != NULL);
-
-  if (cur_field_idx > 0) {
-    fieldp = GST_BUFFER_DATA (history[cur_field_idx - 1].buf);
-  } else {
-    fieldp = NULL;
-  }
-
-  dest = GST_BUFFER_DATA (outbuf);
-  field0 = GST_BUFFER_DATA (history[cur_field_idx].buf);
-
-  g_assert (dm_class->fields_required <= 4);
-
-  if (cur_field_idx + 1 < history_count) {
-    field1 = GST_BUFFER_DATA (history[cur_field_idx + 1].buf);
-  } else {
-    field1 = NULL;
-  }
-
-  if (cur_field_idx + 2 < history_count) {
-    field2 = GST_BUFFER_DATA (history[cur_field_idx + 2].buf);
-  } else {
-    field2 = NULL;
-  }
-
-#define CLAMP_LOW(i) (((i)<0) ? (i+2) : (i))
-#define CLAMP_HI(i) (((i)>=(frame_height)) ? (i-2) : (i))
-#define LINE(x,i) ((x) + CLAMP_HI(CLAMP_LOW(i)) * (stride))
-#define LINE2(x,i) ((x) ? LINE(x,i) : NULL)
-
-  for (i = 0; i < frame_height; i++) {
-    memset (&scanlines, 0, sizeof (scanlines));
-    scanlines.bottom_field = (cur_field_flags == PICTURE_INTERLACED_BOTTOM);
-
-    if (!((i & 1) ^ scanlines.bottom_field)) {
-      /* copying */
-      scanlines.tp = LINE2 (fieldp, i - 1);
-      scanlines.bp = LINE2 (fieldp, i + 1);
-
-      scanlines.tt0 = LINE2 (field0, (i - 2 >= 0) ? i - 2 : i);
-      scanlines.m0 = LINE2 (field0, i);
-      scanlines.bb0 = LINE2 (field0, (i + 2 < frame_height ? i + 2 : i));
-
-      scanlines.t1 = LINE2 (field1, i - 1);
-      scanlines.b1 = LINE2 (field1, i + 1);
-
-      scanlines.tt2 = LINE2 (field2, (i - 2 >= 0) ? i - 2 : i);
-      scanlines.m2 = LINE2 (field2, i);
-      scanlines.bb2 = LINE2 (field2, (i + 2 < frame_height ? i + 2 : i));
-
-      self->copy_scanline_packed (self, LINE (dest, i), &scanlines);
-    } else {
-      /* interpolating */
-      scanlines.ttp = LINE2 (fieldp, (i - 2 >= 0) ? i - 2 : i);
-      scanlines.mp = LINE2 (fieldp, i);
-      scanlines.bbp = LINE2 (fieldp, (i + 2 < frame_height ? i + 2 : i));
-
-      scanlines.t0 = LINE2 (field0, i - 1);
-      scanlines.b0 = LINE2 (field0, i + 1);
-
-      scanlines.tt1 = LINE2 (field1, (i - 2 >= 0) ? i - 2 : i);
-      scanlines.m1 = LINE2 (field1, i);
-      scanlines.bb1 = LINE2 (field1, (i + 2 < frame_height ? i + 2 : i));
-
-      scanlines.t2 = LINE2 (field2, i - 1);
-      scanlines.b2 = LINE2 (field2, i + 1);
-
-      self->interpolate_scanline_packed (self, LINE (dest, i), &scanlines);
-    }
-  }
-}
-
 static void
     gst_deinterlace_simple_method_interpolate_scanline_planar_y
     (GstDeinterlaceSimpleMethod * self, guint8 * out,
@@ -450,13 +464,19 @@ gst_deinterlace_simple_method_copy_scanline_planar_v (GstDeinterlaceSimpleMethod
   memcpy (out, scanlines->m0, self->parent.row_stride[2]);
 }
 
+#define CLAMP_LOW(i) (((i)<0) ? (i+2) : (i))
+#define CLAMP_HI(i) (((i)>=(frame_height)) ? (i-2) : (i))
+#define LINE(x,i) ((x) + CLAMP_HI(CLAMP_LOW(i)) * (stride))
+#define LINE2(x,i) ((x) ? LINE(x,i) : NULL)
+
 static void
     gst_deinterlace_simple_method_deinterlace_frame_planar_plane
     (GstDeinterlaceSimpleMethod * self, guint8 * dest, const guint8 * field0,
     const guint8 * field1, const guint8 * field2, const guint8 * fieldp,
     guint cur_field_flags,
     gint plane, GstDeinterlaceSimpleMethodFunction copy_scanline,
-    GstDeinterlaceSimpleMethodFunction interpolate_scanline)
+    GstDeinterlaceSimpleMethodFunction interpolate_scanline, gint start,
+    gint end)
 {
   GstDeinterlaceScanlineData scanlines;
   gint i;
@@ -466,7 +486,7 @@ static void
   g_assert (interpolate_scanline != NULL);
   g_assert (copy_scanline != NULL);
 
-  for (i = 0; i < frame_height; i++) {
+  for (i = start; i < end; i++) {
     memset (&scanlines, 0, sizeof (scanlines));
     scanlines.bottom_field = (cur_field_flags == PICTURE_INTERLACED_BOTTOM);
 
@@ -508,102 +528,139 @@ static void
   }
 }
 
+/* Everything needed to process a range of lines of all planes of a frame */
+typedef struct
+{
+  gint n_planes;
+  guint cur_field_flags;
+  guint8 *dest[3];
+  const guint8 *field0[3], *field1[3], *field2[3], *fieldp[3];
+  const GstDeinterlaceSimpleMethodFunction *copy_scanline;
+  const GstDeinterlaceSimpleMethodFunction *interpolate_scanline;
+} GstDeinterlaceSimpleFrame;
+
+/* start and end are lines of the first plane, the corresponding lines of
+ * the other planes are processed too */
 static void
-gst_deinterlace_simple_method_deinterlace_frame_planar (GstDeinterlaceMethod *
-    method, const GstDeinterlaceField * history, guint history_count,
-    GstBuffer * outbuf, gint cur_field_idx)
+gst_deinterlace_simple_method_deinterlace_slice (GstDeinterlaceMethod * method,
+    gpointer user_data, gint start, gint end)
 {
   GstDeinterlaceSimpleMethod *self = GST_DEINTERLACE_SIMPLE_METHOD (method);
+  GstDeinterlaceSimpleFrame *frame = user_data;
+  gint i, height0 = method->height[0];
+
+  for (i = 0; i < frame->n_planes; i++) {
+    gst_deinterlace_simple_method_deinterlace_frame_planar_plane (self,
+        frame->dest[i], frame->field0[i], frame->field1[i], frame->field2[i],
+        frame->fieldp[i], frame->cur_field_flags, i, frame->copy_scanline[i],
+        frame->interpolate_scanline[i], start * method->height[i] / height0,
+        end * method->height[i] / height0);
+  }
+}
+
+static void
+gst_deinterlace_simple_method_deinterlace_planes (GstDeinterlaceSimpleMethod *
+    self, const GstDeinterlaceField * history, guint history_count,
+    GstBuffer * outbuf, gint cur_field_idx, gint n_planes,
+    const GstDeinterlaceSimpleMethodFunction * copy_scanline,
+    const GstDeinterlaceSimpleMethodFunction * interpolate_scanline)
+{
   GstDeinterlaceMethodClass *dm_class = GST_DEINTERLACE_METHOD_GET_CLASS (self);
-  guint8 *out;
-  const guint8 *field0, *field1, *field2, *fieldp;
-  guint cur_field_flags = history[cur_field_idx].flags;
+  GstDeinterlaceSimpleFrame frame;
   gint i, offset;
-  GstDeinterlaceSimpleMethodFunction copy_scanline;
-  GstDeinterlaceSimpleMethodFunction interpolate_scanline;
 
-  g_assert (self->interpolate_scanline_planar[0] != NULL);
-  g_assert (self->interpolate_scanline_planar[1] != NULL);
-  g_assert (self->interpolate_scanline_planar[2] != NULL);
-  g_assert (self->copy_scanline_planar[0] != NULL);
-  g_assert (self->copy_scanline_planar[1] != NULL);
-  g_assert (self->copy_scanline_planar[2] != NULL);
+  g_assert (dm_class->fields_required <= 4);
 
-  for (i = 0; i < 3; i++) {
-    offset = self->parent.offset[i];
-    copy_scanline = self->copy_scanline_planar[i];
-    interpolate_scanline = self->interpolate_scanline_planar[i];
+  frame.n_planes = n_planes;
+  frame.cur_field_flags = history[cur_field_idx].flags;
+  frame.copy_scanline = copy_scanline;
+  frame.interpolate_scanline = interpolate_scanline;
 
-    out = GST_BUFFER_DATA (outbuf) + offset;
+  for (i = 0; i < n_planes; i++) {
+    /* packed formats have all components in the first plane */
+    offset = (n_planes > 1) ? self->parent.offset[i] : 0;
 
-    fieldp = NULL;
+    frame.dest[i] = GST_BUFFER_DATA (outbuf) + offset;
+
+    frame.fieldp[i] = NULL;
     if (cur_field_idx > 0) {
-      fieldp = GST_BUFFER_DATA (history[cur_field_idx - 1].buf) + offset;
+      frame.fieldp[i] = GST_BUFFER_DATA (history[cur_field_idx - 1].buf) +
+          offset;
     }
 
-    field0 = GST_BUFFER_DATA (history[cur_field_idx].buf) + offset;
-
-    g_assert (dm_class->fields_required <= 4);
+    frame.field0[i] = GST_BUFFER_DATA (history[cur_field_idx].buf) + offset;
 
-    field1 = NULL;
+    frame.field1[i] = NULL;
     if (cur_field_idx + 1 < history_count) {
-      field1 = GST_BUFFER_DATA (history[cur_field_idx + 1].buf) + offset;
+      frame.field1[i] = GST_BUFFER_DATA (history[cur_field_idx + 1].buf) +
+          offset;
     }
 
-    field2 = NULL;
+    frame.field2[i] = NULL;
     if (cur_field_idx + 2 < history_count) {
-      field2 = GST_BUFFER_DATA (history[cur_field_idx + 2].buf) + offset;
+      frame.field2[i] = GST_BUFFER_DATA (history[cur_field_idx + 2].buf) +
+          offset;
     }
-
-    gst_deinterlace_simple_method_deinterlace_frame_planar_plane (self, out,
-        field0, field1, field2, fieldp, cur_field_flags, i, copy_scanline,
-        interpolate_scanline);
   }
+
+  gst_deinterlace_method_run_slices (GST_DEINTERLACE_METHOD (self),
+      gst_deinterlace_simple_method_deinterlace_slice, &frame,
+      self->parent.height[0]);
 }
 
 static void
-gst_deinterlace_simple_method_deinterlace_frame_nv12 (GstDeinterlaceMethod *
+gst_deinterlace_simple_method_deinterlace_frame_packed (GstDeinterlaceMethod *
     method, const GstDeinterlaceField * history, guint history_count,
     GstBuffer * outbuf, gint cur_field_idx)
 {
   GstDeinterlaceSimpleMethod *self = GST_DEINTERLACE_SIMPLE_METHOD (method);
-  GstDeinterlaceMethodClass *dm_class = GST_DEINTERLACE_METHOD_GET_CLASS (self);
-  guint8 *out;
-  const guint8 *field0, *field1, *field2, *fieldp;
-  guint cur_field_flags = history[cur_field_idx].flags;
-  gint i, offset;
 
   g_assert (self->interpolate_scanline_packed != NULL);
   g_assert (self->copy_scanline_packed != NULL);
 
-  for (i = 0; i < 2; i++) {
-    offset = self->parent.offset[i];
+  gst_deinterlace_simple_method_deinterlace_planes (self, history,
+      history_count, outbuf, cur_field_idx, 1, &self->copy_scanline_packed,
+      &self->interpolate_scanline_packed);
+}
 
-    out = GST_BUFFER_DATA (outbuf) + offset;
+static void
+gst_deinterlace_simple_method_deinterlace_frame_planar (GstDeinterlaceMethod *
+    method, const GstDeinterlaceField * history, guint history_count,
+    GstBuffer * outbuf, gint cur_field_idx)
+{
+  GstDeinterlaceSimpleMethod *self = GST_DEINTERLACE_SIMPLE_METHOD (method);
 
-    fieldp = NULL;
-    if (cur_field_idx > 0) {
-      fieldp = GST_BUFFER_DATA (history[cur_field_idx - 1].buf) + offset;
-    }
+  g_assert (self->interpolate_scanline_planar[0] != NULL);
+  g_assert (self->interpolate_scanline_planar[1] != NULL);
+  g_assert (self->interpolate_scanline_planar[2] != NULL);
+  g_assert (self->copy_scanline_planar[0] != NULL);
+  g_assert (self->copy_scanline_planar[1] != NULL);
+  g_assert (self->copy_scanline_planar[2] != NULL);
 
-    field0 = GST_BUFFER_DATA (history[cur_field_idx].buf) + offset;
+  gst_deinterlace_simple_method_deinterlace_planes (self, history,
+      history_count, outbuf, cur_field_idx, 3, self->copy_scanline_planar,
+      self->interpolate_scanline_planar);
+}
 
-    g_assert (dm_class->fields_required <= 4);
+static void
+gst_deinterlace_simple_method_deinterlace_frame_nv12 (GstDeinterlaceMethod *
+    method, const GstDeinterlaceField * history, guint history_count,
+    GstBuffer * outbuf, gint cur_field_idx)
+{
+  GstDeinterlaceSimpleMethod *self = GST_DEINTERLACE_SIMPLE_METHOD (method);
+  GstDeinterlaceSimpleMethodFunction copy_scanline[2];
+  GstDeinterlaceSimpleMethodFunction interpolate_scanline[2];
 
-    field1 = NULL;
-    if (cur_field_idx + 1 < history_count) {
-      field1 = GST_BUFFER_DATA (history[cur_field_idx + 1].buf) + offset;
-    }
+  g_assert (self->interpolate_scanline_packed != NULL);
+  g_assert (self->copy_scanline_packed != NULL);
 
-    field2 = NULL;
-    if (cur_field_idx + 2 < history_count) {
-      field2 = GST_BUFFER_DATA (history[cur_field_idx + 2].buf) + offset;
-    }
+  copy_scanline[0] = copy_scanline[1] = self->copy_scanline_packed;
+  interpolate_scanline[0] = interpolate_scanline[1] =
+      self->interpolate_scanline_packed;
 
-    gst_deinterlace_simple_method_deinterlace_frame_planar_plane (self, out,
-        field0, field1, field2, fieldp, cur_field_flags, i,
-        self->copy_scanline_packed, self->interpolate_scanline_packed);
-  }
+  gst_deinterlace_simple_method_deinterlace_planes (self, history,
+      history_count, outbuf, cur_field_idx, 2, copy_scanline,
+      interpolate_scanline);
 }
 
 static void
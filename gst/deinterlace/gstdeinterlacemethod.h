@@ -65,6 +65,11 @@ typedef void (*GstDeinterlaceMethodDeinterlaceFunction) (
     GstDeinterlaceMethod *self, const GstDeinterlaceField *history,
     guint history_count, GstBuffer *outbuf, int cur_field_idx);
 
+/* Processes the lines start to end (exclusive) of a frame, the unit of the
+ * lines is up to the caller of gst_deinterlace_method_run_slices() */
+typedef void (*GstDeinterlaceMethodSliceFunction) (
+    GstDeinterlaceMethod *self, gpointer user_data, gint start, gint end);
+
 struct _GstDeinterlaceMethod {
   GstObject parent;
 
@@ -77,6 +82,13 @@ struct _GstDeinterlaceMethod {
   gint pixel_stride[4];
 
   GstDeinterlaceMethodDeinterlaceFunction deinterlace_frame;
+
+  /* Slice threading, the pool is owned by the element */
+  guint n_threads;
+  GThreadPool *pool;
+  GMutex *slice_lock;
+  GCond *slice_cond;
+  guint slices_pending;
 };
 
 struct _GstDeinterlaceMethodClass {
@@ -118,6 +130,9 @@ void gst_deinterlace_method_deinterlace_frame (GstDeinterlaceMethod * self, cons
     int cur_field_idx);
 gint gst_deinterlace_method_get_fields_required (GstDeinterlaceMethod * self);
 gint gst_deinterlace_method_get_latency (GstDeinterlaceMethod * self);
+GThreadPool * gst_deinterlace_method_thread_pool_new (guint n_threads, GError ** error);
+void gst_deinterlace_method_set_thread_pool (GstDeinterlaceMethod * self, GThreadPool * pool);
+void gst_deinterlace_method_run_slices (GstDeinterlaceMethod * self, GstDeinterlaceMethodSliceFunction func, gpointer user_data, gint n_lines);
 
 #define GST_TYPE_DEINTERLACE_SIMPLE_METHOD		(gst_deinterlace_simple_method_get_type ())
 #define GST_IS_DEINTERLACE_SIMPLE_METHOD(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_DEINTERLACE_SIMPLE_METHOD))
@@ -41,6 +41,10 @@
 #include <orc/orc.h>
 #endif
 
+#if defined(__SSE2__)
+#define BUILD_X86_SSE2
+#endif
+
 #define GST_TYPE_DEINTERLACE_METHOD_GREEDY_H	(gst_deinterlace_method_greedy_h_get_type ())
 #define GST_IS_DEINTERLACE_METHOD_GREEDY_H(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_DEINTERLACE_METHOD_GREEDY_H))
 #define GST_IS_DEINTERLACE_METHOD_GREEDY_H_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_DEINTERLACE_METHOD_GREEDY_H))
@@ -68,6 +72,7 @@ typedef struct
   ScanlineFunction scanline_ayuv;
   ScanlineFunction scanline_planar_y;
   ScanlineFunction scanline_planar_uv;
+  ScanlineFunction scanline_interleaved_uv;     /* NV12/NV21 chroma */
 } GstDeinterlaceMethodGreedyHClass;
 
 static void
@@ -663,6 +668,180 @@ greedyh_scanline_C_planar_uv (GstDeinterlaceMethodGreedyH * self,
   }
 }
 
+/* One output pixel of the planar scanline functions above, with the
+ * horizontal neighbours step bytes away. Used for the interleaved chroma
+ * plane of NV12/NV21 and for the borders of the SSE2 versions. */
+static inline guint8
+greedyh_pixel (GstDeinterlaceMethodGreedyH * self, const guint8 * L1,
+    const guint8 * L2, const guint8 * L3, const guint8 * L2P, gint Pos,
+    gint width, gint step, gboolean motion)
+{
+  gint prev = (Pos >= step) ? Pos - step : Pos;
+  gint next = (Pos + step < width) ? Pos + step : Pos;
+  guint8 avg, avg__1, avg_1, avg_s, avg_sc;
+  guint8 l2, lp2, l2_diff, lp2_diff, best, min, max, out;
+  guint max_comb = self->max_comb;
+
+  avg = (L1[Pos] + L3[Pos]) / 2;
+  avg__1 = (L1[prev] + L3[prev]) / 2;
+  avg_1 = (L1[next] + L3[next]) / 2;
+  avg_s = (avg__1 + avg_1) / 2;
+  avg_sc = (avg + avg_s) / 2;
+
+  l2 = L2[Pos];
+  lp2 = L2P[Pos];
+  l2_diff = ABS (l2 - avg_sc);
+  lp2_diff = ABS (lp2 - avg_sc);
+  best = (l2_diff > lp2_diff) ? lp2 : l2;
+
+  max = MAX (L1[Pos], L3[Pos]);
+  min = MIN (L1[Pos], L3[Pos]);
+  max = (max < 256 - max_comb) ? max + max_comb : 255;
+  min = (min > max_comb) ? min - max_comb : 0;
+
+  out = CLAMP (best, min, max);
+
+  if (motion) {
+    guint16 mov = ABS (l2 - lp2);
+
+    mov = (mov > self->motion_threshold) ? mov - self->motion_threshold : 0;
+    mov = mov * self->motion_sense;
+    if (mov > 256)
+      mov = 256;
+
+    out = (out * (256 - mov) + avg_sc * mov) / 256;
+  }
+
+  return out;
+}
+
+static void
+greedyh_scanline_C_interleaved_uv (GstDeinterlaceMethodGreedyH * self,
+    const guint8 * L1, const guint8 * L2, const guint8 * L3, const guint8 * L2P,
+    guint8 * Dest, gint width)
+{
+  gint Pos;
+
+  for (Pos = 0; Pos < width; Pos++)
+    Dest[Pos] = greedyh_pixel (self, L1, L2, L3, L2P, Pos, width, 2, FALSE);
+}
+
+#ifdef BUILD_X86_SSE2
+#include <emmintrin.h>
+
+/* Rounding down average, _mm_avg_epu8() rounds up */
+static inline __m128i
+greedyh_avg_sse2 (__m128i a, __m128i b)
+{
+  return _mm_sub_epi8 (_mm_avg_epu8 (a, b),
+      _mm_and_si128 (_mm_xor_si128 (a, b), _mm_set1_epi8 (1)));
+}
+
+static inline __m128i
+greedyh_absdiff_sse2 (__m128i a, __m128i b)
+{
+  return _mm_or_si128 (_mm_subs_epu8 (a, b), _mm_subs_epu8 (b, a));
+}
+
+/* Computes exactly the same as greedyh_pixel(), 16 pixels at a time */
+static inline void
+greedyh_scanline_sse2 (GstDeinterlaceMethodGreedyH * self, const guint8 * L1,
+    const guint8 * L2, const guint8 * L3, const guint8 * L2P, guint8 * Dest,
+    gint width, gint step, gboolean motion)
+{
+  const __m128i max_comb = _mm_set1_epi8 ((gchar) self->max_comb);
+  const __m128i threshold = _mm_set1_epi8 ((gchar) self->motion_threshold);
+  const __m128i sense = _mm_set1_epi16 (self->motion_sense);
+  const __m128i c256 = _mm_set1_epi16 (256);
+  const __m128i zero = _mm_setzero_si128 ();
+  gint Pos;
+
+  for (Pos = 0; Pos < step && Pos < width; Pos++)
+    Dest[Pos] = greedyh_pixel (self, L1, L2, L3, L2P, Pos, width, step, motion);
+
+  for (; Pos + 16 + step <= width; Pos += 16) {
+    __m128i l1 = _mm_loadu_si128 ((const __m128i *) (L1 + Pos));
+    __m128i l3 = _mm_loadu_si128 ((const __m128i *) (L3 + Pos));
+    __m128i l2 = _mm_loadu_si128 ((const __m128i *) (L2 + Pos));
+    __m128i lp2 = _mm_loadu_si128 ((const __m128i *) (L2P + Pos));
+    __m128i avg, avg__1, avg_1, avg_sc, l2_diff, lp2_diff, le, best;
+    __m128i min, max, out;
+
+    avg = greedyh_avg_sse2 (l1, l3);
+    avg__1 =
+        greedyh_avg_sse2 (_mm_loadu_si128 ((const __m128i *) (L1 + Pos -
+                step)), _mm_loadu_si128 ((const __m128i *) (L3 + Pos - step)));
+    avg_1 =
+        greedyh_avg_sse2 (_mm_loadu_si128 ((const __m128i *) (L1 + Pos +
+                step)), _mm_loadu_si128 ((const __m128i *) (L3 + Pos + step)));
+    avg_sc = greedyh_avg_sse2 (avg, greedyh_avg_sse2 (avg__1, avg_1));
+
+    /* l2_diff <= lp2_diff selects l2 */
+    l2_diff = greedyh_absdiff_sse2 (l2, avg_sc);
+    lp2_diff = greedyh_absdiff_sse2 (lp2, avg_sc);
+    le = _mm_cmpeq_epi8 (_mm_max_epu8 (l2_diff, lp2_diff), lp2_diff);
+    best = _mm_or_si128 (_mm_and_si128 (le, l2), _mm_andnot_si128 (le, lp2));
+
+    max = _mm_adds_epu8 (_mm_max_epu8 (l1, l3), max_comb);
+    min = _mm_subs_epu8 (_mm_min_epu8 (l1, l3), max_comb);
+    out = _mm_max_epu8 (_mm_min_epu8 (best, max), min);
+
+    if (motion) {
+      __m128i mov = _mm_subs_epu8 (greedyh_absdiff_sse2 (l2, lp2), threshold);
+      __m128i mov_lo = _mm_unpacklo_epi8 (mov, zero);
+      __m128i mov_hi = _mm_unpackhi_epi8 (mov, zero);
+      __m128i out_lo = _mm_unpacklo_epi8 (out, zero);
+      __m128i out_hi = _mm_unpackhi_epi8 (out, zero);
+      __m128i avg_lo = _mm_unpacklo_epi8 (avg_sc, zero);
+      __m128i avg_hi = _mm_unpackhi_epi8 (avg_sc, zero);
+
+      /* all products are below 65536, so the unsigned 16 bit results of
+       * mullo are exact; min (x, 256) is x - (x -sat 256) */
+      mov_lo = _mm_mullo_epi16 (mov_lo, sense);
+      mov_hi = _mm_mullo_epi16 (mov_hi, sense);
+      mov_lo = _mm_sub_epi16 (mov_lo, _mm_subs_epu16 (mov_lo, c256));
+      mov_hi = _mm_sub_epi16 (mov_hi, _mm_subs_epu16 (mov_hi, c256));
+
+      out_lo = _mm_add_epi16 (_mm_mullo_epi16 (out_lo, _mm_sub_epi16 (c256,
+                  mov_lo)), _mm_mullo_epi16 (avg_lo, mov_lo));
+      out_hi = _mm_add_epi16 (_mm_mullo_epi16 (out_hi, _mm_sub_epi16 (c256,
+                  mov_hi)), _mm_mullo_epi16 (avg_hi, mov_hi));
+      out = _mm_packus_epi16 (_mm_srli_epi16 (out_lo, 8),
+          _mm_srli_epi16 (out_hi, 8));
+    }
+
+    _mm_storeu_si128 ((__m128i *) (Dest + Pos), out);
+  }
+
+  for (; Pos < width; Pos++)
+    Dest[Pos] = greedyh_pixel (self, L1, L2, L3, L2P, Pos, width, step, motion);
+}
+
+static void
+greedyh_scanline_SSE2_planar_y (GstDeinterlaceMethodGreedyH * self,
+    const guint8 * L1, const guint8 * L2, const guint8 * L3, const guint8 * L2P,
+    guint8 * Dest, gint width)
+{
+  greedyh_scanline_sse2 (self, L1, L2, L3, L2P, Dest, width, 1, TRUE);
+}
+
+static void
+greedyh_scanline_SSE2_planar_uv (GstDeinterlaceMethodGreedyH * self,
+    const guint8 * L1, const guint8 * L2, const guint8 * L3, const guint8 * L2P,
+    guint8 * Dest, gint width)
+{
+  greedyh_scanline_sse2 (self, L1, L2, L3, L2P, Dest, width, 1, FALSE);
+}
+
+static void
+greedyh_scanline_SSE2_interleaved_uv (GstDeinterlaceMethodGreedyH * self,
+    const guint8 * L1, const guint8 * L2, const guint8 * L3, const guint8 * L2P,
+    guint8 * Dest, gint width)
+{
+  greedyh_scanline_sse2 (self, L1, L2, L3, L2P, Dest, width, 2, FALSE);
+}
+#endif
+
 #ifdef BUILD_X86_ASM
 
 #define IS_MMXEXT
@@ -716,6 +895,96 @@ greedyh_scanline_C_planar_uv (GstDeinterlaceMethodGreedyH * self,
 
 #endif
 
+/* The weave lines of up to three planes, see
+ * deinterlace_frame_di_greedyh_slice() */
+typedef struct
+{
+  gint n_planes;
+  const guint8 *L1[3];          // ptr to Line1, of 3
+  const guint8 *L2[3];          // ptr to Line2, the weave line
+  const guint8 *L3[3];          // ptr to Line3
+  const guint8 *L2P[3];         // ptr to prev Line2
+  guint8 *Dest[3];
+  gint RowStride[3];
+  gint FieldHeight[3];
+  gint Pitch[3];
+  ScanlineFunction scanline[3];
+} GreedyHFrame;
+
+// start and end count the lines of the first plane that are interpolated,
+// the corresponding lines of the other planes are processed too
+static void
+deinterlace_frame_di_greedyh_slice (GstDeinterlaceMethod * method,
+    gpointer user_data, gint start, gint end)
+{
+  GstDeinterlaceMethodGreedyH *self = GST_DEINTERLACE_METHOD_GREEDY_H (method);
+  GreedyHFrame *frame = user_data;
+  gint Lines0 = frame->FieldHeight[0] - 1;
+  gint i, Line, Lines, First, Last;
+
+  if (Lines0 <= 0)
+    return;
+
+  for (i = 0; i < frame->n_planes; i++) {
+    gint RowStride = frame->RowStride[i];
+    gint Pitch = frame->Pitch[i];
+
+    Lines = frame->FieldHeight[i] - 1;
+    First = start * Lines / Lines0;
+    Last = end * Lines / Lines0;
+
+    for (Line = First; Line < Last; ++Line) {
+      guint8 *Dest = frame->Dest[i] + Line * 2 * RowStride;
+      const guint8 *L3 = frame->L3[i] + Line * Pitch;
+
+      frame->scanline[i] (self, frame->L1[i] + Line * Pitch,
+          frame->L2[i] + Line * Pitch, L3, frame->L2P[i] + Line * Pitch,
+          Dest, RowStride);
+      memcpy (Dest + RowStride, L3, RowStride);
+    }
+  }
+}
+
+static void
+deinterlace_frame_di_greedyh_plane (GreedyHFrame * frame, gint i,
+    const guint8 * L1, const guint8 * L2, const guint8 * L3,
+    const guint8 * L2P, guint8 * Dest, gint RowStride, gint FieldHeight,
+    gint Pitch, gint InfoIsOdd, ScanlineFunction scanline)
+{
+  // copy first even line no matter what, and the first odd line if we're
+  // processing an EVEN field. (note diff from other deint rtns.)
+
+  if (InfoIsOdd) {
+    // copy first even line
+    memcpy (Dest, L1, RowStride);
+    Dest += RowStride;
+  } else {
+    // copy first even line
+    memcpy (Dest, L1, RowStride);
+    Dest += RowStride;
+    // then first odd line
+    memcpy (Dest, L1, RowStride);
+    Dest += RowStride;
+  }
+
+  // the interpolated lines in between are done by the slices
+  frame->L1[i] = L1;
+  frame->L2[i] = L2;
+  frame->L3[i] = L3;
+  frame->L2P[i] = L2P;
+  frame->Dest[i] = Dest;
+  frame->RowStride[i] = RowStride;
+  frame->FieldHeight[i] = FieldHeight;
+  frame->Pitch[i] = Pitch;
+  frame->scanline[i] = scanline;
+
+  if (InfoIsOdd) {
+    Dest += MAX (FieldHeight - 1, 0) * 2 * RowStride;
+    L2 += MAX (FieldHeight - 1, 0) * Pitch;
+    memcpy (Dest, L2, RowStride);
+  }
+}
+
 static void
 deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
     const GstDeinterlaceField * history, guint history_count,
@@ -725,7 +994,6 @@ deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
   GstDeinterlaceMethodGreedyHClass *klass =
       GST_DEINTERLACE_METHOD_GREEDY_H_GET_CLASS (self);
   gint InfoIsOdd = 0;
-  gint Line;
   gint RowStride = method->row_stride[0];
   gint FieldHeight = method->frame_height / 2;
   gint Pitch = method->row_stride[0] * 2;
@@ -735,6 +1003,7 @@ deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
   const guint8 *L2P;            // ptr to prev Line2
   guint8 *Dest = GST_BUFFER_DATA (outbuf);
   ScanlineFunction scanline;
+  GreedyHFrame frame;
 
   if (cur_field_idx + 2 > history_count || cur_field_idx < 1) {
     GstDeinterlaceMethod *backup_method;
@@ -769,9 +1038,6 @@ deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
       return;
   }
 
-  // copy first even line no matter what, and the first odd line if we're
-  // processing an EVEN field. (note diff from other deint rtns.)
-
   if (history[cur_field_idx - 1].flags == PICTURE_INTERLACED_BOTTOM) {
     InfoIsOdd = 1;
 
@@ -787,10 +1053,6 @@ deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
     L2P = GST_BUFFER_DATA (history[cur_field_idx - 3].buf);
     if (history[cur_field_idx - 3].flags & PICTURE_INTERLACED_BOTTOM)
       L2P += RowStride;
-
-    // copy first even line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
   } else {
     InfoIsOdd = 0;
     L1 = GST_BUFFER_DATA (history[cur_field_idx - 2].buf);
@@ -805,71 +1067,14 @@ deinterlace_frame_di_greedyh_packed (GstDeinterlaceMethod * method,
     L2P = GST_BUFFER_DATA (history[cur_field_idx - 3].buf) + Pitch;
     if (history[cur_field_idx - 3].flags & PICTURE_INTERLACED_BOTTOM)
       L2P += RowStride;
-
-    // copy first even line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
-    // then first odd line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
-  }
-
-  for (Line = 0; Line < (FieldHeight - 1); ++Line) {
-    scanline (self, L1, L2, L3, L2P, Dest, RowStride);
-    Dest += RowStride;
-    memcpy (Dest, L3, RowStride);
-    Dest += RowStride;
-
-    L1 += Pitch;
-    L2 += Pitch;
-    L3 += Pitch;
-    L2P += Pitch;
-  }
-
-  if (InfoIsOdd) {
-    memcpy (Dest, L2, RowStride);
   }
-}
-
-static void
-deinterlace_frame_di_greedyh_planar_plane (GstDeinterlaceMethodGreedyH * self,
-    const guint8 * L1, const guint8 * L2, const guint8 * L3, const guint8 * L2P,
-    guint8 * Dest, gint RowStride, gint FieldHeight, gint Pitch, gint InfoIsOdd,
-    ScanlineFunction scanline)
-{
-  gint Line;
 
-  // copy first even line no matter what, and the first odd line if we're
-  // processing an EVEN field. (note diff from other deint rtns.)
+  frame.n_planes = 1;
+  deinterlace_frame_di_greedyh_plane (&frame, 0, L1, L2, L3, L2P, Dest,
+      RowStride, FieldHeight, Pitch, InfoIsOdd, scanline);
 
-  if (InfoIsOdd) {
-    // copy first even line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
-  } else {
-    // copy first even line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
-    // then first odd line
-    memcpy (Dest, L1, RowStride);
-    Dest += RowStride;
-  }
-
-  for (Line = 0; Line < (FieldHeight - 1); ++Line) {
-    scanline (self, L1, L2, L3, L2P, Dest, RowStride);
-    Dest += RowStride;
-    memcpy (Dest, L3, RowStride);
-    Dest += RowStride;
-
-    L1 += Pitch;
-    L2 += Pitch;
-    L3 += Pitch;
-    L2P += Pitch;
-  }
-
-  if (InfoIsOdd) {
-    memcpy (Dest, L2, RowStride);
-  }
+  gst_deinterlace_method_run_slices (method,
+      deinterlace_frame_di_greedyh_slice, &frame, FieldHeight - 1);
 }
 
 static void
@@ -892,6 +1097,7 @@ deinterlace_frame_di_greedyh_planar (GstDeinterlaceMethod * method,
   gint i;
   gint Offset;
   ScanlineFunction scanline;
+  GreedyHFrame frame;
 
   if (cur_field_idx + 2 > history_count || cur_field_idx < 1) {
     GstDeinterlaceMethod *backup_method;
@@ -910,8 +1116,17 @@ deinterlace_frame_di_greedyh_planar (GstDeinterlaceMethod * method,
 
   cur_field_idx += 2;
 
-  for (i = 0; i < 3; i++) {
+  /* NV12/NV21 have a single plane with interleaved chroma */
+  if (method->format == GST_VIDEO_FORMAT_NV12 ||
+      method->format == GST_VIDEO_FORMAT_NV21)
+    frame.n_planes = 2;
+  else
+    frame.n_planes = 3;
+
+  for (i = 0; i < frame.n_planes; i++) {
     Offset = method->offset[i];
+    if (frame.n_planes == 2 && i == 1)
+      Offset = MIN (method->offset[1], method->offset[2]);
 
     InfoIsOdd = (history[cur_field_idx - 1].flags == PICTURE_INTERLACED_BOTTOM);
     RowStride = method->row_stride[i];
@@ -920,6 +1135,8 @@ deinterlace_frame_di_greedyh_planar (GstDeinterlaceMethod * method,
 
     if (i == 0)
       scanline = klass->scanline_planar_y;
+    else if (frame.n_planes == 2)
+      scanline = klass->scanline_interleaved_uv;
     else
       scanline = klass->scanline_planar_uv;
 
@@ -938,9 +1155,13 @@ deinterlace_frame_di_greedyh_planar (GstDeinterlaceMethod * method,
     if (history[cur_field_idx - 3].flags & PICTURE_INTERLACED_BOTTOM)
       L2P += RowStride;
 
-    deinterlace_frame_di_greedyh_planar_plane (self, L1, L2, L3, L2P, Dest,
+    deinterlace_frame_di_greedyh_plane (&frame, i, L1, L2, L3, L2P, Dest,
         RowStride, FieldHeight, Pitch, InfoIsOdd, scanline);
   }
+
+  gst_deinterlace_method_run_slices (method,
+      deinterlace_frame_di_greedyh_slice, &frame,
+      method->height[0] / 2 - 1);
 }
 
 G_DEFINE_TYPE (GstDeinterlaceMethodGreedyH, gst_deinterlace_method_greedy_h,
@@ -1044,6 +1265,8 @@ gst_deinterlace_method_greedy_h_class_init (GstDeinterlaceMethodGreedyHClass *
   dim_class->deinterlace_frame_yv12 = deinterlace_frame_di_greedyh_planar;
   dim_class->deinterlace_frame_y42b = deinterlace_frame_di_greedyh_planar;
   dim_class->deinterlace_frame_y41b = deinterlace_frame_di_greedyh_planar;
+  dim_class->deinterlace_frame_nv12 = deinterlace_frame_di_greedyh_planar;
+  dim_class->deinterlace_frame_nv21 = deinterlace_frame_di_greedyh_planar;
 
 #ifdef BUILD_X86_ASM
   if (cpu_flags & ORC_TARGET_MMX_MMXEXT) {
@@ -1063,10 +1286,17 @@ gst_deinterlace_method_greedy_h_class_init (GstDeinterlaceMethodGreedyHClass *
   klass->scanline_yuy2 = greedyh_scanline_C_yuy2;
   klass->scanline_uyvy = greedyh_scanline_C_uyvy;
 #endif
-  /* TODO: MMX implementation of these two */
+  /* TODO: MMX implementation of this one */
   klass->scanline_ayuv = greedyh_scanline_C_ayuv;
+#ifdef BUILD_X86_SSE2
+  klass->scanline_planar_y = greedyh_scanline_SSE2_planar_y;
+  klass->scanline_planar_uv = greedyh_scanline_SSE2_planar_uv;
+  klass->scanline_interleaved_uv = greedyh_scanline_SSE2_interleaved_uv;
+#else
   klass->scanline_planar_y = greedyh_scanline_C_planar_y;
   klass->scanline_planar_uv = greedyh_scanline_C_planar_uv;
+  klass->scanline_interleaved_uv = greedyh_scanline_C_interleaved_uv;
+#endif
 }
 
 static void
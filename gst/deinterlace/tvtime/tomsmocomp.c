@@ -68,15 +68,33 @@ Fieldcopy (guint8 * dest, const guint8 * src, gint count,
   }
 }
 
+/* The fields of one frame, the motion search is done in slices of it */
+typedef struct
+{
+  glong SearchEffort;
+  gint UseStrangeBob;
+  gint IsOdd;
+  gint src_pitch;
+  gint dst_pitch;
+  gint rowsize;
+  const guint8 *pWeaveSrc;
+  const guint8 *pWeaveSrcP;
+  guint8 *pWeaveDest;
+  const guint8 *pCopySrc;
+  const guint8 *pCopySrcP;
+} TomsMoCompFrame;
+
 #define USE_FOR_DSCALER
 
 #define IS_C
 #define SIMD_TYPE C
 #define FUNCT_NAME tomsmocompDScaler_C
+#define FUNCT_NAME_SLICE tomsmocompDScaler_C_slice
 #include "tomsmocomp/TomsMoCompAll.inc"
 #undef  IS_C
 #undef  SIMD_TYPE
 #undef  FUNCT_NAME
+#undef  FUNCT_NAME_SLICE
 
 #ifdef BUILD_X86_ASM
 
@@ -86,26 +104,32 @@ Fieldcopy (guint8 * dest, const guint8 * src, gint count,
 #define IS_MMX
 #define SIMD_TYPE MMX
 #define FUNCT_NAME tomsmocompDScaler_MMX
+#define FUNCT_NAME_SLICE tomsmocompDScaler_MMX_slice
 #include "tomsmocomp/TomsMoCompAll.inc"
 #undef  IS_MMX
 #undef  SIMD_TYPE
 #undef  FUNCT_NAME
+#undef  FUNCT_NAME_SLICE
 
 #define IS_3DNOW
 #define SIMD_TYPE 3DNOW
 #define FUNCT_NAME tomsmocompDScaler_3DNOW
+#define FUNCT_NAME_SLICE tomsmocompDScaler_3DNOW_slice
 #include "tomsmocomp/TomsMoCompAll.inc"
 #undef  IS_3DNOW
 #undef  SIMD_TYPE
 #undef  FUNCT_NAME
+#undef  FUNCT_NAME_SLICE
 
 #define IS_MMXEXT
 #define SIMD_TYPE MMXEXT
 #define FUNCT_NAME tomsmocompDScaler_MMXEXT
+#define FUNCT_NAME_SLICE tomsmocompDScaler_MMXEXT_slice
 #include "tomsmocomp/TomsMoCompAll.inc"
 #undef  IS_MMXEXT
 #undef  SIMD_TYPE
 #undef  FUNCT_NAME
+#undef  FUNCT_NAME_SLICE
 
 #endif
 
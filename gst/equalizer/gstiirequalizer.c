@@ -417,6 +417,8 @@ gst_iir_equalizer_finalize (GObject * object)
 
   g_free (equ->bands);
   g_free (equ->history);
+  g_free (equ->sections);
+  g_free (equ->frame);
 
   g_mutex_free (equ->bands_lock);
 
@@ -613,20 +615,61 @@ set_passthrough (GstIirEqualizer * equ)
   GST_DEBUG ("Passthrough mode: %d\n", passthrough);
 }
 
+/* the bands are run as second order sections in transposed direct form II,
+ * which needs only two state values and has a shorter dependency chain from
+ * the input to the output than the direct form I */
+typedef struct
+{
+  gdouble s1, s2;
+} SecondOrderHistory;
+
+typedef struct
+{
+  gdouble a0, a1, a2;           /* IIR coefficients for inputs */
+  gdouble b1, b2;               /* IIR coefficients for outputs */
+  guint band;                   /* index of the band and its history */
+} SecondOrderSection;
+
 /* Must be called with bands_lock and transform lock! */
 static void
 update_coefficients (GstIirEqualizer * equ)
 {
   gint i, n = equ->freq_band_count;
+  guint channels = GST_AUDIO_FILTER (equ)->format.channels;
+  SecondOrderSection *sections;
+
+  equ->sections = g_renew (SecondOrderSection, equ->sections, n);
+  sections = equ->sections;
+  equ->n_sections = 0;
 
   for (i = 0; i < n; i++) {
-    if (equ->bands[i]->type == BAND_TYPE_PEAK)
-      setup_peak_filter (equ, equ->bands[i]);
-    else if (equ->bands[i]->type == BAND_TYPE_LOW_SHELF)
-      setup_low_shelf_filter (equ, equ->bands[i]);
+    GstIirEqualizerBand *band = equ->bands[i];
+
+    if (band->type == BAND_TYPE_PEAK)
+      setup_peak_filter (equ, band);
+    else if (band->type == BAND_TYPE_LOW_SHELF)
+      setup_low_shelf_filter (equ, band);
     else
-      setup_high_shelf_filter (equ, equ->bands[i]);
+      setup_high_shelf_filter (equ, band);
+
+    /* a band at 0 dB does not change anything, leave it out. Its history
+     * starts from silence when it is used again */
+    if (band->gain == 0.0) {
+      if (equ->history)
+        memset ((SecondOrderHistory *) equ->history + i * channels, 0,
+            channels * sizeof (SecondOrderHistory));
+      continue;
+    }
+
+    sections[equ->n_sections].a0 = band->a0;
+    sections[equ->n_sections].a1 = band->a1;
+    sections[equ->n_sections].a2 = band->a2;
+    sections[equ->n_sections].b1 = band->b1;
+    sections[equ->n_sections].b2 = band->b2;
+    sections[equ->n_sections].band = i;
+    equ->n_sections++;
   }
+  GST_DEBUG_OBJECT (equ, "%u of %d bands active", equ->n_sections, n);
 
   equ->need_new_coefficients = FALSE;
 }
@@ -730,110 +773,91 @@ gst_iir_equalizer_compute_frequencies (GstIirEqualizer * equ, guint new_count)
   BANDS_UNLOCK (equ);
 }
 
+/* run one frame through all bands. The channels do not depend on each
+ * other, so the iterations of the inner loop can overlap, which they can't
+ * for the bands of one channel */
+static inline void
+process_frame (GstIirEqualizer * equ, gdouble * frame, guint channels)
+{
+  const SecondOrderSection *sections = equ->sections;
+  guint s, c, ns = equ->n_sections;
+
+  for (s = 0; s < ns; s++) {
+    SecondOrderHistory *history =
+        (SecondOrderHistory *) equ->history + sections[s].band * channels;
+    gdouble a0 = sections[s].a0, a1 = sections[s].a1, a2 = sections[s].a2;
+    gdouble b1 = sections[s].b1, b2 = sections[s].b2;
+
+    for (c = 0; c < channels; c++) {
+      gdouble input = frame[c];
+      gdouble output = a0 * input + history[c].s1;
+
+      history[c].s1 = a1 * input + b1 * output + history[c].s2;
+      history[c].s2 = a2 * input + b2 * output;
+      frame[c] = output;
+    }
+  }
+}
+
 /* start of code that is type specific */
 
-#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,BIG_TYPE,MIN_VAL,MAX_VAL)   \
-typedef struct {                                                        \
-  BIG_TYPE x1, x2;          /* history of input values for a filter */  \
-  BIG_TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
-                                                                        \
-static inline BIG_TYPE                                                  \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, BIG_TYPE input)                \
-{                                                                       \
-  /* calculate output */                                                \
-  BIG_TYPE output = filter->a0 * input +                                \
-      filter->a1 * history->x1 + filter->a2 * history->x2 +             \
-      filter->b1 * history->y1 + filter->b2 * history->y2;              \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
-                                                                        \
-  return output;                                                        \
-}                                                                       \
-                                                                        \
-static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
-                                                                        \
+#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,MIN_VAL,MAX_VAL)            \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
-  BIG_TYPE cur;                                                         \
-  GstIirEqualizerBand **filters = equ->bands;                           \
+  guint i, c;                                                           \
+  TYPE *samples = (TYPE *) data;                                        \
+  gdouble *frame = equ->frame;                                          \
                                                                         \
   for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      cur = CLAMP (cur, MIN_VAL, MAX_VAL);                              \
-      *((TYPE *) data) = (TYPE) floor (cur);                            \
-      data += sizeof (TYPE);                                            \
-    }                                                                   \
+    for (c = 0; c < channels; c++)                                      \
+      frame[c] = samples[c];                                            \
+    process_frame (equ, frame, channels);                               \
+    for (c = 0; c < channels; c++)                                      \
+      samples[c] = (TYPE) floor (CLAMP (frame[c], MIN_VAL, MAX_VAL));   \
+    samples += channels;                                                \
   }                                                                     \
 }
 
 #define CREATE_OPTIMIZED_FUNCTIONS(TYPE)                                \
-typedef struct {                                                        \
-  TYPE x1, x2;          /* history of input values for a filter */  \
-  TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
-                                                                        \
-static inline TYPE                                                      \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, TYPE input)                    \
-{                                                                       \
-  /* calculate output */                                                \
-  TYPE output = filter->a0 * input + filter->a1 * history->x1 +         \
-      filter->a2 * history->x2 + filter->b1 * history->y1 +             \
-      filter->b2 * history->y2;                                         \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
-                                                                        \
-  return output;                                                        \
-}                                                                       \
-                                                                        \
-static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
-                                                                        \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
-  TYPE cur;                                                             \
-  GstIirEqualizerBand **filters = equ->bands;                           \
+  guint i, c;                                                           \
+  TYPE *samples = (TYPE *) data;                                        \
+  gdouble *frame = equ->frame;                                          \
                                                                         \
   for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      *((TYPE *) data) = (TYPE) cur;                                    \
-      data += sizeof (TYPE);                                            \
-    }                                                                   \
+    for (c = 0; c < channels; c++)                                      \
+      frame[c] = samples[c];                                            \
+    process_frame (equ, frame, channels);                               \
+    for (c = 0; c < channels; c++)                                      \
+      samples[c] = (TYPE) frame[c];                                     \
+    samples += channels;                                                \
   }                                                                     \
 }
 
-CREATE_OPTIMIZED_FUNCTIONS_INT (gint16, gfloat, -32768.0, 32767.0);
+CREATE_OPTIMIZED_FUNCTIONS_INT (gint16, -32768.0, 32767.0);
 CREATE_OPTIMIZED_FUNCTIONS (gfloat);
-CREATE_OPTIMIZED_FUNCTIONS (gdouble);
+
+/* no conversion needed, filter in place */
+static void
+gst_iir_equ_process_gdouble (GstIirEqualizer * equ, guint8 * data,
+    guint size, guint channels)
+{
+  guint frames = size / channels / sizeof (gdouble);
+  guint i;
+  gdouble *samples = (gdouble *) data;
+
+  for (i = 0; i < frames; i++) {
+    process_frame (equ, samples, channels);
+    samples += channels;
+  }
+}
 
 static GstFlowReturn
 gst_iir_equalizer_transform_ip (GstBaseTransform * btrans, GstBuffer * buf)
@@ -892,7 +916,6 @@ gst_iir_equalizer_setup (GstAudioFilter * audio, GstRingBufferSpec * fmt)
     case GST_BUFTYPE_LINEAR:
       switch (fmt->width) {
         case 16:
-          equ->history_size = history_size_gint16;
           equ->process = gst_iir_equ_process_gint16;
           break;
         default:
@@ -902,11 +925,9 @@ gst_iir_equalizer_setup (GstAudioFilter * audio, GstRingBufferSpec * fmt)
     case GST_BUFTYPE_FLOAT:
       switch (fmt->width) {
         case 32:
-          equ->history_size = history_size_gfloat;
           equ->process = gst_iir_equ_process_gfloat;
           break;
         case 64:
-          equ->history_size = history_size_gdouble;
           equ->process = gst_iir_equ_process_gdouble;
           break;
         default:
@@ -917,7 +938,17 @@ gst_iir_equalizer_setup (GstAudioFilter * audio, GstRingBufferSpec * fmt)
       return FALSE;
   }
 
+  equ->history_size = sizeof (SecondOrderHistory);
   alloc_history (equ);
+
+  g_free (equ->frame);
+  equ->frame = g_new0 (gdouble, fmt->channels);
+
+  /* the coefficients depend on the rate, the sections on the channels */
+  BANDS_LOCK (equ);
+  equ->need_new_coefficients = TRUE;
+  BANDS_UNLOCK (equ);
+
   return TRUE;
 }
 
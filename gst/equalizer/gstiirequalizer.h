@@ -61,6 +61,13 @@ struct _GstIirEqualizer
   gpointer history;
   guint history_size;
 
+  /* the bands that are not at 0 dB, in processing order */
+  gpointer sections;
+  guint n_sections;
+
+  /* one frame of samples as doubles */
+  gdouble *frame;
+
   gboolean need_new_coefficients;
 
   ProcessFunc process;
@@ -103,15 +103,58 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
         "width = (int) { 32, 64 }")
     );
 
+/* The input is deinterleaved in blocks of BLOCK_FRAMES frames. All
+ * channels are taken from one block while it is still in the cache,
+ * instead of going over the complete input buffer once per channel */
+#define BLOCK_FRAMES 64
+
 #define MAKE_FUNC(type) \
-static void deinterleave_##type (guint##type *out, guint##type *in, \
-    guint stride, guint nframes) \
+static void deinterleave_##type (guint##type **out, guint##type *in, \
+    guint channels, guint nframes) \
+{ \
+  guint i, j, block, n; \
+  \
+  for (block = 0; block < nframes; block += BLOCK_FRAMES) { \
+    n = MIN (BLOCK_FRAMES, nframes - block); \
+    \
+    for (j = 0; j < channels; j++) { \
+      guint##type *o = out[j] + block; \
+      guint##type *p = in + block * channels + j; \
+      \
+      for (i = 0; i < n; i++) { \
+        o[i] = *p; \
+        p += channels; \
+      } \
+    } \
+  } \
+}
+
+/* With a constant number of channels four frames are handled per
+ * iteration, the four consecutive samples of every output channel can
+ * then be stored with one SIMD instruction */
+#define MAKE_FUNC_FIXED_CHANNELS(type,channels) \
+static void deinterleave_##channels##_##type (guint##type **out, \
+    guint##type *in, guint stride, guint nframes) \
 { \
-  gint i; \
+  guint i, j; \
   \
-  for (i = 0; i < nframes; i++) { \
-    out[i] = *in; \
-    in += stride; \
+  for (i = 0; i + 4 <= nframes; i += 4) { \
+    for (j = 0; j < channels; j++) { \
+      guint##type *o = out[j] + i; \
+      guint##type s0 = in[j], s1 = in[channels + j]; \
+      guint##type s2 = in[2 * channels + j], s3 = in[3 * channels + j]; \
+      \
+      o[0] = s0; \
+      o[1] = s1; \
+      o[2] = s2; \
+      o[3] = s3; \
+    } \
+    in += 4 * channels; \
+  } \
+  for (; i < nframes; i++) { \
+    for (j = 0; j < channels; j++) \
+      out[j][i] = in[j]; \
+    in += channels; \
   } \
 }
 
@@ -120,15 +163,41 @@ MAKE_FUNC (16);
 MAKE_FUNC (32);
 MAKE_FUNC (64);
 
+MAKE_FUNC_FIXED_CHANNELS (8, 2);
+MAKE_FUNC_FIXED_CHANNELS (16, 2);
+MAKE_FUNC_FIXED_CHANNELS (32, 2);
+MAKE_FUNC_FIXED_CHANNELS (64, 2);
+
+MAKE_FUNC_FIXED_CHANNELS (8, 4);
+MAKE_FUNC_FIXED_CHANNELS (16, 4);
+MAKE_FUNC_FIXED_CHANNELS (32, 4);
+MAKE_FUNC_FIXED_CHANNELS (64, 4);
+
+MAKE_FUNC_FIXED_CHANNELS (8, 8);
+MAKE_FUNC_FIXED_CHANNELS (16, 8);
+MAKE_FUNC_FIXED_CHANNELS (32, 8);
+MAKE_FUNC_FIXED_CHANNELS (64, 8);
+
 static void
-deinterleave_24 (guint8 * out, guint8 * in, guint stride, guint nframes)
+deinterleave_24 (guint8 ** out, guint8 * in, guint channels, guint nframes)
 {
-  gint i;
+  guint i, j, block, n;
+
+  for (block = 0; block < nframes; block += BLOCK_FRAMES) {
+    n = MIN (BLOCK_FRAMES, nframes - block);
+
+    for (j = 0; j < channels; j++) {
+      guint8 *o = out[j] + block * 3;
+      guint8 *p = in + (block * channels + j) * 3;
 
-  for (i = 0; i < nframes; i++) {
-    memcpy (out, in, 3);
-    out += 3;
-    in += stride * 3;
+      for (i = 0; i < n; i++) {
+        o[0] = p[0];
+        o[1] = p[1];
+        o[2] = p[2];
+        o += 3;
+        p += channels * 3;
+      }
+    }
   }
 }
 
@@ -138,7 +207,8 @@ GST_BOILERPLATE (GstDeinterleave, gst_deinterleave, GstElement,
 enum
 {
   PROP_0,
-  PROP_KEEP_POSITIONS
+  PROP_KEEP_POSITIONS,
+  PROP_BATCH_ALLOCATION
 };
 
 static GstFlowReturn gst_deinterleave_chain (GstPad * pad, GstBuffer * buffer);
@@ -221,6 +291,23 @@ gst_deinterleave_class_init (GstDeinterleaveClass * klass)
       g_param_spec_boolean ("keep-positions", "Keep positions",
           "Keep the original channel positions on the output buffers",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDeinterleave:batch-allocation
+   *
+   * Allocate the output buffers of all channels at once as parts of one
+   * memory block instead of requesting every buffer from downstream. This
+   * saves one allocation per channel and buffer, which matters for streams
+   * with many channels. gst_pad_alloc_buffer() is not called in this mode,
+   * so downstream elements can't provide the buffers from their own pool
+   * and can't suggest different caps with them.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_ALLOCATION,
+      g_param_spec_boolean ("batch-allocation", "Batch allocation",
+          "Allocate the output buffers of all channels as parts of one "
+          "memory block", FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -229,6 +316,7 @@ gst_deinterleave_init (GstDeinterleave * self, GstDeinterleaveClass * klass)
   self->channels = 0;
   self->pos = NULL;
   self->keep_positions = FALSE;
+  self->batch_allocation = FALSE;
   self->width = 0;
   self->func = NULL;
 
@@ -349,6 +437,17 @@ gst_deinterleave_remove_pads (GstDeinterleave * self)
   gst_caps_replace (&self->sinkcaps, NULL);
 }
 
+#define SET_FUNC(type) G_STMT_START { \
+  if (self->channels == 2) \
+    self->func = (GstDeinterleaveFunc) deinterleave_2_##type; \
+  else if (self->channels == 4) \
+    self->func = (GstDeinterleaveFunc) deinterleave_4_##type; \
+  else if (self->channels == 8) \
+    self->func = (GstDeinterleaveFunc) deinterleave_8_##type; \
+  else \
+    self->func = (GstDeinterleaveFunc) deinterleave_##type; \
+} G_STMT_END
+
 static gboolean
 gst_deinterleave_set_process_function (GstDeinterleave * self, GstCaps * caps)
 {
@@ -360,19 +459,19 @@ gst_deinterleave_set_process_function (GstDeinterleave * self, GstCaps * caps)
 
   switch (self->width) {
     case 8:
-      self->func = (GstDeinterleaveFunc) deinterleave_8;
+      SET_FUNC (8);
       break;
     case 16:
-      self->func = (GstDeinterleaveFunc) deinterleave_16;
+      SET_FUNC (16);
       break;
     case 24:
       self->func = (GstDeinterleaveFunc) deinterleave_24;
       break;
     case 32:
-      self->func = (GstDeinterleaveFunc) deinterleave_32;
+      SET_FUNC (32);
       break;
     case 64:
-      self->func = (GstDeinterleaveFunc) deinterleave_64;
+      SET_FUNC (64);
       break;
     default:
       return FALSE;
@@ -380,6 +479,8 @@ gst_deinterleave_set_process_function (GstDeinterleave * self, GstCaps * caps)
   return TRUE;
 }
 
+#undef SET_FUNC
+
 static gboolean
 gst_deinterleave_sink_setcaps (GstPad * pad, GstCaps * caps)
 {
@@ -674,6 +775,9 @@ gst_deinterleave_set_property (GObject * object, guint prop_id,
     case PROP_KEEP_POSITIONS:
       self->keep_positions = g_value_get_boolean (value);
       break;
+    case PROP_BATCH_ALLOCATION:
+      self->batch_allocation = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -690,6 +794,9 @@ gst_deinterleave_get_property (GObject * object, guint prop_id,
     case PROP_KEEP_POSITIONS:
       g_value_set_boolean (value, self->keep_positions);
       break;
+    case PROP_BATCH_ALLOCATION:
+      g_value_set_boolean (value, self->batch_allocation);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -715,7 +822,11 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
 
   GstBuffer **buffers_out = g_new0 (GstBuffer *, channels);
 
-  guint8 *in, *out;
+  gpointer *out = g_new0 (gpointer, channels);
+
+  GstBuffer *block = NULL;
+
+  guint8 *scratch = NULL;
 
   /* Send any pending events to all src pads */
   GST_OBJECT_LOCK (self);
@@ -739,31 +850,57 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
   }
   GST_OBJECT_UNLOCK (self);
 
-  /* Allocate buffers */
-  for (srcs = self->srcpads, i = 0; srcs; srcs = srcs->next, i++) {
-    GstPad *pad = (GstPad *) srcs->data;
+  /* Allocate one block for all channels and give every linked pad
+   * a part of it */
+  if (self->batch_allocation) {
+    block = gst_buffer_new_and_alloc (bufsize * channels);
 
-    buffers_out[i] = NULL;
-    ret =
-        gst_pad_alloc_buffer (pad, GST_BUFFER_OFFSET_NONE, bufsize,
-        GST_PAD_CAPS (pad), &buffers_out[i]);
-
-    /* Make sure we got a correct buffer. The only other case we allow
-     * here is an unliked pad */
-    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
-      goto alloc_buffer_failed;
-    else if (buffers_out[i] && GST_BUFFER_SIZE (buffers_out[i]) != bufsize)
-      goto alloc_buffer_bad_size;
-    else if (buffers_out[i] &&
-        !gst_caps_is_equal (GST_BUFFER_CAPS (buffers_out[i]),
-            GST_PAD_CAPS (pad)))
-      goto invalid_caps;
+    for (srcs = self->srcpads, i = 0; srcs; srcs = srcs->next, i++) {
+      GstPad *pad = (GstPad *) srcs->data;
 
-    if (buffers_out[i]) {
+      out[i] = GST_BUFFER_DATA (block) + i * bufsize;
+      if (!gst_pad_is_linked (pad))
+        continue;
+
+      buffers_out[i] = gst_buffer_create_sub (block, i * bufsize, bufsize);
+      gst_buffer_set_caps (buffers_out[i], GST_PAD_CAPS (pad));
       gst_buffer_copy_metadata (buffers_out[i], buf,
           GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_FLAGS);
       buffers_allocated++;
     }
+  } else {
+    /* Allocate buffers */
+    for (srcs = self->srcpads, i = 0; srcs; srcs = srcs->next, i++) {
+      GstPad *pad = (GstPad *) srcs->data;
+
+      buffers_out[i] = NULL;
+      ret =
+          gst_pad_alloc_buffer (pad, GST_BUFFER_OFFSET_NONE, bufsize,
+          GST_PAD_CAPS (pad), &buffers_out[i]);
+
+      /* Make sure we got a correct buffer. The only other case we allow
+       * here is an unliked pad */
+      if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
+        goto alloc_buffer_failed;
+      else if (buffers_out[i] && GST_BUFFER_SIZE (buffers_out[i]) != bufsize)
+        goto alloc_buffer_bad_size;
+      else if (buffers_out[i] &&
+          !gst_caps_is_equal (GST_BUFFER_CAPS (buffers_out[i]),
+              GST_PAD_CAPS (pad)))
+        goto invalid_caps;
+
+      if (buffers_out[i]) {
+        gst_buffer_copy_metadata (buffers_out[i], buf,
+            GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_FLAGS);
+        out[i] = GST_BUFFER_DATA (buffers_out[i]);
+        buffers_allocated++;
+      } else {
+        /* Unlinked pads still need somewhere to write to */
+        if (!scratch)
+          scratch = g_malloc (bufsize);
+        out[i] = scratch;
+      }
+    }
   }
 
   /* Return NOT_LINKED if no pad was linked */
@@ -774,17 +911,13 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
     goto done;
   }
 
-  /* deinterleave */
+  /* deinterleave all channels at once */
+  self->func (out, GST_BUFFER_DATA (buf), channels, nframes);
+
   for (srcs = self->srcpads, i = 0; srcs; srcs = srcs->next, i++) {
     GstPad *pad = (GstPad *) srcs->data;
 
-    in = (guint8 *) GST_BUFFER_DATA (buf);
-    in += i * (self->width / 8);
     if (buffers_out[i]) {
-      out = (guint8 *) GST_BUFFER_DATA (buffers_out[i]);
-
-      self->func (out, in, channels, nframes);
-
       ret = gst_pad_push (pad, buffers_out[i]);
       buffers_out[i] = NULL;
       if (ret == GST_FLOW_OK)
@@ -802,7 +935,11 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
 
 done:
   gst_buffer_unref (buf);
+  if (block)
+    gst_buffer_unref (block);
+  g_free (scratch);
   g_free (buffers_out);
+  g_free (out);
   return ret;
 
 alloc_buffer_failed:
@@ -835,7 +972,11 @@ clean_buffers:
         gst_buffer_unref (buffers_out[i]);
     }
     gst_buffer_unref (buf);
+    if (block)
+      gst_buffer_unref (block);
+    g_free (scratch);
     g_free (buffers_out);
+    g_free (out);
     return ret;
   }
 }
@@ -42,7 +42,7 @@ G_BEGIN_DECLS
 typedef struct _GstDeinterleave GstDeinterleave;
 typedef struct _GstDeinterleaveClass GstDeinterleaveClass;
 
-typedef void (*GstDeinterleaveFunc) (gpointer out, gpointer in, guint stride, guint nframes);
+typedef void (*GstDeinterleaveFunc) (gpointer *out, gpointer in, guint channels, guint nframes);
 
 struct _GstDeinterleave
 {
@@ -54,6 +54,7 @@ struct _GstDeinterleave
   gint channels;
   GstAudioChannelPosition *pos;
   gboolean keep_positions;
+  gboolean batch_allocation;
 
   GstPad *sink;
 
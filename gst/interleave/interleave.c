@@ -104,15 +104,72 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
         "width = (int) { 32, 64 }")
     );
 
+/* The output is interleaved in blocks of BLOCK_FRAMES frames. All
+ * channels are written to one block while it is still in the cache,
+ * instead of going over the complete output buffer once per channel.
+ * Channels without input are NULL and stay untouched */
+#define BLOCK_FRAMES 64
+
 #define MAKE_FUNC(type) \
-static void interleave_##type (guint##type *out, guint##type *in, \
-    guint stride, guint nframes) \
+static void interleave_##type (guint##type *out, guint##type **in, \
+    guint channels, guint nframes) \
 { \
-  gint i; \
+  guint i, j, block, n; \
   \
-  for (i = 0; i < nframes; i++) { \
-    *out = in[i]; \
-    out += stride; \
+  for (block = 0; block < nframes; block += BLOCK_FRAMES) { \
+    n = MIN (BLOCK_FRAMES, nframes - block); \
+    \
+    for (j = 0; j < channels; j++) { \
+      guint##type *o = out + block * channels + j; \
+      guint##type *p; \
+      \
+      if (!in[j]) \
+        continue; \
+      \
+      p = in[j] + block; \
+      for (i = 0; i < n; i++) { \
+        *o = p[i]; \
+        o += channels; \
+      } \
+    } \
+  } \
+}
+
+/* With a constant number of channels four frames are handled per
+ * iteration, the four consecutive samples of every input channel can
+ * then be loaded with one SIMD instruction */
+#define MAKE_FUNC_FIXED_CHANNELS(type,channels) \
+static void interleave_##channels##_##type (guint##type *out, \
+    guint##type **in, guint stride, guint nframes) \
+{ \
+  guint i, j; \
+  \
+  for (i = 0; i + 4 <= nframes; i += 4) { \
+    for (j = 0; j < channels; j++) { \
+      guint##type *p = in[j]; \
+      guint##type s0, s1, s2, s3; \
+      \
+      if (!p) \
+        continue; \
+      \
+      p += i; \
+      s0 = p[0]; \
+      s1 = p[1]; \
+      s2 = p[2]; \
+      s3 = p[3]; \
+      out[j] = s0; \
+      out[channels + j] = s1; \
+      out[2 * channels + j] = s2; \
+      out[3 * channels + j] = s3; \
+    } \
+    out += 4 * channels; \
+  } \
+  for (; i < nframes; i++) { \
+    for (j = 0; j < channels; j++) { \
+      if (in[j]) \
+        out[j] = in[j][i]; \
+    } \
+    out += channels; \
   } \
 }
 
@@ -121,15 +178,45 @@ MAKE_FUNC (16);
 MAKE_FUNC (32);
 MAKE_FUNC (64);
 
+MAKE_FUNC_FIXED_CHANNELS (8, 2);
+MAKE_FUNC_FIXED_CHANNELS (16, 2);
+MAKE_FUNC_FIXED_CHANNELS (32, 2);
+MAKE_FUNC_FIXED_CHANNELS (64, 2);
+
+MAKE_FUNC_FIXED_CHANNELS (8, 4);
+MAKE_FUNC_FIXED_CHANNELS (16, 4);
+MAKE_FUNC_FIXED_CHANNELS (32, 4);
+MAKE_FUNC_FIXED_CHANNELS (64, 4);
+
+MAKE_FUNC_FIXED_CHANNELS (8, 8);
+MAKE_FUNC_FIXED_CHANNELS (16, 8);
+MAKE_FUNC_FIXED_CHANNELS (32, 8);
+MAKE_FUNC_FIXED_CHANNELS (64, 8);
+
 static void
-interleave_24 (guint8 * out, guint8 * in, guint stride, guint nframes)
+interleave_24 (guint8 * out, guint8 ** in, guint channels, guint nframes)
 {
-  gint i;
+  guint i, j, block, n;
+
+  for (block = 0; block < nframes; block += BLOCK_FRAMES) {
+    n = MIN (BLOCK_FRAMES, nframes - block);
+
+    for (j = 0; j < channels; j++) {
+      guint8 *o = out + (block * channels + j) * 3;
+      guint8 *p;
 
-  for (i = 0; i < nframes; i++) {
-    memcpy (out, in, 3);
-    out += stride * 3;
-    in += 3;
+      if (!in[j])
+        continue;
+
+      p = in[j] + block * 3;
+      for (i = 0; i < n; i++) {
+        o[0] = p[0];
+        o[1] = p[1];
+        o[2] = p[2];
+        o += channels * 3;
+        p += 3;
+      }
+    }
   }
 }
 
@@ -729,24 +816,35 @@ gst_interleave_sink_getcaps (GstPad * pad)
   return result;
 }
 
+#define SET_FUNC(type) G_STMT_START { \
+  if (self->channels == 2) \
+    self->func = (GstInterleaveFunc) interleave_2_##type; \
+  else if (self->channels == 4) \
+    self->func = (GstInterleaveFunc) interleave_4_##type; \
+  else if (self->channels == 8) \
+    self->func = (GstInterleaveFunc) interleave_8_##type; \
+  else \
+    self->func = (GstInterleaveFunc) interleave_##type; \
+} G_STMT_END
+
 static void
 gst_interleave_set_process_function (GstInterleave * self)
 {
   switch (self->width) {
     case 8:
-      self->func = (GstInterleaveFunc) interleave_8;
+      SET_FUNC (8);
       break;
     case 16:
-      self->func = (GstInterleaveFunc) interleave_16;
+      SET_FUNC (16);
       break;
     case 24:
       self->func = (GstInterleaveFunc) interleave_24;
       break;
     case 32:
-      self->func = (GstInterleaveFunc) interleave_32;
+      SET_FUNC (32);
       break;
     case 64:
-      self->func = (GstInterleaveFunc) interleave_64;
+      SET_FUNC (64);
       break;
     default:
       g_assert_not_reached ();
@@ -754,6 +852,8 @@ gst_interleave_set_process_function (GstInterleave * self)
   }
 }
 
+#undef SET_FUNC
+
 static gboolean
 gst_interleave_sink_setcaps (GstPad * pad, GstCaps * caps)
 {
@@ -1199,15 +1299,22 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
   GstFlowReturn ret = GST_FLOW_OK;
   GSList *collected;
   guint nsamples;
-  guint ncollected = 0;
+  guint ncollected = 0, nfilled = 0;
   gboolean empty = TRUE;
   gint width = self->width / 8;
+  guint channels, i;
+  GstBuffer **inbufs;
+  gpointer *in;
 
   g_return_val_if_fail (self->func != NULL, GST_FLOW_NOT_NEGOTIATED);
   g_return_val_if_fail (self->width > 0, GST_FLOW_NOT_NEGOTIATED);
   g_return_val_if_fail (self->channels > 0, GST_FLOW_NOT_NEGOTIATED);
   g_return_val_if_fail (self->rate > 0, GST_FLOW_NOT_NEGOTIATED);
 
+  /* Pads can be added and removed at any time, so the function for
+   * the current number of channels is selected here */
+  gst_interleave_set_process_function (self);
+
   size = gst_collect_pads_available (pads);
 
   g_return_val_if_fail (size % width == 0, GST_FLOW_ERROR);
@@ -1232,12 +1339,14 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
     return GST_FLOW_NOT_NEGOTIATED;
   }
 
-  memset (GST_BUFFER_DATA (outbuf), 0, size * self->channels);
+  channels = self->channels;
+  inbufs = g_new0 (GstBuffer *, channels);
+  in = g_new0 (gpointer, channels);
 
   for (collected = pads->data; collected != NULL; collected = collected->next) {
     GstCollectData *cdata;
     GstBuffer *inbuf;
-    guint8 *outdata;
+    guint channel;
 
     cdata = (GstCollectData *) collected->data;
 
@@ -1251,18 +1360,35 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
     if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP))
       goto next;
 
-    empty = FALSE;
-    outdata =
-        GST_BUFFER_DATA (outbuf) +
-        width * GST_INTERLEAVE_PAD_CAST (cdata->pad)->channel;
+    channel = GST_INTERLEAVE_PAD_CAST (cdata->pad)->channel;
+    if (channel >= channels || inbufs[channel])
+      goto next;
 
-    self->func (outdata, GST_BUFFER_DATA (inbuf), self->channels, nsamples);
+    empty = FALSE;
+    inbufs[channel] = inbuf;
+    in[channel] = GST_BUFFER_DATA (inbuf);
+    inbuf = NULL;
+    nfilled++;
 
   next:
     if (inbuf)
       gst_buffer_unref (inbuf);
   }
 
+  /* Channels without data are silence, all others are interleaved
+   * at once */
+  if (nfilled < channels)
+    memset (GST_BUFFER_DATA (outbuf), 0, size * channels);
+  if (nfilled > 0)
+    self->func (GST_BUFFER_DATA (outbuf), in, channels, nsamples);
+
+  for (i = 0; i < channels; i++) {
+    if (inbufs[i])
+      gst_buffer_unref (inbufs[i]);
+  }
+  g_free (inbufs);
+  g_free (in);
+
   if (ncollected == 0)
     goto eos;
 
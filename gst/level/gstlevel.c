@@ -93,6 +93,28 @@
  * </listitem>
  * </itemizedlist>
  *
+ * If the #GstLevel:compact-message property is #TRUE, the lists are replaced
+ * by these fields, which are much cheaper to create for many channels:
+ * <itemizedlist>
+ * <listitem>
+ *   <para>
+ *   #gint
+ *   <classname>&quot;channels&quot;</classname>:
+ *   the number of channels.
+ *   </para>
+ * </listitem>
+ * <listitem>
+ *   <para>
+ *   #GstBuffer
+ *   <classname>&quot;values&quot;</classname>:
+ *   the rms, peak and decay levels in dB as #gdouble, first the rms levels
+ *   of all channels, then the peak levels and then the decay levels. The
+ *   buffer is reused for later messages once the message is freed, so take a
+ *   reference to keep it.
+ *   </para>
+ * </listitem>
+ * </itemizedlist>
+ *
  * <refsect2>
  * <title>Example application</title>
  * |[
@@ -156,7 +178,8 @@ enum
   PROP_SIGNAL_LEVEL,
   PROP_SIGNAL_INTERVAL,
   PROP_PEAK_TTL,
-  PROP_PEAK_FALLOFF
+  PROP_PEAK_FALLOFF,
+  PROP_COMPACT_MESSAGE
 };
 
 GST_BOILERPLATE (GstLevel, gst_level, GstBaseTransform,
@@ -218,6 +241,19 @@ gst_level_class_init (GstLevelClass * klass)
       g_param_spec_double ("peak-falloff", "Peak Falloff",
           "Decay rate of decay peak after TTL (in dB/sec)",
           0.0, G_MAXDOUBLE, 10.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstLevel:compact-message
+   *
+   * Put the levels of all channels into one #GstBuffer of doubles in the
+   * messages, instead of three lists with a #GValue for every channel. This
+   * is a lot cheaper with many channels or short intervals.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_COMPACT_MESSAGE,
+      g_param_spec_boolean ("compact-message", "Compact message",
+          "Post the levels in one buffer instead of lists of values",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   GST_DEBUG_CATEGORY_INIT (level_debug, "level", 0, "Level calculation");
 
@@ -259,6 +295,10 @@ gst_level_finalize (GObject * obj)
   g_free (filter->decay_peak);
   g_free (filter->decay_peak_base);
   g_free (filter->decay_peak_age);
+  g_free (filter->lane_CS);
+  g_free (filter->lane_peak);
+  if (filter->values)
+    gst_buffer_unref (filter->values);
 
   filter->CS = NULL;
   filter->peak = NULL;
@@ -266,6 +306,9 @@ gst_level_finalize (GObject * obj)
   filter->decay_peak = NULL;
   filter->decay_peak_base = NULL;
   filter->decay_peak_age = NULL;
+  filter->lane_CS = NULL;
+  filter->lane_peak = NULL;
+  filter->values = NULL;
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -294,6 +337,9 @@ gst_level_set_property (GObject * object, guint prop_id,
     case PROP_PEAK_FALLOFF:
       filter->decay_peak_falloff = g_value_get_double (value);
       break;
+    case PROP_COMPACT_MESSAGE:
+      filter->compact_message = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -319,6 +365,9 @@ gst_level_get_property (GObject * object, guint prop_id,
     case PROP_PEAK_FALLOFF:
       g_value_set_double (value, filter->decay_peak_falloff);
       break;
+    case PROP_COMPACT_MESSAGE:
+      g_value_set_boolean (value, filter->compact_message);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -326,93 +375,72 @@ gst_level_get_property (GObject * object, guint prop_id,
 }
 
 
-/* process one (interleaved) channel of incoming samples
- * calculate square sum of samples
- * normalize and average over number of samples
- * returns a normalized cumulative square value, which can be averaged
- * to return the average power as a double between 0 and 1
- * also returns the normalized peak power (square of the highest amplitude)
+/* process a buffer of interleaved samples
+ * calculate the square sum and the peak square of the samples in lanes:
+ * sample j goes to lane j % lanes, and lanes is a multiple of the number of
+ * channels, so every lane holds samples of one channel only. The lanes are
+ * independent of each other, so the additions do not wait for each other
+ * like they do when a single sum is kept per channel, and the buffer is only
+ * walked once for all channels. When there are just LEVEL_LANES lanes (mono,
+ * stereo and 4 channels) they are kept in registers.
+ *
+ * the caller sums up the lanes of each channel and normalizes the values,
+ * so they can be averaged to return the average power as a double between
+ * 0 and 1
  *
  * caller must assure num is a multiple of channels
- * samples for multiple channels are interleaved
- * input sample data enters in *in_data as 8 or 16 bit data
  * this filter only accepts signed audio data, so mid level is always 0
  *
- * for 16 bit, this code considers the non-existant 32768 value to be
+ * for 16 bit, the caller considers the non-existant 32768 value to be
  * full-scale; so 32767 will not map to 1.0
  */
 
-#define DEFINE_INT_LEVEL_CALCULATOR(TYPE, RESOLUTION)                         \
-static void inline                                                            \
-gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
-                            gdouble *NCS, gdouble *NPS)                       \
-{                                                                             \
-  TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the integer samples */  \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
-  gdouble normalizer;               /* divisor to get a [-1.0, 1.0] range */  \
-                                                                              \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peask Square */                                   \
-                                                                              \
-  normalizer = (gdouble) (G_GINT64_CONSTANT(1) << (RESOLUTION * 2));          \
-                                                                              \
-  /* oil_squaresum_shifted_s16(&squaresum,in,num); */                         \
-  for (j = 0; j < num; j += channels)                                         \
-  {                                                                           \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
-  }                                                                           \
-                                                                              \
-  *NCS = squaresum / normalizer;                                              \
-  *NPS = peaksquare / normalizer;                                             \
-}
+/* minimum number of lanes to accumulate in */
+#define LEVEL_LANES 4
 
-DEFINE_INT_LEVEL_CALCULATOR (gint32, 31);
-DEFINE_INT_LEVEL_CALCULATOR (gint16, 15);
-DEFINE_INT_LEVEL_CALCULATOR (gint8, 7);
+#define LEVEL_ACCUMULATE(cs, ps, sample) G_STMT_START {                       \
+  gdouble _square = ((gdouble) (sample)) * (sample);                          \
+  cs += _square;                                                              \
+  ps = MAX (ps, _square);                                                     \
+} G_STMT_END
 
-#define DEFINE_FLOAT_LEVEL_CALCULATOR(TYPE)                                   \
-static void inline                                                            \
-gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
-                            gdouble *NCS, gdouble *NPS)                       \
+#define DEFINE_LEVEL_CALCULATOR(TYPE)                                         \
+static void                                                                   \
+gst_level_calculate_##TYPE (gpointer data, guint num, guint lanes,            \
+                            gdouble *CS, gdouble *PS)                         \
 {                                                                             \
-  TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the integer samples */  \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
+  const TYPE * in = (const TYPE *) data;                                      \
+  guint i = 0, j;                                                             \
                                                                               \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peask Square */                                   \
+  for (j = 0; j < lanes; j++)                                                 \
+    CS[j] = PS[j] = 0.0;                                                      \
                                                                               \
-  /* oil_squaresum_f64(&squaresum,in,num); */                                 \
-  for (j = 0; j < num; j += channels)                                         \
-  {                                                                           \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
-  }                                                                           \
+  if (lanes == LEVEL_LANES) {                                                 \
+    gdouble cs0 = 0.0, cs1 = 0.0, cs2 = 0.0, cs3 = 0.0;                       \
+    gdouble ps0 = 0.0, ps1 = 0.0, ps2 = 0.0, ps3 = 0.0;                       \
                                                                               \
-  *NCS = squaresum;                                                           \
-  *NPS = peaksquare;                                                          \
+    for (; i + LEVEL_LANES <= num; i += LEVEL_LANES) {                        \
+      LEVEL_ACCUMULATE (cs0, ps0, in[i]);                                     \
+      LEVEL_ACCUMULATE (cs1, ps1, in[i + 1]);                                 \
+      LEVEL_ACCUMULATE (cs2, ps2, in[i + 2]);                                 \
+      LEVEL_ACCUMULATE (cs3, ps3, in[i + 3]);                                 \
+    }                                                                         \
+    CS[0] = cs0; CS[1] = cs1; CS[2] = cs2; CS[3] = cs3;                       \
+    PS[0] = ps0; PS[1] = ps1; PS[2] = ps2; PS[3] = ps3;                       \
+  } else {                                                                    \
+    for (; i + lanes <= num; i += lanes)                                      \
+      for (j = 0; j < lanes; j++)                                             \
+        LEVEL_ACCUMULATE (CS[j], PS[j], in[i + j]);                           \
+  }                                                                           \
+  for (j = 0; i < num; i++, j++)                                              \
+    LEVEL_ACCUMULATE (CS[j], PS[j], in[i]);                                   \
 }
 
-DEFINE_FLOAT_LEVEL_CALCULATOR (gfloat);
-DEFINE_FLOAT_LEVEL_CALCULATOR (gdouble);
-
-/* we would need stride to deinterleave also
-static void inline
-gst_level_calculate_gdouble (gpointer data, guint num, guint channels,
-                            gdouble *NCS, gdouble *NPS)
-{
-  oil_squaresum_f64(NCS,(gdouble *)data,num);
-  *NPS = 0.0;
-}
-*/
+DEFINE_LEVEL_CALCULATOR (gint32);
+DEFINE_LEVEL_CALCULATOR (gint16);
+DEFINE_LEVEL_CALCULATOR (gint8);
+DEFINE_LEVEL_CALCULATOR (gfloat);
+DEFINE_LEVEL_CALCULATOR (gdouble);
 
 
 static gint
@@ -442,8 +470,12 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
 
   /* FIXME: set calculator func depending on caps */
   filter->process = NULL;
+  filter->normalizer = 1.0;
   if (strcmp (mimetype, "audio/x-raw-int") == 0) {
     GST_DEBUG_OBJECT (filter, "use int: %u", filter->width);
+    /* divisor to get a [-1.0, 1.0] range */
+    filter->normalizer = 1.0 / (gdouble) (G_GINT64_CONSTANT (1) <<
+        ((filter->width - 1) * 2));
     switch (filter->width) {
       case 8:
         filter->process = gst_level_calculate_gint8;
@@ -474,6 +506,8 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
   g_free (filter->decay_peak);
   g_free (filter->decay_peak_base);
   g_free (filter->decay_peak_age);
+  g_free (filter->lane_CS);
+  g_free (filter->lane_peak);
   filter->CS = g_new (gdouble, filter->channels);
   filter->peak = g_new (gdouble, filter->channels);
   filter->last_peak = g_new (gdouble, filter->channels);
@@ -482,6 +516,16 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
 
   filter->decay_peak_age = g_new (GstClockTime, filter->channels);
 
+  filter->lanes = filter->channels *
+      ((LEVEL_LANES + filter->channels - 1) / filter->channels);
+  filter->lane_CS = g_new (gdouble, filter->lanes);
+  filter->lane_peak = g_new (gdouble, filter->lanes);
+
+  if (filter->values) {
+    gst_buffer_unref (filter->values);
+    filter->values = NULL;
+  }
+
   for (i = 0; i < filter->channels; ++i) {
     filter->CS[i] = filter->peak[i] = filter->last_peak[i] =
         filter->decay_peak[i] = filter->decay_peak_base[i] = 0.0;
@@ -506,7 +550,7 @@ gst_level_start (GstBaseTransform * trans)
 
 static GstMessage *
 gst_level_message_new (GstLevel * level, GstClockTime timestamp,
-    GstClockTime duration)
+    GstClockTime duration, GstBuffer * values)
 {
   GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (level);
   GstStructure *s;
@@ -528,16 +572,37 @@ gst_level_message_new (GstLevel * level, GstClockTime timestamp,
       "stream-time", G_TYPE_UINT64, stream_time,
       "running-time", G_TYPE_UINT64, running_time,
       "duration", G_TYPE_UINT64, duration, NULL);
-  /* will copy-by-value */
-  gst_structure_set_value (s, "rms", &v);
-  gst_structure_set_value (s, "peak", &v);
-  gst_structure_set_value (s, "decay", &v);
+  if (values) {
+    gst_structure_set (s, "channels", G_TYPE_INT, level->channels,
+        "values", GST_TYPE_BUFFER, values, NULL);
+  } else {
+    /* will copy-by-value */
+    gst_structure_set_value (s, "rms", &v);
+    gst_structure_set_value (s, "peak", &v);
+    gst_structure_set_value (s, "decay", &v);
+  }
 
   g_value_unset (&v);
 
   return gst_message_new_element (GST_OBJECT (level), s);
 }
 
+/* the buffer of a compact message can be reused once the application has
+ * dropped the message */
+static GstBuffer *
+gst_level_get_values (GstLevel * level)
+{
+  if (level->values && !gst_buffer_is_writable (level->values)) {
+    gst_buffer_unref (level->values);
+    level->values = NULL;
+  }
+  if (level->values == NULL)
+    level->values = gst_buffer_new_and_alloc (3 * level->channels *
+        sizeof (gdouble));
+
+  return level->values;
+}
+
 static void
 gst_level_message_append_channel (GstMessage * m, gdouble rms, gdouble peak,
     gdouble decay)
@@ -570,8 +635,7 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
 {
   GstLevel *filter;
   guint8 *in_data;
-  gdouble CS;
-  guint i;
+  guint i, j;
   guint num_frames = 0;
   guint num_int_samples = 0;    /* number of interleaved samples
                                  * ie. total count for all channels combined */
@@ -590,18 +654,27 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
 
   num_frames = num_int_samples / filter->channels;
 
-  for (i = 0; i < filter->channels; ++i) {
-    if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP)) {
-      filter->process (in_data, num_int_samples, filter->channels, &CS,
-          &filter->peak[i]);
-      GST_LOG_OBJECT (filter,
-          "channel %d, cumulative sum %f, peak %f, over %d samples/%d channels",
-          i, CS, filter->peak[i], num_int_samples, filter->channels);
-      filter->CS[i] += CS;
-    } else {
-      filter->peak[i] = 0.0;
+  for (i = 0; i < filter->channels; ++i)
+    filter->peak[i] = 0.0;
+
+  if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP)) {
+    filter->process (in_data, num_int_samples, filter->lanes,
+        filter->lane_CS, filter->lane_peak);
+
+    /* sum up the lanes of every channel */
+    for (i = 0; i < filter->lanes; i += filter->channels) {
+      for (j = 0; j < filter->channels; ++j) {
+        filter->CS[j] += filter->lane_CS[i + j] * filter->normalizer;
+        filter->peak[j] = MAX (filter->peak[j],
+            filter->lane_peak[i + j] * filter->normalizer);
+      }
     }
-    in_data += (filter->width / 8);
+  }
+
+  for (i = 0; i < filter->channels; ++i) {
+    GST_LOG_OBJECT (filter,
+        "channel %d, cumulative sum %f, peak %f, over %d samples/%d channels",
+        i, filter->CS[i], filter->peak[i], num_int_samples, filter->channels);
 
     filter->decay_peak_age[i] +=
         GST_FRAMES_TO_CLOCK_TIME (num_frames, filter->rate);
@@ -659,10 +732,17 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
   if (filter->num_frames >= filter->interval_frames) {
     if (filter->message) {
       GstMessage *m;
+      GstBuffer *values = NULL;
+      gdouble *v = NULL;
       GstClockTime duration =
           GST_FRAMES_TO_CLOCK_TIME (filter->num_frames, filter->rate);
 
-      m = gst_level_message_new (filter, filter->message_ts, duration);
+      if (filter->compact_message) {
+        values = gst_level_get_values (filter);
+        v = (gdouble *) GST_BUFFER_DATA (values);
+      }
+      m = gst_level_message_new (filter, filter->message_ts, duration,
+          values);
 
       GST_LOG_OBJECT (filter,
           "message: ts %" GST_TIME_FORMAT ", num_frames %d",
@@ -697,7 +777,13 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
             "message: RMS %f dB, peak %f dB, decay %f dB",
             RMSdB, lastdB, decaydB);
 
-        gst_level_message_append_channel (m, RMSdB, lastdB, decaydB);
+        if (v) {
+          v[i] = RMSdB;
+          v[filter->channels + i] = lastdB;
+          v[2 * filter->channels + i] = decaydB;
+        } else {
+          gst_level_message_append_channel (m, RMSdB, lastdB, decaydB);
+        }
 
         /* reset cumulative and normal peak */
         filter->CS[i] = 0.0;
@@ -79,7 +79,16 @@ struct _GstLevel {
   gdouble *MS;                  /* normalized Mean Square of buffer */
   gdouble *RMS_dB;              /* RMS in dB to emit */
   GstClockTime *decay_peak_age; /* age of last peak */
-  
+
+  /* the samples are accumulated in lanes, a multiple of the channels */
+  guint lanes;
+  gdouble *lane_CS;             /* Cumulative Square of each lane */
+  gdouble *lane_peak;           /* Peak Square of each lane */
+  gdouble normalizer;           /* scales the squares to [0.0, 1.0] */
+
+  gboolean compact_message;     /* values in a buffer instead of lists */
+  GstBuffer *values;            /* reused for compact messages */
+
   void (*process)(gpointer, guint, guint, gdouble*, gdouble*);
 };
 
@@ -94,8 +94,32 @@
  *   the offset-end of the buffer that triggered the message.
  *   </para>
  * </listitem>
+ * <listitem>
+ *   <para>
+ *   #GstClockTime
+ *   <classname>&quot;write-latency&quot;</classname>:
+ *   the time between the file operation being queued and it being done,
+ *   only larger than the write time itself with #GstMultiFileSink:write-behind
+ *   (Since: 0.10.32).
+ *   </para>
+ * </listitem>
  * </itemizedlist>
  *
+ * If the #GstMultiFileSink:index-location property is set, an index of the
+ * written files is kept in that file. A line is appended whenever a file is
+ * finished. The whole index is only replaced, atomically, at EOS, when
+ * stopping and after #GstMultiFileSink:max-files removed old files. Every
+ * line but the first, which is a comment, describes one file:
+ * |[
+ * start stop size first-keyframe filename
+ * ]|
+ * start and stop are the timestamps of the first buffer and the end of the
+ * last buffer in nanoseconds, size is the size of the file in bytes and
+ * first-keyframe the timestamp of the first buffer without the
+ * #GST_BUFFER_FLAG_DELTA_UNIT flag. Unknown timestamps are written as
+ * <quote>-</quote>. The filename is relative to the directory of the index.
+ * #GstSplitFileSrc:index-location reads the index to seek in time.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -113,8 +137,17 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
 #include <glib/gstdio.h>
+#include <string.h>
 #include "gstmultifilesink.h"
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>             /* for fsync */
+#endif
+#ifdef G_OS_WIN32
+#include <io.h>                 /* for _commit */
+#define fsync _commit
+#endif
+
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -129,6 +162,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_multi_file_sink_debug);
 #define DEFAULT_NEXT_FILE GST_MULTI_FILE_SINK_NEXT_BUFFER
 #define DEFAULT_MAX_FILES 0
 #define DEFAULT_MAX_FILE_SIZE G_GUINT64_CONSTANT(2*1024*1024*1024)
+#define DEFAULT_FSYNC GST_MULTI_FILE_SINK_FSYNC_NONE
+#define DEFAULT_WRITE_BEHIND FALSE
+#define DEFAULT_MAX_QUEUED_BYTES (16 * 1024 * 1024)
+#define DEFAULT_INDEX_LOCATION NULL
 
 enum
 {
@@ -139,9 +176,48 @@ enum
   PROP_NEXT_FILE,
   PROP_MAX_FILES,
   PROP_MAX_FILE_SIZE,
+  PROP_FSYNC,
+  PROP_WRITE_BEHIND,
+  PROP_MAX_QUEUED_BYTES,
+  PROP_QUEUED_BYTES,
+  PROP_WRITE_LATENCY,
+  PROP_INDEX_LOCATION,
   PROP_LAST
 };
 
+typedef enum
+{
+  OP_OPEN,
+  OP_WRITE,
+  OP_CLOSE,
+  OP_WRITE_FILE,
+  OP_REPLACE_FILE,
+  OP_APPEND_FILE,
+  OP_REMOVE
+} GstMultiFileSinkOpType;
+
+/* A file operation, done right away or by the write-behind thread. The
+ * operations are done in the order they were submitted. */
+typedef struct
+{
+  GstMultiFileSinkOpType type;
+  gchar *filename;
+  GstBuffer *buffer;
+  /* posted when the operation is done */
+  GstStructure *message;
+  GstClockTime queued;
+} GstMultiFileSinkOp;
+
+/* a line of the segment index */
+typedef struct
+{
+  gchar *filename;
+  GstClockTime start;
+  GstClockTime stop;
+  GstClockTime keyframe;
+  guint64 size;
+} GstMultiFileSinkIndexEntry;
+
 static void gst_multi_file_sink_finalize (GObject * object);
 
 static void gst_multi_file_sink_set_property (GObject * object, guint prop_id,
@@ -149,21 +225,27 @@ static void gst_multi_file_sink_set_property (GObject * object, guint prop_id,
 static void gst_multi_file_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
+static gboolean gst_multi_file_sink_start (GstBaseSink * sink);
 static gboolean gst_multi_file_sink_stop (GstBaseSink * sink);
+static gboolean gst_multi_file_sink_unlock (GstBaseSink * sink);
+static gboolean gst_multi_file_sink_unlock_stop (GstBaseSink * sink);
 static GstFlowReturn gst_multi_file_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
 static GstFlowReturn gst_multi_file_sink_render_list (GstBaseSink * sink,
     GstBufferList * buffer_list);
 static gboolean gst_multi_file_sink_set_caps (GstBaseSink * sink,
     GstCaps * caps);
-static gboolean gst_multi_file_sink_open_next_file (GstMultiFileSink *
+static GstFlowReturn gst_multi_file_sink_open_next_file (GstMultiFileSink *
     multifilesink);
 static void gst_multi_file_sink_close_file (GstMultiFileSink * multifilesink,
-    GstBuffer * buffer);
+    GstStructure * message);
 static void gst_multi_file_sink_ensure_max_files (GstMultiFileSink *
     multifilesink);
 static gboolean gst_multi_file_sink_event (GstBaseSink * sink,
     GstEvent * event);
+static void gst_multi_file_sink_index_entry_free (GstMultiFileSinkIndexEntry *
+    entry);
+static void gst_multi_file_sink_reset_segment (GstMultiFileSink * sink);
 
 #define GST_TYPE_MULTI_FILE_SINK_NEXT (gst_multi_file_sink_next_get_type ())
 static GType
@@ -192,6 +274,28 @@ gst_multi_file_sink_next_get_type (void)
   return multi_file_sync_next_type;
 }
 
+#define GST_TYPE_MULTI_FILE_SINK_FSYNC (gst_multi_file_sink_fsync_get_type ())
+static GType
+gst_multi_file_sink_fsync_get_type (void)
+{
+  static GType multi_file_sink_fsync_type = 0;
+  static const GEnumValue fsync_types[] = {
+    {GST_MULTI_FILE_SINK_FSYNC_NONE, "Leave it to the system", "none"},
+    {GST_MULTI_FILE_SINK_FSYNC_FILE, "Flush every file when it is closed",
+        "file"},
+    {GST_MULTI_FILE_SINK_FSYNC_BUFFER, "Flush the file after every buffer",
+        "buffer"},
+    {0, NULL, NULL}
+  };
+
+  if (!multi_file_sink_fsync_type) {
+    multi_file_sink_fsync_type =
+        g_enum_register_static ("GstMultiFileSinkFsync", fsync_types);
+  }
+
+  return multi_file_sink_fsync_type;
+}
+
 GST_BOILERPLATE (GstMultiFileSink, gst_multi_file_sink, GstBaseSink,
     GST_TYPE_BASE_SINK);
 
@@ -283,10 +387,97 @@ gst_multi_file_sink_class_init (GstMultiFileSinkClass * klass)
           0, G_MAXUINT64, DEFAULT_MAX_FILE_SIZE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiFileSink:fsync
+   *
+   * When written data is flushed to the disk.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_FSYNC,
+      g_param_spec_enum ("fsync", "Fsync",
+          "When written data is flushed to the disk",
+          GST_TYPE_MULTI_FILE_SINK_FSYNC, DEFAULT_FSYNC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiFileSink:write-behind
+   *
+   * Open, write and close the files in a separate thread, so that a slow disk
+   * does not stall the streaming thread. The streaming thread only blocks
+   * when #GstMultiFileSink:max-queued-bytes are waiting to be written.
+   * Messages are posted when the data has been written.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_BEHIND,
+      g_param_spec_boolean ("write-behind", "Write Behind",
+          "Write the files in a separate thread",
+          DEFAULT_WRITE_BEHIND, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiFileSink:max-queued-bytes
+   *
+   * Maximum number of bytes waiting to be written in write-behind mode.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUED_BYTES,
+      g_param_spec_uint64 ("max-queued-bytes", "Max Queued Bytes",
+          "Maximum number of bytes waiting to be written in write-behind mode",
+          0, G_MAXUINT64, DEFAULT_MAX_QUEUED_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiFileSink:queued-bytes
+   *
+   * Number of bytes waiting to be written in write-behind mode.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_QUEUED_BYTES,
+      g_param_spec_uint64 ("queued-bytes", "Queued Bytes",
+          "Number of bytes waiting to be written in write-behind mode",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiFileSink:write-latency
+   *
+   * Time in nanoseconds between receiving the last written buffer and
+   * having it written, including the time it was queued in write-behind
+   * mode.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_LATENCY,
+      g_param_spec_uint64 ("write-latency", "Write Latency",
+          "Time in nanoseconds it took to write the last buffer",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiFileSink:index-location
+   *
+   * Location of an index of the written files, with their time ranges, sizes
+   * and first key frames. Lets #GstSplitFileSrc seek to the right file
+   * without opening the files in order.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index Location",
+          "Location of the index of the written files (NULL = no index)",
+          DEFAULT_INDEX_LOCATION, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_multi_file_sink_finalize;
 
   gstbasesink_class->get_times = NULL;
+  gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_multi_file_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_multi_file_sink_stop);
+  gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_multi_file_sink_unlock);
+  gstbasesink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_multi_file_sink_unlock_stop);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_multi_file_sink_render);
   gstbasesink_class->render_list =
       GST_DEBUG_FUNCPTR (gst_multi_file_sink_render_list);
@@ -306,6 +497,15 @@ gst_multi_file_sink_init (GstMultiFileSink * multifilesink,
   multifilesink->max_file_size = DEFAULT_MAX_FILE_SIZE;
   multifilesink->files = NULL;
   multifilesink->n_files = 0;
+  multifilesink->fsync = DEFAULT_FSYNC;
+  multifilesink->write_behind = DEFAULT_WRITE_BEHIND;
+  multifilesink->max_queued_bytes = DEFAULT_MAX_QUEUED_BYTES;
+  multifilesink->ops = g_queue_new ();
+  multifilesink->lock = g_mutex_new ();
+  multifilesink->cond = g_cond_new ();
+  multifilesink->index_location = g_strdup (DEFAULT_INDEX_LOCATION);
+  multifilesink->index_entries = g_queue_new ();
+  gst_multi_file_sink_reset_segment (multifilesink);
 
   gst_base_sink_set_sync (GST_BASE_SINK (multifilesink), FALSE);
 
@@ -321,6 +521,13 @@ gst_multi_file_sink_finalize (GObject * object)
   g_free (sink->filename);
   g_slist_foreach (sink->files, (GFunc) g_free, NULL);
   g_slist_free (sink->files);
+  g_queue_free (sink->ops);
+  g_mutex_free (sink->lock);
+  g_cond_free (sink->cond);
+  g_free (sink->index_location);
+  g_queue_foreach (sink->index_entries,
+      (GFunc) gst_multi_file_sink_index_entry_free, NULL);
+  g_queue_free (sink->index_entries);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -361,6 +568,22 @@ gst_multi_file_sink_set_property (GObject * object, guint prop_id,
     case PROP_MAX_FILE_SIZE:
       sink->max_file_size = g_value_get_uint64 (value);
       break;
+    case PROP_FSYNC:
+      sink->fsync = g_value_get_enum (value);
+      break;
+    case PROP_WRITE_BEHIND:
+      sink->write_behind = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_QUEUED_BYTES:
+      g_mutex_lock (sink->lock);
+      sink->max_queued_bytes = g_value_get_uint64 (value);
+      g_cond_broadcast (sink->cond);
+      g_mutex_unlock (sink->lock);
+      break;
+    case PROP_INDEX_LOCATION:
+      g_free (sink->index_location);
+      sink->index_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -392,12 +615,509 @@ gst_multi_file_sink_get_property (GObject * object, guint prop_id,
     case PROP_MAX_FILE_SIZE:
       g_value_set_uint64 (value, sink->max_file_size);
       break;
+    case PROP_FSYNC:
+      g_value_set_enum (value, sink->fsync);
+      break;
+    case PROP_WRITE_BEHIND:
+      g_value_set_boolean (value, sink->write_behind);
+      break;
+    case PROP_MAX_QUEUED_BYTES:
+      g_mutex_lock (sink->lock);
+      g_value_set_uint64 (value, sink->max_queued_bytes);
+      g_mutex_unlock (sink->lock);
+      break;
+    case PROP_QUEUED_BYTES:
+      g_mutex_lock (sink->lock);
+      g_value_set_uint64 (value, sink->queued_bytes);
+      g_mutex_unlock (sink->lock);
+      break;
+    case PROP_WRITE_LATENCY:
+      g_mutex_lock (sink->lock);
+      g_value_set_uint64 (value, sink->write_latency);
+      g_mutex_unlock (sink->lock);
+      break;
+    case PROP_INDEX_LOCATION:
+      g_value_set_string (value, sink->index_location);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static GstMultiFileSinkOp *
+gst_multi_file_sink_op_new (GstMultiFileSinkOpType type, gchar * filename,
+    GstBuffer * buffer)
+{
+  GstMultiFileSinkOp *op;
+
+  op = g_slice_new0 (GstMultiFileSinkOp);
+  op->type = type;
+  op->filename = filename;
+  if (buffer)
+    op->buffer = gst_buffer_ref (buffer);
+
+  return op;
+}
+
+static void
+gst_multi_file_sink_op_free (GstMultiFileSinkOp * op)
+{
+  g_free (op->filename);
+  if (op->buffer)
+    gst_buffer_unref (op->buffer);
+  if (op->message)
+    gst_structure_free (op->message);
+  g_slice_free (GstMultiFileSinkOp, op);
+}
+
+static gboolean
+gst_multi_file_sink_sync_file (FILE * file)
+{
+  if (fflush (file) != 0)
+    return FALSE;
+
+  return fsync (fileno (file)) == 0;
+}
+
+static gboolean
+gst_multi_file_sink_write_file (const gchar * filename, GstBuffer * buffer)
+{
+  FILE *file;
+  gboolean ret;
+
+  file = g_fopen (filename, "wb");
+  if (file == NULL)
+    return FALSE;
+
+  ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
+      file) == 1 && gst_multi_file_sink_sync_file (file);
+  if (fclose (file) != 0)
+    ret = FALSE;
+
+  return ret;
+}
+
+static gboolean
+gst_multi_file_sink_append_file (GstMultiFileSink * sink,
+    const gchar * filename, GstBuffer * buffer)
+{
+  FILE *file;
+  gboolean ret;
+
+  file = g_fopen (filename, "ab");
+  if (file == NULL)
+    return FALSE;
+
+  ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
+      file) == 1;
+  if (ret && sink->fsync != GST_MULTI_FILE_SINK_FSYNC_NONE)
+    ret = gst_multi_file_sink_sync_file (file);
+  if (fclose (file) != 0)
+    ret = FALSE;
+
+  return ret;
+}
+
+/* Does the file operation and posts its message, or an error */
+static gboolean
+gst_multi_file_sink_execute (GstMultiFileSink * sink, GstMultiFileSinkOp * op)
+{
+  GError *error = NULL;
+  GstClockTime latency;
+
+  switch (op->type) {
+    case OP_OPEN:
+      GST_INFO_OBJECT (sink, "opening file %s", op->filename);
+      sink->file = g_fopen (op->filename, "wb");
+      if (sink->file == NULL)
+        goto stdio_write_error;
+      break;
+    case OP_WRITE:
+      if (fwrite (GST_BUFFER_DATA (op->buffer), GST_BUFFER_SIZE (op->buffer), 1,
+              sink->file) != 1)
+        goto stdio_write_error;
+      if (sink->fsync == GST_MULTI_FILE_SINK_FSYNC_BUFFER &&
+          !gst_multi_file_sink_sync_file (sink->file))
+        goto stdio_write_error;
+      break;
+    case OP_CLOSE:
+      if (sink->fsync != GST_MULTI_FILE_SINK_FSYNC_NONE &&
+          !gst_multi_file_sink_sync_file (sink->file)) {
+        fclose (sink->file);
+        sink->file = NULL;
+        goto stdio_write_error;
+      }
+      fclose (sink->file);
+      sink->file = NULL;
+      break;
+    case OP_WRITE_FILE:
+      if (sink->fsync == GST_MULTI_FILE_SINK_FSYNC_NONE) {
+        if (!g_file_set_contents (op->filename,
+                (char *) GST_BUFFER_DATA (op->buffer),
+                GST_BUFFER_SIZE (op->buffer), &error))
+          goto write_error;
+      } else {
+        if (!gst_multi_file_sink_write_file (op->filename, op->buffer))
+          goto stdio_write_error;
+      }
+      break;
+    case OP_REPLACE_FILE:
+      /* writes to a temporary file that is renamed over the old one */
+      if (!g_file_set_contents (op->filename,
+              (char *) GST_BUFFER_DATA (op->buffer),
+              GST_BUFFER_SIZE (op->buffer), &error))
+        goto write_error;
+      break;
+    case OP_APPEND_FILE:
+      if (!gst_multi_file_sink_append_file (sink, op->filename, op->buffer))
+        goto stdio_write_error;
+      break;
+    case OP_REMOVE:
+      g_remove (op->filename);
+      break;
+  }
+
+  latency = gst_util_get_timestamp () - op->queued;
+  if (op->type == OP_WRITE || op->type == OP_WRITE_FILE) {
+    g_mutex_lock (sink->lock);
+    sink->write_latency = latency;
+    g_mutex_unlock (sink->lock);
+  }
+  if (op->message) {
+    gst_structure_set (op->message, "write-latency", G_TYPE_UINT64, latency,
+        NULL);
+    gst_element_post_message (GST_ELEMENT_CAST (sink),
+        gst_message_new_element (GST_OBJECT_CAST (sink), op->message));
+    op->message = NULL;
+  }
+
+  return TRUE;
+
+  /* ERRORS */
+write_error:
+  {
+    switch (error->code) {
+      case G_FILE_ERROR_NOSPC:{
+        GST_ELEMENT_ERROR (sink, RESOURCE, NO_SPACE_LEFT, (NULL), (NULL));
+        break;
+      }
+      default:{
+        GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+            ("Error while writing to file \"%s\".", op->filename),
+            ("%s", g_strerror (errno)));
+      }
+    }
+    g_error_free (error);
+    return FALSE;
+  }
+stdio_write_error:
+  switch (errno) {
+    case ENOSPC:
+      GST_ELEMENT_ERROR (sink, RESOURCE, NO_SPACE_LEFT,
+          ("Error while writing to file."), ("%s", g_strerror (errno)));
+      break;
+    default:
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+          ("Error while writing to file."), ("%s", g_strerror (errno)));
+  }
+  return FALSE;
+}
+
+static gpointer
+gst_multi_file_sink_thread (GstMultiFileSink * sink)
+{
+  GstMultiFileSinkOp *op;
+  gboolean failed = FALSE;
+
+  g_mutex_lock (sink->lock);
+  while (TRUE) {
+    while (sink->running && g_queue_is_empty (sink->ops))
+      g_cond_wait (sink->cond, sink->lock);
+
+    /* only stop when everything is written */
+    op = g_queue_pop_head (sink->ops);
+    if (op == NULL)
+      break;
+    g_mutex_unlock (sink->lock);
+
+    /* nothing is written anymore after an error */
+    if (!failed)
+      failed = !gst_multi_file_sink_execute (sink, op);
+
+    g_mutex_lock (sink->lock);
+    if (failed)
+      sink->io_error = TRUE;
+    if (op->buffer)
+      sink->queued_bytes -= GST_BUFFER_SIZE (op->buffer);
+    sink->n_pending--;
+    g_cond_broadcast (sink->cond);
+    gst_multi_file_sink_op_free (op);
+  }
+  g_mutex_unlock (sink->lock);
+
+  return NULL;
+}
+
+/* Does the file operation right away or queues it for the write-behind
+ * thread. Errors are posted by the one doing the operation, queued
+ * operations fail the next submit. */
+static GstFlowReturn
+gst_multi_file_sink_submit (GstMultiFileSink * sink, GstMultiFileSinkOp * op)
+{
+  guint size = op->buffer ? GST_BUFFER_SIZE (op->buffer) : 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  op->queued = gst_util_get_timestamp ();
+
+  if (sink->thread == NULL) {
+    if (!gst_multi_file_sink_execute (sink, op))
+      ret = GST_FLOW_ERROR;
+    gst_multi_file_sink_op_free (op);
+    return ret;
+  }
+
+  g_mutex_lock (sink->lock);
+  /* a buffer larger than the maximum is queued when the queue is empty */
+  while (size > 0 && !sink->io_error && !sink->unlocked &&
+      sink->queued_bytes > 0 &&
+      sink->queued_bytes + size > sink->max_queued_bytes)
+    g_cond_wait (sink->cond, sink->lock);
+
+  if (sink->io_error) {
+    ret = GST_FLOW_ERROR;
+  } else if (size > 0 && sink->unlocked) {
+    ret = GST_FLOW_WRONG_STATE;
+  } else {
+    g_queue_push_tail (sink->ops, op);
+    sink->queued_bytes += size;
+    sink->n_pending++;
+    g_cond_broadcast (sink->cond);
+    op = NULL;
+  }
+  g_mutex_unlock (sink->lock);
+
+  if (op)
+    gst_multi_file_sink_op_free (op);
+
+  return ret;
+}
+
+/* waits until the write-behind thread has done all queued operations */
+static void
+gst_multi_file_sink_drain (GstMultiFileSink * sink)
+{
+  if (sink->thread == NULL)
+    return;
+
+  g_mutex_lock (sink->lock);
+  while (sink->n_pending > 0 && !sink->unlocked)
+    g_cond_wait (sink->cond, sink->lock);
+  g_mutex_unlock (sink->lock);
+}
+
+static void
+gst_multi_file_sink_index_entry_free (GstMultiFileSinkIndexEntry * entry)
+{
+  g_free (entry->filename);
+  g_slice_free (GstMultiFileSinkIndexEntry, entry);
+}
+
+static void
+gst_multi_file_sink_reset_segment (GstMultiFileSink * sink)
+{
+  sink->seg_start = GST_CLOCK_TIME_NONE;
+  sink->seg_stop = GST_CLOCK_TIME_NONE;
+  sink->seg_keyframe = GST_CLOCK_TIME_NONE;
+  sink->seg_size = 0;
+}
+
+/* accounts the timestamps of buffer to the current file */
+static void
+gst_multi_file_sink_update_segment (GstMultiFileSink * sink,
+    GstBuffer * buffer)
+{
+  GstClockTime timestamp, stop;
+
+  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    return;
+
+  stop = timestamp;
+  if (GST_BUFFER_DURATION_IS_VALID (buffer))
+    stop += GST_BUFFER_DURATION (buffer);
+
+  if (!GST_CLOCK_TIME_IS_VALID (sink->seg_start))
+    sink->seg_start = timestamp;
+  if (!GST_CLOCK_TIME_IS_VALID (sink->seg_stop) || stop > sink->seg_stop)
+    sink->seg_stop = stop;
+  if (!GST_CLOCK_TIME_IS_VALID (sink->seg_keyframe) &&
+      !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    sink->seg_keyframe = timestamp;
+}
+
+static GstMultiFileSinkIndexEntry *
+gst_multi_file_sink_new_index_entry (GstMultiFileSink * sink)
+{
+  GstMultiFileSinkIndexEntry *entry;
+  gchar *filename;
+
+  filename = g_strdup_printf (sink->filename, sink->index);
+  entry = g_slice_new (GstMultiFileSinkIndexEntry);
+  entry->filename = g_path_get_basename (filename);
+  entry->start = sink->seg_start;
+  entry->stop = sink->seg_stop;
+  entry->keyframe = sink->seg_keyframe;
+  entry->size = sink->seg_size;
+  g_free (filename);
+
+  return entry;
+}
+
+/* adds the current file to the index, once it is complete */
+static void
+gst_multi_file_sink_add_index_entry (GstMultiFileSink * sink)
+{
+  if (sink->index_location)
+    g_queue_push_tail (sink->index_entries,
+        gst_multi_file_sink_new_index_entry (sink));
+
+  gst_multi_file_sink_reset_segment (sink);
+}
+
+static void
+gst_multi_file_sink_append_time (GString * str, GstClockTime time)
+{
+  if (GST_CLOCK_TIME_IS_VALID (time))
+    g_string_append_printf (str, "%" G_GUINT64_FORMAT, time);
+  else
+    g_string_append_c (str, '-');
+}
+
+static void
+gst_multi_file_sink_append_index_entry (GString * str,
+    GstMultiFileSinkIndexEntry * entry)
+{
+  gst_multi_file_sink_append_time (str, entry->start);
+  g_string_append_c (str, ' ');
+  gst_multi_file_sink_append_time (str, entry->stop);
+  g_string_append_printf (str, " %" G_GUINT64_FORMAT " ", entry->size);
+  gst_multi_file_sink_append_time (str, entry->keyframe);
+  g_string_append_printf (str, " %s\n", entry->filename);
+}
+
+static GstBuffer *
+gst_multi_file_sink_string_to_buffer (GString * str)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new ();
+  GST_BUFFER_SIZE (buf) = str->len;
+  GST_BUFFER_DATA (buf) = (guint8 *) g_string_free (str, FALSE);
+  GST_BUFFER_MALLOCDATA (buf) = GST_BUFFER_DATA (buf);
+
+  return buf;
+}
+
+/* Replaces the index file, in the write-behind thread if there is one.
+ * with_current also lists the file that is still being written. */
+static void
+gst_multi_file_sink_write_index (GstMultiFileSink * sink,
+    gboolean with_current)
+{
+  GstBuffer *buf;
+  GString *str;
+  GList *l;
+
+  if (sink->index_location == NULL)
+    return;
+
+  /* the line of an unfinished file can't be appended to later */
+  sink->index_rewrite = with_current && sink->file_open;
+
+  str = g_string_new ("# start stop size first-keyframe filename\n");
+  for (l = sink->index_entries->head; l; l = l->next)
+    gst_multi_file_sink_append_index_entry (str, l->data);
+
+  if (with_current && sink->file_open) {
+    GstMultiFileSinkIndexEntry *entry;
+
+    entry = gst_multi_file_sink_new_index_entry (sink);
+    gst_multi_file_sink_append_index_entry (str, entry);
+    gst_multi_file_sink_index_entry_free (entry);
+  }
+
+  buf = gst_multi_file_sink_string_to_buffer (str);
+  gst_multi_file_sink_submit (sink,
+      gst_multi_file_sink_op_new (OP_REPLACE_FILE,
+          g_strdup (sink->index_location), buf));
+  gst_buffer_unref (buf);
+}
+
+/* Adds the line of the file that was just finished to the index file. The
+ * whole index is only written again when the file doesn't match the
+ * entries anymore, so the cost doesn't grow with the number of files. */
+static void
+gst_multi_file_sink_update_index (GstMultiFileSink * sink)
+{
+  GstBuffer *buf;
+  GString *str;
+
+  if (sink->index_location == NULL)
+    return;
+
+  if (sink->index_rewrite || g_queue_is_empty (sink->index_entries)) {
+    gst_multi_file_sink_write_index (sink, FALSE);
+    return;
+  }
+
+  str = g_string_new (NULL);
+  gst_multi_file_sink_append_index_entry (str,
+      g_queue_peek_tail (sink->index_entries));
+
+  buf = gst_multi_file_sink_string_to_buffer (str);
+  gst_multi_file_sink_submit (sink,
+      gst_multi_file_sink_op_new (OP_APPEND_FILE,
+          g_strdup (sink->index_location), buf));
+  gst_buffer_unref (buf);
+}
+
+static gboolean
+gst_multi_file_sink_start (GstBaseSink * sink)
+{
+  GstMultiFileSink *multifilesink = GST_MULTI_FILE_SINK (sink);
+  GError *error = NULL;
+
+  multifilesink->io_error = FALSE;
+  multifilesink->unlocked = FALSE;
+  multifilesink->n_pending = 0;
+  multifilesink->queued_bytes = 0;
+  multifilesink->write_latency = 0;
+  /* replace whatever an earlier run left in the index file */
+  multifilesink->index_rewrite = TRUE;
+
+  if (!multifilesink->write_behind)
+    return TRUE;
+
+  multifilesink->running = TRUE;
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  multifilesink->thread =
+      g_thread_create ((GThreadFunc) gst_multi_file_sink_thread,
+      multifilesink, TRUE, &error);
+#else
+  multifilesink->thread = g_thread_try_new ("multifilesink-write-behind",
+      (GThreadFunc) gst_multi_file_sink_thread, multifilesink, &error);
+#endif
+  if (multifilesink->thread == NULL) {
+    GST_ELEMENT_ERROR (multifilesink, RESOURCE, FAILED,
+        ("Failed to start the write-behind thread"), ("%s", error->message));
+    g_error_free (error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 gst_multi_file_sink_stop (GstBaseSink * sink)
 {
@@ -406,10 +1126,26 @@ gst_multi_file_sink_stop (GstBaseSink * sink)
 
   multifilesink = GST_MULTI_FILE_SINK (sink);
 
+  if (multifilesink->thread) {
+    /* the thread writes everything that is queued before it stops */
+    g_mutex_lock (multifilesink->lock);
+    multifilesink->running = FALSE;
+    g_cond_broadcast (multifilesink->cond);
+    g_mutex_unlock (multifilesink->lock);
+
+    g_thread_join (multifilesink->thread);
+    multifilesink->thread = NULL;
+  }
+
   if (multifilesink->file != NULL) {
+    if (multifilesink->fsync != GST_MULTI_FILE_SINK_FSYNC_NONE)
+      gst_multi_file_sink_sync_file (multifilesink->file);
     fclose (multifilesink->file);
     multifilesink->file = NULL;
   }
+  /* the thread is stopped, so this is written right away */
+  gst_multi_file_sink_write_index (multifilesink, TRUE);
+  multifilesink->file_open = FALSE;
 
   if (multifilesink->streamheaders) {
     for (i = 0; i < multifilesink->n_streamheaders; i++) {
@@ -424,19 +1160,42 @@ gst_multi_file_sink_stop (GstBaseSink * sink)
   return TRUE;
 }
 
+static gboolean
+gst_multi_file_sink_unlock (GstBaseSink * sink)
+{
+  GstMultiFileSink *multifilesink = GST_MULTI_FILE_SINK (sink);
+
+  g_mutex_lock (multifilesink->lock);
+  multifilesink->unlocked = TRUE;
+  g_cond_broadcast (multifilesink->cond);
+  g_mutex_unlock (multifilesink->lock);
 
-static void
-gst_multi_file_sink_post_message_full (GstMultiFileSink * multifilesink,
+  return TRUE;
+}
+
+static gboolean
+gst_multi_file_sink_unlock_stop (GstBaseSink * sink)
+{
+  GstMultiFileSink *multifilesink = GST_MULTI_FILE_SINK (sink);
+
+  g_mutex_lock (multifilesink->lock);
+  multifilesink->unlocked = FALSE;
+  g_mutex_unlock (multifilesink->lock);
+
+  return TRUE;
+}
+
+
+static GstStructure *
+gst_multi_file_sink_new_message_full (GstMultiFileSink * multifilesink,
     GstClockTime timestamp, GstClockTime duration, GstClockTime offset,
     GstClockTime offset_end, GstClockTime running_time,
     GstClockTime stream_time, const char *filename)
 {
-  GstStructure *s;
-
   if (!multifilesink->post_messages)
-    return;
+    return NULL;
 
-  s = gst_structure_new ("GstMultiFileSink",
+  return gst_structure_new ("GstMultiFileSink",
       "filename", G_TYPE_STRING, filename,
       "index", G_TYPE_INT, multifilesink->index,
       "timestamp", G_TYPE_UINT64, timestamp,
@@ -445,14 +1204,11 @@ gst_multi_file_sink_post_message_full (GstMultiFileSink * multifilesink,
       "duration", G_TYPE_UINT64, duration,
       "offset", G_TYPE_UINT64, offset,
       "offset-end", G_TYPE_UINT64, offset_end, NULL);
-
-  gst_element_post_message (GST_ELEMENT_CAST (multifilesink),
-      gst_message_new_element (GST_OBJECT_CAST (multifilesink), s));
 }
 
 
-static void
-gst_multi_file_sink_post_message (GstMultiFileSink * multifilesink,
+static GstStructure *
+gst_multi_file_sink_new_message (GstMultiFileSink * multifilesink,
     GstBuffer * buffer, const char *filename)
 {
   GstClockTime duration, timestamp;
@@ -462,7 +1218,7 @@ gst_multi_file_sink_post_message (GstMultiFileSink * multifilesink,
   GstFormat format;
 
   if (!multifilesink->post_messages)
-    return;
+    return NULL;
 
   segment = &GST_BASE_SINK (multifilesink)->segment;
   format = segment->format;
@@ -475,50 +1231,75 @@ gst_multi_file_sink_post_message (GstMultiFileSink * multifilesink,
   running_time = gst_segment_to_running_time (segment, format, timestamp);
   stream_time = gst_segment_to_stream_time (segment, format, timestamp);
 
-  gst_multi_file_sink_post_message_full (multifilesink, timestamp, duration,
-      offset, offset_end, running_time, stream_time, filename);
+  return gst_multi_file_sink_new_message_full (multifilesink, timestamp,
+      duration, offset, offset_end, running_time, stream_time, filename);
 }
 
-static gboolean
+/* the message for closing the current file because of buffer */
+static GstStructure *
+gst_multi_file_sink_new_close_message (GstMultiFileSink * multifilesink,
+    GstBuffer * buffer)
+{
+  GstStructure *s;
+  gchar *filename;
+
+  if (!multifilesink->post_messages)
+    return NULL;
+
+  filename = g_strdup_printf (multifilesink->filename, multifilesink->index);
+  s = gst_multi_file_sink_new_message (multifilesink, buffer, filename);
+  g_free (filename);
+
+  return s;
+}
+
+static GstFlowReturn
+gst_multi_file_sink_write (GstMultiFileSink * sink, GstBuffer * buffer)
+{
+  GstFlowReturn ret;
+
+  ret = gst_multi_file_sink_submit (sink,
+      gst_multi_file_sink_op_new (OP_WRITE, NULL, buffer));
+  if (ret == GST_FLOW_OK)
+    sink->seg_size += GST_BUFFER_SIZE (buffer);
+
+  return ret;
+}
+
+static GstFlowReturn
 gst_multi_file_sink_write_stream_headers (GstMultiFileSink * sink)
 {
+  GstFlowReturn ret;
   int i;
 
   if (sink->streamheaders == NULL)
-    return TRUE;
+    return GST_FLOW_OK;
 
   /* we want to write these at the beginning */
   g_assert (sink->cur_file_size == 0);
 
   for (i = 0; i < sink->n_streamheaders; i++) {
     GstBuffer *hdr;
-    int ret;
 
     hdr = sink->streamheaders[i];
 
-    ret = fwrite (GST_BUFFER_DATA (hdr), GST_BUFFER_SIZE (hdr), 1, sink->file);
-
-    if (ret != 1)
-      return FALSE;
+    ret = gst_multi_file_sink_write (sink, hdr);
+    if (ret != GST_FLOW_OK)
+      return ret;
 
     sink->cur_file_size += GST_BUFFER_SIZE (hdr);
   }
 
-  return TRUE;
+  return GST_FLOW_OK;
 }
 
 static GstFlowReturn
 gst_multi_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstMultiFileSink *multifilesink;
-  guint size;
-  guint8 *data;
+  GstMultiFileSinkOp *op;
   gchar *filename;
-  gboolean ret;
-  GError *error = NULL;
-
-  size = GST_BUFFER_SIZE (buffer);
-  data = GST_BUFFER_DATA (buffer);
+  GstFlowReturn ret;
 
   multifilesink = GST_MULTI_FILE_SINK (sink);
 
@@ -528,32 +1309,47 @@ gst_multi_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 
       filename = g_strdup_printf (multifilesink->filename,
           multifilesink->index);
-      ret = g_file_set_contents (filename, (char *) data, size, &error);
-      if (!ret)
-        goto write_error;
+      op = gst_multi_file_sink_op_new (OP_WRITE_FILE, g_strdup (filename),
+          buffer);
+      op->message = gst_multi_file_sink_new_message (multifilesink, buffer,
+          filename);
+      ret = gst_multi_file_sink_submit (multifilesink, op);
+      if (ret != GST_FLOW_OK) {
+        g_free (filename);
+        return ret;
+      }
 
       multifilesink->files = g_slist_append (multifilesink->files, filename);
       multifilesink->n_files += 1;
 
-      gst_multi_file_sink_post_message (multifilesink, buffer, filename);
+      if (multifilesink->index_location) {
+        gst_multi_file_sink_reset_segment (multifilesink);
+        gst_multi_file_sink_update_segment (multifilesink, buffer);
+        multifilesink->seg_size = GST_BUFFER_SIZE (buffer);
+        gst_multi_file_sink_add_index_entry (multifilesink);
+        gst_multi_file_sink_update_index (multifilesink);
+      }
+
       multifilesink->index++;
 
       break;
     case GST_MULTI_FILE_SINK_NEXT_DISCONT:
       if (GST_BUFFER_IS_DISCONT (buffer)) {
-        if (multifilesink->file)
-          gst_multi_file_sink_close_file (multifilesink, buffer);
+        if (multifilesink->file_open)
+          gst_multi_file_sink_close_file (multifilesink,
+              gst_multi_file_sink_new_close_message (multifilesink, buffer));
       }
 
-      if (multifilesink->file == NULL) {
-        if (!gst_multi_file_sink_open_next_file (multifilesink))
-          goto stdio_write_error;
+      if (!multifilesink->file_open) {
+        ret = gst_multi_file_sink_open_next_file (multifilesink);
+        if (ret != GST_FLOW_OK)
+          return ret;
       }
 
-      ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
-          multifilesink->file);
-      if (ret != 1)
-        goto stdio_write_error;
+      ret = gst_multi_file_sink_write (multifilesink, buffer);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      gst_multi_file_sink_update_segment (multifilesink, buffer);
 
       break;
     case GST_MULTI_FILE_SINK_NEXT_KEY_FRAME:
@@ -567,35 +1363,38 @@ gst_multi_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
       if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer) &&
           GST_BUFFER_TIMESTAMP (buffer) >= multifilesink->next_segment &&
           !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
-        if (multifilesink->file)
-          gst_multi_file_sink_close_file (multifilesink, buffer);
+        if (multifilesink->file_open)
+          gst_multi_file_sink_close_file (multifilesink,
+              gst_multi_file_sink_new_close_message (multifilesink, buffer));
 
         multifilesink->next_segment += 10 * GST_SECOND;
       }
 
-      if (multifilesink->file == NULL) {
-        if (!gst_multi_file_sink_open_next_file (multifilesink))
-          goto stdio_write_error;
+      if (!multifilesink->file_open) {
+        ret = gst_multi_file_sink_open_next_file (multifilesink);
+        if (ret != GST_FLOW_OK)
+          return ret;
 
         gst_multi_file_sink_write_stream_headers (multifilesink);
       }
 
-      ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
-          multifilesink->file);
-      if (ret != 1)
-        goto stdio_write_error;
+      ret = gst_multi_file_sink_write (multifilesink, buffer);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      gst_multi_file_sink_update_segment (multifilesink, buffer);
 
       break;
     case GST_MULTI_FILE_SINK_NEXT_KEY_UNIT_EVENT:
-      if (multifilesink->file == NULL) {
-        if (!gst_multi_file_sink_open_next_file (multifilesink))
-          goto stdio_write_error;
+      if (!multifilesink->file_open) {
+        ret = gst_multi_file_sink_open_next_file (multifilesink);
+        if (ret != GST_FLOW_OK)
+          return ret;
       }
 
-      ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
-          multifilesink->file);
-      if (ret != 1)
-        goto stdio_write_error;
+      ret = gst_multi_file_sink_write (multifilesink, buffer);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      gst_multi_file_sink_update_segment (multifilesink, buffer);
 
       break;
     case GST_MULTI_FILE_SINK_NEXT_MAX_SIZE:{
@@ -609,22 +1408,22 @@ gst_multi_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
             multifilesink->cur_file_size, new_size,
             multifilesink->max_file_size);
 
-        if (multifilesink->file != NULL)
+        if (multifilesink->file_open)
           gst_multi_file_sink_close_file (multifilesink, NULL);
       }
 
-      if (multifilesink->file == NULL) {
-        if (!gst_multi_file_sink_open_next_file (multifilesink))
-          goto stdio_write_error;
+      if (!multifilesink->file_open) {
+        ret = gst_multi_file_sink_open_next_file (multifilesink);
+        if (ret != GST_FLOW_OK)
+          return ret;
 
         gst_multi_file_sink_write_stream_headers (multifilesink);
       }
 
-      ret = fwrite (GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer), 1,
-          multifilesink->file);
-
-      if (ret != 1)
-        goto stdio_write_error;
+      ret = gst_multi_file_sink_write (multifilesink, buffer);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      gst_multi_file_sink_update_segment (multifilesink, buffer);
 
       multifilesink->cur_file_size += GST_BUFFER_SIZE (buffer);
       break;
@@ -634,38 +1433,6 @@ gst_multi_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
   }
 
   return GST_FLOW_OK;
-
-  /* ERRORS */
-write_error:
-  {
-    switch (error->code) {
-      case G_FILE_ERROR_NOSPC:{
-        GST_ELEMENT_ERROR (multifilesink, RESOURCE, NO_SPACE_LEFT, (NULL),
-            (NULL));
-        break;
-      }
-      default:{
-        GST_ELEMENT_ERROR (multifilesink, RESOURCE, WRITE,
-            ("Error while writing to file \"%s\".", filename),
-            ("%s", g_strerror (errno)));
-      }
-    }
-    g_error_free (error);
-    g_free (filename);
-
-    return GST_FLOW_ERROR;
-  }
-stdio_write_error:
-  switch (errno) {
-    case ENOSPC:
-      GST_ELEMENT_ERROR (multifilesink, RESOURCE, NO_SPACE_LEFT,
-          ("Error while writing to file."), ("%s", g_strerror (errno)));
-      break;
-    default:
-      GST_ELEMENT_ERROR (multifilesink, RESOURCE, WRITE,
-          ("Error while writing to file."), ("%s", g_strerror (errno)));
-  }
-  return GST_FLOW_ERROR;
 }
 
 static GstBufferListItem
@@ -703,6 +1470,7 @@ static GstFlowReturn
 gst_multi_file_sink_render_list (GstBaseSink * sink, GstBufferList * list)
 {
   GstBuffer *buf;
+  GstFlowReturn ret;
   guint size;
 
   gst_buffer_list_foreach (list, buffer_list_calc_size, &size);
@@ -715,10 +1483,10 @@ gst_multi_file_sink_render_list (GstBaseSink * sink, GstBufferList * list)
   gst_buffer_list_foreach (list, buffer_list_copy_data, buf);
   g_assert (GST_BUFFER_SIZE (buf) == size);
 
-  gst_multi_file_sink_render (sink, buf);
+  ret = gst_multi_file_sink_render (sink, buf);
   gst_buffer_unref (buf);
 
-  return GST_FLOW_OK;
+  return ret;
 }
 
 static gboolean
@@ -760,6 +1528,27 @@ gst_multi_file_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   return TRUE;
 }
 
+/* the files are removed in the order they were written */
+static void
+gst_multi_file_sink_remove_index_entry (GstMultiFileSink * multifilesink,
+    const gchar * filename)
+{
+  GstMultiFileSinkIndexEntry *entry;
+  gchar *basename;
+
+  entry = g_queue_peek_head (multifilesink->index_entries);
+  if (entry == NULL)
+    return;
+
+  basename = g_path_get_basename (filename);
+  if (strcmp (entry->filename, basename) == 0) {
+    g_queue_pop_head (multifilesink->index_entries);
+    gst_multi_file_sink_index_entry_free (entry);
+    multifilesink->index_rewrite = TRUE;
+  }
+  g_free (basename);
+}
+
 static void
 gst_multi_file_sink_ensure_max_files (GstMultiFileSink * multifilesink)
 {
@@ -768,8 +1557,9 @@ gst_multi_file_sink_ensure_max_files (GstMultiFileSink * multifilesink)
   while (multifilesink->max_files &&
       multifilesink->n_files >= multifilesink->max_files) {
     filename = multifilesink->files->data;
-    g_remove (filename);
-    g_free (filename);
+    gst_multi_file_sink_remove_index_entry (multifilesink, filename);
+    gst_multi_file_sink_submit (multifilesink,
+        gst_multi_file_sink_op_new (OP_REMOVE, filename, NULL));
     multifilesink->files = g_slist_delete_link (multifilesink->files,
         multifilesink->files);
     multifilesink->n_files -= 1;
@@ -807,77 +1597,79 @@ gst_multi_file_sink_event (GstBaseSink * sink, GstEvent * event)
 
       multifilesink->force_key_unit_count = count;
 
-      if (multifilesink->file) {
+      if (multifilesink->file_open) {
         duration = GST_CLOCK_TIME_NONE;
         offset = offset_end = -1;
         filename = g_strdup_printf (multifilesink->filename,
             multifilesink->index);
-        gst_multi_file_sink_post_message_full (multifilesink, timestamp,
-            duration, offset, offset_end, running_time, stream_time, filename);
+        gst_multi_file_sink_close_file (multifilesink,
+            gst_multi_file_sink_new_message_full (multifilesink, timestamp,
+                duration, offset, offset_end, running_time, stream_time,
+                filename));
 
         g_free (filename);
-
-        gst_multi_file_sink_close_file (multifilesink, NULL);
-
       }
 
-      if (multifilesink->file == NULL) {
-        if (!gst_multi_file_sink_open_next_file (multifilesink))
-          goto stdio_write_error;
+      if (!multifilesink->file_open) {
+        if (gst_multi_file_sink_open_next_file (multifilesink) != GST_FLOW_OK)
+          res = FALSE;
       }
 
       break;
     }
+    case GST_EVENT_EOS:
+      /* everything is on disk when EOS is posted */
+      gst_multi_file_sink_write_index (multifilesink, TRUE);
+      gst_multi_file_sink_drain (multifilesink);
+      break;
     default:
       break;
   }
 
 out:
   return res;
-
-stdio_write_error:
-  GST_ELEMENT_ERROR (multifilesink, RESOURCE, WRITE,
-      ("Error while writing to file."), (NULL));
-  return FALSE;
 }
 
-static gboolean
+static GstFlowReturn
 gst_multi_file_sink_open_next_file (GstMultiFileSink * multifilesink)
 {
   char *filename;
+  GstFlowReturn ret;
 
-  g_return_val_if_fail (multifilesink->file == NULL, FALSE);
+  g_return_val_if_fail (!multifilesink->file_open, GST_FLOW_ERROR);
 
   gst_multi_file_sink_ensure_max_files (multifilesink);
   filename = g_strdup_printf (multifilesink->filename, multifilesink->index);
-  multifilesink->file = g_fopen (filename, "wb");
-  if (multifilesink->file == NULL) {
+  ret = gst_multi_file_sink_submit (multifilesink,
+      gst_multi_file_sink_op_new (OP_OPEN, g_strdup (filename), NULL));
+  if (ret != GST_FLOW_OK) {
     g_free (filename);
-    return FALSE;
+    return ret;
   }
 
-  GST_INFO_OBJECT (multifilesink, "opening file %s", filename);
+  multifilesink->file_open = TRUE;
   multifilesink->files = g_slist_append (multifilesink->files, filename);
   multifilesink->n_files += 1;
 
   multifilesink->cur_file_size = 0;
-  return TRUE;
+  gst_multi_file_sink_reset_segment (multifilesink);
+  return GST_FLOW_OK;
 }
 
+/* takes ownership of message, which is posted once the file is closed */
 static void
 gst_multi_file_sink_close_file (GstMultiFileSink * multifilesink,
-    GstBuffer * buffer)
+    GstStructure * message)
 {
-  char *filename;
+  GstMultiFileSinkOp *op;
 
-  fclose (multifilesink->file);
-  multifilesink->file = NULL;
+  op = gst_multi_file_sink_op_new (OP_CLOSE, NULL, NULL);
+  op->message = message;
+  gst_multi_file_sink_submit (multifilesink, op);
+  multifilesink->file_open = FALSE;
 
-  if (buffer) {
-    filename = g_strdup_printf (multifilesink->filename, multifilesink->index);
-    gst_multi_file_sink_post_message (multifilesink, buffer, filename);
-    g_free (filename);
-  }
+  gst_multi_file_sink_add_index_entry (multifilesink);
+  gst_multi_file_sink_update_index (multifilesink);
 
   multifilesink->index++;
 }
@@ -73,6 +73,25 @@ typedef enum {
   GST_MULTI_FILE_SINK_NEXT_MAX_SIZE
 } GstMultiFileSinkNext;
 
+/**
+ * GstMultiFileSinkFsync:
+ * @GST_MULTI_FILE_SINK_FSYNC_NONE: Leave it to the system when the data
+ *  reaches the disk
+ * @GST_MULTI_FILE_SINK_FSYNC_FILE: Flush every file to the disk when it is
+ *  closed
+ * @GST_MULTI_FILE_SINK_FSYNC_BUFFER: Flush the file to the disk after every
+ *  buffer
+ *
+ * When written data is flushed to the disk.
+ *
+ * Since: 0.10.32
+ */
+typedef enum {
+  GST_MULTI_FILE_SINK_FSYNC_NONE,
+  GST_MULTI_FILE_SINK_FSYNC_FILE,
+  GST_MULTI_FILE_SINK_FSYNC_BUFFER
+} GstMultiFileSinkFsync;
+
 struct _GstMultiFileSink
 {
   GstBaseSink parent;
@@ -94,6 +113,39 @@ struct _GstMultiFileSink
 
   guint64 cur_file_size;
   guint64 max_file_size;
+
+  /* a file is open, or its opening is queued */
+  gboolean file_open;
+
+  GstMultiFileSinkFsync fsync;
+  gboolean write_behind;
+
+  /* the write-behind thread and the file operations it has to do, protected
+   * by the lock */
+  GThread *thread;
+  GMutex *lock;
+  GCond *cond;
+  GQueue *ops;
+  guint n_pending;
+  gboolean running;
+  gboolean unlocked;
+  gboolean io_error;
+  guint64 queued_bytes;
+  guint64 max_queued_bytes;
+  GstClockTime write_latency;
+
+  /* the segment index, the entries of the files on disk oldest first */
+  gchar *index_location;
+  GQueue *index_entries;
+  /* the index file doesn't match the entries, it is written again instead
+   * of appending the next line */
+  gboolean index_rewrite;
+
+  /* the file that is written to */
+  GstClockTime seg_start;
+  GstClockTime seg_stop;
+  GstClockTime seg_keyframe;
+  guint64 seg_size;
 };
 
 struct _GstMultiFileSinkClass
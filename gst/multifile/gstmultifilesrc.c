@@ -58,6 +58,8 @@ static void gst_multi_file_src_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static GstCaps *gst_multi_file_src_getcaps (GstBaseSrc * src);
 static gboolean gst_multi_file_src_query (GstBaseSrc * src, GstQuery * query);
+static gboolean gst_multi_file_src_start (GstBaseSrc * src);
+static gboolean gst_multi_file_src_stop (GstBaseSrc * src);
 
 
 static GstStaticPadTemplate gst_multi_file_src_pad_template =
@@ -77,11 +79,32 @@ enum
   ARG_START_INDEX,
   ARG_STOP_INDEX,
   ARG_CAPS,
-  ARG_LOOP
+  ARG_LOOP,
+  ARG_USE_MMAP,
+  ARG_PREFETCH
 };
 
 #define DEFAULT_LOCATION "%05d"
 #define DEFAULT_INDEX 0
+#define DEFAULT_USE_MMAP FALSE
+#define DEFAULT_PREFETCH 0
+
+#define MAX_PREFETCH 64
+/* the smallest common page size, for touching every page of a mapped file */
+#define FAULT_IN_STRIDE 4096
+
+/* a file that is loaded by a prefetch thread */
+typedef struct
+{
+  gint index;
+  gchar *filename;
+  gboolean use_mmap;
+
+  /* set by the prefetch thread, protected by the lock */
+  gboolean done;
+  GstBuffer *buffer;
+  GError *error;
+} GstMultiFileSrcLoad;
 
 
 GST_BOILERPLATE (GstMultiFileSrc, gst_multi_file_src, GstPushSrc,
@@ -145,11 +168,40 @@ gst_multi_file_src_class_init (GstMultiFileSrcClass * klass)
       g_param_spec_boolean ("loop", "Loop",
           "Whether to repeat from the beginning when all files have been read.",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstMultiFileSrc:use-mmap:
+   *
+   * Map the files into memory instead of reading them. The buffers reference
+   * the mapped files, so the data is not copied. The files must not be
+   * truncated while they are in use.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, ARG_USE_MMAP,
+      g_param_spec_boolean ("use-mmap", "Use mmap",
+          "Map the files into memory instead of reading them",
+          DEFAULT_USE_MMAP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstMultiFileSrc:prefetch:
+   *
+   * Number of files that background threads load ahead of the streaming
+   * thread. Mapped files are paged in completely. With 0, every file is
+   * loaded when it is needed.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, ARG_PREFETCH,
+      g_param_spec_uint ("prefetch", "Prefetch",
+          "Number of files to load ahead (0 = disabled)", 0, MAX_PREFETCH,
+          DEFAULT_PREFETCH, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
 
   gobject_class->dispose = gst_multi_file_src_dispose;
 
   gstbasesrc_class->get_caps = gst_multi_file_src_getcaps;
   gstbasesrc_class->query = gst_multi_file_src_query;
+  gstbasesrc_class->start = gst_multi_file_src_start;
+  gstbasesrc_class->stop = gst_multi_file_src_stop;
 
   gstpushsrc_class->create = gst_multi_file_src_create;
 
@@ -168,6 +220,11 @@ gst_multi_file_src_init (GstMultiFileSrc * multifilesrc,
   multifilesrc->stop_index = -1;
   multifilesrc->filename = g_strdup (DEFAULT_LOCATION);
   multifilesrc->successful_read = FALSE;
+  multifilesrc->use_mmap = DEFAULT_USE_MMAP;
+  multifilesrc->prefetch = DEFAULT_PREFETCH;
+  multifilesrc->loads = g_queue_new ();
+  multifilesrc->lock = g_mutex_new ();
+  multifilesrc->cond = g_cond_new ();
 }
 
 static void
@@ -179,6 +236,19 @@ gst_multi_file_src_dispose (GObject * object)
   src->filename = NULL;
   if (src->caps)
     gst_caps_unref (src->caps);
+  src->caps = NULL;
+  if (src->loads) {
+    g_queue_free (src->loads);
+    src->loads = NULL;
+  }
+  if (src->lock) {
+    g_mutex_free (src->lock);
+    src->lock = NULL;
+  }
+  if (src->cond) {
+    g_cond_free (src->cond);
+    src->cond = NULL;
+  }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -279,6 +349,12 @@ gst_multi_file_src_set_property (GObject * object, guint prop_id,
     case ARG_LOOP:
       src->loop = g_value_get_boolean (value);
       break;
+    case ARG_USE_MMAP:
+      src->use_mmap = g_value_get_boolean (value);
+      break;
+    case ARG_PREFETCH:
+      src->prefetch = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -310,6 +386,12 @@ gst_multi_file_src_get_property (GObject * object, guint prop_id,
     case ARG_LOOP:
       g_value_set_boolean (value, src->loop);
       break;
+    case ARG_USE_MMAP:
+      g_value_set_boolean (value, src->use_mmap);
+      break;
+    case ARG_PREFETCH:
+      g_value_set_uint (value, src->prefetch);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -327,15 +409,206 @@ gst_multi_file_src_get_filename (GstMultiFileSrc * multifilesrc)
   return filename;
 }
 
+static GstBuffer *
+gst_multi_file_src_read_file (const gchar * filename, gboolean use_mmap,
+    gboolean fault_in, GError ** error)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new ();
+  if (use_mmap) {
+    GMappedFile *mapped;
+
+    mapped = g_mapped_file_new (filename, FALSE, error);
+    if (mapped == NULL)
+      goto failed;
+
+    /* the buffer keeps the file mapped */
+    GST_BUFFER_DATA (buf) = (guint8 *) g_mapped_file_get_contents (mapped);
+    GST_BUFFER_SIZE (buf) = g_mapped_file_get_length (mapped);
+    GST_BUFFER_MALLOCDATA (buf) = (guint8 *) mapped;
+    GST_BUFFER_FREE_FUNC (buf) = (GFreeFunc) g_mapped_file_unref;
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_READONLY);
+
+    if (fault_in) {
+      volatile guint8 sum = 0;
+      gsize i;
+
+      for (i = 0; i < GST_BUFFER_SIZE (buf); i += FAULT_IN_STRIDE)
+        sum += GST_BUFFER_DATA (buf)[i];
+    }
+  } else {
+    gchar *data;
+    gsize size;
+
+    if (!g_file_get_contents (filename, &data, &size, error))
+      goto failed;
+
+    GST_BUFFER_DATA (buf) = (unsigned char *) data;
+    GST_BUFFER_MALLOCDATA (buf) = GST_BUFFER_DATA (buf);
+    GST_BUFFER_SIZE (buf) = size;
+  }
+
+  return buf;
+
+failed:
+  gst_buffer_unref (buf);
+  return NULL;
+}
+
+static void
+gst_multi_file_src_prefetch (gpointer data, gpointer user_data)
+{
+  GstMultiFileSrcLoad *load = data;
+  GstMultiFileSrc *src = user_data;
+  GstBuffer *buf;
+  GError *error = NULL;
+
+  buf = gst_multi_file_src_read_file (load->filename, load->use_mmap, TRUE,
+      &error);
+
+  g_mutex_lock (src->lock);
+  load->buffer = buf;
+  load->error = error;
+  load->done = TRUE;
+  g_cond_broadcast (src->cond);
+  g_mutex_unlock (src->lock);
+}
+
+/* with the lock */
+static void
+gst_multi_file_src_queue_load (GstMultiFileSrc * src, gint index)
+{
+  GstMultiFileSrcLoad *load;
+
+  load = g_slice_new0 (GstMultiFileSrcLoad);
+  load->index = index;
+  load->filename = g_strdup_printf (src->filename, index);
+  load->use_mmap = src->use_mmap;
+
+  g_queue_push_tail (src->loads, load);
+  g_thread_pool_push (src->pool, load, NULL);
+}
+
+/* with the lock, waits until the prefetch thread is done with the load */
+static void
+gst_multi_file_src_free_load (GstMultiFileSrc * src, GstMultiFileSrcLoad * load)
+{
+  while (!load->done)
+    g_cond_wait (src->cond, src->lock);
+
+  if (load->buffer)
+    gst_buffer_unref (load->buffer);
+  if (load->error)
+    g_error_free (load->error);
+  g_free (load->filename);
+  g_slice_free (GstMultiFileSrcLoad, load);
+}
+
+/* with the lock */
+static void
+gst_multi_file_src_flush_loads (GstMultiFileSrc * src)
+{
+  GstMultiFileSrcLoad *load;
+
+  while ((load = g_queue_pop_head (src->loads)))
+    gst_multi_file_src_free_load (src, load);
+}
+
+/* Returns the contents of the file for the current index, from the prefetch
+ * threads if they are running */
+static GstBuffer *
+gst_multi_file_src_load (GstMultiFileSrc * src, const gchar * filename,
+    GError ** error)
+{
+  GstMultiFileSrcLoad *load;
+  GstBuffer *buf;
+
+  if (src->pool == NULL)
+    return gst_multi_file_src_read_file (filename, src->use_mmap, FALSE,
+        error);
+
+  g_mutex_lock (src->lock);
+  /* the index was changed or wrapped around differently than expected */
+  load = g_queue_peek_head (src->loads);
+  if (load && load->index != src->index) {
+    GST_DEBUG_OBJECT (src, "dropping files prefetched from index %d",
+        load->index);
+    gst_multi_file_src_flush_loads (src);
+  }
+
+  if (g_queue_is_empty (src->loads))
+    gst_multi_file_src_queue_load (src, src->index);
+  while (g_queue_get_length (src->loads) <= src->prefetch) {
+    gint index;
+
+    load = g_queue_peek_tail (src->loads);
+    index = load->index + 1;
+    if (src->stop_index != -1 && index >= src->stop_index)
+      index = src->start_index;
+    gst_multi_file_src_queue_load (src, index);
+  }
+
+  load = g_queue_pop_head (src->loads);
+  while (!load->done)
+    g_cond_wait (src->cond, src->lock);
+
+  buf = load->buffer;
+  load->buffer = NULL;
+  g_propagate_error (error, load->error);
+  load->error = NULL;
+  gst_multi_file_src_free_load (src, load);
+  g_mutex_unlock (src->lock);
+
+  return buf;
+}
+
+static gboolean
+gst_multi_file_src_start (GstBaseSrc * basesrc)
+{
+  GstMultiFileSrc *src = GST_MULTI_FILE_SRC (basesrc);
+  GError *err = NULL;
+
+  if (src->prefetch == 0)
+    return TRUE;
+
+  GST_DEBUG_OBJECT (src, "prefetching %u files", src->prefetch);
+  src->pool = g_thread_pool_new (gst_multi_file_src_prefetch, src,
+      src->prefetch, TRUE, &err);
+  if (src->pool == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, FAILED,
+        ("Failed to start the prefetch threads"), ("%s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_multi_file_src_stop (GstBaseSrc * basesrc)
+{
+  GstMultiFileSrc *src = GST_MULTI_FILE_SRC (basesrc);
+
+  if (src->pool) {
+    g_mutex_lock (src->lock);
+    gst_multi_file_src_flush_loads (src);
+    g_mutex_unlock (src->lock);
+
+    g_thread_pool_free (src->pool, FALSE, TRUE);
+    src->pool = NULL;
+  }
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_multi_file_src_create (GstPushSrc * src, GstBuffer ** buffer)
 {
   GstMultiFileSrc *multifilesrc;
   gsize size;
-  gchar *data;
   gchar *filename;
   GstBuffer *buf;
-  gboolean ret;
   GError *error = NULL;
 
   multifilesrc = GST_MULTI_FILE_SRC (src);
@@ -347,8 +620,8 @@ gst_multi_file_src_create (GstPushSrc * src, GstBuffer ** buffer)
 
   GST_DEBUG_OBJECT (multifilesrc, "reading from file \"%s\".", filename);
 
-  ret = g_file_get_contents (filename, &data, &size, &error);
-  if (!ret) {
+  buf = gst_multi_file_src_load (multifilesrc, filename, &error);
+  if (buf == NULL) {
     if (multifilesrc->successful_read) {
       /* If we've read at least one buffer successfully, not finding the
        * next file is EOS. */
@@ -361,8 +634,8 @@ gst_multi_file_src_create (GstPushSrc * src, GstBuffer ** buffer)
         multifilesrc->index = multifilesrc->start_index;
 
         filename = gst_multi_file_src_get_filename (multifilesrc);
-        ret = g_file_get_contents (filename, &data, &size, &error);
-        if (!ret) {
+        buf = gst_multi_file_src_load (multifilesrc, filename, &error);
+        if (buf == NULL) {
           g_free (filename);
           if (error != NULL)
             g_error_free (error);
@@ -384,10 +657,7 @@ gst_multi_file_src_create (GstPushSrc * src, GstBuffer ** buffer)
     multifilesrc->index = multifilesrc->start_index;
   }
 
-  buf = gst_buffer_new ();
-  GST_BUFFER_DATA (buf) = (unsigned char *) data;
-  GST_BUFFER_MALLOCDATA (buf) = GST_BUFFER_DATA (buf);
-  GST_BUFFER_SIZE (buf) = size;
+  size = GST_BUFFER_SIZE (buf);
   GST_BUFFER_OFFSET (buf) = multifilesrc->offset;
   GST_BUFFER_OFFSET_END (buf) = multifilesrc->offset + size;
   multifilesrc->offset += size;
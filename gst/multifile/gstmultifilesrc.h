@@ -56,6 +56,15 @@ struct _GstMultiFileSrc
 
   GstCaps *caps;
   gboolean successful_read;
+
+  gboolean use_mmap;
+  guint prefetch;
+
+  /* files that are loaded ahead of the streaming thread, in index order */
+  GThreadPool *pool;
+  GQueue *loads;
+  GMutex *lock;
+  GCond *cond;
 };
 
 struct _GstMultiFileSrcClass
@@ -29,6 +29,10 @@
  * (and expects) shell-style wildcards (but only for the filename, not for
  * directories). The results will be sorted.
  *
+ * Alternatively the parts can be read from an index written by
+ * #GstMultiFileSink, see #GstSplitFileSrc:index-location. Time seeks then go
+ * straight to the right part, and the duration in time is known.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -50,7 +54,24 @@
 #include "gstsplitfilesrc.h"
 #include "patternspec.h"
 
+#include <glib/gstdio.h>
+
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef G_OS_WIN32
+#include <io.h>                 /* for close, read and lseek */
+#define lseek _lseeki64
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 #ifdef G_OS_WIN32
 #define DEFAULT_PATTERN_MATCH_MODE MATCH_MODE_UTF8
@@ -60,10 +81,17 @@
 
 enum
 {
-  PROP_LOCATION = 1
+  PROP_LOCATION = 1,
+  PROP_MAX_OPEN_FILES,
+  PROP_INDEX_LOCATION
 };
 
 #define DEFAULT_LOCATION NULL
+#define DEFAULT_INDEX_LOCATION NULL
+#define DEFAULT_MAX_OPEN_FILES 16
+
+/* number of threads querying the sizes of the parts in start */
+#define STAT_THREADS 16
 
 static void gst_split_file_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -79,6 +107,10 @@ static gboolean gst_split_file_src_get_size (GstBaseSrc * basesrc, guint64 * s);
 static gboolean gst_split_file_src_unlock (GstBaseSrc * basesrc);
 static GstFlowReturn gst_split_file_src_create (GstBaseSrc * basesrc,
     guint64 offset, guint size, GstBuffer ** buffer);
+static gboolean gst_split_file_src_prepare_seek_segment (GstBaseSrc * basesrc,
+    GstEvent * event, GstSegment * segment);
+static gboolean gst_split_file_src_query (GstBaseSrc * basesrc,
+    GstQuery * query);
 
 static GstStaticPadTemplate gst_split_file_src_pad_template =
 GST_STATIC_PAD_TEMPLATE ("src",
@@ -133,6 +165,38 @@ gst_split_file_src_class_init (GstSplitFileSrcClass * klass)
           "matching. The results will be sorted." WIN32_BLURB,
           DEFAULT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSplitFileSrc:max-open-files
+   *
+   * Maximum number of parts that are kept open. The parts are only opened
+   * when they are read from, and the least recently used part is closed
+   * when another one needs to be opened.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_OPEN_FILES,
+      g_param_spec_uint ("max-open-files", "Max Open Files",
+          "Maximum number of file parts that are kept open", 1, G_MAXINT,
+          DEFAULT_MAX_OPEN_FILES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSplitFileSrc:index-location
+   *
+   * Location of an index written by #GstMultiFileSink:index-location. The
+   * parts are taken from the index instead of the location pattern, and
+   * seeks in time go straight to the part with the closest key frame
+   * before the seek position. Times in seeks and queries are relative to the
+   * start of the first part, so they go from 0 to the duration even when
+   * the oldest parts were removed.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index Location",
+          "Location of an index of the parts written by multifilesink. If "
+          "set, it is used instead of the location pattern" WIN32_BLURB,
+          DEFAULT_INDEX_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_split_file_src_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_split_file_src_stop);
   gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gst_split_file_src_create);
@@ -142,12 +206,17 @@ gst_split_file_src_class_init (GstSplitFileSrcClass * klass)
       GST_DEBUG_FUNCPTR (gst_split_file_src_can_seek);
   gstbasesrc_class->check_get_range =
       GST_DEBUG_FUNCPTR (gst_split_file_src_check_get_range);
+  gstbasesrc_class->prepare_seek_segment =
+      GST_DEBUG_FUNCPTR (gst_split_file_src_prepare_seek_segment);
+  gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_split_file_src_query);
 }
 
 static void
 gst_split_file_src_init (GstSplitFileSrc * splitfilesrc,
     GstSplitFileSrcClass * g_class)
 {
+  splitfilesrc->max_open_files = DEFAULT_MAX_OPEN_FILES;
+  splitfilesrc->open_parts = g_queue_new ();
 }
 
 static void
@@ -157,6 +226,11 @@ gst_split_file_src_finalize (GObject * obj)
 
   g_free (src->location);
   src->location = NULL;
+  g_free (src->index_location);
+  src->index_location = NULL;
+
+  g_queue_free (src->open_parts);
+  src->open_parts = NULL;
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -176,16 +250,7 @@ gst_split_file_src_check_get_range (GstBaseSrc * basesrc)
 static gboolean
 gst_split_file_src_unlock (GstBaseSrc * basesrc)
 {
-  /* This is not actually that useful, since all normal file
-   * operations are fully blocking anyway */
-#if 0
-  GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
-
-  GST_DEBUG_OBJECT (src, "cancelling pending I/O operation if there is one");
-  /* g_cancellable_cancel (src->cancellable); */
-  GST_DEBUG_OBJECT (src, "done");
-#endif
-
+  /* Nothing to do, all file operations are fully blocking anyway */
   return TRUE;
 }
 
@@ -217,6 +282,17 @@ gst_split_file_src_set_property (GObject * object, guint prop_id,
 #endif
       GST_OBJECT_UNLOCK (src);
       break;
+    case PROP_MAX_OPEN_FILES:
+      GST_OBJECT_LOCK (src);
+      src->max_open_files = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (src);
+      g_free (src->index_location);
+      src->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -235,6 +311,16 @@ gst_split_file_src_get_property (GObject * object, guint prop_id,
       g_value_set_string (value, src->location);
       GST_OBJECT_UNLOCK (src);
       break;
+    case PROP_MAX_OPEN_FILES:
+      GST_OBJECT_LOCK (src);
+      g_value_set_uint (value, src->max_open_files);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (src);
+      g_value_set_string (value, src->index_location);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -319,17 +405,186 @@ no_matches:
   }
 }
 
+/* stat of one part, done by the stat threads */
+typedef struct
+{
+  const gchar *path;
+  guint64 size;
+  gint err;                     /* errno of the failed stat, or 0 */
+} GstSplitFileSrcStat;
+
+static void
+gst_split_file_src_stat_part (gpointer data, gpointer user_data)
+{
+  GstSplitFileSrcStat *part_stat = data;
+  struct stat buf;
+
+  if (g_stat (part_stat->path, &buf) != 0)
+    part_stat->err = errno;
+  else if (S_ISDIR (buf.st_mode))
+    part_stat->err = EISDIR;
+  else
+    part_stat->size = buf.st_size;
+}
+
+/* Gets the sizes of all parts. This is done in parallel since every stat
+ * may need a round trip to the server on network file systems. */
+static void
+gst_split_file_src_stat_parts (GstSplitFileSrc * src,
+    GstSplitFileSrcStat * stats, guint n_stats)
+{
+  GThreadPool *pool = NULL;
+  guint i;
+
+  if (n_stats > 1) {
+    pool = g_thread_pool_new (gst_split_file_src_stat_part, NULL,
+        MIN (n_stats, STAT_THREADS), FALSE, NULL);
+  }
+
+  GST_DEBUG_OBJECT (src, "querying the size of %u parts %s", n_stats,
+      pool ? "in parallel" : "serially");
+
+  for (i = 0; i < n_stats; ++i) {
+    if (pool)
+      g_thread_pool_push (pool, &stats[i], NULL);
+    else
+      gst_split_file_src_stat_part (&stats[i], NULL);
+  }
+
+  /* waits until all parts are done */
+  if (pool)
+    g_thread_pool_free (pool, FALSE, TRUE);
+}
+
+/* parses a number or '-' for none, followed by a space */
+static gboolean
+gst_split_file_src_parse_index_field (gchar ** p, guint64 * val)
+{
+  gchar *end;
+
+  if (**p == '-') {
+    *val = GST_CLOCK_TIME_NONE;
+    end = *p + 1;
+  } else if (g_ascii_isdigit (**p)) {
+    *val = g_ascii_strtoull (*p, &end, 10);
+  } else {
+    return FALSE;
+  }
+
+  if (*end != ' ')
+    return FALSE;
+
+  *p = end + 1;
+  return TRUE;
+}
+
+/* Reads the parts and their time ranges from an index written by
+ * multifilesink, instead of looking for the files and querying their
+ * sizes */
+static gboolean
+gst_split_file_src_read_index (GstSplitFileSrc * src, const gchar * location,
+    GError ** err)
+{
+  GArray *parts;
+  gchar *contents, *dirname;
+  gchar **lines;
+  GstClockTime time = 0;
+  guint64 offset = 0;
+  guint i;
+
+  if (!g_file_get_contents (location, &contents, NULL, err))
+    return FALSE;
+
+  GST_INFO_OBJECT (src, "reading the parts from index '%s'", location);
+
+  dirname = g_path_get_dirname (location);
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  parts = g_array_new (FALSE, TRUE, sizeof (GstFilePart));
+  for (i = 0; lines[i] != NULL; ++i) {
+    GstFilePart part = { -1, };
+    gchar *p = lines[i];
+    guint64 size;
+
+    if (*p == '\0' || *p == '#')
+      continue;
+
+    if (!gst_split_file_src_parse_index_field (&p, &part.start_time) ||
+        !gst_split_file_src_parse_index_field (&p, &part.stop_time) ||
+        !gst_split_file_src_parse_index_field (&p, &size) ||
+        !gst_split_file_src_parse_index_field (&p, &part.keyframe) ||
+        size == G_MAXUINT64 || *p == '\0')
+      goto invalid_line;
+
+    /* parts without timestamps continue where the previous one ended, so
+     * that the times can be searched */
+    if (!GST_CLOCK_TIME_IS_VALID (part.start_time) || part.start_time < time)
+      part.start_time = time;
+    if (!GST_CLOCK_TIME_IS_VALID (part.stop_time) ||
+        part.stop_time < part.start_time)
+      part.stop_time = part.start_time;
+    time = part.stop_time;
+
+    part.path = g_build_filename (dirname, p, NULL);
+    part.start = offset;
+    part.stop = offset + size - 1;
+    offset += size;
+
+    GST_DEBUG ("[%010" G_GUINT64_FORMAT "-%010" G_GUINT64_FORMAT "] [%"
+        GST_TIME_FORMAT "-%" GST_TIME_FORMAT "] %s", part.start, part.stop,
+        GST_TIME_ARGS (part.start_time), GST_TIME_ARGS (part.stop_time),
+        part.path);
+
+    g_array_append_val (parts, part);
+  }
+
+  if (parts->len == 0)
+    goto no_parts;
+
+  src->num_parts = parts->len;
+  src->parts = (GstFilePart *) g_array_free (parts, FALSE);
+
+  g_strfreev (lines);
+  g_free (dirname);
+  return TRUE;
+
+/* ERRORS */
+invalid_line:
+  {
+    g_set_error (err, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "Invalid line %u in the index.", i + 1);
+    goto failed;
+  }
+no_parts:
+  {
+    g_set_error_literal (err, G_FILE_ERROR, G_FILE_ERROR_NOENT,
+        "The index contains no files.");
+    goto failed;
+  }
+failed:
+  {
+    for (i = 0; i < parts->len; ++i)
+      g_free (g_array_index (parts, GstFilePart, i).path);
+    g_array_free (parts, TRUE);
+    g_strfreev (lines);
+    g_free (dirname);
+    return FALSE;
+  }
+}
+
 static gboolean
 gst_split_file_src_start (GstBaseSrc * basesrc)
 {
   GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
-  GCancellable *cancel;
+  GstSplitFileSrcStat *stats = NULL;
   gboolean ret = FALSE;
   guint64 offset;
   GError *err = NULL;
   gchar *basename = NULL;
   gchar *dirname = NULL;
-  gchar **files;
+  gchar *index_location;
+  gchar **files = NULL;
   guint i;
 
   GST_OBJECT_LOCK (src);
@@ -337,100 +592,87 @@ gst_split_file_src_start (GstBaseSrc * basesrc)
     basename = g_path_get_basename (src->location);
     dirname = g_path_get_dirname (src->location);
   }
+  index_location = g_strdup (src->index_location);
   GST_OBJECT_UNLOCK (src);
 
+  if (index_location != NULL) {
+    if (!gst_split_file_src_read_index (src, index_location, &err))
+      goto index_error;
+    src->cur_part = 0;
+    ret = TRUE;
+    goto done;
+  }
+
   files = gst_split_file_src_find_files (src, dirname, basename, &err);
 
   if (files == NULL || *files == NULL)
     goto no_files;
 
   src->num_parts = g_strv_length (files);
-  src->parts = g_new0 (GstFilePart, src->num_parts);
 
-  cancel = src->cancellable;
+  /* the parts are opened when they are read from */
+  stats = g_new0 (GstSplitFileSrcStat, src->num_parts);
+  for (i = 0; i < src->num_parts; ++i)
+    stats[i].path = files[i];
+  gst_split_file_src_stat_parts (src, stats, src->num_parts);
+
+  src->parts = g_new0 (GstFilePart, src->num_parts);
 
   offset = 0;
   for (i = 0; i < src->num_parts; ++i) {
-    GFileInputStream *stream;
-    GFileInfo *info;
-    goffset size;
-    GFile *file;
-
-    file = g_file_new_for_path (files[i]);
-    stream = g_file_read (file, cancel, &err);
-    g_object_unref (file);
-
-    if (err != NULL)
-      goto open_read_error;
-
-    info = g_file_input_stream_query_info (stream, "standard::*", NULL, &err);
-    if (err != NULL) {
-      g_object_unref (stream);
+    if (stats[i].err != 0)
       goto query_info_error;
-    }
-
-    size = g_file_info_get_size (info);
-    g_object_unref (info);
 
-    src->parts[i].stream = stream;
+    src->parts[i].fd = -1;
     src->parts[i].path = g_strdup (files[i]);
+    src->parts[i].start_time = GST_CLOCK_TIME_NONE;
+    src->parts[i].stop_time = GST_CLOCK_TIME_NONE;
+    src->parts[i].keyframe = GST_CLOCK_TIME_NONE;
     src->parts[i].start = offset;
-    src->parts[i].stop = offset + size - 1;
+    src->parts[i].stop = offset + stats[i].size - 1;
 
     GST_DEBUG ("[%010" G_GUINT64_FORMAT "-%010" G_GUINT64_FORMAT "] %s",
         src->parts[i].start, src->parts[i].stop, src->parts[i].path);
 
-    offset += size;
+    offset += stats[i].size;
   }
 
-  GST_INFO ("Successfully opened %u file parts for reading", src->num_parts);
+  GST_INFO ("Successfully found %u file parts for reading", src->num_parts);
 
   src->cur_part = 0;
 
-  src->cancellable = g_cancellable_new ();
-
   ret = TRUE;
 
 done:
   if (err != NULL)
     g_error_free (err);
+  g_free (stats);
   g_strfreev (files);
   g_free (basename);
   g_free (dirname);
+  g_free (index_location);
   return ret;
 
 /* ERRORS */
-no_files:
+index_error:
   {
-    if (err->code == G_IO_ERROR_CANCELLED)
-      goto cancelled;
-
     GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, ("%s", err->message),
-        ("Failed to find files in '%s' for pattern '%s'",
-            GST_STR_NULL (dirname), GST_STR_NULL (basename)));
+        ("Failed to read the index '%s'", index_location));
     goto done;
   }
-open_read_error:
+no_files:
   {
-    if (err->code == G_IO_ERROR_CANCELLED)
-      goto cancelled;
-
     GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, ("%s", err->message),
-        ("Failed to open file '%s' for reading", files[i]));
+        ("Failed to find files in '%s' for pattern '%s'",
+            GST_STR_NULL (dirname), GST_STR_NULL (basename)));
     goto done;
   }
 query_info_error:
   {
-    if (err->code == G_IO_ERROR_CANCELLED)
-      goto cancelled;
-
-    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, ("%s", err->message),
+    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, ("%s",
+            g_strerror (stats[i].err)),
         ("Failed to query info for file '%s'", files[i]));
-    goto done;
-  }
-cancelled:
-  {
-    GST_DEBUG_OBJECT (src, "I/O operation cancelled from another thread");
+    gst_split_file_src_stop (basesrc);
     goto done;
   }
 }
@@ -439,41 +681,269 @@ static gboolean
 gst_split_file_src_stop (GstBaseSrc * basesrc)
 {
   GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
+  GstFilePart *part;
   guint i;
 
-  for (i = 0; i < src->num_parts; ++i) {
-    if (src->parts[i].stream != NULL)
-      g_object_unref (src->parts[i].stream);
-    g_free (src->parts[i].path);
+  while ((part = g_queue_pop_head (src->open_parts))) {
+    close (part->fd);
+    part->fd = -1;
   }
+
+  for (i = 0; i < src->num_parts; ++i)
+    g_free (src->parts[i].path);
   g_free (src->parts);
   src->parts = NULL;
   src->num_parts = 0;
 
-  g_object_unref (src->cancellable);
-  src->cancellable = NULL;
-
   return TRUE;
 }
 
+static gint
+gst_split_file_src_part_compare (const GstFilePart * part,
+    const guint64 * offset, gpointer user_data)
+{
+  if (*offset < part->start)
+    return 1;
+  /* empty parts have stop == start - 1 and never contain the offset */
+  if (*offset - part->start >= part->stop - part->start + 1)
+    return -1;
+  return 0;
+}
+
 static gboolean
 gst_split_file_src_find_part_for_offset (GstSplitFileSrc * src, guint64 offset,
     guint * part_number)
 {
   GstFilePart *part;
-  guint i;
 
-  /* TODO: could use gst_util_array_binary_search() here */
-  part = src->parts;
-  for (i = 0; i < src->num_parts; ++i) {
-    if (offset >= part->start && offset <= part->stop) {
-      *part_number = i;
+  part = gst_util_array_binary_search (src->parts, src->num_parts,
+      sizeof (GstFilePart),
+      (GCompareDataFunc) gst_split_file_src_part_compare,
+      GST_SEARCH_MODE_EXACT, &offset, NULL);
+  if (part == NULL)
+    return FALSE;
+
+  *part_number = part - src->parts;
+  return TRUE;
+}
+
+/* only parts read from an index have times */
+static gboolean
+gst_split_file_src_has_times (GstSplitFileSrc * src)
+{
+  return src->num_parts > 0 &&
+      GST_CLOCK_TIME_IS_VALID (src->parts[0].start_time);
+}
+
+static gint
+gst_split_file_src_part_compare_time (const GstFilePart * part,
+    const GstClockTime * time, gpointer user_data)
+{
+  if (part->start_time < *time)
+    return -1;
+  if (part->start_time > *time)
+    return 1;
+  return 0;
+}
+
+/* the last part that starts at or before time, which is relative to the
+ * start of the first part like all times outside of the index */
+static GstFilePart *
+gst_split_file_src_find_part_for_time (GstSplitFileSrc * src,
+    GstClockTime time)
+{
+  GstFilePart *part;
+
+  time += src->parts[0].start_time;
+  part = gst_util_array_binary_search (src->parts, src->num_parts,
+      sizeof (GstFilePart),
+      (GCompareDataFunc) gst_split_file_src_part_compare_time,
+      GST_SEARCH_MODE_BEFORE, &time, NULL);
+
+  return part ? part : src->parts;
+}
+
+/* the part to start reading at to decode from time on, which has a key
+ * frame before time */
+static GstFilePart *
+gst_split_file_src_find_seek_part (GstSplitFileSrc * src, GstClockTime time)
+{
+  GstFilePart *part;
+
+  part = gst_split_file_src_find_part_for_time (src, time);
+  time += src->parts[0].start_time;
+  while (part > src->parts && (!GST_CLOCK_TIME_IS_VALID (part->keyframe) ||
+          part->keyframe > time))
+    --part;
+
+  return part;
+}
+
+static gboolean
+gst_split_file_src_prepare_seek_segment (GstBaseSrc * basesrc,
+    GstEvent * event, GstSegment * segment)
+{
+  GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
+  GstSeekType cur_type, stop_type;
+  GstSeekFlags flags;
+  GstFormat format;
+  gdouble rate;
+  gint64 cur, stop;
+  gboolean update;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &cur_type, &cur,
+      &stop_type, &stop);
+
+  if (format != GST_FORMAT_TIME || !gst_split_file_src_has_times (src))
+    return GST_BASE_SRC_CLASS (parent_class)->prepare_seek_segment (basesrc,
+        event, segment);
+
+  if ((cur_type != GST_SEEK_TYPE_SET && cur_type != GST_SEEK_TYPE_NONE) ||
+      (stop_type != GST_SEEK_TYPE_SET && stop_type != GST_SEEK_TYPE_NONE)) {
+    GST_DEBUG_OBJECT (src, "only absolute time seeks are supported");
+    return FALSE;
+  }
+
+  /* seek straight to the parts with the start and the stop */
+  if (cur_type == GST_SEEK_TYPE_SET && cur != -1)
+    cur = gst_split_file_src_find_seek_part (src, cur)->start;
+  if (stop_type == GST_SEEK_TYPE_SET && stop != -1)
+    stop = gst_split_file_src_find_part_for_time (src, stop)->stop + 1;
+
+  GST_DEBUG_OBJECT (src, "time seek to bytes %" G_GINT64_FORMAT " - %"
+      G_GINT64_FORMAT, cur, stop);
+
+  gst_segment_set_seek (segment, rate, GST_FORMAT_BYTES, flags, cur_type, cur,
+      stop_type, stop, &update);
+
+  return TRUE;
+}
+
+static gboolean
+gst_split_file_src_query (GstBaseSrc * basesrc, GstQuery * query)
+{
+  GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
+
+  if (!gst_split_file_src_has_times (src))
+    goto done;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_DURATION:{
+      GstFormat format;
+
+      gst_query_parse_duration (query, &format, NULL);
+      if (format != GST_FORMAT_TIME)
+        break;
+
+      gst_query_set_duration (query, format,
+          src->parts[src->num_parts - 1].stop_time - src->parts[0].start_time);
       return TRUE;
     }
-    ++part;
+    case GST_QUERY_CONVERT:{
+      GstFormat src_format, dest_format;
+      gint64 src_value, dest_value;
+      guint part_number;
+
+      gst_query_parse_convert (query, &src_format, &src_value, &dest_format,
+          NULL);
+      if (src_value == -1)
+        break;
+
+      if (src_format == GST_FORMAT_TIME && dest_format == GST_FORMAT_BYTES) {
+        dest_value = gst_split_file_src_find_seek_part (src, src_value)->start;
+      } else if (src_format == GST_FORMAT_BYTES &&
+          dest_format == GST_FORMAT_TIME) {
+        if (!gst_split_file_src_find_part_for_offset (src, src_value,
+                &part_number))
+          break;
+        dest_value = src->parts[part_number].start_time -
+            src->parts[0].start_time;
+      } else {
+        break;
+      }
+
+      gst_query_set_convert (query, src_format, src_value, dest_format,
+          dest_value);
+      return TRUE;
+    }
+    default:
+      break;
+  }
+
+done:
+  return GST_BASE_SRC_CLASS (parent_class)->query (basesrc, query);
+}
+
+/* Makes sure the part is open, closing the least recently used parts
+ * when too many are open already */
+static gboolean
+gst_split_file_src_open_part (GstSplitFileSrc * src, GstFilePart * part)
+{
+  guint max_open_files;
+
+  if (part->fd != -1) {
+    if (g_queue_peek_head (src->open_parts) != part) {
+      g_queue_remove (src->open_parts, part);
+      g_queue_push_head (src->open_parts, part);
+    }
+    return TRUE;
+  }
+
+  GST_OBJECT_LOCK (src);
+  max_open_files = src->max_open_files;
+  GST_OBJECT_UNLOCK (src);
+
+  while (g_queue_get_length (src->open_parts) >= max_open_files) {
+    GstFilePart *lru = g_queue_pop_tail (src->open_parts);
+
+    GST_LOG_OBJECT (src, "closing %s", lru->path);
+    close (lru->fd);
+    lru->fd = -1;
+  }
+
+  GST_DEBUG_OBJECT (src, "opening %s", part->path);
+  part->fd = g_open (part->path, O_RDONLY | O_BINARY, 0);
+  if (part->fd < 0) {
+    part->fd = -1;
+    return FALSE;
+  }
+
+  g_queue_push_head (src->open_parts, part);
+  return TRUE;
+}
+
+/* Reads size bytes from offset in the file, or less at the end of the file.
+ * Returns the number of bytes read, or -1 on errors. */
+static gssize
+gst_split_file_src_pread (gint fd, guint8 * data, gsize size, guint64 offset)
+{
+  gsize done = 0;
+
+#ifndef HAVE_PREAD
+  if (lseek (fd, offset, SEEK_SET) < 0)
+    return -1;
+#endif
+
+  while (done < size) {
+    gssize ret;
+
+#ifdef HAVE_PREAD
+    ret = pread (fd, data + done, size - done, offset + done);
+#else
+    ret = read (fd, data + done, size - done);
+#endif
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (ret == 0)
+      break;
+
+    done += ret;
   }
 
-  return FALSE;
+  return done;
 }
 
 static GstFlowReturn
@@ -481,26 +951,22 @@ gst_split_file_src_create (GstBaseSrc * basesrc, guint64 offset, guint size,
     GstBuffer ** buffer)
 {
   GstSplitFileSrc *src = GST_SPLIT_FILE_SRC (basesrc);
-  GstFilePart cur_part;
-  GInputStream *stream;
-  GCancellable *cancel;
-  GSeekable *seekable;
+  GstFilePart *cur_part;
   GstBuffer *buf;
-  GError *err = NULL;
   guint64 read_offset;
   guint8 *data;
   guint to_read;
 
-  cur_part = src->parts[src->cur_part];
-  if (offset < cur_part.start || offset > cur_part.stop) {
+  cur_part = &src->parts[src->cur_part];
+  if (gst_split_file_src_part_compare (cur_part, &offset, NULL) != 0) {
     if (!gst_split_file_src_find_part_for_offset (src, offset, &src->cur_part))
       return GST_FLOW_UNEXPECTED;
-    cur_part = src->parts[src->cur_part];
+    cur_part = &src->parts[src->cur_part];
   }
 
   GST_LOG_OBJECT (src, "current part: %u (%" G_GUINT64_FORMAT " - "
-      "%" G_GUINT64_FORMAT ", %s)", src->cur_part, cur_part.start,
-      cur_part.stop, cur_part.path);
+      "%" G_GUINT64_FORMAT ", %s)", src->cur_part, cur_part->start,
+      cur_part->stop, cur_part->path);
 
   buf = gst_buffer_new_and_alloc (size);
 
@@ -508,35 +974,29 @@ gst_split_file_src_create (GstBaseSrc * basesrc, guint64 offset, guint size,
 
   data = GST_BUFFER_DATA (buf);
 
-  cancel = src->cancellable;
-
   while (size > 0) {
     guint64 bytes_to_end_of_part;
-    gsize read = 0;
+    gssize read;
 
     /* we want the offset into the file part */
-    read_offset = offset - cur_part.start;
-
-    GST_LOG ("Reading part %03u from offset %" G_GUINT64_FORMAT " (%s)",
-        src->cur_part, read_offset, cur_part.path);
+    read_offset = offset - cur_part->start;
 
-    /* FIXME: only seek when needed (hopefully gio is smart) */
-    seekable = G_SEEKABLE (cur_part.stream);
-    if (!g_seekable_seek (seekable, read_offset, G_SEEK_SET, cancel, &err))
-      goto seek_failed;
+    if (!gst_split_file_src_open_part (src, cur_part))
+      goto open_failed;
 
-    GST_LOG_OBJECT (src, "now: %" G_GUINT64_FORMAT, g_seekable_tell (seekable));
+    GST_LOG ("Reading part %03u from offset %" G_GUINT64_FORMAT " (%s)",
+        src->cur_part, read_offset, cur_part->path);
 
-    bytes_to_end_of_part = (cur_part.stop - cur_part.start) + 1 - read_offset;
+    bytes_to_end_of_part = (cur_part->stop - cur_part->start) + 1 -
+        read_offset;
     to_read = MIN (size, bytes_to_end_of_part);
 
     GST_LOG_OBJECT (src, "reading %u bytes from part %u (bytes to end of "
         "part: %u)", to_read, src->cur_part, (guint) bytes_to_end_of_part);
 
-    stream = G_INPUT_STREAM (cur_part.stream);
-
     /* NB: we won't try to read beyond EOF */
-    if (!g_input_stream_read_all (stream, data, to_read, &read, cancel, &err))
+    read = gst_split_file_src_pread (cur_part->fd, data, to_read, read_offset);
+    if (read < 0)
       goto read_failed;
 
     GST_LOG_OBJECT (src, "read %u bytes", (guint) read);
@@ -551,20 +1011,19 @@ gst_split_file_src_create (GstBaseSrc * basesrc, guint64 offset, guint size,
 
     GST_LOG_OBJECT (src, "%u bytes left to read for this chunk", size);
 
+    if (src->cur_part == src->num_parts - 1) {
+      /* last file part, stop reading and truncate buffer */
+      GST_BUFFER_SIZE (buf) = offset - GST_BUFFER_OFFSET (buf);
+      break;
+    }
+
     /* corner case, this should never really happen (assuming basesrc clips
      * requests beyond the file size) */
-    if (read < to_read) {
-      if (src->cur_part == src->num_parts - 1) {
-        /* last file part, stop reading and truncate buffer */
-        GST_BUFFER_SIZE (buf) = offset - GST_BUFFER_OFFSET (buf);
-        break;
-      } else {
-        goto file_part_changed;
-      }
-    }
+    if (read < to_read)
+      goto file_part_changed;
 
     ++src->cur_part;
-    cur_part = src->parts[src->cur_part];
+    cur_part = &src->parts[src->cur_part];
   }
 
   GST_BUFFER_OFFSET_END (buf) = offset;
@@ -574,43 +1033,27 @@ gst_split_file_src_create (GstBaseSrc * basesrc, guint64 offset, guint size,
   return GST_FLOW_OK;
 
 /* ERRORS */
-seek_failed:
+open_failed:
   {
-    if (err->code == G_IO_ERROR_CANCELLED)
-      goto cancelled;
-
-    GST_ELEMENT_ERROR (src, RESOURCE, SEEK, (NULL),
-        ("Seek to %" G_GUINT64_FORMAT " in %s failed", read_offset,
-            cur_part.path));
-    g_error_free (err);
+    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, ("%s", g_strerror (errno)),
+        ("Failed to open file '%s' for reading", cur_part->path));
     gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
 read_failed:
   {
-    if (err->code == G_IO_ERROR_CANCELLED)
-      goto cancelled;
-
-    GST_ELEMENT_ERROR (src, RESOURCE, READ, ("%s", err->message),
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, ("%s", g_strerror (errno)),
         ("Read from %" G_GUINT64_FORMAT " in %s failed", read_offset,
-            cur_part.path));
-    g_error_free (err);
+            cur_part->path));
     gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
 file_part_changed:
   {
     GST_ELEMENT_ERROR (src, RESOURCE, READ,
-        ("Read error while reading file part %s", cur_part.path),
+        ("Read error while reading file part %s", cur_part->path),
         ("Short read in file part, file may have been modified since start"));
     gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
-cancelled:
-  {
-    GST_DEBUG_OBJECT (src, "I/O operation cancelled from another thread");
-    g_error_free (err);
-    gst_buffer_unref (buf);
-    return GST_FLOW_WRONG_STATE;
-  }
 }
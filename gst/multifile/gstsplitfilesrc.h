@@ -21,7 +21,6 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesrc.h>
-#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -42,10 +41,15 @@ typedef struct _GstSplitFileSrcClass GstSplitFileSrcClass;
 
 struct _GstFilePart
 {
-  GFileInputStream  *stream;
+  gint               fd;    /* -1 while the part is not open */
   gchar             *path;
   guint64            start; /* inclusive */
   guint64            stop;  /* inclusive */
+
+  /* from the index, GST_CLOCK_TIME_NONE without index */
+  GstClockTime       start_time;
+  GstClockTime       stop_time;
+  GstClockTime       keyframe;  /* of the first key frame */
 };
 
 struct _GstSplitFileSrc
@@ -53,13 +57,15 @@ struct _GstSplitFileSrc
   GstBaseSrc   parent;
 
   gchar       *location;  /* OBJECT_LOCK */
+  gchar       *index_location;  /* OBJECT_LOCK */
 
   GstFilePart *parts;
   guint        num_parts;
 
   guint        cur_part;  /* part used last (likely also to be used next) */
 
-  GCancellable *cancellable; /* so we can interrupt blocking operations */
+  guint        max_open_files;  /* OBJECT_LOCK */
+  GQueue      *open_parts;      /* open parts, most recently used first */
 };
 
 struct _GstSplitFileSrcClass
@@ -55,6 +55,9 @@
 GST_DEBUG_CATEGORY_STATIC (gst_multipart_demux_debug);
 #define GST_CAT_DEFAULT gst_multipart_demux_debug
 
+/* initial number of bytes to parse a part header from */
+#define HEADER_PEEK_SIZE 1024
+
 /* signals and args */
 enum
 {
@@ -381,18 +384,15 @@ get_mime_len (const guint8 * data, guint maxlen)
 }
 
 static gint
-multipart_parse_header (GstMultipartDemux * multipart)
+multipart_parse_header_data (GstMultipartDemux * multipart,
+    const guint8 * data, guint datalen)
 {
-  const guint8 *data;
   const guint8 *dataend;
   gchar *boundary;
   int boundary_len;
-  int datalen;
   guint8 *pos;
   guint8 *end, *next;
 
-  datalen = gst_adapter_available (multipart->adapter);
-  data = gst_adapter_peek (multipart->adapter, datalen);
   dataend = data + datalen;
 
   /* Skip leading whitespace, pos endposition should at least leave space for
@@ -482,25 +482,67 @@ wrong_header:
   }
 }
 
+static gint
+multipart_parse_header (GstMultipartDemux * multipart)
+{
+  guint avail, len;
+  gint res;
+
+  /* Headers are small, so only peek at the start of the adapter and grow
+   * that if needed. Peeking at everything would merge the buffers of the
+   * part behind the header. */
+  avail = gst_adapter_available (multipart->adapter);
+  len = MIN (avail, HEADER_PEEK_SIZE);
+  while (TRUE) {
+    res = multipart_parse_header_data (multipart,
+        gst_adapter_peek (multipart->adapter, len), len);
+    if (res != MULTIPART_NEED_MORE_DATA || len == avail)
+      return res;
+    len = MIN (avail, len * 2);
+  }
+}
+
+/* Compares the boundary with the data at offset in the adapter, which has
+ * to be available */
+static gboolean
+multipart_boundary_matches (GstMultipartDemux * multipart, guint offset)
+{
+  guint8 tmp[64];
+  guint i, n;
+
+  for (i = 0; i < multipart->boundary_len; i += n) {
+    n = MIN (sizeof (tmp), multipart->boundary_len - i);
+    gst_adapter_copy (multipart->adapter, tmp, offset + i, n);
+    if (memcmp (tmp, multipart->boundary + i, n) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
 static gint
 multipart_find_boundary (GstMultipartDemux * multipart, gint * datalen)
 {
   /* Adaptor is positioned at the start of the data */
-  const guint8 *data, *pos;
-  const guint8 *dataend;
+  GstAdapter *adapter = multipart->adapter;
+  guint32 mask, pattern;
+  guint avail, blen, pos;
   gint len;
 
   if (multipart->content_length >= 0) {
     /* fast path, known content length :) */
     len = multipart->content_length;
-    if (gst_adapter_available (multipart->adapter) >= len + 2) {
+    if (gst_adapter_available (adapter) >= len + 2) {
+      guint8 c;
+
       *datalen = len;
-      data = gst_adapter_peek (multipart->adapter, len + 1);
+      /* Only copy the byte behind the data, peeking would merge all buffers
+       * of the part */
+      gst_adapter_copy (adapter, &c, len, 1);
 
       /* If data[len] contains \r then assume a newline is \r\n */
-      if (data[len] == '\r')
+      if (c == '\r')
         len += 2;
-      else if (data[len] == '\n')
+      else if (c == '\n')
         len += 1;
       /* Don't check if boundary is actually there, but let the header parsing 
        * bail out if it isn't */
@@ -511,30 +553,53 @@ multipart_find_boundary (GstMultipartDemux * multipart, gint * datalen)
     }
   }
 
-  len = gst_adapter_available (multipart->adapter);
-  if (len == 0)
-    return MULTIPART_NEED_MORE_DATA;
-  data = gst_adapter_peek (multipart->adapter, len);
-  dataend = data + len;
-
-  for (pos = data + multipart->scanpos;
-      pos <= dataend - multipart->boundary_len - 2; pos++) {
-    if (*pos == '-' && pos[1] == '-' &&
-        !strncmp ((gchar *) pos + 2,
-            multipart->boundary, multipart->boundary_len)) {
+  /* Search for the leading -- and the first bytes of the boundary. The scan
+   * walks the buffers in the adapter without merging them and the position
+   * is kept between calls, so every byte is only looked at once. */
+  avail = gst_adapter_available (adapter);
+  blen = multipart->boundary_len;
+  pattern = ('-' << 24) | ('-' << 16) | ((guint8) multipart->boundary[0] << 8);
+  mask = 0xffffff00;
+  if (blen > 1) {
+    pattern |= (guint8) multipart->boundary[1];
+    mask = 0xffffffff;
+  }
+
+  pos = multipart->scanpos;
+  while (pos + blen + 2 <= avail) {
+    guint found;
+
+    found = gst_adapter_masked_scan_uint32 (adapter, mask, pattern, pos,
+        avail - pos);
+    if (found == (guint) - 1) {
+      /* the last 3 bytes can still be the start of a boundary */
+      pos = avail - 3;
+      break;
+    }
+    pos = found;
+    if (pos + blen + 2 > avail)
+      break;
+
+    if (multipart_boundary_matches (multipart, pos + 2)) {
       /* Found the boundary! Check if there was a newline before the boundary */
-      len = pos - data;
-      if (pos - 2 > data && pos[-2] == '\r')
-        len -= 2;
-      else if (pos - 1 > data && pos[-1] == '\n')
-        len -= 1;
+      len = pos;
+      if (pos > 1) {
+        guint8 nl[2];
+
+        gst_adapter_copy (adapter, nl, pos - 2, 2);
+        if (pos > 2 && nl[0] == '\r')
+          len -= 2;
+        else if (nl[1] == '\n')
+          len -= 1;
+      }
       *datalen = len;
 
       multipart->scanpos = 0;
-      return pos - data;
+      return pos;
     }
+    pos++;
   }
-  multipart->scanpos = pos - data;
+  multipart->scanpos = pos;
   return MULTIPART_NEED_MORE_DATA;
 }
 
@@ -556,12 +621,14 @@ gst_multipart_demux_chain (GstPad * pad, GstBuffer * buf)
 
   if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DISCONT)) {
     gst_adapter_clear (adapter);
+    multipart->scanpos = 0;
   }
   gst_adapter_push (adapter, buf);
 
   while (gst_adapter_available (adapter) > 0) {
     GstMultipartPad *srcpad;
     GstBuffer *outbuf;
+    GList *list;
     gboolean created;
     gint datalen;
 
@@ -588,9 +655,13 @@ gst_multipart_demux_chain (GstPad * pad, GstBuffer * buf)
       srcpad =
           gst_multipart_find_pad_by_mime (multipart,
           multipart->mime_type, &created);
-      outbuf = gst_adapter_take_buffer (adapter, datalen);
+      list = gst_adapter_take_list (adapter, datalen);
       gst_adapter_flush (adapter, size - datalen);
 
+      /* the first buffer of the part carries the metadata */
+      outbuf = gst_buffer_make_metadata_writable (list->data);
+      list->data = outbuf;
+
       gst_buffer_set_caps (outbuf, GST_PAD_CAPS (srcpad->pad));
       if (created) {
         GstTagList *tags;
@@ -612,7 +683,26 @@ gst_multipart_demux_chain (GstPad * pad, GstBuffer * buf)
           GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)));
       GST_DEBUG_OBJECT (multipart, "buffer has caps %" GST_PTR_FORMAT,
           GST_BUFFER_CAPS (outbuf));
-      res = gst_pad_push (srcpad->pad, outbuf);
+      if (list->next == NULL) {
+        g_list_free (list);
+        res = gst_pad_push (srcpad->pad, outbuf);
+      } else {
+        GstBufferList *buflist;
+        GstBufferListIterator *it;
+
+        /* The part spans several input buffers, push them as one group
+         * instead of merging them. Peers without buffer list support get
+         * them merged by the core. */
+        GST_DEBUG_OBJECT (multipart, "pushing part of %u buffers as list",
+            g_list_length (list));
+        buflist = gst_buffer_list_new ();
+        it = gst_buffer_list_iterate (buflist);
+        gst_buffer_list_iterator_add_group (it);
+        gst_buffer_list_iterator_add_list (it, list);
+        gst_buffer_list_iterator_free (it);
+
+        res = gst_pad_push_list (srcpad->pad, buflist);
+      }
       res = gst_multipart_combine_flows (multipart, srcpad, res);
       if (res != GST_FLOW_OK)
         break;
@@ -653,6 +743,7 @@ gst_multipart_demux_change_state (GstElement * element,
       g_free (multipart->mime_type);
       multipart->mime_type = NULL;
       gst_adapter_clear (multipart->adapter);
+      multipart->scanpos = 0;
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -43,14 +43,19 @@ GST_DEBUG_CATEGORY_STATIC (gst_multipart_mux_debug);
 #define GST_CAT_DEFAULT gst_multipart_mux_debug
 
 #define DEFAULT_BOUNDARY        "ThisRandomString"
+#define DEFAULT_BUFFER_LIST     FALSE
 
 enum
 {
   ARG_0,
-  ARG_BOUNDARY
+  ARG_BOUNDARY,
+  ARG_BUFFER_LIST
       /* FILL ME */
 };
 
+/* the footer behind the data of every part */
+static const gchar footer[] = "\r\n";
+
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -90,6 +95,7 @@ static GstStateChangeReturn gst_multipart_mux_change_state (GstElement *
 
 static GstFlowReturn gst_multipart_mux_collected (GstCollectPads * pads,
     GstMultipartMux * mux);
+static void gst_multipart_mux_clear_header (GstMultipartMux * mux);
 
 static void gst_multipart_mux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -155,6 +161,20 @@ gst_multipart_mux_class_init (GstMultipartMuxClass * klass)
       g_param_spec_string ("boundary", "Boundary", "Boundary string",
           DEFAULT_BOUNDARY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultipartMux:buffer-list:
+   *
+   * Push the header, data and footer of every part as one group of a buffer
+   * list instead of three buffers. Elements without buffer list support
+   * merge the group into one buffer, which copies the data.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_BUFFER_LIST,
+      g_param_spec_boolean ("buffer-list", "Buffer List",
+          "Push every part as one buffer list",
+          DEFAULT_BUFFER_LIST, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->request_new_pad = gst_multipart_mux_request_new_pad;
   gstelement_class->change_state = gst_multipart_mux_change_state;
 
@@ -179,6 +199,7 @@ gst_multipart_mux_init (GstMultipartMux * multipart_mux)
   gst_element_add_pad (GST_ELEMENT (multipart_mux), multipart_mux->srcpad);
 
   multipart_mux->boundary = g_strdup (DEFAULT_BOUNDARY);
+  multipart_mux->buffer_list = DEFAULT_BUFFER_LIST;
 
   multipart_mux->collect = gst_collect_pads_new ();
   gst_collect_pads_set_function (multipart_mux->collect,
@@ -194,6 +215,7 @@ gst_multipart_mux_finalize (GObject * object)
   multipart_mux = GST_MULTIPART_MUX (object);
 
   g_free (multipart_mux->boundary);
+  gst_multipart_mux_clear_header (multipart_mux);
 
   if (multipart_mux->collect)
     gst_object_unref (multipart_mux->collect);
@@ -410,20 +432,74 @@ gst_multipart_mux_queue_pads (GstMultipartMux * mux)
   return bestpad;
 }
 
+static void
+gst_multipart_mux_clear_header (GstMultipartMux * mux)
+{
+  g_free (mux->header_mime);
+  mux->header_mime = NULL;
+  g_free (mux->header_prefix);
+  mux->header_prefix = NULL;
+  if (mux->header) {
+    gst_buffer_unref (mux->header);
+    mux->header = NULL;
+  }
+}
+
+/* Returns a buffer with the header for a part with the given mime type and
+ * size. The header only changes with those and the boundary, so the last one
+ * is kept and shared with a subbuffer. Otherwise it is rendered from a
+ * prefix that is kept for the mime type. Must be called with the object lock,
+ * which protects the boundary and the cached header. */
+static GstBuffer *
+gst_multipart_mux_get_header (GstMultipartMux * mux, const gchar * mime,
+    guint size)
+{
+  GstBuffer *header;
+  gchar *data;
+  gint len;
+
+  if (mux->header_mime == NULL || strcmp (mux->header_mime, mime) != 0) {
+    gst_multipart_mux_clear_header (mux);
+    mux->header_mime = g_strdup (mime);
+    mux->header_prefix =
+        g_strdup_printf ("--%s\r\nContent-Type: %s\r\nContent-Length: ",
+        mux->boundary, mime);
+    mux->header_prefix_len = strlen (mux->header_prefix);
+  } else if (mux->header && mux->header_size == size) {
+    return gst_buffer_create_sub (mux->header, 0,
+        GST_BUFFER_SIZE (mux->header));
+  }
+
+  /* room for the size and the two newlines */
+  header = gst_buffer_new_and_alloc (mux->header_prefix_len + 16);
+  data = (gchar *) GST_BUFFER_DATA (header);
+  memcpy (data, mux->header_prefix, mux->header_prefix_len);
+  len = g_snprintf (data + mux->header_prefix_len, 16, "%u\r\n\r\n", size);
+  GST_BUFFER_SIZE (header) = mux->header_prefix_len + len;
+
+  if (mux->header)
+    gst_buffer_unref (mux->header);
+  mux->header = header;
+  mux->header_size = size;
+
+  return gst_buffer_create_sub (header, 0, GST_BUFFER_SIZE (header));
+}
+
 /* basic idea:
  *
  * 1) find a pad to pull on, this is done by pulling on all pads and
  *    looking at the buffers to decide which one should be muxed first.
- * 2) create a new buffer for the header
- * 3) push both buffers on best pad, go to 1
+ * 2) get a buffer for the header, the header of the previous part is reused
+ *    when it has the same mime type and size
+ * 3) push the header, data and footer buffers on the src pad, as one
+ *    buffer list if configured, go to 1
  */
 static GstFlowReturn
 gst_multipart_mux_collected (GstCollectPads * pads, GstMultipartMux * mux)
 {
   GstMultipartPadData *best;
   GstFlowReturn ret = GST_FLOW_OK;
-  gchar *header = NULL;
-  size_t headerlen;
+  gsize headerlen;
   GstBuffer *headerbuf = NULL;
   GstBuffer *footerbuf = NULL;
   GstBuffer *databuf = NULL;
@@ -444,8 +520,10 @@ gst_multipart_mux_collected (GstCollectPads * pads, GstMultipartMux * mux)
   if (!mux->negotiated) {
     GstCaps *newcaps;
 
+    GST_OBJECT_LOCK (mux);
     newcaps = gst_caps_new_simple ("multipart/x-mixed-replace",
         "boundary", G_TYPE_STRING, mux->boundary, NULL);
+    GST_OBJECT_UNLOCK (mux);
 
     if (!gst_pad_set_caps (mux->srcpad, newcaps)) {
       gst_caps_unref (newcaps);
@@ -483,19 +561,13 @@ gst_multipart_mux_collected (GstCollectPads * pads, GstMultipartMux * mux)
   /* get the mime type for the structure */
   mime = gst_multipart_mux_get_mime (mux, structure);
 
-  header = g_strdup_printf ("--%s\r\nContent-Type: %s\r\n"
-      "Content-Length: %u\r\n\r\n",
-      mux->boundary, mime, GST_BUFFER_SIZE (best->buffer));
-  headerlen = strlen (header);
-
-  ret = gst_pad_alloc_buffer_and_set_caps (mux->srcpad, GST_BUFFER_OFFSET_NONE,
-      headerlen, GST_PAD_CAPS (mux->srcpad), &headerbuf);
-  if (ret != GST_FLOW_OK)
-    goto alloc_failed;
-
-  memcpy (GST_BUFFER_DATA (headerbuf), header, headerlen);
-  g_free (header);
+  GST_OBJECT_LOCK (mux);
+  headerbuf = gst_multipart_mux_get_header (mux, mime,
+      GST_BUFFER_SIZE (best->buffer));
+  GST_OBJECT_UNLOCK (mux);
+  headerlen = GST_BUFFER_SIZE (headerbuf);
 
+  gst_buffer_set_caps (headerbuf, GST_PAD_CAPS (mux->srcpad));
   /* the header has the same timestamp as the data buffer (which we will push
    * below) and has a duration of 0 */
   GST_BUFFER_TIMESTAMP (headerbuf) = best->timestamp;
@@ -504,14 +576,6 @@ gst_multipart_mux_collected (GstCollectPads * pads, GstMultipartMux * mux)
   mux->offset += headerlen;
   GST_BUFFER_OFFSET_END (headerbuf) = mux->offset;
 
-  GST_DEBUG_OBJECT (mux, "pushing %" G_GSIZE_FORMAT " bytes header buffer",
-      headerlen);
-  ret = gst_pad_push (mux->srcpad, headerbuf);
-  if (ret != GST_FLOW_OK)
-    /* push always takes ownership of the buffer, even after an error, so we
-     * don't need to unref headerbuf here. */
-    goto beach;
-
   /* take best->buffer, we don't need to unref it later as we will push it
    * now. */
   databuf = gst_buffer_make_metadata_writable (best->buffer);
@@ -525,31 +589,63 @@ gst_multipart_mux_collected (GstCollectPads * pads, GstMultipartMux * mux)
   GST_BUFFER_OFFSET_END (databuf) = mux->offset;
   GST_BUFFER_FLAG_SET (databuf, GST_BUFFER_FLAG_DELTA_UNIT);
 
-  GST_DEBUG_OBJECT (mux, "pushing %u bytes data buffer",
-      GST_BUFFER_SIZE (databuf));
-  ret = gst_pad_push (mux->srcpad, databuf);
-  if (ret != GST_FLOW_OK)
-    /* push always takes ownership of the buffer, even after an error, so we
-     * don't need to unref headerbuf here. */
-    goto beach;
-
-  ret = gst_pad_alloc_buffer_and_set_caps (mux->srcpad, GST_BUFFER_OFFSET_NONE,
-      2, GST_PAD_CAPS (mux->srcpad), &footerbuf);
-  if (ret != GST_FLOW_OK)
-    goto alloc_failed;
-
-  memcpy (GST_BUFFER_DATA (footerbuf), "\r\n", 2);
+  /* the footer is always the same, wrap the static data */
+  footerbuf = gst_buffer_new ();
+  GST_BUFFER_DATA (footerbuf) = (guint8 *) footer;
+  GST_BUFFER_SIZE (footerbuf) = sizeof (footer) - 1;
+  GST_BUFFER_FLAG_SET (footerbuf, GST_BUFFER_FLAG_READONLY);
 
+  gst_buffer_set_caps (footerbuf, GST_PAD_CAPS (mux->srcpad));
   /* the footer has the same timestamp as the data buffer and has a
    * duration of 0 */
   GST_BUFFER_TIMESTAMP (footerbuf) = best->timestamp;
   GST_BUFFER_DURATION (footerbuf) = 0;
   GST_BUFFER_OFFSET (footerbuf) = mux->offset;
-  mux->offset += 2;
+  mux->offset += GST_BUFFER_SIZE (footerbuf);
   GST_BUFFER_OFFSET_END (footerbuf) = mux->offset;
   GST_BUFFER_FLAG_SET (footerbuf, GST_BUFFER_FLAG_DELTA_UNIT);
 
-  GST_DEBUG_OBJECT (mux, "pushing 2 bytes footer buffer");
+  if (mux->buffer_list) {
+    GstBufferList *list;
+    GstBufferListIterator *it;
+
+    /* one group per part, the data is not copied */
+    list = gst_buffer_list_new ();
+    it = gst_buffer_list_iterate (list);
+    gst_buffer_list_iterator_add_group (it);
+    gst_buffer_list_iterator_add (it, headerbuf);
+    gst_buffer_list_iterator_add (it, databuf);
+    gst_buffer_list_iterator_add (it, footerbuf);
+    gst_buffer_list_iterator_free (it);
+
+    GST_DEBUG_OBJECT (mux, "pushing list with %" G_GSIZE_FORMAT
+        " bytes header and %u bytes data", headerlen,
+        GST_BUFFER_SIZE (databuf));
+    ret = gst_pad_push_list (mux->srcpad, list);
+    goto beach;
+  }
+
+  GST_DEBUG_OBJECT (mux, "pushing %" G_GSIZE_FORMAT " bytes header buffer",
+      headerlen);
+  ret = gst_pad_push (mux->srcpad, headerbuf);
+  if (ret != GST_FLOW_OK) {
+    /* push always takes ownership of the buffer, even after an error, so we
+     * don't need to unref headerbuf here. */
+    gst_buffer_unref (databuf);
+    gst_buffer_unref (footerbuf);
+    goto beach;
+  }
+
+  GST_DEBUG_OBJECT (mux, "pushing %u bytes data buffer",
+      GST_BUFFER_SIZE (databuf));
+  ret = gst_pad_push (mux->srcpad, databuf);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (footerbuf);
+    goto beach;
+  }
+
+  GST_DEBUG_OBJECT (mux, "pushing %u bytes footer buffer",
+      GST_BUFFER_SIZE (footerbuf));
   ret = gst_pad_push (mux->srcpad, footerbuf);
 
 beach:
@@ -588,13 +684,6 @@ no_caps:
     ret = GST_FLOW_NOT_NEGOTIATED;
     goto beach;
   }
-alloc_failed:
-  {
-    GST_WARNING_OBJECT (mux,
-        "failed allocating a %" G_GSIZE_FORMAT " bytes buffer", headerlen);
-    g_free (header);
-    goto beach;
-  }
 }
 
 static void
@@ -607,7 +696,12 @@ gst_multipart_mux_get_property (GObject * object,
 
   switch (prop_id) {
     case ARG_BOUNDARY:
+      GST_OBJECT_LOCK (mux);
       g_value_set_string (value, mux->boundary);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    case ARG_BUFFER_LIST:
+      g_value_set_boolean (value, mux->buffer_list);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -625,8 +719,15 @@ gst_multipart_mux_set_property (GObject * object,
 
   switch (prop_id) {
     case ARG_BOUNDARY:
+      /* the streaming thread may be rendering a header with the old one */
+      GST_OBJECT_LOCK (mux);
       g_free (mux->boundary);
       mux->boundary = g_strdup (g_value_get_string (value));
+      gst_multipart_mux_clear_header (mux);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    case ARG_BUFFER_LIST:
+      mux->buffer_list = g_value_get_boolean (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -73,6 +73,17 @@ struct _GstMultipartMux
   /* boundary string */
   gchar *boundary;
 
+  /* push every part as one buffer list */
+  gboolean buffer_list;
+
+  /* header of the last part and the start of the header for its mime type,
+   * reused for following parts */
+  GstBuffer *header;
+  guint header_size;
+  gchar *header_mime;
+  gchar *header_prefix;
+  gsize header_prefix_len;
+
   gboolean negotiated;
   gboolean need_segment;
 };
@@ -82,12 +82,35 @@
  *   present if the #GstSpectrum:message-phase property is %TRUE.
  *   </para>
  * </listitem>
+ * <listitem>
+ *   <para>
+ *   #gboolean
+ *   <classname>&quot;skipped&quot;</classname>:
+ *   %TRUE if all FFTs of the interval were skipped because the worker thread
+ *   of #GstSpectrum:threaded was too far behind. The message then has no
+ *   magnitude and phase fields. Only present on such messages
+ *   (Since: 0.10.32).
+ *   </para>
+ * </listitem>
  * </itemizedlist>
  *
  * If #GstSpectrum:multi-channel property is set to true. magnitude and phase
  * fields will be each a nested #GstValueArray. The first dimension are the
  * channels and the second dimension are the values.
  *
+ * If the #GstSpectrum:compact-message property is %TRUE, the magnitude and
+ * phase fields are a #GstBuffer of #gfloat instead, holding the values of all
+ * bands of the first channel, then of the second channel and so on. The
+ * number of bands and channels is in the additional #gint fields
+ * <classname>&quot;bands&quot;</classname> and
+ * <classname>&quot;channels&quot;</classname>. The buffers are reused for
+ * later messages once the message is freed, so take a reference to keep them.
+ *
+ * By default the FFTs of an interval do not overlap. For a finer time
+ * resolution the #GstSpectrum:overlap property lets consecutive FFTs share a
+ * part of their input. The FFTs and the messages can be moved out of the
+ * streaming thread with the #GstSpectrum:threaded property.
+ *
  * <refsect2>
  * <title>Example application</title>
  * |[
@@ -148,6 +171,13 @@ GST_DEBUG_CATEGORY_STATIC (gst_spectrum_debug);
 #define DEFAULT_BANDS			128
 #define DEFAULT_THRESHOLD		-60
 #define DEFAULT_MULTI_CHANNEL		FALSE
+#define DEFAULT_OVERLAP			0.0
+#define DEFAULT_WINDOW			GST_FFT_WINDOW_HAMMING
+#define DEFAULT_THREADED		FALSE
+#define DEFAULT_COMPACT_MESSAGE		FALSE
+
+/* FFTs queued to the worker thread before new ones are dropped */
+#define MAX_PENDING_FFT			64
 
 enum
 {
@@ -159,9 +189,44 @@ enum
   PROP_INTERVAL,
   PROP_BANDS,
   PROP_THRESHOLD,
-  PROP_MULTI_CHANNEL
+  PROP_MULTI_CHANNEL,
+  PROP_OVERLAP,
+  PROP_WINDOW,
+  PROP_THREADED,
+  PROP_COMPACT_MESSAGE
 };
 
+/* a job for the worker thread, either an FFT over the input of all channels
+ * or the end of an interval */
+typedef struct
+{
+  gfloat *input;                /* nfft frames of every channel, or NULL */
+  GstStructure *message;        /* message to complete and post, or NULL */
+  guint num_fft;
+} GstSpectrumJob;
+
+#define GST_TYPE_SPECTRUM_WINDOW (gst_spectrum_window_get_type ())
+static GType
+gst_spectrum_window_get_type (void)
+{
+  static GType spectrum_window_type = 0;
+  static const GEnumValue window_types[] = {
+    {GST_FFT_WINDOW_RECTANGULAR, "Rectangular window", "rectangular"},
+    {GST_FFT_WINDOW_HAMMING, "Hamming window", "hamming"},
+    {GST_FFT_WINDOW_HANN, "Hann window", "hann"},
+    {GST_FFT_WINDOW_BARTLETT, "Bartlett window", "bartlett"},
+    {GST_FFT_WINDOW_BLACKMAN, "Blackman window", "blackman"},
+    {0, NULL, NULL}
+  };
+
+  if (!spectrum_window_type) {
+    spectrum_window_type =
+        g_enum_register_static ("GstSpectrumWindow", window_types);
+  }
+
+  return spectrum_window_type;
+}
+
 GST_BOILERPLATE (GstSpectrum, gst_spectrum, GstAudioFilter,
     GST_TYPE_AUDIO_FILTER);
 
@@ -174,6 +239,8 @@ static gboolean gst_spectrum_start (GstBaseTransform * trans);
 static gboolean gst_spectrum_stop (GstBaseTransform * trans);
 static GstFlowReturn gst_spectrum_transform_ip (GstBaseTransform * trans,
     GstBuffer * in);
+static gboolean gst_spectrum_event (GstBaseTransform * trans,
+    GstEvent * event);
 static gboolean gst_spectrum_setup (GstAudioFilter * base,
     GstRingBufferSpec * format);
 
@@ -210,6 +277,7 @@ gst_spectrum_class_init (GstSpectrumClass * klass)
   trans_class->start = GST_DEBUG_FUNCPTR (gst_spectrum_start);
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_spectrum_stop);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_spectrum_transform_ip);
+  trans_class->event = GST_DEBUG_FUNCPTR (gst_spectrum_event);
   trans_class->passthrough_on_same_caps = TRUE;
 
   filter_class->setup = GST_DEBUG_FUNCPTR (gst_spectrum_setup);
@@ -275,6 +343,63 @@ gst_spectrum_class_init (GstSpectrumClass * klass)
           "Send separate results for each channel",
           DEFAULT_MULTI_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSpectrum:overlap
+   *
+   * Part of the input of an FFT that is also used by the next one. With 0.5
+   * a new FFT is run after half of the window, which doubles the number of
+   * FFTs per interval.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_OVERLAP,
+      g_param_spec_double ("overlap", "Overlap",
+          "Part of the window shared by consecutive FFTs",
+          0.0, 1.0, DEFAULT_OVERLAP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:window
+   *
+   * Window function applied to the input of every FFT.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_WINDOW,
+      g_param_spec_enum ("window", "Window",
+          "Window function applied before the FFT",
+          GST_TYPE_SPECTRUM_WINDOW, DEFAULT_WINDOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:threaded
+   *
+   * Run the FFTs and post the messages from a worker thread, so the
+   * streaming thread only copies the input. If the worker falls behind,
+   * FFTs are skipped instead of blocking the streaming thread. Intervals
+   * without any FFT are still posted, with the skipped field set.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_THREADED,
+      g_param_spec_boolean ("threaded", "Threaded",
+          "Run the FFTs in a separate thread",
+          DEFAULT_THREADED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:compact-message
+   *
+   * Put the magnitudes and phases of all bands and channels into a #GstBuffer
+   * of floats in the messages, instead of lists with a #GValue for every
+   * band. This is a lot cheaper with many bands or channels.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_COMPACT_MESSAGE,
+      g_param_spec_boolean ("compact-message", "Compact message",
+          "Post the values in buffers instead of lists of values",
+          DEFAULT_COMPACT_MESSAGE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (gst_spectrum_debug, "spectrum", 0,
       "audio spectrum analyser element");
 }
@@ -288,8 +413,17 @@ gst_spectrum_init (GstSpectrum * spectrum, GstSpectrumClass * g_class)
   spectrum->interval = DEFAULT_INTERVAL;
   spectrum->bands = DEFAULT_BANDS;
   spectrum->threshold = DEFAULT_THRESHOLD;
+  spectrum->overlap = DEFAULT_OVERLAP;
+  spectrum->window = DEFAULT_WINDOW;
+  spectrum->threaded = DEFAULT_THREADED;
+  spectrum->compact_message = DEFAULT_COMPACT_MESSAGE;
+
+  spectrum->lock = g_mutex_new ();
+  spectrum->cond = g_cond_new ();
 }
 
+static void gst_spectrum_job_process (gpointer data, gpointer user_data);
+
 static void
 gst_spectrum_alloc_channel_data (GstSpectrum * spectrum)
 {
@@ -316,6 +450,19 @@ gst_spectrum_alloc_channel_data (GstSpectrum * spectrum)
     cd->spect_magnitude = g_new0 (gfloat, bands);
     cd->spect_phase = g_new0 (gfloat, bands);
   }
+
+  if (spectrum->threaded) {
+    GError *err = NULL;
+
+    /* a single thread, so the jobs are processed in order */
+    spectrum->pool = g_thread_pool_new (gst_spectrum_job_process, spectrum,
+        1, FALSE, &err);
+    if (spectrum->pool == NULL) {
+      GST_WARNING_OBJECT (spectrum, "could not create worker thread: %s",
+          err->message);
+      g_error_free (err);
+    }
+  }
 }
 
 static void
@@ -328,6 +475,12 @@ gst_spectrum_free_channel_data (GstSpectrum * spectrum)
     GST_DEBUG_OBJECT (spectrum, "freeing data for %d channels",
         spectrum->num_channels);
 
+    /* finishes the queued jobs */
+    if (spectrum->pool) {
+      g_thread_pool_free (spectrum->pool, FALSE, TRUE);
+      spectrum->pool = NULL;
+    }
+
     for (i = 0; i < spectrum->num_channels; i++) {
       cd = &spectrum->channel_data[i];
       if (cd->fft_ctx)
@@ -341,11 +494,41 @@ gst_spectrum_free_channel_data (GstSpectrum * spectrum)
     g_free (spectrum->channel_data);
     spectrum->channel_data = NULL;
   }
+
+  if (spectrum->magnitude_values) {
+    gst_buffer_unref (spectrum->magnitude_values);
+    spectrum->magnitude_values = NULL;
+  }
+  if (spectrum->phase_values) {
+    gst_buffer_unref (spectrum->phase_values);
+    spectrum->phase_values = NULL;
+  }
+}
+
+/* wait until the worker thread has processed all queued jobs */
+static void
+gst_spectrum_drain (GstSpectrum * spectrum)
+{
+  g_mutex_lock (spectrum->lock);
+  while (spectrum->pending > 0)
+    g_cond_wait (spectrum->cond, spectrum->lock);
+  g_mutex_unlock (spectrum->lock);
 }
 
+static void gst_spectrum_reset_message_data (GstSpectrum * spectrum,
+    GstSpectrumChannel * cd);
+
 static void
 gst_spectrum_flush (GstSpectrum * spectrum)
 {
+  if (spectrum->channel_data) {
+    guint i;
+
+    gst_spectrum_drain (spectrum);
+    for (i = 0; i < spectrum->num_channels; i++)
+      gst_spectrum_reset_message_data (spectrum, &spectrum->channel_data[i]);
+  }
+
   spectrum->num_frames = 0;
   spectrum->num_fft = 0;
 
@@ -368,6 +551,9 @@ gst_spectrum_finalize (GObject * object)
 
   gst_spectrum_reset_state (spectrum);
 
+  g_mutex_free (spectrum->lock);
+  g_cond_free (spectrum->cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -421,6 +607,25 @@ gst_spectrum_set_property (GObject * object, guint prop_id,
       }
     }
       break;
+    case PROP_OVERLAP:
+      filter->overlap = g_value_get_double (value);
+      break;
+    case PROP_WINDOW:
+      filter->window = g_value_get_enum (value);
+      break;
+    case PROP_THREADED:{
+      gboolean threaded = g_value_get_boolean (value);
+      if (filter->threaded != threaded) {
+        GST_BASE_TRANSFORM_LOCK (filter);
+        filter->threaded = threaded;
+        gst_spectrum_reset_state (filter);
+        GST_BASE_TRANSFORM_UNLOCK (filter);
+      }
+    }
+      break;
+    case PROP_COMPACT_MESSAGE:
+      filter->compact_message = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -456,6 +661,18 @@ gst_spectrum_get_property (GObject * object, guint prop_id,
     case PROP_MULTI_CHANNEL:
       g_value_set_boolean (value, filter->multi_channel);
       break;
+    case PROP_OVERLAP:
+      g_value_set_double (value, filter->overlap);
+      break;
+    case PROP_WINDOW:
+      g_value_set_enum (value, filter->window);
+      break;
+    case PROP_THREADED:
+      g_value_set_boolean (value, filter->threaded);
+      break;
+    case PROP_COMPACT_MESSAGE:
+      g_value_set_boolean (value, filter->compact_message);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -853,18 +1070,43 @@ gst_spectrum_message_add_array (GValue * cv, gfloat * data, guint num_values)
   g_value_unset (&a);
 }
 
-static GstMessage *
+/* the values buffers of compact messages can be reused once the
+ * application has dropped the previous message */
+static void
+gst_spectrum_message_add_values (GstSpectrum * spectrum, GstStructure * s,
+    const gchar * name, GstBuffer ** values, gboolean phase)
+{
+  guint bands = spectrum->bands;
+  guint c;
+  gfloat *data;
+
+  if (*values && !gst_buffer_is_writable (*values)) {
+    gst_buffer_unref (*values);
+    *values = NULL;
+  }
+  if (*values == NULL)
+    *values = gst_buffer_new_and_alloc (spectrum->num_channels * bands *
+        sizeof (gfloat));
+
+  data = (gfloat *) GST_BUFFER_DATA (*values);
+  for (c = 0; c < spectrum->num_channels; c++) {
+    GstSpectrumChannel *cd = &spectrum->channel_data[c];
+
+    memcpy (data + c * bands, phase ? cd->spect_phase : cd->spect_magnitude,
+        bands * sizeof (gfloat));
+  }
+  gst_structure_set (s, name, GST_TYPE_BUFFER, *values, NULL);
+}
+
+/* the times are taken in the streaming thread, the values are added when
+ * the interval is complete, which can be in the worker thread */
+static GstStructure *
 gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
     GstClockTime duration)
 {
   GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (spectrum);
-  GstSpectrumChannel *cd;
-  GstStructure *s;
-  GValue *mcv = NULL, *pcv = NULL;
   GstClockTime endtime, running_time, stream_time;
 
-  GST_DEBUG_OBJECT (spectrum, "preparing message, bands =%d ", spectrum->bands);
-
   running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
       timestamp);
   stream_time = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
@@ -872,14 +1114,34 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
   /* endtime is for backwards compatibility */
   endtime = stream_time + duration;
 
-  s = gst_structure_new ("spectrum",
+  return gst_structure_new ("spectrum",
       "endtime", GST_TYPE_CLOCK_TIME, endtime,
       "timestamp", G_TYPE_UINT64, timestamp,
       "stream-time", G_TYPE_UINT64, stream_time,
       "running-time", G_TYPE_UINT64, running_time,
       "duration", G_TYPE_UINT64, duration, NULL);
+}
+
+static void
+gst_spectrum_message_add_data (GstSpectrum * spectrum, GstStructure * s)
+{
+  GstSpectrumChannel *cd;
+  GValue *mcv = NULL, *pcv = NULL;
 
-  if (!spectrum->multi_channel) {
+  GST_DEBUG_OBJECT (spectrum, "preparing message, bands =%d ", spectrum->bands);
+
+  if (spectrum->compact_message) {
+    gst_structure_set (s, "bands", G_TYPE_INT, spectrum->bands,
+        "channels", G_TYPE_INT, spectrum->num_channels, NULL);
+    if (spectrum->message_magnitude) {
+      gst_spectrum_message_add_values (spectrum, s, "magnitude",
+          &spectrum->magnitude_values, FALSE);
+    }
+    if (spectrum->message_phase) {
+      gst_spectrum_message_add_values (spectrum, s, "phase",
+          &spectrum->phase_values, TRUE);
+    }
+  } else if (!spectrum->multi_channel) {
     cd = &spectrum->channel_data[0];
 
     if (spectrum->message_magnitude) {
@@ -894,7 +1156,6 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
     }
   } else {
     guint c;
-    guint channels = GST_AUDIO_FILTER (spectrum)->format.channels;
 
     if (spectrum->message_magnitude) {
       mcv = gst_spectrum_message_add_container (s, GST_TYPE_ARRAY, "magnitude");
@@ -903,7 +1164,7 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
       pcv = gst_spectrum_message_add_container (s, GST_TYPE_ARRAY, "phase");
     }
 
-    for (c = 0; c < channels; c++) {
+    for (c = 0; c < spectrum->num_channels; c++) {
       cd = &spectrum->channel_data[c];
 
       if (spectrum->message_magnitude) {
@@ -911,35 +1172,38 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
             spectrum->bands);
       }
       if (spectrum->message_phase) {
-        gst_spectrum_message_add_array (pcv, cd->spect_magnitude,
-            spectrum->bands);
+        gst_spectrum_message_add_array (pcv, cd->spect_phase, spectrum->bands);
       }
     }
   }
-  return gst_message_new_element (GST_OBJECT (spectrum), s);
 }
 
+/* copy the last nfft frames of a channel out of its ringbuffer */
+static void
+gst_spectrum_copy_input (GstSpectrumChannel * cd, gfloat * out,
+    guint input_pos, guint nfft)
+{
+  memcpy (out, cd->input + input_pos, (nfft - input_pos) * sizeof (gfloat));
+  memcpy (out + nfft - input_pos, cd->input, input_pos * sizeof (gfloat));
+}
+
+/* input is overwritten by the window */
 static void
 gst_spectrum_run_fft (GstSpectrum * spectrum, GstSpectrumChannel * cd,
-    guint input_pos)
+    gfloat * input)
 {
   guint i;
   guint bands = spectrum->bands;
   guint nfft = 2 * bands - 2;
   gint threshold = spectrum->threshold;
-  gfloat *input = cd->input;
-  gfloat *input_tmp = cd->input_tmp;
   gfloat *spect_magnitude = cd->spect_magnitude;
   gfloat *spect_phase = cd->spect_phase;
   GstFFTF32Complex *freqdata = cd->freqdata;
   GstFFTF32 *fft_ctx = cd->fft_ctx;
 
-  for (i = 0; i < nfft; i++)
-    input_tmp[i] = input[(input_pos + i) % nfft];
+  gst_fft_f32_window (fft_ctx, input, spectrum->window);
 
-  gst_fft_f32_window (fft_ctx, input_tmp, GST_FFT_WINDOW_HAMMING);
-
-  gst_fft_f32_fft (fft_ctx, input_tmp, freqdata);
+  gst_fft_f32_fft (fft_ctx, input, freqdata);
 
   if (spectrum->message_magnitude) {
     gdouble val;
@@ -964,11 +1228,10 @@ gst_spectrum_run_fft (GstSpectrum * spectrum, GstSpectrumChannel * cd,
 
 static void
 gst_spectrum_prepare_message_data (GstSpectrum * spectrum,
-    GstSpectrumChannel * cd)
+    GstSpectrumChannel * cd, guint num_fft)
 {
   guint i;
   guint bands = spectrum->bands;
-  guint num_fft = spectrum->num_fft;
 
   /* Calculate average */
   if (spectrum->message_magnitude) {
@@ -996,6 +1259,125 @@ gst_spectrum_reset_message_data (GstSpectrum * spectrum,
   memset (spect_phase, 0, bands * sizeof (gfloat));
 }
 
+/* complete the interval: average the spectra of num_fft FFTs, post them
+ * with the message s, if any, and start over. Without FFTs the message is
+ * posted with the skipped field instead of the values */
+static void
+gst_spectrum_post_message (GstSpectrum * spectrum, GstStructure * s,
+    guint num_fft)
+{
+  guint c;
+
+  if (s && num_fft > 0) {
+    for (c = 0; c < spectrum->num_channels; c++)
+      gst_spectrum_prepare_message_data (spectrum,
+          &spectrum->channel_data[c], num_fft);
+
+    gst_spectrum_message_add_data (spectrum, s);
+    gst_element_post_message (GST_ELEMENT (spectrum),
+        gst_message_new_element (GST_OBJECT (spectrum), s));
+  } else if (s) {
+    GST_DEBUG_OBJECT (spectrum, "all FFTs of the interval were skipped");
+    gst_structure_set (s, "skipped", G_TYPE_BOOLEAN, TRUE, NULL);
+    gst_element_post_message (GST_ELEMENT (spectrum),
+        gst_message_new_element (GST_OBJECT (spectrum), s));
+  }
+
+  for (c = 0; c < spectrum->num_channels; c++)
+    gst_spectrum_reset_message_data (spectrum, &spectrum->channel_data[c]);
+}
+
+static void
+gst_spectrum_job_process (gpointer data, gpointer user_data)
+{
+  GstSpectrumJob *job = data;
+  GstSpectrum *spectrum = user_data;
+  guint nfft = 2 * spectrum->bands - 2;
+  gboolean is_fft = (job->input != NULL);
+  guint c;
+
+  if (is_fft) {
+    for (c = 0; c < spectrum->num_channels; c++)
+      gst_spectrum_run_fft (spectrum, &spectrum->channel_data[c],
+          job->input + c * nfft);
+    g_free (job->input);
+  } else {
+    gst_spectrum_post_message (spectrum, job->message, job->num_fft);
+  }
+  g_slice_free (GstSpectrumJob, job);
+
+  g_mutex_lock (spectrum->lock);
+  spectrum->pending--;
+  if (is_fft)
+    spectrum->pending_fft--;
+  g_cond_signal (spectrum->cond);
+  g_mutex_unlock (spectrum->lock);
+}
+
+static void
+gst_spectrum_push_job (GstSpectrum * spectrum, GstSpectrumJob * job)
+{
+  g_mutex_lock (spectrum->lock);
+  spectrum->pending++;
+  if (job->input)
+    spectrum->pending_fft++;
+  g_mutex_unlock (spectrum->lock);
+
+  g_thread_pool_push (spectrum->pool, job, NULL);
+}
+
+/* run the FFT of all channels over the last nfft frames, or queue it for the
+ * worker thread. Returns FALSE if the FFT was skipped because the worker
+ * thread is too far behind. */
+static gboolean
+gst_spectrum_run_ffts (GstSpectrum * spectrum, guint input_pos)
+{
+  guint nfft = 2 * spectrum->bands - 2;
+  GstSpectrumChannel *cd;
+  GstSpectrumJob *job;
+  gboolean skip;
+  guint c;
+
+  if (spectrum->pool == NULL) {
+    for (c = 0; c < spectrum->num_channels; c++) {
+      cd = &spectrum->channel_data[c];
+      gst_spectrum_copy_input (cd, cd->input_tmp, input_pos, nfft);
+      gst_spectrum_run_fft (spectrum, cd, cd->input_tmp);
+    }
+    return TRUE;
+  }
+
+  g_mutex_lock (spectrum->lock);
+  skip = (spectrum->pending_fft >= MAX_PENDING_FFT);
+  g_mutex_unlock (spectrum->lock);
+  if (skip) {
+    GST_DEBUG_OBJECT (spectrum, "worker thread is behind, skipping FFT");
+    return FALSE;
+  }
+
+  job = g_slice_new0 (GstSpectrumJob);
+  job->input = g_new (gfloat, spectrum->num_channels * nfft);
+  for (c = 0; c < spectrum->num_channels; c++) {
+    gst_spectrum_copy_input (&spectrum->channel_data[c],
+        job->input + c * nfft, input_pos, nfft);
+  }
+  gst_spectrum_push_job (spectrum, job);
+
+  return TRUE;
+}
+
+static gboolean
+gst_spectrum_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstSpectrum *spectrum = GST_SPECTRUM (trans);
+
+  /* post the messages of the queued intervals before the EOS */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    gst_spectrum_drain (spectrum);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->event (trans, event);
+}
+
 static GstFlowReturn
 gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
 {
@@ -1009,6 +1391,7 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
   gfloat max_value = (1UL << (format->depth - 1)) - 1;
   guint bands = spectrum->bands;
   guint nfft = 2 * bands - 2;
+  guint hop;
   guint input_pos;
   gfloat *input;
   const guint8 *data = GST_BUFFER_DATA (buffer);
@@ -1061,9 +1444,14 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
   input_pos = spectrum->input_pos;
   input_data = spectrum->input_data;
 
+  /* frames between the starts of two FFTs */
+  hop = nfft - (guint) (spectrum->overlap * nfft);
+  if (hop == 0)
+    hop = 1;
+
   while (size >= frame_size) {
     /* run input_data for a chunk of data */
-    fft_todo = nfft - (spectrum->num_frames % nfft);
+    fft_todo = hop - (spectrum->num_frames % hop);
     msg_todo = spectrum->frames_todo - spectrum->num_frames;
     GST_LOG_OBJECT (spectrum,
         "message frames todo: %u, fft frames todo: %u, input frames %u",
@@ -1089,21 +1477,20 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
     have_full_interval = (spectrum->num_frames == spectrum->frames_todo);
 
     GST_LOG_OBJECT (spectrum, "size: %u, do-fft = %d, do-message = %d", size,
-        (spectrum->num_frames % nfft == 0), have_full_interval);
+        (spectrum->num_frames % hop == 0), have_full_interval);
 
     /* If we have enough frames for an FFT or we have all frames required for
      * the interval and we haven't run a FFT, then run an FFT */
-    if ((spectrum->num_frames % nfft == 0) ||
+    if ((spectrum->num_frames % hop == 0) ||
         (have_full_interval && !spectrum->num_fft)) {
-      for (c = 0; c < output_channels; c++) {
-        cd = &spectrum->channel_data[c];
-        gst_spectrum_run_fft (spectrum, cd, input_pos);
-      }
-      spectrum->num_fft++;
+      if (gst_spectrum_run_ffts (spectrum, input_pos))
+        spectrum->num_fft++;
     }
 
     /* Do we have the FFTs for one interval? */
     if (have_full_interval) {
+      GstStructure *s = NULL;
+
       GST_DEBUG_OBJECT (spectrum, "nfft: %u frames: %" G_GUINT64_FORMAT
           " fpi: %" G_GUINT64_FORMAT " error: %" GST_TIME_FORMAT, nfft,
           spectrum->num_frames, spectrum->frames_per_interval,
@@ -1117,27 +1504,24 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
       spectrum->accumulated_error += spectrum->error_per_interval;
 
       if (spectrum->post_messages) {
-        GstMessage *m;
-
-        for (c = 0; c < output_channels; c++) {
-          cd = &spectrum->channel_data[c];
-          gst_spectrum_prepare_message_data (spectrum, cd);
-        }
-
-        m = gst_spectrum_message_new (spectrum, spectrum->message_ts,
+        s = gst_spectrum_message_new (spectrum, spectrum->message_ts,
             spectrum->interval);
+      }
+
+      if (spectrum->pool) {
+        GstSpectrumJob *job = g_slice_new0 (GstSpectrumJob);
 
-        gst_element_post_message (GST_ELEMENT (spectrum), m);
+        job->message = s;
+        job->num_fft = spectrum->num_fft;
+        gst_spectrum_push_job (spectrum, job);
+      } else {
+        gst_spectrum_post_message (spectrum, s, spectrum->num_fft);
       }
 
       if (GST_CLOCK_TIME_IS_VALID (spectrum->message_ts))
         spectrum->message_ts +=
             gst_util_uint64_scale (spectrum->num_frames, GST_SECOND, rate);
 
-      for (c = 0; c < output_channels; c++) {
-        cd = &spectrum->channel_data[c];
-        gst_spectrum_reset_message_data (spectrum, cd);
-      }
       spectrum->num_frames = 0;
       spectrum->num_fft = 0;
     }
@@ -64,6 +64,10 @@ struct _GstSpectrum
   guint bands;                  /* number of spectrum bands */
   gint threshold;               /* energy level treshold */
   gboolean multi_channel;       /* send separate channel results */
+  gdouble overlap;              /* part of the window shared by two FFTs */
+  GstFFTWindow window;          /* window function applied before the FFT */
+  gboolean threaded;            /* run the FFTs in a worker thread */
+  gboolean compact_message;     /* values in buffers instead of lists */
 
   guint64 num_frames;           /* frame count (1 sample per channel)
                                  * since last emit */
@@ -79,6 +83,16 @@ struct _GstSpectrum
   guint64 accumulated_error;
 
   GstSpectrumInputData input_data;
+
+  /* worker thread, FFTs and messages are queued to it in order */
+  GThreadPool *pool;
+  GMutex *lock;
+  GCond *cond;
+  guint pending;                /* queued jobs */
+  guint pending_fft;            /* queued FFTs */
+
+  GstBuffer *magnitude_values;  /* reused for compact messages */
+  GstBuffer *phase_values;
 };
 
 struct _GstSpectrumClass
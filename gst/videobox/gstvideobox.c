@@ -140,7 +140,8 @@ static const gint cog_identity_matrix_8bit[] = {
 
 static void
 fill_ayuv (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
-    guint8 * dest, gboolean sdtv, gint width, gint height)
+    guint8 * dest, gboolean sdtv, gint width, gint height, gint first_line,
+    gint n_lines)
 {
   guint32 empty_pixel;
 
@@ -155,7 +156,30 @@ fill_ayuv (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
         (yuv_hdtv_colors_Y[fill_type] << 16) |
         (yuv_hdtv_colors_U[fill_type] << 8) | yuv_hdtv_colors_V[fill_type]);
 
-  orc_splat_u32 ((guint32 *) dest, empty_pixel, width * height);
+  orc_splat_u32 ((guint32 *) (dest + first_line * width * 4), empty_pixel,
+      width * n_lines);
+}
+
+/* Copies n 32 bit pixels and scales the alpha byte at byte offset a_offset
+ * with i_alpha. Works on whole pixels so the compiler can vectorize it. */
+static void
+copy_u32_scale_alpha (guint32 * dest, const guint32 * src, gint a_offset,
+    guint i_alpha, gint n)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  const gint a_shift = a_offset * 8;
+#else
+  const gint a_shift = (3 - a_offset) * 8;
+#endif
+  const guint32 a_mask = 0xff << a_shift;
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    guint32 p = src[i];
+    guint32 a = (p & a_mask) >> a_shift;
+
+    dest[i] = (p & ~a_mask) | (((a * i_alpha) >> 8) << a_shift);
+  }
 }
 
 static void
@@ -198,13 +222,8 @@ copy_ayuv_ayuv (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
     }
   } else {
     for (i = 0; i < h; i++) {
-      for (j = 0; j < w; j += 4) {
-        /* ORC FIXME */
-        dest[j] = (src[j] * i_alpha) >> 8;
-        dest[j + 1] = src[j + 1];
-        dest[j + 2] = src[j + 2];
-        dest[j + 3] = src[j + 3];
-      }
+      copy_u32_scale_alpha ((guint32 *) dest, (const guint32 *) src, 0,
+          i_alpha, w / 4);
       dest += dest_stride;
       src += src_stride;
     }
@@ -633,12 +652,16 @@ copy_ayuv_i420 (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
 static void
 fill_planar_yuv (GstVideoBoxFill fill_type, guint b_alpha,
     GstVideoFormat format, guint8 * dest, gboolean sdtv, gint width,
-    gint height)
+    gint height, gint first_line, gint n_lines)
 {
   guint8 empty_pixel[3];
   guint8 *destY, *destU, *destV;
   gint strideY, strideUV;
   gint heightY, heightUV;
+  gint firstUV, linesUV;
+
+  if (n_lines <= 0)
+    return;
 
   if (sdtv) {
     empty_pixel[0] = yuv_sdtv_colors_Y[fill_type];
@@ -663,9 +686,20 @@ fill_planar_yuv (GstVideoBoxFill fill_type, guint b_alpha,
   heightY = gst_video_format_get_component_height (format, 0, height);
   heightUV = gst_video_format_get_component_height (format, 1, height);
 
-  memset (destY, empty_pixel[0], strideY * heightY);
-  memset (destU, empty_pixel[1], strideUV * heightUV);
-  memset (destV, empty_pixel[2], strideUV * heightUV);
+  /* Include chroma lines that are shared with the frame, the copy
+   * functions blend those with what was filled here */
+  if (heightUV != heightY) {
+    firstUV = first_line / 2;
+    linesUV =
+        MIN (heightUV, (first_line + n_lines + 1) / 2) - first_line / 2;
+  } else {
+    firstUV = first_line;
+    linesUV = n_lines;
+  }
+
+  memset (destY + first_line * strideY, empty_pixel[0], strideY * n_lines);
+  memset (destU + firstUV * strideUV, empty_pixel[1], strideUV * linesUV);
+  memset (destV + firstUV * strideUV, empty_pixel[2], strideUV * linesUV);
 }
 
 static void
@@ -1764,7 +1798,8 @@ copy_i420_ayuv (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
 
 static void
 fill_rgb32 (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
-    guint8 * dest, gboolean sdtv, gint width, gint height)
+    guint8 * dest, gboolean sdtv, gint width, gint height, gint first_line,
+    gint n_lines)
 {
   guint32 empty_pixel;
   gint p[4];
@@ -1781,30 +1816,37 @@ fill_rgb32 (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
       (rgb_colors_G[fill_type] << (p[2] * 8)) |
       (rgb_colors_B[fill_type] << (p[3] * 8)));
 
-  orc_splat_u32 ((guint32 *) dest, empty_pixel, width * height);
+  orc_splat_u32 ((guint32 *) (dest + first_line * width * 4), empty_pixel,
+      width * n_lines);
 }
 
 static void
 fill_rgb24 (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
-    guint8 * dest, gboolean sdtv, gint width, gint height)
+    guint8 * dest, gboolean sdtv, gint width, gint height, gint first_line,
+    gint n_lines)
 {
   gint dest_stride = GST_ROUND_UP_4 (width * 3);
   gint p[4];
   gint i, j;
+  guint8 *line;
 
   p[0] = gst_video_format_get_component_offset (format, 3, width, height);
   p[1] = gst_video_format_get_component_offset (format, 0, width, height);
   p[2] = gst_video_format_get_component_offset (format, 1, width, height);
   p[3] = gst_video_format_get_component_offset (format, 2, width, height);
 
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      dest[3 * j + p[1]] = rgb_colors_R[fill_type];
-      dest[3 * j + p[2]] = rgb_colors_G[fill_type];
-      dest[3 * j + p[3]] = rgb_colors_B[fill_type];
-    }
-    dest += dest_stride;
+  if (n_lines <= 0)
+    return;
+
+  /* Render the first line and copy it to the others */
+  line = dest + first_line * dest_stride;
+  for (j = 0; j < width; j++) {
+    line[3 * j + p[1]] = rgb_colors_R[fill_type];
+    line[3 * j + p[2]] = rgb_colors_G[fill_type];
+    line[3 * j + p[3]] = rgb_colors_B[fill_type];
   }
+  for (i = 1; i < n_lines; i++)
+    memcpy (line + i * dest_stride, line, width * 3);
 }
 
 static void
@@ -1861,7 +1903,14 @@ copy_rgb32 (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
   dest = dest + dest_y * dest_stride + dest_x * out_bpp;
   src = src + src_y * src_stride + src_x * in_bpp;
 
-  if (in_alpha && out_alpha) {
+  if (in_alpha && out_alpha && memcmp (p_in, p_out, sizeof (p_in)) == 0) {
+    for (i = 0; i < h; i++) {
+      copy_u32_scale_alpha ((guint32 *) dest, (const guint32 *) src, p_out[0],
+          i_alpha, w);
+      dest += dest_stride;
+      src += src_stride;
+    }
+  } else if (in_alpha && out_alpha) {
     w *= 4;
     for (i = 0; i < h; i++) {
       for (j = 0; j < w; j += 4) {
@@ -1900,6 +1949,15 @@ copy_rgb32 (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
       dest += dest_stride;
       src += src_stride;
     }
+  } else if (packed_out == packed_in
+      && memcmp (p_in + 1, p_out + 1, 3 * sizeof (gint)) == 0) {
+    /* Same component layout, the padding byte of a 32 bit format is copied
+     * along with the colour */
+    for (i = 0; i < h; i++) {
+      memcpy (dest, src, w * out_bpp);
+      dest += dest_stride;
+      src += src_stride;
+    }
   } else if (!packed_out && !packed_in) {
     w *= 4;
     for (i = 0; i < h; i++) {
@@ -2144,16 +2202,21 @@ copy_ayuv_rgb32 (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
 
 static void
 fill_gray (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
-    guint8 * dest, gboolean sdtv, gint width, gint height)
+    guint8 * dest, gboolean sdtv, gint width, gint height, gint first_line,
+    gint n_lines)
 {
   gint i, j;
   gint dest_stride;
 
+  if (n_lines <= 0)
+    return;
+
   if (format == GST_VIDEO_FORMAT_GRAY8) {
     guint8 val = yuv_sdtv_colors_Y[fill_type];
 
     dest_stride = GST_ROUND_UP_4 (width);
-    for (i = 0; i < height; i++) {
+    dest += first_line * dest_stride;
+    for (i = 0; i < n_lines; i++) {
       memset (dest, val, width);
       dest += dest_stride;
     }
@@ -2161,21 +2224,20 @@ fill_gray (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
     guint16 val = yuv_sdtv_colors_Y[fill_type] << 8;
 
     dest_stride = GST_ROUND_UP_4 (width * 2);
+    dest += first_line * dest_stride;
+
+    /* Render the first line and copy it to the others */
     if (format == GST_VIDEO_FORMAT_GRAY16_BE) {
-      for (i = 0; i < height; i++) {
-        for (j = 0; j < width; j++) {
-          GST_WRITE_UINT16_BE (dest + 2 * j, val);
-        }
-        dest += dest_stride;
+      for (j = 0; j < width; j++) {
+        GST_WRITE_UINT16_BE (dest + 2 * j, val);
       }
     } else {
-      for (i = 0; i < height; i++) {
-        for (j = 0; j < width; j++) {
-          GST_WRITE_UINT16_LE (dest + 2 * j, val);
-        }
-        dest += dest_stride;
+      for (j = 0; j < width; j++) {
+        GST_WRITE_UINT16_LE (dest + 2 * j, val);
       }
     }
+    for (i = 1; i < n_lines; i++)
+      memcpy (dest + i * dest_stride, dest, width * 2);
   }
 }
 
@@ -2207,52 +2269,28 @@ copy_packed_simple (guint i_alpha, GstVideoFormat dest_format, guint8 * dest,
 
 static void
 fill_yuy2 (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFormat format,
-    guint8 * dest, gboolean sdtv, gint width, gint height)
+    guint8 * dest, gboolean sdtv, gint width, gint height, gint first_line,
+    gint n_lines)
 {
   guint8 y, u, v;
-  gint i, j;
+  guint32 empty_pixel;
   gint stride = gst_video_format_get_row_stride (format, 0, width);
 
   y = (sdtv) ? yuv_sdtv_colors_Y[fill_type] : yuv_hdtv_colors_Y[fill_type];
   u = (sdtv) ? yuv_sdtv_colors_U[fill_type] : yuv_hdtv_colors_U[fill_type];
   v = (sdtv) ? yuv_sdtv_colors_V[fill_type] : yuv_hdtv_colors_V[fill_type];
 
-  width = width + (width % 2);
-
-  if (format == GST_VIDEO_FORMAT_YUY2) {
-    for (i = 0; i < height; i++) {
-      for (j = 0; j < width; j += 2) {
-        dest[j * 2 + 0] = y;
-        dest[j * 2 + 1] = u;
-        dest[j * 2 + 2] = y;
-        dest[j * 2 + 3] = v;
-      }
-
-      dest += stride;
-    }
-  } else if (format == GST_VIDEO_FORMAT_YVYU) {
-    for (i = 0; i < height; i++) {
-      for (j = 0; j < width; j += 2) {
-        dest[j * 2 + 0] = y;
-        dest[j * 2 + 1] = v;
-        dest[j * 2 + 2] = y;
-        dest[j * 2 + 3] = u;
-      }
-
-      dest += stride;
-    }
-  } else {
-    for (i = 0; i < height; i++) {
-      for (j = 0; j < width; j += 2) {
-        dest[j * 2 + 0] = u;
-        dest[j * 2 + 1] = y;
-        dest[j * 2 + 2] = v;
-        dest[j * 2 + 3] = y;
-      }
+  if (format == GST_VIDEO_FORMAT_YUY2)
+    empty_pixel = GUINT32_FROM_BE ((y << 24) | (u << 16) | (y << 8) | v);
+  else if (format == GST_VIDEO_FORMAT_YVYU)
+    empty_pixel = GUINT32_FROM_BE ((y << 24) | (v << 16) | (y << 8) | u);
+  else
+    empty_pixel = GUINT32_FROM_BE ((u << 24) | (y << 16) | (v << 8) | y);
 
-      dest += stride;
-    }
-  }
+  /* A line is a whole number of macropixels, there is no padding between
+   * the lines */
+  orc_splat_u32 ((guint32 *) (dest + first_line * stride), empty_pixel,
+      (stride / 4) * n_lines);
 }
 
 static void
@@ -2430,6 +2468,8 @@ static GstFlowReturn gst_video_box_transform (GstBaseTransform * trans,
     GstBuffer * in, GstBuffer * out);
 static void gst_video_box_before_transform (GstBaseTransform * trans,
     GstBuffer * in);
+static GstFlowReturn gst_video_box_prepare_output_buffer (GstBaseTransform *
+    trans, GstBuffer * in, gint size, GstCaps * caps, GstBuffer ** buf);
 static void gst_video_box_fixate_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * othercaps);
 static gboolean gst_video_box_src_event (GstBaseTransform * trans,
@@ -2544,6 +2584,8 @@ gst_video_box_class_init (GstVideoBoxClass * klass)
   trans_class->transform = GST_DEBUG_FUNCPTR (gst_video_box_transform);
   trans_class->before_transform =
       GST_DEBUG_FUNCPTR (gst_video_box_before_transform);
+  trans_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_video_box_prepare_output_buffer);
   trans_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_video_box_transform_caps);
   trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_video_box_set_caps);
@@ -2567,6 +2609,7 @@ gst_video_box_init (GstVideoBox * video_box, GstVideoBoxClass * g_class)
   video_box->alpha = DEFAULT_ALPHA;
   video_box->border_alpha = DEFAULT_BORDER_ALPHA;
   video_box->autocrop = FALSE;
+  video_box->out_is_subbuffer = FALSE;
 
   video_box->mutex = g_mutex_new ();
 }
@@ -3314,7 +3357,8 @@ gst_video_box_process (GstVideoBox * video_box, const guint8 * src,
 
   if (crop_h < 0 || crop_w < 0) {
     video_box->fill (fill_type, b_alpha, video_box->out_format, dest,
-        video_box->out_sdtv, video_box->out_width, video_box->out_height);
+        video_box->out_sdtv, video_box->out_width, video_box->out_height, 0,
+        video_box->out_height);
   } else if (bb == 0 && bt == 0 && br == 0 && bl == 0) {
     video_box->copy (i_alpha, video_box->out_format, dest, video_box->out_sdtv,
         video_box->out_width, video_box->out_height, 0, 0, video_box->in_format,
@@ -3324,10 +3368,24 @@ gst_video_box_process (GstVideoBox * video_box, const guint8 * src,
     gint src_x = 0, src_y = 0;
     gint dest_x = 0, dest_y = 0;
 
-    /* Fill everything if a border should be added somewhere */
-    if (bt < 0 || bb < 0 || br < 0 || bl < 0)
+    /* Fill everything if a border should be added at the sides, otherwise
+     * only the lines above and below the frame */
+    if (br < 0 || bl < 0) {
       video_box->fill (fill_type, b_alpha, video_box->out_format, dest,
-          video_box->out_sdtv, video_box->out_width, video_box->out_height);
+          video_box->out_sdtv, video_box->out_width, video_box->out_height, 0,
+          video_box->out_height);
+    } else if (bt < 0 || bb < 0) {
+      gint frame_end = (bt < 0 ? -bt : 0) + crop_h;
+
+      if (bt < 0)
+        video_box->fill (fill_type, b_alpha, video_box->out_format, dest,
+            video_box->out_sdtv, video_box->out_width, video_box->out_height,
+            0, -bt);
+      if (bb < 0 && video_box->out_height > frame_end)
+        video_box->fill (fill_type, b_alpha, video_box->out_format, dest,
+            video_box->out_sdtv, video_box->out_width, video_box->out_height,
+            frame_end, video_box->out_height - frame_end);
+    }
 
     /* Top border */
     if (bt < 0) {
@@ -3370,6 +3428,69 @@ gst_video_box_before_transform (GstBaseTransform * trans, GstBuffer * in)
     gst_object_sync_values (G_OBJECT (video_box), stream_time);
 }
 
+/* Returns the offset of the output frame in the input frame if the output
+ * is a contiguous part of the input, i.e. only lines at the top and bottom
+ * of a packed format without alpha are cropped, or -1 otherwise */
+static gint
+gst_video_box_get_crop_offset (GstVideoBox * video_box)
+{
+  switch (video_box->out_format) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+      return -1;
+    default:
+      break;
+  }
+
+  /* The alpha channel is always scaled by the alpha property */
+  if (gst_video_format_has_alpha (video_box->out_format))
+    return -1;
+
+  if (video_box->in_format != video_box->out_format ||
+      video_box->in_sdtv != video_box->out_sdtv ||
+      video_box->in_width != video_box->out_width ||
+      video_box->box_left != 0 || video_box->box_right != 0 ||
+      video_box->box_top < 0 || video_box->box_bottom < 0 ||
+      (video_box->box_top == 0 && video_box->box_bottom == 0) ||
+      video_box->in_height - video_box->box_top - video_box->box_bottom !=
+      video_box->out_height)
+    return -1;
+
+  return video_box->box_top *
+      gst_video_format_get_row_stride (video_box->in_format, 0,
+      video_box->in_width);
+}
+
+static GstFlowReturn
+gst_video_box_prepare_output_buffer (GstBaseTransform * trans, GstBuffer * in,
+    gint size, GstCaps * caps, GstBuffer ** buf)
+{
+  GstVideoBox *video_box = GST_VIDEO_BOX (trans);
+  gint offset;
+
+  /* the borders and out_is_subbuffer are only accessed with the lock, the
+   * properties change them from the application thread */
+  g_mutex_lock (video_box->mutex);
+  video_box->out_is_subbuffer = FALSE;
+  offset = gst_video_box_get_crop_offset (video_box);
+
+  /* Let the base class allocate a buffer if we have to copy */
+  if (offset >= 0 && offset + size <= GST_BUFFER_SIZE (in)) {
+    GST_LOG_OBJECT (video_box, "cropping with a subbuffer at offset %d",
+        offset);
+
+    *buf = gst_buffer_create_sub (in, offset, size);
+    gst_buffer_set_caps (*buf, caps);
+    video_box->out_is_subbuffer = TRUE;
+  }
+  g_mutex_unlock (video_box->mutex);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_video_box_transform (GstBaseTransform * trans, GstBuffer * in,
     GstBuffer * out)
@@ -3382,7 +3503,9 @@ gst_video_box_transform (GstBaseTransform * trans, GstBuffer * in,
   outdata = GST_BUFFER_DATA (out);
 
   g_mutex_lock (video_box->mutex);
-  gst_video_box_process (video_box, indata, outdata);
+  /* Cropped with a subbuffer, nothing left to do */
+  if (!video_box->out_is_subbuffer)
+    gst_video_box_process (video_box, indata, outdata);
   g_mutex_unlock (video_box->mutex);
   return GST_FLOW_OK;
 }
@@ -32,6 +32,8 @@
  * it will always output images in exactly the same format as the input image.
  *
  * If there is nothing to crop, the element will operate in pass-through mode.
+ * If only lines at the top or bottom of a packed format are cropped, the
+ * output buffers are subbuffers of the input buffers and no data is copied.
  *
  * Note that no special efforts are made to handle chroma-subsampled formats
  * in the case of odd-valued cropping and compensate for sub-unit chroma plane
@@ -47,12 +49,6 @@
  * </refsect2>
  */
 
-/* TODO:
- *  - for packed formats, we could avoid memcpy() in case crop_left
- *    and crop_right are 0 and just create a sub-buffer of the input
- *    buffer
- */
-
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -130,6 +126,8 @@ static void gst_video_crop_get_property (GObject * object, guint prop_id,
 
 static GstCaps *gst_video_crop_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps);
+static GstFlowReturn gst_video_crop_prepare_output_buffer (GstBaseTransform *
+    trans, GstBuffer * inbuf, gint size, GstCaps * caps, GstBuffer ** outbuf);
 static GstFlowReturn gst_video_crop_transform (GstBaseTransform * trans,
     GstBuffer * inbuf, GstBuffer * outbuf);
 static gboolean gst_video_crop_get_unit_size (GstBaseTransform * trans,
@@ -228,6 +226,8 @@ gst_video_crop_class_init (GstVideoCropClass * klass)
           "Pixels to crop at bottom (-1 to auto-crop)", -1, G_MAXINT, 0,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  basetransform_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_video_crop_prepare_output_buffer);
   basetransform_class->transform = GST_DEBUG_FUNCPTR (gst_video_crop_transform);
   basetransform_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_video_crop_transform_caps);
@@ -250,6 +250,8 @@ gst_video_crop_init (GstVideoCrop * vcrop, GstVideoCropClass * klass)
   vcrop->crop_left = 0;
   vcrop->crop_top = 0;
   vcrop->crop_bottom = 0;
+  vcrop->use_subbuffers = FALSE;
+  vcrop->out_is_subbuffer = FALSE;
 }
 
 static gboolean
@@ -527,12 +529,40 @@ gst_video_crop_transform_semi_planar (GstVideoCrop * vcrop, GstBuffer * inbuf,
   }
 }
 
+static GstFlowReturn
+gst_video_crop_prepare_output_buffer (GstBaseTransform * trans,
+    GstBuffer * inbuf, gint size, GstCaps * caps, GstBuffer ** outbuf)
+{
+  GstVideoCrop *vcrop = GST_VIDEO_CROP (trans);
+  guint offset;
+
+  vcrop->out_is_subbuffer = FALSE;
+
+  /* Let the base class allocate a buffer if we have to copy */
+  if (!vcrop->use_subbuffers)
+    return GST_FLOW_OK;
+
+  offset = vcrop->crop_top * vcrop->in.stride;
+  if (offset + size > GST_BUFFER_SIZE (inbuf))
+    return GST_FLOW_OK;
+
+  *outbuf = gst_buffer_create_sub (inbuf, offset, size);
+  gst_buffer_set_caps (*outbuf, caps);
+  vcrop->out_is_subbuffer = TRUE;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_video_crop_transform (GstBaseTransform * trans, GstBuffer * inbuf,
     GstBuffer * outbuf)
 {
   GstVideoCrop *vcrop = GST_VIDEO_CROP (trans);
 
+  /* nothing to copy, the output is a part of the input */
+  if (vcrop->out_is_subbuffer)
+    return GST_FLOW_OK;
+
   switch (vcrop->in.packing) {
     case VIDEO_CROP_PIXEL_FORMAT_PACKED_SIMPLE:
       gst_video_crop_transform_packed_simple (vcrop, inbuf, outbuf);
@@ -786,6 +816,17 @@ gst_video_crop_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (crop), FALSE);
   }
 
+  /* If only lines are cropped from a packed format, the output image is a
+   * contiguous part of the input image with the same stride. Planar formats
+   * and cropped columns need a copy as buffers have no stride of their own */
+  crop->use_subbuffers =
+      (crop->in.packing == VIDEO_CROP_PIXEL_FORMAT_PACKED_SIMPLE ||
+      crop->in.packing == VIDEO_CROP_PIXEL_FORMAT_PACKED_COMPLEX) &&
+      crop->crop_left == 0 && crop->crop_right == 0 &&
+      (crop->crop_top | crop->crop_bottom) != 0 &&
+      crop->in.stride == crop->out.stride;
+  GST_LOG_OBJECT (crop, "using subbuffers: %d", crop->use_subbuffers);
+
   return TRUE;
 
   /* ERROR */
@@ -86,6 +86,9 @@ struct _GstVideoCrop
 
   GstVideoCropImageDetails in;  /* details of input image */
   GstVideoCropImageDetails out; /* details of output image */
+
+  gboolean use_subbuffers;      /* output is a part of the input buffer */
+  gboolean out_is_subbuffer;    /* current output buffer is such a part */
 };
 
 struct _GstVideoCropClass
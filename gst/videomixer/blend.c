@@ -45,7 +45,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_videomixer_blend_debug);
 static void \
 method##_ ##name (const guint8 * src, gint xpos, gint ypos, \
     gint src_width, gint src_height, gdouble src_alpha, \
-    guint8 * dest, gint dest_width, gint dest_height) \
+    guint8 * dest, gint dest_width, gint dest_height, \
+    gint dest_y_start, gint dest_y_end) \
 { \
   guint s_alpha; \
   gint src_stride, dest_stride; \
@@ -65,18 +66,21 @@ method##_ ##name (const guint8 * src, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dest_y_start) { \
+    src += (dest_y_start - ypos) * src_stride; \
+    src_height -= dest_y_start - ypos; \
+    ypos = dest_y_start; \
   } \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dest_y_end) { \
+    src_height = dest_y_end - ypos; \
   } \
+  /* nothing to do if the source doesn't cover these lines */ \
+  if (src_width <= 0 || src_height <= 0) \
+    return; \
   \
   dest = dest + 4 * xpos + (ypos * dest_stride); \
   \
@@ -110,41 +114,62 @@ BLEND_A32 (argb, overlay, _overlay_loop_bgra);
 BLEND_A32 (bgra, overlay, _overlay_loop_argb);
 #endif
 
-#define A32_CHECKER_C(name, RGB, A, C1, C2, C3) \
+/* The checker pattern only has two different kinds of lines, alternating every
+ * 8 lines. Those are rendered once with runs of 8 equal pixels and then
+ * copied to the other lines, which lets the ORC kernels do all the work. */
+static void
+fill_checker_lines (guint8 * dest, gint height, gint stride,
+    void (*render_line) (guint8 * line, gint type, gpointer user_data),
+    gpointer user_data)
+{
+  guint8 *lines[2] = { NULL, NULL };
+  gint i, type;
+
+  for (i = 0; i < height; i++) {
+    type = (i & 0x8) >> 3;
+    if (lines[type] == NULL) {
+      render_line (dest, type, user_data);
+      lines[type] = dest;
+    } else {
+      memcpy (dest, lines[type], stride);
+    }
+    dest += stride;
+  }
+}
+
+static const gint checker_tab[] = { 80, 160, 80, 160 };
+
+#define A32_CHECKER(name, RGB, A, C1, C2, C3) \
 static void \
-fill_checker_##name##_c (guint8 * dest, gint width, gint height) \
+_checker_line_##name (guint8 * line, gint type, gpointer user_data) \
 { \
-  gint i, j; \
-  gint val; \
-  static const gint tab[] = { 80, 160, 80, 160 }; \
-  \
-  if (!RGB) { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        dest[A] = 0xff; \
-        dest[C1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[C2] = 128; \
-        dest[C3] = 128; \
-        dest += 4; \
-      } \
-    } \
-  } else { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[A] = 0xFF; \
-        dest[C1] = val; \
-        dest[C2] = val; \
-        dest[C3] = val; \
-        dest += 4; \
-      } \
-    } \
+  gint width = GPOINTER_TO_INT (user_data); \
+  guint8 px[4]; \
+  guint32 val; \
+  gint j, c; \
+  \
+  for (j = 0; j < width; j += 8) { \
+    c = checker_tab[type + ((j & 0x8) >> 3)]; \
+    px[A] = 0xff; \
+    px[C1] = c; \
+    px[C2] = RGB ? c : 128; \
+    px[C3] = RGB ? c : 128; \
+    memcpy (&val, px, 4); \
+    videomixer_orc_splat_u32 ((guint32 *) (line + j * 4), val, \
+        MIN (8, width - j)); \
   } \
+} \
+\
+static void \
+fill_checker_##name (guint8 * dest, gint width, gint height) \
+{ \
+  fill_checker_lines (dest, height, width * 4, _checker_line_##name, \
+      GINT_TO_POINTER (width)); \
 }
 
-A32_CHECKER_C (argb, TRUE, 0, 1, 2, 3);
-A32_CHECKER_C (bgra, TRUE, 3, 2, 1, 0);
-A32_CHECKER_C (ayuv, FALSE, 0, 1, 2, 3);
+A32_CHECKER (argb, TRUE, 0, 1, 2, 3);
+A32_CHECKER (bgra, TRUE, 3, 2, 1, 0);
+A32_CHECKER (ayuv, FALSE, 0, 1, 2, 3);
 
 #define YUV_TO_R(Y,U,V) (CLAMP (1.164 * (Y - 16) + 1.596 * (V - 128), 0, 255))
 #define YUV_TO_G(Y,U,V) (CLAMP (1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128), 0, 255))
@@ -212,7 +237,8 @@ _blend_##format_name (const guint8 * src, guint8 * dest, \
 static void \
 blend_##format_name (const guint8 * src, gint xpos, gint ypos, \
     gint src_width, gint src_height, gdouble src_alpha, \
-    guint8 * dest, gint dest_width, gint dest_height) \
+    guint8 * dest, gint dest_width, gint dest_height, \
+    gint dest_y_start, gint dest_y_end) \
 { \
   const guint8 *b_src; \
   guint8 *b_dest; \
@@ -235,24 +261,24 @@ blend_##format_name (const guint8 * src, gint xpos, gint ypos, \
     b_src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    yoffset += -ypos; \
-    b_src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dest_y_start) { \
+    yoffset += dest_y_start - ypos; \
+    b_src_height -= dest_y_start - ypos; \
+    ypos = dest_y_start; \
   } \
   /* If x or y offset are larger then the source it's outside of the picture */ \
-  if (xoffset > src_width || yoffset > src_width) { \
+  if (xoffset > src_width || yoffset > src_height) { \
     return; \
   } \
   \
   /* adjust width/height if the src is bigger than dest */ \
-  if (xpos + src_width > dest_width) { \
+  if (xpos + b_src_width > dest_width) { \
     b_src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    b_src_height = dest_height - ypos; \
+  if (ypos + b_src_height > dest_y_end) { \
+    b_src_height = dest_y_end - ypos; \
   } \
-  if (b_src_width < 0 || b_src_height < 0) { \
+  if (b_src_width <= 0 || b_src_height <= 0) { \
     return; \
   } \
   \
@@ -306,12 +332,21 @@ blend_##format_name (const guint8 * src, gint xpos, gint ypos, \
       src_alpha); \
 }
 
+static void
+_checker_line_u8 (guint8 * line, gint type, gpointer user_data)
+{
+  gint width = GPOINTER_TO_INT (user_data);
+  gint j;
+
+  for (j = 0; j < width; j += 8)
+    memset (line + j, checker_tab[type + ((j & 0x8) >> 3)], MIN (8, width - j));
+}
+
 #define PLANAR_YUV_FILL_CHECKER(format_name, format_enum, MEMSET) \
 static void \
 fill_checker_##format_name (guint8 * dest, gint width, gint height) \
 { \
-  gint i, j; \
-  static const int tab[] = { 80, 160, 80, 160 }; \
+  gint i; \
   guint8 *p; \
   gint comp_width, comp_height; \
   gint rowstride; \
@@ -321,12 +356,8 @@ fill_checker_##format_name (guint8 * dest, gint width, gint height) \
   comp_height = gst_video_format_get_component_height (format_enum, 0, height); \
   rowstride = gst_video_format_get_row_stride (format_enum, 0, width); \
   \
-  for (i = 0; i < comp_height; i++) { \
-    for (j = 0; j < comp_width; j++) { \
-      *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-    } \
-    p += rowstride - comp_width; \
-  } \
+  fill_checker_lines (p, comp_height, rowstride, _checker_line_u8, \
+      GINT_TO_POINTER (comp_width)); \
   \
   p = dest + gst_video_format_get_component_offset (format_enum, 1, width, height); \
   comp_width = gst_video_format_get_component_width (format_enum, 1, width); \
@@ -416,7 +447,8 @@ PLANAR_YUV_FILL_COLOR (y41b, GST_VIDEO_FORMAT_Y41B, memset);
 static void \
 blend_##name (const guint8 * src, gint xpos, gint ypos, \
     gint src_width, gint src_height, gdouble src_alpha, \
-    guint8 * dest, gint dest_width, gint dest_height) \
+    guint8 * dest, gint dest_width, gint dest_height, \
+    gint dest_y_start, gint dest_y_end) \
 { \
   gint b_alpha; \
   gint i; \
@@ -433,18 +465,21 @@ blend_##name (const guint8 * src, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dest_y_start) { \
+    src += (dest_y_start - ypos) * src_stride; \
+    src_height -= dest_y_start - ypos; \
+    ypos = dest_y_start; \
   } \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dest_y_end) { \
+    src_height = dest_y_end - ypos; \
   } \
+  /* nothing to do if the source doesn't cover these lines */ \
+  if (src_width <= 0 || src_height <= 0) \
+    return; \
   \
   dest = dest + bpp * xpos + (ypos * dest_stride); \
   /* If it's completely transparent... we just return */ \
@@ -467,25 +502,29 @@ blend_##name (const guint8 * src, gint xpos, gint ypos, \
   BLENDLOOP(dest, dest_stride, src, src_stride, b_alpha, src_width * bpp, src_height); \
 }
 
-#define RGB_FILL_CHECKER_C(name, bpp, r, g, b) \
+/* red, green and blue are all equal in the checker pattern, so a run of 8
+ * pixels is a run of 8 * bpp equal bytes. The padding byte of the 32 bit
+ * formats gets the same value. */
+#define RGB_FILL_CHECKER(name, bpp) \
 static void \
-fill_checker_##name##_c (guint8 * dest, gint width, gint height) \
+_checker_line_##name (guint8 * line, gint type, gpointer user_data) \
 { \
-  gint i, j; \
-  static const int tab[] = { 80, 160, 80, 160 }; \
-  gint dest_add = GST_ROUND_UP_4 (width * bpp) - width * bpp; \
+  gint width = GPOINTER_TO_INT (user_data); \
+  gint j; \
   \
-  for (i = 0; i < height; i++) { \
-    for (j = 0; j < width; j++) { \
-      dest[r] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* red */ \
-      dest[g] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* green */ \
-      dest[b] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* blue */ \
-      dest += bpp; \
-    } \
-    dest += dest_add; \
-  } \
+  for (j = 0; j < width; j += 8) \
+    memset (line + j * bpp, checker_tab[type + ((j & 0x8) >> 3)], \
+        MIN (8, width - j) * bpp); \
+} \
+\
+static void \
+fill_checker_##name (guint8 * dest, gint width, gint height) \
+{ \
+  fill_checker_lines (dest, height, GST_ROUND_UP_4 (width * bpp), \
+      _checker_line_##name, GINT_TO_POINTER (width)); \
 }
 
+/* only the first line is rendered, the others are copies of it */
 #define RGB_FILL_COLOR(name, bpp, MEMSET_RGB) \
 static void \
 fill_color_##name (guint8 * dest, gint width, gint height, \
@@ -494,14 +533,19 @@ fill_color_##name (guint8 * dest, gint width, gint height, \
   gint red, green, blue; \
   gint i; \
   gint dest_stride = GST_ROUND_UP_4 (width * bpp); \
+  guint8 *line = dest; \
+  \
+  if (height <= 0) \
+    return; \
   \
   red = YUV_TO_R (colY, colU, colV); \
   green = YUV_TO_G (colY, colU, colV); \
   blue = YUV_TO_B (colY, colU, colV); \
   \
-  for (i = 0; i < height; i++) { \
-    MEMSET_RGB (dest, red, green, blue, width); \
+  MEMSET_RGB (dest, red, green, blue, width); \
+  for (i = 1; i < height; i++) { \
     dest += dest_stride; \
+    memcpy (dest, line, width * bpp); \
   } \
 }
 
@@ -530,7 +574,7 @@ _memset_##name (guint8* dest, gint red, gint green, gint blue, gint width) { \
 #define _orc_memcpy_u32(dest,src,len) orc_memcpy_u32((guint32 *) dest, (const guint32 *) src, len/4)
 
 RGB_BLEND (rgb, 3, memcpy, orc_blend_u8);
-RGB_FILL_CHECKER_C (rgb, 3, 0, 1, 2);
+RGB_FILL_CHECKER (rgb, 3);
 MEMSET_RGB_C (rgb, 0, 1, 2);
 RGB_FILL_COLOR (rgb_c, 3, _memset_rgb_c);
 
@@ -538,7 +582,7 @@ MEMSET_RGB_C (bgr, 2, 1, 0);
 RGB_FILL_COLOR (bgr_c, 3, _memset_bgr_c);
 
 RGB_BLEND (xrgb, 4, _orc_memcpy_u32, orc_blend_u8);
-RGB_FILL_CHECKER_C (xrgb, 4, 1, 2, 3);
+RGB_FILL_CHECKER (xrgb, 4);
 MEMSET_XRGB (xrgb, 24, 16, 0);
 RGB_FILL_COLOR (xrgb, 4, _memset_xrgb);
 
@@ -557,7 +601,8 @@ RGB_FILL_COLOR (bgrx, 4, _memset_bgrx);
 static void \
 blend_##name (const guint8 * src, gint xpos, gint ypos, \
     gint src_width, gint src_height, gdouble src_alpha, \
-    guint8 * dest, gint dest_width, gint dest_height) \
+    guint8 * dest, gint dest_width, gint dest_height, \
+    gint dest_y_start, gint dest_y_end) \
 { \
   gint b_alpha; \
   gint i; \
@@ -576,19 +621,22 @@ blend_##name (const guint8 * src, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dest_y_start) { \
+    src += (dest_y_start - ypos) * src_stride; \
+    src_height -= dest_y_start - ypos; \
+    ypos = dest_y_start; \
   } \
   \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dest_y_end) { \
+    src_height = dest_y_end - ypos; \
   } \
+  /* nothing to do if the source doesn't cover these lines */ \
+  if (src_width <= 0 || src_height <= 0) \
+    return; \
   \
   dest = dest + 2 * xpos + (ypos * dest_stride); \
   /* If it's completely transparent... we just return */ \
@@ -611,28 +659,34 @@ blend_##name (const guint8 * src, gint xpos, gint ypos, \
   BLENDLOOP(dest, dest_stride, src, src_stride, b_alpha, 2 * src_width, src_height); \
 }
 
-#define PACKED_422_FILL_CHECKER_C(name, Y1, U, Y2, V) \
+/* runs of 8 macropixels of 2 pixels each */
+#define PACKED_422_FILL_CHECKER(name, Y1, U, Y2, V) \
 static void \
-fill_checker_##name##_c (guint8 * dest, gint width, gint height) \
+_checker_line_##name (guint8 * line, gint type, gpointer user_data) \
 { \
-  gint i, j; \
-  static const int tab[] = { 80, 160, 80, 160 }; \
-  gint dest_add; \
-  \
-  width = GST_ROUND_UP_2 (width); \
-  dest_add = GST_ROUND_UP_4 (width * 2) - width * 2; \
-  width /= 2; \
-  \
-  for (i = 0; i < height; i++) { \
-    for (j = 0; j < width; j++) { \
-      dest[Y1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-      dest[Y2] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-      dest[U] = 128; \
-      dest[V] = 128; \
-      dest += 4; \
-    } \
-    dest += dest_add; \
+  gint width = GPOINTER_TO_INT (user_data); \
+  guint8 px[4]; \
+  guint32 val; \
+  gint j, c; \
+  \
+  for (j = 0; j < width; j += 8) { \
+    c = checker_tab[type + ((j & 0x8) >> 3)]; \
+    px[Y1] = c; \
+    px[Y2] = c; \
+    px[U] = 128; \
+    px[V] = 128; \
+    memcpy (&val, px, 4); \
+    videomixer_orc_splat_u32 ((guint32 *) (line + j * 4), val, \
+        MIN (8, width - j)); \
   } \
+} \
+\
+static void \
+fill_checker_##name (guint8 * dest, gint width, gint height) \
+{ \
+  width = GST_ROUND_UP_2 (width); \
+  fill_checker_lines (dest, height, GST_ROUND_UP_4 (width * 2), \
+      _checker_line_##name, GINT_TO_POINTER (width / 2)); \
 }
 
 #define PACKED_422_FILL_COLOR(name, Y1, U, Y2, V) \
@@ -657,8 +711,8 @@ fill_color_##name (guint8 * dest, gint width, gint height, \
 }
 
 PACKED_422_BLEND (yuy2, memcpy, orc_blend_u8);
-PACKED_422_FILL_CHECKER_C (yuy2, 0, 1, 2, 3);
-PACKED_422_FILL_CHECKER_C (uyvy, 1, 0, 3, 2);
+PACKED_422_FILL_CHECKER (yuy2, 0, 1, 2, 3);
+PACKED_422_FILL_CHECKER (uyvy, 1, 0, 3, 2);
 PACKED_422_FILL_COLOR (yuy2, 24, 16, 8, 0);
 PACKED_422_FILL_COLOR (yvyu, 24, 0, 8, 16);
 PACKED_422_FILL_COLOR (uyvy, 16, 24, 0, 8);
@@ -736,17 +790,17 @@ gst_video_mixer_init_blend (void)
   gst_video_mixer_blend_xrgb = blend_xrgb;
   gst_video_mixer_blend_yuy2 = blend_yuy2;
 
-  gst_video_mixer_fill_checker_argb = fill_checker_argb_c;
-  gst_video_mixer_fill_checker_bgra = fill_checker_bgra_c;
-  gst_video_mixer_fill_checker_ayuv = fill_checker_ayuv_c;
+  gst_video_mixer_fill_checker_argb = fill_checker_argb;
+  gst_video_mixer_fill_checker_bgra = fill_checker_bgra;
+  gst_video_mixer_fill_checker_ayuv = fill_checker_ayuv;
   gst_video_mixer_fill_checker_i420 = fill_checker_i420;
   gst_video_mixer_fill_checker_y444 = fill_checker_y444;
   gst_video_mixer_fill_checker_y42b = fill_checker_y42b;
   gst_video_mixer_fill_checker_y41b = fill_checker_y41b;
-  gst_video_mixer_fill_checker_rgb = fill_checker_rgb_c;
-  gst_video_mixer_fill_checker_xrgb = fill_checker_xrgb_c;
-  gst_video_mixer_fill_checker_yuy2 = fill_checker_yuy2_c;
-  gst_video_mixer_fill_checker_uyvy = fill_checker_uyvy_c;
+  gst_video_mixer_fill_checker_rgb = fill_checker_rgb;
+  gst_video_mixer_fill_checker_xrgb = fill_checker_xrgb;
+  gst_video_mixer_fill_checker_yuy2 = fill_checker_yuy2;
+  gst_video_mixer_fill_checker_uyvy = fill_checker_uyvy;
 
   gst_video_mixer_fill_color_argb = fill_color_argb;
   gst_video_mixer_fill_color_bgra = fill_color_bgra;
@@ -22,7 +22,10 @@
 
 #include <gst/gst.h>
 
-typedef void (*BlendFunction) (const guint8 * src, gint xpos, gint ypos, gint src_width, gint src_height, gdouble src_alpha, guint8 * dest, gint dest_width, gint dest_height);
+/* Only the lines dest_y_start to dest_y_end (exclusive) of dest are touched,
+ * which allows to composite horizontal stripes of a frame independently.
+ * dest_y_start has to be a multiple of the vertical subsampling. */
+typedef void (*BlendFunction) (const guint8 * src, gint xpos, gint ypos, gint src_width, gint src_height, gdouble src_alpha, guint8 * dest, gint dest_width, gint dest_height, gint dest_y_start, gint dest_y_end);
 typedef void (*FillCheckerFunction) (guint8 * dest, gint width, gint height);
 typedef void (*FillColorFunction) (guint8 * dest, gint width, gint height, gint c1, gint c2, gint c3);
 
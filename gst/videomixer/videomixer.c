@@ -1448,7 +1448,8 @@ gst_videomixer_blend_buffers (GstVideoMixer * mix, GstBuffer * outbuf)
 
       blend (GST_BUFFER_DATA (mixcol->buffer),
           pad->xpos, pad->ypos, pad->in_width, pad->in_height, pad->alpha,
-          GST_BUFFER_DATA (outbuf), mix->out_width, mix->out_height);
+          GST_BUFFER_DATA (outbuf), mix->out_width, mix->out_height,
+          0, mix->out_height);
     }
   }
 }
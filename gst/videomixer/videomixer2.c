@@ -540,10 +540,12 @@ gst_videomixer2_pad_init (GstVideoMixer2Pad * mixerpad)
 
 /* GstVideoMixer2 */
 #define DEFAULT_BACKGROUND VIDEO_MIXER2_BACKGROUND_CHECKER
+#define DEFAULT_THREADS 1
 enum
 {
   PROP_0,
-  PROP_BACKGROUND
+  PROP_BACKGROUND,
+  PROP_THREADS
 };
 
 #define GST_TYPE_VIDEO_MIXER2_BACKGROUND (gst_videomixer2_background_get_type())
@@ -815,6 +817,105 @@ gst_videomixer2_fill_queues (GstVideoMixer2 * mix,
   return 1;
 }
 
+/* A snapshot of the pad properties for one frame, so that the blending
+ * threads don't have to access the pads */
+typedef struct
+{
+  const guint8 *data;
+  gint xpos, ypos;
+  gint width, height;
+  gdouble alpha;
+} GstVideoMixer2Layer;
+
+typedef struct
+{
+  BlendFunction composite;
+  const GstVideoMixer2Layer *layers;
+  guint n_layers;
+  guint8 *dest;
+  gint width, height;
+  gint y_start, y_end;
+} GstVideoMixer2Stripe;
+
+/* Blends all layers in z-order into the lines of one stripe */
+static void
+gst_videomixer2_blend_stripe (const GstVideoMixer2Stripe * stripe)
+{
+  guint i;
+
+  for (i = 0; i < stripe->n_layers; i++) {
+    const GstVideoMixer2Layer *layer = &stripe->layers[i];
+
+    stripe->composite (layer->data, layer->xpos, layer->ypos, layer->width,
+        layer->height, layer->alpha, stripe->dest, stripe->width,
+        stripe->height, stripe->y_start, stripe->y_end);
+  }
+}
+
+static void
+gst_videomixer2_blend_worker (gpointer data, gpointer user_data)
+{
+  GstVideoMixer2 *mix = user_data;
+
+  gst_videomixer2_blend_stripe (data);
+
+  g_mutex_lock (mix->blend_lock);
+  if (--mix->blend_pending == 0)
+    g_cond_signal (mix->blend_cond);
+  g_mutex_unlock (mix->blend_lock);
+}
+
+static void
+gst_videomixer2_blend_layers (GstVideoMixer2 * mix, BlendFunction composite,
+    const GstVideoMixer2Layer * layers, guint n_layers, guint8 * dest)
+{
+  GstVideoMixer2Stripe *stripes;
+  guint n_stripes, lines, i;
+
+  /* stripes are a multiple of 16 lines high, which keeps them aligned to
+   * the vertical chroma subsampling */
+  if (mix->blend_pool != NULL) {
+    lines = GST_ROUND_UP_16 ((mix->height + mix->n_threads - 1) /
+        mix->n_threads);
+    n_stripes = (mix->height + lines - 1) / lines;
+  } else {
+    lines = mix->height;
+    n_stripes = 1;
+  }
+
+  stripes = g_newa (GstVideoMixer2Stripe, n_stripes);
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].composite = composite;
+    stripes[i].layers = layers;
+    stripes[i].n_layers = n_layers;
+    stripes[i].dest = dest;
+    stripes[i].width = mix->width;
+    stripes[i].height = mix->height;
+    stripes[i].y_start = i * lines;
+    stripes[i].y_end = MIN ((i + 1) * lines, mix->height);
+  }
+
+  if (n_stripes == 1) {
+    gst_videomixer2_blend_stripe (&stripes[0]);
+    return;
+  }
+
+  GST_LOG_OBJECT (mix, "blending %u layers in %u stripes of %u lines",
+      n_layers, n_stripes, lines);
+
+  /* hand out all but the first stripe to the pool and do that one here */
+  mix->blend_pending = n_stripes - 1;
+  for (i = 1; i < n_stripes; i++)
+    g_thread_pool_push (mix->blend_pool, &stripes[i], NULL);
+
+  gst_videomixer2_blend_stripe (&stripes[0]);
+
+  g_mutex_lock (mix->blend_lock);
+  while (mix->blend_pending > 0)
+    g_cond_wait (mix->blend_cond, mix->blend_lock);
+  g_mutex_unlock (mix->blend_lock);
+}
+
 static GstFlowReturn
 gst_videomixer2_blend_buffers (GstVideoMixer2 * mix,
     GstClockTime output_start_time, GstClockTime output_end_time,
@@ -824,6 +925,8 @@ gst_videomixer2_blend_buffers (GstVideoMixer2 * mix,
   GstFlowReturn ret;
   guint outsize;
   BlendFunction composite;
+  GstVideoMixer2Layer *layers;
+  guint n_layers = 0;
 
   outsize = gst_video_format_get_size (mix->format, mix->width, mix->height);
   ret = gst_pad_alloc_buffer_and_set_caps (mix->srcpad, GST_BUFFER_OFFSET_NONE,
@@ -857,11 +960,13 @@ gst_videomixer2_blend_buffers (GstVideoMixer2 * mix,
       break;
   }
 
+  layers = g_newa (GstVideoMixer2Layer, g_slist_length (mix->sinkpads));
   for (l = mix->sinkpads; l; l = l->next) {
     GstVideoMixer2Pad *pad = l->data;
     GstVideoMixer2Collect *mixcol = pad->mixcol;
 
     if (mixcol->buffer != NULL) {
+      GstVideoMixer2Layer *layer = &layers[n_layers++];
       GstClockTime timestamp;
       gint64 stream_time;
       GstSegment *seg;
@@ -877,12 +982,19 @@ gst_videomixer2_blend_buffers (GstVideoMixer2 * mix,
       if (GST_CLOCK_TIME_IS_VALID (stream_time))
         gst_object_sync_values (G_OBJECT (pad), stream_time);
 
-      composite (GST_BUFFER_DATA (mixcol->buffer),
-          pad->xpos, pad->ypos, pad->width, pad->height, pad->alpha,
-          GST_BUFFER_DATA (*outbuf), mix->width, mix->height);
+      layer->data = GST_BUFFER_DATA (mixcol->buffer);
+      layer->xpos = pad->xpos;
+      layer->ypos = pad->ypos;
+      layer->width = pad->width;
+      layer->height = pad->height;
+      layer->alpha = pad->alpha;
     }
   }
 
+  if (n_layers > 0)
+    gst_videomixer2_blend_layers (mix, composite, layers, n_layers,
+        GST_BUFFER_DATA (*outbuf));
+
   return GST_FLOW_OK;
 }
 
@@ -1716,6 +1828,43 @@ gst_videomixer2_push_sink_event (GstVideoMixer2 * mix, GstEvent * event)
 }
 
 /* GstElement vmethods */
+static gboolean
+gst_videomixer2_start_blend_pool (GstVideoMixer2 * mix)
+{
+  GError *err = NULL;
+
+  GST_OBJECT_LOCK (mix);
+  mix->n_threads = mix->threads;
+  GST_OBJECT_UNLOCK (mix);
+
+  mix->n_threads = gst_get_n_threads (mix->n_threads);
+
+  GST_DEBUG_OBJECT (mix, "using %u blending threads", mix->n_threads);
+  if (mix->n_threads == 1)
+    return TRUE;
+
+  /* the streaming thread blends one of the stripes itself */
+  mix->blend_pool = g_thread_pool_new (gst_videomixer2_blend_worker, mix,
+      mix->n_threads - 1, TRUE, &err);
+  if (mix->blend_pool == NULL) {
+    GST_ELEMENT_ERROR (mix, RESOURCE, FAILED,
+        ("Failed to start the blending threads"), ("%s", err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_videomixer2_stop_blend_pool (GstVideoMixer2 * mix)
+{
+  if (mix->blend_pool) {
+    g_thread_pool_free (mix->blend_pool, FALSE, TRUE);
+    mix->blend_pool = NULL;
+  }
+}
+
 static GstStateChangeReturn
 gst_videomixer2_change_state (GstElement * element, GstStateChange transition)
 {
@@ -1724,6 +1873,8 @@ gst_videomixer2_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_videomixer2_start_blend_pool (mix))
+        return GST_STATE_CHANGE_FAILURE;
       GST_LOG_OBJECT (mix, "starting collectpads");
       gst_collect_pads2_start (mix->collect);
       break;
@@ -1739,6 +1890,7 @@ gst_videomixer2_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_videomixer2_stop_blend_pool (mix);
       gst_videomixer2_reset (mix);
       break;
     default:
@@ -1857,6 +2009,8 @@ gst_videomixer2_finalize (GObject * o)
 
   gst_object_unref (mix->collect);
   g_mutex_free (mix->lock);
+  g_mutex_free (mix->blend_lock);
+  g_cond_free (mix->blend_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (o);
 }
@@ -1871,6 +2025,11 @@ gst_videomixer2_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, mix->background);
       break;
+    case PROP_THREADS:
+      GST_OBJECT_LOCK (mix);
+      g_value_set_uint (value, mix->threads);
+      GST_OBJECT_UNLOCK (mix);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1887,6 +2046,11 @@ gst_videomixer2_set_property (GObject * object,
     case PROP_BACKGROUND:
       mix->background = g_value_get_enum (value);
       break;
+    case PROP_THREADS:
+      GST_OBJECT_LOCK (mix);
+      mix->threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (mix);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1962,6 +2126,22 @@ gst_videomixer2_class_init (GstVideoMixer2Class * klass)
           GST_TYPE_VIDEO_MIXER2_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVideoMixer2:threads
+   *
+   * Number of threads used for compositing. The output frame is split into
+   * horizontal stripes that are blended in parallel, 0 selects the number
+   * of CPUs. Takes effect when going from READY to PAUSED.
+   *
+   * Since: 0.10.32
+   */
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Number of threads used for compositing (0 = number of CPUs)",
+          0, GST_MAX_THREADS, DEFAULT_THREADS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_videomixer2_request_new_pad);
   gstelement_class->release_pad =
@@ -2003,6 +2183,9 @@ gst_videomixer2_init (GstVideoMixer2 * mix, GstVideoMixer2Class * g_class)
       (GstCollectPads2ClipFunction) gst_videomixer2_sink_clip, mix);
 
   mix->lock = g_mutex_new ();
+  mix->threads = DEFAULT_THREADS;
+  mix->blend_lock = g_mutex_new ();
+  mix->blend_cond = g_cond_new ();
   /* initialize variables */
   gst_videomixer2_reset (mix);
 }
@@ -111,6 +111,14 @@ struct _GstVideoMixer2
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* Compositing of horizontal stripes in parallel */
+  guint threads;
+  guint n_threads;
+  GThreadPool *blend_pool;
+  GMutex *blend_lock;
+  GCond *blend_cond;
+  guint blend_pending;
 };
 
 struct _GstVideoMixer2Class
@@ -0,0 +1,317 @@
+/* GStreamer unit test for the alpha element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI  3.14159265358979323846
+#endif
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_YUV ("AYUV"))
+    );
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_YUV ("{ AYUV, I420 }"))
+    );
+
+/* Every chroma value once per line pair */
+#define WIDTH 256
+#define HEIGHT 256
+
+static GstElement *
+setup_alpha (void)
+{
+  GstElement *alpha;
+
+  alpha = gst_check_setup_element ("alpha");
+  mysrcpad = gst_check_setup_src_pad (alpha, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (alpha, &sinktemplate, NULL);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  return alpha;
+}
+
+static void
+cleanup_alpha (GstElement * alpha)
+{
+  GST_DEBUG ("cleaning up");
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (alpha);
+  gst_check_teardown_sink_pad (alpha);
+  gst_check_teardown_element (alpha);
+}
+
+/* Reference implementation of the chroma keying, as the element did it per
+ * pixel before it used a lookup table */
+typedef struct
+{
+  gint8 cb, cr, kg;
+  guint8 accept_angle_tg, accept_angle_ctg, one_over_kc, kfgy_scale;
+  guint noise_level2;
+} RefParams;
+
+static void
+ref_init_params (RefParams * p, guint target_r, guint target_g,
+    guint target_b, gfloat angle, gfloat noise_level)
+{
+  static const gint matrix[] = {
+    66, 129, 25, 4096,
+    -38, -74, 112, 32768,
+    112, -94, -18, 32768,
+  };
+  gfloat kgl, tmp, tmp1, tmp2, y;
+
+  y = (matrix[0] * ((gint) target_r) + matrix[1] * ((gint) target_g) +
+      matrix[2] * ((gint) target_b) + matrix[3]) >> 8;
+  tmp1 = (matrix[4] * ((gint) target_r) + matrix[5] * ((gint) target_g) +
+      matrix[6] * ((gint) target_b)) >> 8;
+  tmp2 = (matrix[8] * ((gint) target_r) + matrix[9] * ((gint) target_g) +
+      matrix[10] * ((gint) target_b)) >> 8;
+
+  kgl = sqrt (tmp1 * tmp1 + tmp2 * tmp2);
+  p->cb = 127 * (tmp1 / kgl);
+  p->cr = 127 * (tmp2 / kgl);
+
+  tmp = 15 * tan (M_PI * angle / 180);
+  tmp = MIN (tmp, 255);
+  p->accept_angle_tg = tmp;
+  tmp = 15 / tan (M_PI * angle / 180);
+  tmp = MIN (tmp, 255);
+  p->accept_angle_ctg = tmp;
+  tmp = 1 / (kgl);
+  p->one_over_kc = 255 * 2 * tmp - 255;
+  tmp = 15 * y / kgl;
+  tmp = MIN (tmp, 255);
+  p->kfgy_scale = tmp;
+  p->kg = MIN (kgl, 127);
+
+  p->noise_level2 = noise_level * noise_level;
+}
+
+static gint
+ref_chroma_keying_yuv (const RefParams * p, gint a, gint * y, gint * u,
+    gint * v, gint smin, gint smax)
+{
+  gint tmp, tmp1;
+  gint x1, y1;
+  gint x, z;
+  gint b_alpha;
+
+  if (*y < smin || *y > smax)
+    return a;
+
+  tmp = ((*u) * p->cb + (*v) * p->cr) >> 7;
+  x = CLAMP (tmp, -128, 127);
+  tmp = ((*v) * p->cb - (*u) * p->cr) >> 7;
+  z = CLAMP (tmp, -128, 127);
+
+  tmp = (x * p->accept_angle_tg) >> 4;
+  tmp = MIN (tmp, 127);
+
+  if (abs (z) > tmp)
+    return a;
+
+  tmp = (z * p->accept_angle_ctg) >> 4;
+  tmp = CLAMP (tmp, -128, 127);
+  x1 = abs (tmp);
+  y1 = z;
+
+  tmp1 = x - x1;
+  tmp1 = MAX (tmp1, 0);
+  b_alpha = (tmp1 * p->one_over_kc) / 2;
+  b_alpha = 255 - CLAMP (b_alpha, 0, 255);
+  b_alpha = (a * b_alpha) >> 8;
+
+  tmp = (tmp1 * p->kfgy_scale) >> 4;
+  tmp1 = MIN (tmp, 255);
+
+  *y = (*y < tmp1) ? 0 : *y - tmp1;
+
+  tmp = (x1 * p->cb - y1 * p->cr) >> 7;
+  *u = CLAMP (tmp, -128, 127);
+
+  tmp = (x1 * p->cr + y1 * p->cb) >> 7;
+  *v = CLAMP (tmp, -128, 127);
+
+  tmp = z * z + (x - p->kg) * (x - p->kg);
+  tmp = MIN (tmp, 0xffff);
+
+  if (tmp < p->noise_level2)
+    b_alpha = 0;
+
+  return b_alpha;
+}
+
+/* luma sweeps over the lines, chroma over the columns and line pairs */
+#define TEST_Y(i,j) (((i) * 7 + (j)) & 0xff)
+#define TEST_U(i,j) (j)
+#define TEST_V(i,j) ((i) & ~1)
+
+static GstBuffer *
+create_buffer (const gchar * format)
+{
+  GstBuffer *buf;
+  GstCaps *caps;
+  guint8 *data;
+  gint i, j;
+
+  caps = gst_caps_new_simple ("video/x-raw-yuv",
+      "format", GST_TYPE_FOURCC, GST_STR_FOURCC (format),
+      "width", G_TYPE_INT, WIDTH, "height", G_TYPE_INT, HEIGHT,
+      "framerate", GST_TYPE_FRACTION, 0, 1, NULL);
+
+  if (strcmp (format, "AYUV") == 0) {
+    buf = gst_buffer_new_and_alloc (WIDTH * HEIGHT * 4);
+    data = GST_BUFFER_DATA (buf);
+    for (i = 0; i < HEIGHT; i++) {
+      for (j = 0; j < WIDTH; j++) {
+        data[0] = 0xff;
+        data[1] = TEST_Y (i, j);
+        data[2] = TEST_U (i, j);
+        data[3] = TEST_V (i, j);
+        data += 4;
+      }
+    }
+  } else {
+    guint8 *u, *v;
+
+    /* chroma is subsampled, use the top left value of each 2x2 block */
+    buf = gst_buffer_new_and_alloc (WIDTH * HEIGHT * 3 / 2);
+    data = GST_BUFFER_DATA (buf);
+    u = data + WIDTH * HEIGHT;
+    v = u + WIDTH * HEIGHT / 4;
+    for (i = 0; i < HEIGHT; i++) {
+      for (j = 0; j < WIDTH; j++) {
+        data[i * WIDTH + j] = TEST_Y (i, j);
+        if (i % 2 == 0 && j % 2 == 0) {
+          u[(i / 2) * (WIDTH / 2) + j / 2] = TEST_U (i, j);
+          v[(i / 2) * (WIDTH / 2) + j / 2] = TEST_V (i, j);
+        }
+      }
+    }
+  }
+
+  gst_buffer_set_caps (buf, caps);
+  gst_caps_unref (caps);
+
+  return buf;
+}
+
+static void
+check_chroma_key (const gchar * format, guint target_r, guint target_g,
+    guint target_b, gfloat angle, gfloat noise_level)
+{
+  GstElement *alpha;
+  GstBuffer *inbuf, *outbuf;
+  RefParams params;
+  const guint8 *out;
+  gboolean subsampled = (strcmp (format, "I420") == 0);
+  gint i, j;
+
+  alpha = setup_alpha ();
+  g_object_set (alpha, "method", 3, "target-r", target_r, "target-g",
+      target_g, "target-b", target_b, "angle", angle, "noise-level",
+      noise_level, NULL);
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  inbuf = create_buffer (format);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuf), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuf = buffers->data;
+  fail_unless_equals_int (GST_BUFFER_SIZE (outbuf), WIDTH * HEIGHT * 4);
+
+  ref_init_params (&params, target_r, target_g, target_b, angle, noise_level);
+
+  out = GST_BUFFER_DATA (outbuf);
+  for (i = 0; i < HEIGHT; i++) {
+    for (j = 0; j < WIDTH; j++) {
+      gint y = TEST_Y (i, j);
+      gint u = TEST_U (subsampled ? i & ~1 : i, subsampled ? j & ~1 : j) - 128;
+      gint v = TEST_V (subsampled ? i & ~1 : i, subsampled ? j & ~1 : j) - 128;
+      gint a;
+
+      /* default black and white sensitivity of 100 */
+      a = ref_chroma_keying_yuv (&params, 255, &y, &u, &v, 28, 228);
+
+      fail_unless (out[0] == a && out[1] == y && out[2] == u + 128
+          && out[3] == v + 128, "%s: pixel %d,%d is %d,%d,%d,%d "
+          "instead of %d,%d,%d,%d", format, j, i, out[0], out[1], out[2],
+          out[3], a, y, u + 128, v + 128);
+      out += 4;
+    }
+  }
+
+  gst_buffer_unref (outbuf);
+  g_list_free (buffers);
+  buffers = NULL;
+
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  cleanup_alpha (alpha);
+}
+
+GST_START_TEST (test_chroma_key_ayuv)
+{
+  check_chroma_key ("AYUV", 0, 255, 0, 20.0, 2.0);
+  check_chroma_key ("AYUV", 0, 0, 255, 45.0, 8.0);
+  check_chroma_key ("AYUV", 200, 40, 90, 10.0, 0.0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_chroma_key_i420)
+{
+  check_chroma_key ("I420", 0, 255, 0, 20.0, 2.0);
+  check_chroma_key ("I420", 30, 60, 250, 60.0, 16.0);
+}
+
+GST_END_TEST;
+
+static Suite *
+alpha_suite (void)
+{
+  Suite *s = suite_create ("alpha");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_chroma_key_ayuv);
+  tcase_add_test (tc_chain, test_chroma_key_i420);
+
+  return s;
+}
+
+GST_CHECK_MAIN (alpha);
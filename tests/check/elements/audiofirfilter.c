@@ -21,6 +21,8 @@
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
 
+#include <math.h>
+
 static gboolean have_eos = FALSE;
 
 static gboolean
@@ -154,6 +156,147 @@ GST_START_TEST (test_pipeline)
 
 GST_END_TEST;
 
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw-float, "
+        "channels = (int) 1, "
+        "rate = (int) 44100, "
+        "endianness = (int) BYTE_ORDER, " "width = (int) { 32, 64 } ")
+    );
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw-float, "
+        "channels = (int) 1, "
+        "rate = (int) 44100, "
+        "endianness = (int) BYTE_ORDER, " "width = (int) { 32, 64 } ")
+    );
+
+#define KERNEL_LENGTH 100
+#define NUM_SAMPLES 1000
+#define CHUNK_SAMPLES 90
+
+/* Pushes a ramp through a kernel with two taps that is longer than the
+ * partitions and compares the output with the directly calculated
+ * convolution */
+static void
+check_partitioned (gint width, guint partition_length)
+{
+  GstElement *filter;
+  GstCaps *caps;
+  GValueArray *va;
+  GValue v = { 0, };
+  gdouble *in, *out;
+  guint i, n_out = 0;
+  GList *node;
+
+  filter = gst_check_setup_element ("audiofirfilter");
+  mysrcpad = gst_check_setup_src_pad (filter, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (filter, &sinktemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  va = g_value_array_new (KERNEL_LENGTH);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < KERNEL_LENGTH; i++) {
+    g_value_set_double (&v, (i == 37) ? 0.5 : (i == 80) ? 0.25 : 0.0);
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+  g_object_set (G_OBJECT (filter), "partition-length", partition_length,
+      "kernel", va, NULL);
+  g_value_array_free (va);
+
+  fail_unless (gst_element_set_state (filter,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_simple ("audio/x-raw-float",
+      "channels", G_TYPE_INT, 1, "rate", G_TYPE_INT, 44100,
+      "endianness", G_TYPE_INT, G_BYTE_ORDER, "width", G_TYPE_INT, width,
+      NULL);
+
+  in = g_new (gdouble, NUM_SAMPLES);
+  for (i = 0; i < NUM_SAMPLES; i++)
+    in[i] = sin (i * 0.1) + (i % 7) / 7.0;
+
+  for (i = 0; i < NUM_SAMPLES; i += CHUNK_SAMPLES) {
+    guint j, n = MIN (CHUNK_SAMPLES, NUM_SAMPLES - i);
+    GstBuffer *inbuffer;
+
+    inbuffer = gst_buffer_new_and_alloc (n * width / 8);
+    for (j = 0; j < n; j++) {
+      if (width == 32)
+        ((gfloat *) GST_BUFFER_DATA (inbuffer))[j] = in[i + j];
+      else
+        ((gdouble *) GST_BUFFER_DATA (inbuffer))[j] = in[i + j];
+    }
+    GST_BUFFER_TIMESTAMP (inbuffer) =
+        gst_util_uint64_scale_int (i, GST_SECOND, 44100);
+    gst_buffer_set_caps (inbuffer, caps);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  gst_caps_unref (caps);
+
+  out = g_new (gdouble, NUM_SAMPLES);
+  for (node = buffers; node; node = node->next) {
+    GstBuffer *outbuffer = (GstBuffer *) node->data;
+    guint n = GST_BUFFER_SIZE (outbuffer) / (width / 8);
+
+    fail_unless (n_out + n <= NUM_SAMPLES);
+    for (i = 0; i < n; i++) {
+      if (width == 32)
+        out[n_out + i] = ((gfloat *) GST_BUFFER_DATA (outbuffer))[i];
+      else
+        out[n_out + i] = ((gdouble *) GST_BUFFER_DATA (outbuffer))[i];
+    }
+    n_out += n;
+  }
+  fail_unless_equals_int (n_out, NUM_SAMPLES);
+
+  for (i = 0; i < NUM_SAMPLES; i++) {
+    gdouble expected = 0.0;
+
+    if (i >= 37)
+      expected += 0.5 * in[i - 37];
+    if (i >= 80)
+      expected += 0.25 * in[i - 80];
+    fail_unless (fabs (out[i] - expected) < 1e-5,
+        "sample %u is %f instead of %f", i, out[i], expected);
+  }
+
+  g_free (in);
+  g_free (out);
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+
+  gst_element_set_state (filter, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (filter);
+  gst_check_teardown_sink_pad (filter);
+  gst_check_teardown_element (filter);
+}
+
+GST_START_TEST (test_partitioned)
+{
+  /* one partition, partitions that divide the kernel and ones that don't */
+  check_partitioned (32, 0);
+  check_partitioned (64, 0);
+  check_partitioned (32, 25);
+  check_partitioned (64, 25);
+  check_partitioned (32, 32);
+  check_partitioned (64, 32);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiofirfilter_suite (void)
 {
@@ -162,6 +305,7 @@ audiofirfilter_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_pipeline);
+  tcase_add_test (tc_chain, test_partitioned);
 
   return s;
 }
@@ -22,6 +22,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <gst/check/gstcheck.h>
 #include <gst/video/video.h>
 
@@ -424,6 +425,141 @@ GST_START_TEST (test_mode_auto_deinterlaced_passthrough)
 
 GST_END_TEST;
 
+static void
+threads_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GList ** buffers)
+{
+  *buffers = g_list_append (*buffers, gst_buffer_ref (buffer));
+}
+
+/* runs a moving pattern through deinterlace and returns the output buffers */
+static GList *
+deinterlace_run_threads (const gchar * caps, const gchar * method,
+    guint threads)
+{
+  GstElement *bin, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+  GList *buffers = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc pattern=ball num-buffers=6 ! "
+      "%s, width=(int)320, height=(int)240, framerate=(fraction)25/1, "
+      "interlaced=(boolean)true ! deinterlace method=%s threads=%u ! "
+      "fakesink name=sink signal-handoffs=true", caps, method, threads);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (threads_handoff), &buffers);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (bin, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (bin);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+
+  return buffers;
+}
+
+static void
+deinterlace_check_threads (const gchar * caps, const gchar * method)
+{
+  GList *ref, *out, *l, *m;
+
+  ref = deinterlace_run_threads (caps, method, 1);
+  out = deinterlace_run_threads (caps, method, 4);
+
+  fail_unless (ref != NULL);
+  fail_unless_equals_int (g_list_length (ref), g_list_length (out));
+  for (l = ref, m = out; l && m; l = l->next, m = m->next) {
+    GstBuffer *a = l->data, *b = m->data;
+
+    fail_unless_equals_int (GST_BUFFER_SIZE (a), GST_BUFFER_SIZE (b));
+    fail_unless (memcmp (GST_BUFFER_DATA (a), GST_BUFFER_DATA (b),
+            GST_BUFFER_SIZE (a)) == 0, "%s output differs with threads",
+        method);
+  }
+
+  g_list_foreach (ref, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (ref);
+  g_list_foreach (out, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (out);
+}
+
+GST_START_TEST (test_threads_same_output)
+{
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)YUY2", "linear");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)YUY2", "vfir");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)YUY2",
+      "greedyh");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)YUY2",
+      "tomsmocomp");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)I420", "linear");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)I420",
+      "greedyh");
+  deinterlace_check_threads ("video/x-raw-yuv, format=(fourcc)NV12", "vfir");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_auto_quality_messages)
+{
+  GstElement *bin;
+  GstBus *bus;
+  GstMessage *msg;
+  gint n_messages = 0;
+
+  bin = gst_parse_launch ("videotestsrc pattern=ball num-buffers=60 ! "
+      "video/x-raw-yuv, format=(fourcc)I420, width=(int)320, "
+      "height=(int)240, framerate=(fraction)25/1, interlaced=(boolean)true ! "
+      "deinterlace method=auto-quality fields=all ! fakesink", NULL);
+  fail_unless (bin != NULL);
+
+  fail_unless (gst_element_set_state (bin, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (bin);
+  while ((msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+              GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+    const gchar *method;
+
+    if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ELEMENT) {
+      fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+      gst_message_unref (msg);
+      break;
+    }
+
+    if (gst_structure_has_name (s, "deinterlace-auto-quality")) {
+      method = gst_structure_get_string (s, "method");
+      fail_unless (method != NULL);
+      fail_unless (!strcmp (method, "greedyh") || !strcmp (method, "vfir")
+          || !strcmp (method, "linear"), "unexpected method %s", method);
+      fail_unless (gst_structure_has_field (s, "processing-time"));
+      fail_unless (gst_structure_has_field (s, "budget"));
+      n_messages++;
+    }
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+
+  /* 120 output frames, statistics are posted at least every 100 frames */
+  fail_unless (n_messages > 0);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
 static Suite *
 deinterlace_suite (void)
 {
@@ -438,6 +574,8 @@ deinterlace_suite (void)
   tcase_add_test (tc_chain, test_mode_disabled_accept_caps);
   tcase_add_test (tc_chain, test_mode_disabled_passthrough);
   tcase_add_test (tc_chain, test_mode_auto_deinterlaced_passthrough);
+  tcase_add_test (tc_chain, test_threads_same_output);
+  tcase_add_test (tc_chain, test_auto_quality_messages);
 
   return s;
 }
@@ -348,6 +348,11 @@ GST_END_TEST;
 
 static guint pads_created;
 
+/* the block all output buffers are parts of with batch allocation */
+static gboolean check_batch;
+static GstBuffer *batch_block;
+static guint batch_buffers;
+
 static void
 set_channel_positions (GstCaps * caps, int channels,
     GstAudioChannelPosition * channelpositions)
@@ -440,6 +445,17 @@ float_buffer_check_probe (GstPad * pad, GstBuffer * buf, gpointer userdata)
   data = (gfloat *) GST_BUFFER_DATA (buf);
   num = GST_BUFFER_SIZE (buf) / sizeof (gfloat);
 
+  /* Check that the buffer is the part of the block for its channel */
+  if (check_batch) {
+    fail_unless (buf->parent != NULL, "not a subbuffer");
+    if (batch_block == NULL)
+      batch_block = gst_buffer_ref (buf->parent);
+    fail_unless (buf->parent == batch_block, "not from the same block");
+    fail_unless (GST_BUFFER_DATA (buf) ==
+        GST_BUFFER_DATA (batch_block) + padnum * GST_BUFFER_SIZE (buf));
+    ++batch_buffers;
+  }
+
   /* Check buffer content */
   for (i = 0; i < num; ++i) {
     guint val, rest;
@@ -502,7 +518,8 @@ make_fake_src_8chans_float32 (void)
   return src;
 }
 
-GST_START_TEST (test_8_channels_float32)
+static void
+check_8_channels_float32 (gboolean batch_allocation)
 {
   GstElement *pipeline, *src, *deinterleave;
   GstMessage *msg;
@@ -514,7 +531,8 @@ GST_START_TEST (test_8_channels_float32)
 
   deinterleave = gst_element_factory_make ("deinterleave", "deinterleave");
   fail_unless (deinterleave != NULL, "failed to create deinterleave element");
-  g_object_set (deinterleave, "keep-positions", TRUE, NULL);
+  g_object_set (deinterleave, "keep-positions", TRUE,
+      "batch-allocation", batch_allocation, NULL);
 
   gst_bin_add_many (GST_BIN (pipeline), src, deinterleave, NULL);
 
@@ -525,6 +543,9 @@ GST_START_TEST (test_8_channels_float32)
       G_CALLBACK (pad_added_setup_data_check_float32_8ch_cb), pipeline);
 
   pads_created = 0;
+  check_batch = batch_allocation;
+  batch_block = NULL;
+  batch_buffers = 0;
 
   gst_element_set_state (pipeline, GST_STATE_PLAYING);
 
@@ -532,11 +553,30 @@ GST_START_TEST (test_8_channels_float32)
   gst_message_unref (msg);
 
   fail_unless_equals_int (pads_created, NUM_CHANNELS);
+  if (batch_allocation) {
+    fail_unless_equals_int (batch_buffers, NUM_CHANNELS);
+    fail_unless_equals_int (GST_BUFFER_SIZE (batch_block),
+        NUM_CHANNELS * SAMPLES_PER_BUFFER * sizeof (gfloat));
+    gst_buffer_unref (batch_block);
+  }
 
   gst_element_set_state (pipeline, GST_STATE_NULL);
   gst_object_unref (pipeline);
 }
 
+GST_START_TEST (test_8_channels_float32)
+{
+  check_8_channels_float32 (FALSE);
+}
+
+GST_END_TEST;
+
+/* all output buffers are subbuffers of one block */
+GST_START_TEST (test_8_channels_float32_batch_allocation)
+{
+  check_8_channels_float32 (TRUE);
+}
+
 GST_END_TEST;
 
 static Suite *
@@ -552,6 +592,7 @@ deinterleave_suite (void)
   tcase_add_test (tc_chain, test_2_channels_1_linked);
   tcase_add_test (tc_chain, test_2_channels_caps_change);
   tcase_add_test (tc_chain, test_8_channels_float32);
+  tcase_add_test (tc_chain, test_8_channels_float32_batch_allocation);
 
   return s;
 }
@@ -42,7 +42,7 @@ static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw-float, "
-        "channels = (int) 1, "
+        "channels = (int) [ 1, 8 ], "
         "rate = (int) 48000, "
         "endianness = (int) BYTE_ORDER, " "width = (int) 64 ")
     );
@@ -50,7 +50,7 @@ static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw-float, "
-        "channels = (int) 1, "
+        "channels = (int) [ 1, 8 ], "
         "rate = (int) 48000, "
         "endianness = (int) BYTE_ORDER, " "width = (int) 64 ")
     );
@@ -344,6 +344,130 @@ GST_START_TEST (test_equalizer_presets)
 
 GST_END_TEST;
 
+GST_START_TEST (test_equalizer_single_band)
+{
+  GstElement *equalizer;
+  GstObject *band;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  gdouble *in, *res, freq, peak;
+  gint i;
+
+  equalizer = setup_equalizer ();
+  g_object_set (G_OBJECT (equalizer), "num-bands", 10, NULL);
+
+  /* only this band is processed, the others are at 0 dB */
+  band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (equalizer), 4);
+  fail_unless (band != NULL);
+  g_object_set (G_OBJECT (band), "gain", 12.0, NULL);
+  g_object_get (G_OBJECT (band), "freq", &freq, NULL);
+  g_object_unref (G_OBJECT (band));
+
+  fail_unless (gst_element_set_state (equalizer,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  inbuffer = gst_buffer_new_and_alloc (48000 * sizeof (gdouble));
+  in = (gdouble *) GST_BUFFER_DATA (inbuffer);
+  for (i = 0; i < 48000; i++)
+    in[i] = 0.1 * sin (2.0 * G_PI * freq * i / 48000.0);
+
+  caps = gst_caps_from_string (EQUALIZER_CAPS_STRING);
+  gst_buffer_set_caps (inbuffer, caps);
+  gst_caps_unref (caps);
+
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless (g_list_length (buffers) == 1);
+
+  /* the center frequency of a peak filter is amplified by the gain, 12 dB
+   * is a factor of 3.98 */
+  res = (gdouble *) GST_BUFFER_DATA (GST_BUFFER (buffers->data));
+  peak = 0.0;
+  for (i = 24000; i < 48000; i++)
+    peak = MAX (peak, fabs (res[i]));
+  GST_DEBUG ("peak at %lf Hz is %lf", freq, peak);
+  fail_unless (peak > 0.398 * 0.95 && peak < 0.398 * 1.05);
+
+  /* cleanup */
+  cleanup_equalizer (equalizer);
+}
+
+GST_END_TEST;
+
+/* prints how many times faster than realtime the bands are processed, run
+ * with GST_DEBUG=check:4 to see the numbers */
+GST_START_TEST (test_equalizer_throughput)
+{
+  static const gint channels[] = { 1, 2, 8 };
+  static const gint bands[] = { 10, 30 };
+  gint c, b, i, n;
+
+  for (c = 0; c < G_N_ELEMENTS (channels); c++) {
+    for (b = 0; b < G_N_ELEMENTS (bands); b++) {
+      GstElement *equalizer;
+      GstCaps *caps;
+      GTimer *timer;
+      gdouble elapsed;
+      /* one second of audio in 10 buffers */
+      gint frames = 4800;
+
+      equalizer = setup_equalizer ();
+      g_object_set (G_OBJECT (equalizer), "num-bands", bands[b], NULL);
+      /* leave every third band at 0 dB */
+      for (i = 0; i < bands[b]; i++) {
+        GstObject *band =
+            gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (equalizer),
+            i);
+
+        if (i % 3 != 0)
+          g_object_set (G_OBJECT (band), "gain", (i % 2) ? 6.0 : -6.0, NULL);
+        g_object_unref (G_OBJECT (band));
+      }
+
+      fail_unless (gst_element_set_state (equalizer,
+              GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+          "could not set to playing");
+
+      caps = gst_caps_new_simple ("audio/x-raw-float",
+          "channels", G_TYPE_INT, channels[c],
+          "rate", G_TYPE_INT, 48000,
+          "endianness", G_TYPE_INT, G_BYTE_ORDER,
+          "width", G_TYPE_INT, 64, NULL);
+
+      timer = g_timer_new ();
+      g_timer_stop (timer);
+      for (n = 0; n < 10; n++) {
+        GstBuffer *inbuffer;
+        gdouble *in;
+
+        inbuffer = gst_buffer_new_and_alloc (frames * channels[c] *
+            sizeof (gdouble));
+        in = (gdouble *) GST_BUFFER_DATA (inbuffer);
+        for (i = 0; i < frames * channels[c]; i++)
+          in[i] = g_random_double_range (-1.0, 1.0);
+        gst_buffer_set_caps (inbuffer, caps);
+
+        g_timer_continue (timer);
+        fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+        g_timer_stop (timer);
+
+        g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+        g_list_free (buffers);
+        buffers = NULL;
+      }
+      elapsed = g_timer_elapsed (timer, NULL);
+      GST_INFO ("%d channels, %2d bands: %.1fx realtime", channels[c],
+          bands[b], elapsed > 0.0 ? 1.0 / elapsed : 0.0);
+      g_timer_destroy (timer);
+      gst_caps_unref (caps);
+
+      cleanup_equalizer (equalizer);
+    }
+  }
+}
+
+GST_END_TEST;
+
 
 static Suite *
 equalizer_suite (void)
@@ -357,6 +481,8 @@ equalizer_suite (void)
   tcase_add_test (tc_chain, test_equalizer_5bands_plus_12);
   tcase_add_test (tc_chain, test_equalizer_band_number_changing);
   tcase_add_test (tc_chain, test_equalizer_presets);
+  tcase_add_test (tc_chain, test_equalizer_single_band);
+  tcase_add_test (tc_chain, test_equalizer_throughput);
 
   return s;
 }
@@ -0,0 +1,430 @@
+/* GStreamer
+ *
+ * unit test for jpegdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+#include <jpeglib.h>
+
+#define NUM_FRAMES 20
+#define MAX_IN_FLIGHT 3
+
+/* Decodes a moving pattern with the given number of threads and returns
+ * all decoded pictures. The latency jpegdec reports is stored in latency. */
+static GList *
+decode_frames (guint threads, GstClockTime * latency)
+{
+  GstElement *pipeline, *dec, *sink;
+  GstBuffer *buffer;
+  GstQuery *query;
+  GstPad *pad;
+  GList *frames = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=ball ! "
+      "video/x-raw-yuv,format=(fourcc)I420,width=160,height=120,"
+      "framerate=25/1 ! jpegenc ! jpegdec name=dec threads=%u "
+      "max-in-flight=%d ! appsink name=sink", NUM_FRAMES, threads,
+      MAX_IN_FLIGHT);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_assert (pipeline != NULL);
+
+  dec = gst_bin_get_by_name (GST_BIN (pipeline), "dec");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  while ((buffer = gst_app_sink_pull_buffer (GST_APP_SINK (sink))) != NULL)
+    frames = g_list_append (frames, buffer);
+
+  /* the caps are known now, so the framerate is too */
+  pad = gst_element_get_static_pad (dec, "src");
+  query = gst_query_new_latency ();
+  fail_unless (gst_pad_query (pad, query));
+  gst_query_parse_latency (query, NULL, latency, NULL);
+  gst_query_unref (query);
+  gst_object_unref (pad);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  gst_object_unref (sink);
+  gst_object_unref (dec);
+  return frames;
+}
+
+static void
+free_frames (GList * frames)
+{
+  g_list_foreach (frames, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (frames);
+}
+
+GST_START_TEST (test_jpegdec_threads)
+{
+  GList *serial, *threaded, *s, *t;
+  GstClockTime serial_latency, threaded_latency;
+
+  serial = decode_frames (1, &serial_latency);
+  threaded = decode_frames (4, &threaded_latency);
+
+  /* the same pictures in the same order */
+  fail_unless_equals_int (g_list_length (serial), NUM_FRAMES);
+  fail_unless_equals_int (g_list_length (threaded), NUM_FRAMES);
+  for (s = serial, t = threaded; s && t; s = s->next, t = t->next) {
+    GstBuffer *a = s->data, *b = t->data;
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (b),
+        GST_BUFFER_TIMESTAMP (a));
+    fail_unless_equals_int (GST_BUFFER_SIZE (b), GST_BUFFER_SIZE (a));
+    fail_unless (memcmp (GST_BUFFER_DATA (b), GST_BUFFER_DATA (a),
+            GST_BUFFER_SIZE (a)) == 0, "picture differs with threads");
+  }
+
+  /* every picture in flight adds one frame of latency */
+  fail_unless_equals_uint64 (serial_latency, 0);
+  fail_unless_equals_uint64 (threaded_latency,
+      MAX_IN_FLIGHT * gst_util_uint64_scale (GST_SECOND, 1, 25));
+
+  free_frames (serial);
+  free_frames (threaded);
+}
+
+GST_END_TEST;
+
+/* Decodes a 320x240 picture with the given scale and filter caps after
+ * jpegdec, and returns the size of the output */
+static void
+decode_scaled (const gchar * scale, const gchar * filter, gint * width,
+    gint * height)
+{
+  GstElement *pipeline, *sink;
+  GstBuffer *buffer;
+  GstStructure *s;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 ! "
+      "video/x-raw-yuv,format=(fourcc)I420,width=320,height=240 ! jpegenc ! "
+      "jpegdec scale=%s ! %s ! appsink name=sink", scale, filter);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_assert (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  buffer = gst_app_sink_pull_buffer (GST_APP_SINK (sink));
+  fail_unless (buffer != NULL);
+  fail_unless (GST_BUFFER_CAPS (buffer) != NULL);
+
+  s = gst_caps_get_structure (GST_BUFFER_CAPS (buffer), 0);
+  fail_unless (gst_structure_get_int (s, "width", width));
+  fail_unless (gst_structure_get_int (s, "height", height));
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffer),
+      gst_video_format_get_size (GST_VIDEO_FORMAT_I420, *width, *height));
+  gst_buffer_unref (buffer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  gst_object_unref (sink);
+}
+
+GST_START_TEST (test_jpegdec_scale)
+{
+  static const struct
+  {
+    const gchar *scale;
+    gint width, height;
+  } scales[] = {
+    {
+    "full", 320, 240}, {
+    "half", 160, 120}, {
+    "quarter", 80, 60}, {
+    "eighth", 40, 30}
+  };
+  gint i, width, height;
+
+  for (i = 0; i < G_N_ELEMENTS (scales); i++) {
+    decode_scaled (scales[i].scale, "video/x-raw-yuv", &width, &height);
+    fail_unless_equals_int (width, scales[i].width);
+    fail_unless_equals_int (height, scales[i].height);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_jpegdec_auto_scale)
+{
+  gint width, height;
+
+  /* without a size downstream the picture is decoded at full size */
+  decode_scaled ("auto", "video/x-raw-yuv", &width, &height);
+  fail_unless_equals_int (width, 320);
+  fail_unless_equals_int (height, 240);
+
+  /* downstream only accepting a reduced size picks the matching scale */
+  decode_scaled ("auto", "video/x-raw-yuv,width=160,height=120", &width,
+      &height);
+  fail_unless_equals_int (width, 160);
+  fail_unless_equals_int (height, 120);
+
+  decode_scaled ("auto", "video/x-raw-yuv,width=40,height=30", &width,
+      &height);
+  fail_unless_equals_int (width, 40);
+  fail_unless_equals_int (height, 30);
+}
+
+GST_END_TEST;
+
+/* jpeglib destination that collects the compressed data in memory */
+typedef struct
+{
+  struct jpeg_destination_mgr pub;
+  guint8 *data;
+  gsize size;
+} MemDest;
+
+static void
+mem_dest_init (j_compress_ptr cinfo)
+{
+  MemDest *dest = (MemDest *) cinfo->dest;
+
+  dest->size = 4096;
+  dest->data = g_malloc (dest->size);
+  dest->pub.next_output_byte = dest->data;
+  dest->pub.free_in_buffer = dest->size;
+}
+
+static boolean
+mem_dest_empty (j_compress_ptr cinfo)
+{
+  MemDest *dest = (MemDest *) cinfo->dest;
+  gsize used = dest->size;
+
+  dest->size *= 2;
+  dest->data = g_realloc (dest->data, dest->size);
+  dest->pub.next_output_byte = dest->data + used;
+  dest->pub.free_in_buffer = dest->size - used;
+  return TRUE;
+}
+
+static void
+mem_dest_term (j_compress_ptr cinfo)
+{
+  MemDest *dest = (MemDest *) cinfo->dest;
+
+  dest->size -= dest->pub.free_in_buffer;
+}
+
+/* Encodes a picture with the given luma sampling factors, the chroma
+ * components are not subsampled themselves. The pixel values don't depend
+ * on the width, so pictures of different widths have the same left part. */
+static GstBuffer *
+encode_picture (gint width, gint height, gint n_comp, gint h_samp,
+    gint v_samp)
+{
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  MemDest dest;
+  JSAMPROW row[1];
+  GstBuffer *buffer;
+  gint x, y;
+
+  cinfo.err = jpeg_std_error (&jerr);
+  jpeg_create_compress (&cinfo);
+  dest.pub.init_destination = mem_dest_init;
+  dest.pub.empty_output_buffer = mem_dest_empty;
+  dest.pub.term_destination = mem_dest_term;
+  cinfo.dest = &dest.pub;
+
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = n_comp;
+  cinfo.in_color_space = (n_comp == 1) ? JCS_GRAYSCALE : JCS_YCbCr;
+  jpeg_set_defaults (&cinfo);
+  jpeg_set_colorspace (&cinfo, cinfo.in_color_space);
+  cinfo.comp_info[0].h_samp_factor = h_samp;
+  cinfo.comp_info[0].v_samp_factor = v_samp;
+#if JPEG_LIB_VERSION >= 70
+  cinfo.do_fancy_downsampling = FALSE;
+#endif
+  jpeg_set_quality (&cinfo, 85, TRUE);
+
+  row[0] = g_malloc (width * n_comp);
+  jpeg_start_compress (&cinfo, TRUE);
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      row[0][x * n_comp] = (x * 7 + y * 3) & 0xff;
+      if (n_comp == 3) {
+        row[0][x * n_comp + 1] = (x * 2 + y * 5) & 0xff;
+        row[0][x * n_comp + 2] = (255 - x + y * 2) & 0xff;
+      }
+    }
+    jpeg_write_scanlines (&cinfo, row, 1);
+  }
+  jpeg_finish_compress (&cinfo);
+  jpeg_destroy_compress (&cinfo);
+  g_free (row[0]);
+
+  buffer = gst_buffer_new ();
+  GST_BUFFER_MALLOCDATA (buffer) = GST_BUFFER_DATA (buffer) = dest.data;
+  GST_BUFFER_SIZE (buffer) = dest.size;
+  return buffer;
+}
+
+static GstStaticPadTemplate jpeg_srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("image/jpeg"));
+
+static GstStaticPadTemplate raw_sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw-yuv, format = (fourcc) I420; "
+        "video/x-raw-gray, bpp = (int) 8"));
+
+static GstBuffer *
+decode_picture (GstBuffer * jpeg)
+{
+  GstElement *dec;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstBuffer *buffer;
+
+  dec = gst_check_setup_element ("jpegdec");
+  srcpad = gst_check_setup_src_pad (dec, &jpeg_srctemplate, NULL);
+  sinkpad = gst_check_setup_sink_pad (dec, &raw_sinktemplate, NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (dec, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("image/jpeg, framerate = (fraction) 0/1");
+  gst_buffer_set_caps (jpeg, caps);
+  gst_caps_unref (caps);
+  fail_unless_equals_int (gst_pad_push (srcpad, jpeg), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = gst_buffer_ref (buffers->data);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (dec, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (dec);
+  gst_check_teardown_sink_pad (dec);
+  gst_check_teardown_element (dec);
+  return buffer;
+}
+
+/* A width that is a multiple of the iMCU width is decoded directly into the
+ * output buffer, two more columns make jpegdec take the indirect path. Both
+ * must produce the same picture in the shared columns. */
+static void
+check_sampling (gint n_comp, gint h_samp, gint v_samp)
+{
+  GstVideoFormat format;
+  GstBuffer *direct, *indirect;
+  gint width = 320, height = 240;
+  gint c, y, rows, cols;
+
+  direct = decode_picture (encode_picture (width, height, n_comp, h_samp,
+          v_samp));
+  indirect = decode_picture (encode_picture (width + 2, height, n_comp,
+          h_samp, v_samp));
+
+  format = (n_comp == 1) ? GST_VIDEO_FORMAT_GRAY8 : GST_VIDEO_FORMAT_I420;
+  fail_unless_equals_int (GST_BUFFER_SIZE (direct),
+      gst_video_format_get_size (format, width, height));
+  fail_unless_equals_int (GST_BUFFER_SIZE (indirect),
+      gst_video_format_get_size (format, width + 2, height));
+
+  for (c = 0; c < n_comp; c++) {
+    guint8 *a, *b;
+    gint a_stride, b_stride;
+
+    a = GST_BUFFER_DATA (direct) +
+        gst_video_format_get_component_offset (format, c, width, height);
+    b = GST_BUFFER_DATA (indirect) +
+        gst_video_format_get_component_offset (format, c, width + 2, height);
+    a_stride = gst_video_format_get_row_stride (format, c, width);
+    b_stride = gst_video_format_get_row_stride (format, c, width + 2);
+    rows = gst_video_format_get_component_height (format, c, height);
+    cols = gst_video_format_get_component_width (format, c, width);
+
+    for (y = 0; y < rows; y++) {
+      fail_unless (memcmp (a + y * a_stride, b + y * b_stride, cols) == 0,
+          "component %d differs in line %d", c, y);
+    }
+  }
+
+  gst_buffer_unref (direct);
+  gst_buffer_unref (indirect);
+}
+
+GST_START_TEST (test_jpegdec_sampling_444)
+{
+  check_sampling (3, 1, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_jpegdec_sampling_440)
+{
+  check_sampling (3, 1, 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_jpegdec_sampling_422)
+{
+  check_sampling (3, 2, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_jpegdec_sampling_gray)
+{
+  check_sampling (1, 1, 1);
+}
+
+GST_END_TEST;
+
+static Suite *
+jpegdec_suite (void)
+{
+  Suite *s = suite_create ("jpegdec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_jpegdec_scale);
+  tcase_add_test (tc_chain, test_jpegdec_auto_scale);
+  tcase_add_test (tc_chain, test_jpegdec_threads);
+  tcase_add_test (tc_chain, test_jpegdec_sampling_444);
+  tcase_add_test (tc_chain, test_jpegdec_sampling_440);
+  tcase_add_test (tc_chain, test_jpegdec_sampling_422);
+  tcase_add_test (tc_chain, test_jpegdec_sampling_gray);
+
+  return s;
+}
+
+GST_CHECK_MAIN (jpegdec);
@@ -21,6 +21,7 @@
  */
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/app/gstappsink.h>
@@ -216,6 +217,64 @@ GST_START_TEST (test_jpegenc_different_caps)
 
 GST_END_TEST;
 
+static GstBuffer *
+encode (const gchar * caps, guint threads)
+{
+  GstElement *pipeline;
+  GstElement *sink;
+  GstBuffer *buffer;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! %s ! "
+      "jpegenc threads=%u ! appsink name=sink", caps, threads);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_assert (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  buffer = gst_app_sink_pull_buffer (GST_APP_SINK (sink));
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  gst_object_unref (sink);
+  return buffer;
+}
+
+GST_START_TEST (test_jpegenc_threads)
+{
+  static const gchar *caps[] = {
+    "video/x-raw-yuv,format=(fourcc)I420,width=320,height=240",
+    "video/x-raw-yuv,format=(fourcc)Y42B,width=333,height=250",
+    "video/x-raw-gray,bpp=8,depth=8,width=64,height=40"
+  };
+  gint i, threads;
+
+  /* every MCU row of a slice starts with a restart marker, so the joined
+   * image doesn't depend on where the slices were cut */
+  for (i = 0; i < G_N_ELEMENTS (caps); i++) {
+    GstBuffer *ref, *sliced;
+
+    ref = encode (caps[i], 2);
+    fail_unless (ref != NULL);
+
+    for (threads = 3; threads <= 4; threads++) {
+      sliced = encode (caps[i], threads);
+      fail_unless (sliced != NULL);
+      fail_unless_equals_int (GST_BUFFER_SIZE (sliced), GST_BUFFER_SIZE (ref));
+      fail_unless (memcmp (GST_BUFFER_DATA (sliced), GST_BUFFER_DATA (ref),
+              GST_BUFFER_SIZE (ref)) == 0, "%s differs with %d threads",
+          caps[i], threads);
+      gst_buffer_unref (sliced);
+    }
+
+    gst_buffer_unref (ref);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 jpegenc_suite (void)
 {
@@ -225,6 +284,7 @@ jpegenc_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_jpegenc_getcaps);
   tcase_add_test (tc_chain, test_jpegenc_different_caps);
+  tcase_add_test (tc_chain, test_jpegenc_threads);
 
   return s;
 }
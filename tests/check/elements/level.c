@@ -295,6 +295,83 @@ GST_START_TEST (test_int16_panned)
 
 GST_END_TEST;
 
+GST_START_TEST (test_int16_compact)
+{
+  GstElement *level;
+  GstBuffer *inbuffer, *values, *first_values = NULL;
+  GstBus *bus;
+  GstCaps *caps;
+  GstMessage *message;
+  const GstStructure *structure;
+  int i, j, n;
+  gint channels;
+  gint16 *data;
+  const gdouble *v;
+
+  level = setup_level ();
+  g_object_set (level, "message", TRUE, "interval", GST_SECOND / 10,
+      "compact-message", TRUE, NULL);
+
+  fail_unless (gst_element_set_state (level,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  bus = gst_bus_new ();
+  gst_element_set_bus (level, bus);
+
+  caps = gst_caps_from_string (LEVEL_CAPS_STRING);
+  for (n = 0; n < 2; n++) {
+    /* a fake 0.1 sec buffer with a half-amplitude block signal */
+    inbuffer = gst_buffer_new_and_alloc (400);
+    data = (gint16 *) GST_BUFFER_DATA (inbuffer);
+    for (j = 0; j < 200; ++j)
+      data[j] = 16536;
+    gst_buffer_set_caps (inbuffer, caps);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+    message = gst_bus_poll (bus, GST_MESSAGE_ELEMENT, -1);
+    fail_unless (message != NULL);
+    structure = gst_message_get_structure (message);
+    fail_unless_equals_string ((char *) gst_structure_get_name (structure),
+        "level");
+    fail_if (gst_structure_has_field (structure, "rms"));
+    fail_unless (gst_structure_get_int (structure, "channels", &channels));
+    fail_unless_equals_int (channels, 2);
+
+    values = gst_value_get_buffer (gst_structure_get_value (structure,
+            "values"));
+    fail_unless (values != NULL);
+    fail_unless_equals_int (GST_BUFFER_SIZE (values), 3 * 2 * sizeof (gdouble));
+
+    /* rms, peak and decay of both channels are -5.94 dB */
+    v = (const gdouble *) GST_BUFFER_DATA (values);
+    for (i = 0; i < 3 * channels; i++) {
+      GST_DEBUG ("value %d is %lf", i, v[i]);
+      fail_if (v[i] < -6.0);
+      fail_if (v[i] > -5.9);
+    }
+
+    /* the buffer is reused when the previous message was freed */
+    if (first_values)
+      fail_unless (values == first_values);
+    first_values = values;
+    gst_message_unref (message);
+  }
+  gst_caps_unref (caps);
+
+  gst_bus_set_flushing (bus, TRUE);
+  gst_element_set_bus (level, NULL);
+  gst_object_unref (bus);
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  fail_unless (gst_element_set_state (level,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+  cleanup_level (level);
+}
+
+GST_END_TEST;
+
 static Suite *
 level_suite (void)
 {
@@ -304,6 +381,7 @@ level_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_int16);
   tcase_add_test (tc_chain, test_int16_panned);
+  tcase_add_test (tc_chain, test_int16_compact);
 
   return s;
 }
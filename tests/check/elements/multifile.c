@@ -148,6 +148,65 @@ GST_START_TEST (test_multifilesink_max_files)
 
 GST_END_TEST;
 
+GST_START_TEST (test_multifilesink_write_behind)
+{
+  GstElement *pipeline;
+  GstElement *mfs;
+  int i;
+  const gchar *tmpdir;
+  gchar *my_tmpdir;
+  gchar *template;
+  gchar *mfs_pattern;
+
+  tmpdir = g_get_tmp_dir ();
+  template = g_build_filename (tmpdir, "multifile-test-XXXXXX", NULL);
+  my_tmpdir = g_mkdtemp (template);
+  fail_if (my_tmpdir == NULL);
+
+  pipeline =
+      gst_parse_launch
+      ("videotestsrc num-buffers=10 ! video/x-raw-yuv,format=(fourcc)I420,width=320,height=240 ! multifilesink name=mfs",
+      NULL);
+  fail_if (pipeline == NULL);
+  mfs = gst_bin_get_by_name (GST_BIN (pipeline), "mfs");
+  fail_if (mfs == NULL);
+  mfs_pattern = g_build_filename (my_tmpdir, "%05d", NULL);
+  /* less than one frame may be queued, and the oldest files are removed
+   * behind the streaming thread too */
+  g_object_set (G_OBJECT (mfs), "location", mfs_pattern, "max-files", 5,
+      "write-behind", TRUE, "max-queued-bytes", (guint64) 1000, "fsync", 1,
+      NULL);
+  g_object_unref (mfs);
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  for (i = 0; i < 5; i++) {
+    char *s;
+
+    s = g_strdup_printf (mfs_pattern, i);
+    fail_unless (g_remove (s) != 0);
+    g_free (s);
+  }
+  for (i = 5; i < 10; i++) {
+    char *s;
+    gchar *contents;
+    gsize length;
+
+    s = g_strdup_printf (mfs_pattern, i);
+    fail_unless (g_file_get_contents (s, &contents, &length, NULL));
+    fail_unless_equals_int (length, 320 * 240 * 3 / 2);
+    g_free (contents);
+    fail_if (g_remove (s) != 0);
+    g_free (s);
+  }
+  fail_if (g_remove (my_tmpdir) != 0);
+
+  g_free (mfs_pattern);
+  g_free (my_tmpdir);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_multifilesink_key_unit)
 {
   GstElement *mfs;
@@ -264,6 +323,352 @@ GST_START_TEST (test_multifilesrc)
 
 GST_END_TEST;
 
+#define N_FILES 10
+
+static gint n_handoffs;
+
+static void
+check_file_contents (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  gint file = n_handoffs % N_FILES;
+  gint i;
+
+  fail_unless_equals_int (GST_BUFFER_SIZE (buf), 1000 + file * 3000);
+  for (i = 0; i < GST_BUFFER_SIZE (buf); i++) {
+    fail_unless (GST_BUFFER_DATA (buf)[i] == ((i + file * 7) & 0xff),
+        "wrong data in buffer %d at %d", n_handoffs, i);
+  }
+  n_handoffs++;
+}
+
+static void
+read_files (const gchar * pattern, gboolean use_mmap, guint prefetch)
+{
+  GstElement *pipeline, *src, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("multifilesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (src != NULL && sink != NULL);
+  /* wraps around at the end twice */
+  g_object_set (src, "location", pattern, "use-mmap", use_mmap,
+      "prefetch", prefetch, "loop", TRUE, "num-buffers", 2 * N_FILES + 5,
+      NULL);
+  g_object_set (sink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (check_file_contents), NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  n_handoffs = 0;
+  bus = gst_element_get_bus (pipeline);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  fail_unless_equals_int (n_handoffs, 2 * N_FILES + 5);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_multifilesrc_mmap_prefetch)
+{
+  gchar *my_tmpdir;
+  gchar *template;
+  gchar *pattern;
+  gint i, j;
+
+  template = g_build_filename (g_get_tmp_dir (), "multifile-test-XXXXXX",
+      NULL);
+  my_tmpdir = g_mkdtemp (template);
+  fail_if (my_tmpdir == NULL);
+  pattern = g_build_filename (my_tmpdir, "%05d", NULL);
+
+  for (i = 0; i < N_FILES; i++) {
+    gint size = 1000 + i * 3000;
+    gchar *data = g_malloc (size);
+    gchar *s;
+
+    for (j = 0; j < size; j++)
+      data[j] = (j + i * 7) & 0xff;
+    s = g_strdup_printf (pattern, i);
+    fail_unless (g_file_set_contents (s, data, size, NULL));
+    g_free (s);
+    g_free (data);
+  }
+
+  read_files (pattern, FALSE, 0);
+  read_files (pattern, TRUE, 0);
+  read_files (pattern, FALSE, 3);
+  read_files (pattern, TRUE, 3);
+
+  for (i = 0; i < N_FILES; i++) {
+    gchar *s;
+
+    s = g_strdup_printf (pattern, i);
+    fail_if (g_remove (s) != 0);
+    g_free (s);
+  }
+  fail_if (g_remove (my_tmpdir) != 0);
+
+  g_free (pattern);
+  g_free (my_tmpdir);
+}
+
+GST_END_TEST;
+
+#define N_PARTS 20
+
+static guint64 split_bytes;
+
+static void
+check_split_contents (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  guint64 offset = GST_BUFFER_OFFSET (buf);
+  gint i;
+
+  fail_unless_equals_uint64 (offset, split_bytes);
+  for (i = 0; i < GST_BUFFER_SIZE (buf); i++) {
+    fail_unless (GST_BUFFER_DATA (buf)[i] == (offset + i) % 251,
+        "wrong data at offset %" G_GUINT64_FORMAT, offset + i);
+  }
+  split_bytes += GST_BUFFER_SIZE (buf);
+}
+
+GST_START_TEST (test_splitfilesrc)
+{
+  GstElement *pipeline, *src, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+  gchar *my_tmpdir;
+  gchar *template;
+  gchar *pattern;
+  guint64 total = 0;
+  gint i, j;
+
+  template = g_build_filename (g_get_tmp_dir (), "multifile-test-XXXXXX",
+      NULL);
+  my_tmpdir = g_mkdtemp (template);
+  fail_if (my_tmpdir == NULL);
+
+  /* the first part is empty, and reads span several of the small parts */
+  for (i = 0; i < N_PARTS; i++) {
+    gint size = (i * 997) % 5000;
+    gchar *data = g_malloc (size + 1);
+    gchar *s, *name;
+
+    for (j = 0; j < size; j++)
+      data[j] = (total + j) % 251;
+    name = g_strdup_printf ("part-%02d", i);
+    s = g_build_filename (my_tmpdir, name, NULL);
+    fail_unless (g_file_set_contents (s, data, size, NULL));
+    g_free (s);
+    g_free (name);
+    g_free (data);
+    total += size;
+  }
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("splitfilesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (src != NULL && sink != NULL);
+  pattern = g_build_filename (my_tmpdir, "part-*", NULL);
+  g_object_set (src, "location", pattern, "max-open-files", 2,
+      "blocksize", 1500, NULL);
+  g_free (pattern);
+  g_object_set (sink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (check_split_contents), NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  split_bytes = 0;
+  bus = gst_element_get_bus (pipeline);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  fail_unless_equals_uint64 (split_bytes, total);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  for (i = 0; i < N_PARTS; i++) {
+    gchar *s, *name;
+
+    name = g_strdup_printf ("part-%02d", i);
+    s = g_build_filename (my_tmpdir, name, NULL);
+    fail_if (g_remove (s) != 0);
+    g_free (s);
+    g_free (name);
+  }
+  fail_if (g_remove (my_tmpdir) != 0);
+
+  g_free (my_tmpdir);
+}
+
+GST_END_TEST;
+
+static guint64 seek_offset, seek_bytes;
+
+static void
+count_seek_bytes (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  if (seek_bytes == 0)
+    seek_offset = GST_BUFFER_OFFSET (buf);
+  seek_bytes += GST_BUFFER_SIZE (buf);
+}
+
+/* Writes 10 frames of 115200 bytes with multifilesink, keeping only the last
+ * max_files files if it is not 0, and checks the index and the time
+ * conversions and seeks of splitfilesrc with it */
+static void
+check_splitfilesrc_index (guint max_files)
+{
+  GstElement *pipeline;
+  GstElement *mfs, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+  const gchar *tmpdir;
+  gchar *my_tmpdir;
+  gchar *template;
+  gchar *mfs_pattern;
+  gchar *index;
+  gchar *contents;
+  gchar **lines;
+  GstFormat format;
+  gint64 value;
+  gint first, n_files, seek_file;
+  int i;
+
+  first = (max_files > 0) ? 10 - max_files : 0;
+  n_files = 10 - first;
+  seek_file = n_files / 2;
+
+  tmpdir = g_get_tmp_dir ();
+  template = g_build_filename (tmpdir, "multifile-test-XXXXXX", NULL);
+  my_tmpdir = g_mkdtemp (template);
+  fail_if (my_tmpdir == NULL);
+
+  pipeline =
+      gst_parse_launch
+      ("videotestsrc num-buffers=10 ! video/x-raw-yuv,format=(fourcc)I420,width=320,height=240,framerate=10/1 ! multifilesink name=mfs",
+      NULL);
+  fail_if (pipeline == NULL);
+  mfs = gst_bin_get_by_name (GST_BIN (pipeline), "mfs");
+  fail_if (mfs == NULL);
+  mfs_pattern = g_build_filename (my_tmpdir, "%05d", NULL);
+  index = g_build_filename (my_tmpdir, "index", NULL);
+  g_object_set (G_OBJECT (mfs), "location", mfs_pattern, "index-location",
+      index, "max-files", max_files, NULL);
+  g_object_unref (mfs);
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  /* a comment and one line per file that was kept */
+  fail_unless (g_file_get_contents (index, &contents, NULL, NULL));
+  lines = g_strsplit (contents, "\n", -1);
+  fail_unless_equals_int (g_strv_length (lines), n_files + 2);
+  fail_unless (lines[0][0] == '#');
+  for (i = first; i < 10; i++) {
+    gchar *line;
+
+    line = g_strdup_printf ("%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+        " 115200 %" G_GUINT64_FORMAT " %05d", i * GST_SECOND / 10,
+        (i + 1) * GST_SECOND / 10, i * GST_SECOND / 10, i);
+    fail_unless_equals_string (lines[i - first + 1], line);
+    g_free (line);
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  pipeline = gst_parse_launch ("splitfilesrc name=src ! fakesink name=sink "
+      "sync=false signal-handoffs=true", NULL);
+  fail_if (pipeline == NULL);
+  mfs = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  fail_if (mfs == NULL);
+  g_object_set (G_OBJECT (mfs), "index-location", index, NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_if (sink == NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (count_seek_bytes), NULL);
+  gst_object_unref (sink);
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, -1);
+
+  /* times are relative to the first file that is left */
+  format = GST_FORMAT_TIME;
+  fail_unless (gst_element_query_duration (mfs, &format, &value));
+  fail_unless_equals_uint64 (value, n_files * GST_SECOND / 10);
+  /* time seeks start at the file with the position */
+  format = GST_FORMAT_BYTES;
+  fail_unless (gst_element_query_convert (mfs, GST_FORMAT_TIME,
+          seek_file * GST_SECOND / 10 + 1, &format, &value));
+  fail_unless_equals_uint64 (value, seek_file * 115200);
+  format = GST_FORMAT_TIME;
+  fail_unless (gst_element_query_convert (mfs, GST_FORMAT_BYTES,
+          2 * 115200, &format, &value));
+  fail_unless_equals_uint64 (value, 2 * GST_SECOND / 10);
+
+  /* and a real seek reads from the start of that file to the end */
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, seek_file * GST_SECOND / 10 + 1));
+  gst_element_get_state (pipeline, NULL, NULL, -1);
+
+  seek_offset = -1;
+  seek_bytes = 0;
+  bus = gst_element_get_bus (pipeline);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  fail_unless_equals_uint64 (seek_offset, seek_file * 115200);
+  fail_unless_equals_uint64 (seek_bytes, (n_files - seek_file) * 115200);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (mfs);
+  gst_object_unref (pipeline);
+
+  for (i = first; i < 10; i++) {
+    char *s;
+
+    s = g_strdup_printf (mfs_pattern, i);
+    fail_if (g_remove (s) != 0);
+    g_free (s);
+  }
+  fail_if (g_remove (index) != 0);
+  fail_if (g_remove (my_tmpdir) != 0);
+
+  g_free (index);
+  g_free (mfs_pattern);
+  g_free (my_tmpdir);
+}
+
+GST_START_TEST (test_splitfilesrc_index)
+{
+  check_splitfilesrc_index (0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_splitfilesrc_index_max_files)
+{
+  check_splitfilesrc_index (4);
+}
+
+GST_END_TEST;
+
 static Suite *
 libvisual_suite (void)
 {
@@ -274,8 +679,13 @@ libvisual_suite (void)
 
   tcase_add_test (tc_chain, test_multifilesink_key_frame);
   tcase_add_test (tc_chain, test_multifilesink_max_files);
+  tcase_add_test (tc_chain, test_multifilesink_write_behind);
   tcase_add_test (tc_chain, test_multifilesink_key_unit);
   tcase_add_test (tc_chain, test_multifilesrc);
+  tcase_add_test (tc_chain, test_multifilesrc_mmap_prefetch);
+  tcase_add_test (tc_chain, test_splitfilesrc);
+  tcase_add_test (tc_chain, test_splitfilesrc_index);
+  tcase_add_test (tc_chain, test_splitfilesrc_index_max_files);
 
   return s;
 }
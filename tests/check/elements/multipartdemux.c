@@ -0,0 +1,183 @@
+/* GStreamer unit test for the multipartdemux element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("multipart/x-mixed-replace")
+    );
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define BOUNDARY "ThisRandomString"
+
+/* the data of the parts contains pieces of the boundary */
+static const gchar *parts[] = {
+  "first part",
+  "--ThisRandom\r\n--This--ThisRandomStrin",
+  "\r\n\r\n-",
+  "a part that spans over a couple of buffers when the stream is pushed "
+      "in small chunks, which is the usual case for network sources"
+};
+
+static GstPad *mysrcpad, *mysinkpad;
+static GString *received[G_N_ELEMENTS (parts) + 1];
+static const guint8 *received_data[G_N_ELEMENTS (parts) + 1];
+static gint n_received;
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstBuffer * buf)
+{
+  fail_unless (n_received < G_N_ELEMENTS (received));
+  fail_unless (GST_BUFFER_CAPS (buf) != NULL);
+  received_data[n_received] = GST_BUFFER_DATA (buf);
+  received[n_received++] = g_string_new_len ((gchar *) GST_BUFFER_DATA (buf),
+      GST_BUFFER_SIZE (buf));
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static void
+pad_added (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  fail_unless (mysinkpad == NULL, "only one source pad expected");
+
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, sink_chain);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+static GString *
+create_stream (gsize * offsets)
+{
+  GString *stream;
+  gint i;
+
+  stream = g_string_new (NULL);
+  for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+    g_string_append (stream, "--" BOUNDARY "\r\n"
+        "Content-Type: image/jpeg\r\n\r\n");
+    offsets[i] = stream->len;
+    g_string_append_printf (stream, "%s\r\n", parts[i]);
+  }
+  /* the start of the next part ends the last one */
+  g_string_append (stream, "--" BOUNDARY "\r\n");
+
+  return stream;
+}
+
+static void
+check_demux (gsize chunk_size, gboolean subbuffers)
+{
+  GstElement *demux;
+  GstBuffer *inbuf = NULL;
+  GString *stream;
+  GstCaps *caps;
+  gsize offsets[G_N_ELEMENTS (parts)];
+  gsize offset;
+  gint i;
+
+  demux = gst_check_setup_element ("multipartdemux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added), NULL);
+  mysrcpad = gst_check_setup_src_pad (demux, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("multipart/x-mixed-replace");
+  stream = create_stream (offsets);
+  for (offset = 0; offset < stream->len; offset += chunk_size) {
+    gsize size = MIN (chunk_size, stream->len - offset);
+
+    inbuf = gst_buffer_new_and_alloc (size);
+    memcpy (GST_BUFFER_DATA (inbuf), stream->str + offset, size);
+    gst_buffer_set_caps (inbuf, caps);
+    /* keep the last buffer around to check for subbuffers */
+    gst_buffer_ref (inbuf);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuf), GST_FLOW_OK);
+    if (offset + chunk_size < stream->len)
+      gst_buffer_unref (inbuf);
+  }
+  gst_caps_unref (caps);
+
+  fail_unless_equals_int (n_received, G_N_ELEMENTS (parts));
+  for (i = 0; i < n_received; i++) {
+    fail_unless_equals_string (received[i]->str, parts[i]);
+    /* the parts are not copied out of the input buffer */
+    if (subbuffers)
+      fail_unless (received_data[i] == GST_BUFFER_DATA (inbuf) + offsets[i],
+          "part %d is not a subbuffer of the input", i);
+    g_string_free (received[i], TRUE);
+  }
+  n_received = 0;
+
+  g_string_free (stream, TRUE);
+  gst_buffer_unref (inbuf);
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (demux);
+  if (mysinkpad) {
+    gst_pad_set_active (mysinkpad, FALSE);
+    gst_object_unref (mysinkpad);
+    mysinkpad = NULL;
+  }
+  gst_check_teardown_element (demux);
+}
+
+GST_START_TEST (test_demux_one_buffer)
+{
+  check_demux (G_MAXSIZE, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_demux_split_boundary)
+{
+  gsize chunk_size;
+
+  /* every possible split of the boundaries and headers */
+  for (chunk_size = 1; chunk_size <= 32; chunk_size++)
+    check_demux (chunk_size, FALSE);
+}
+
+GST_END_TEST;
+
+static Suite *
+multipartdemux_suite (void)
+{
+  Suite *s = suite_create ("multipartdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_demux_one_buffer);
+  tcase_add_test (tc_chain, test_demux_split_boundary);
+
+  return s;
+}
+
+GST_CHECK_MAIN (multipartdemux);
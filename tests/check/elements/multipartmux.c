@@ -0,0 +1,211 @@
+/* GStreamer unit test for the multipartmux element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("multipart/x-mixed-replace"));
+
+#define BOUNDARY "SomeOtherBoundary"
+
+/* parts of the same size and type share the header, the others need a new
+ * one, with a new prefix when the type changes */
+static const struct
+{
+  const gchar *caps;
+  const gchar *data;
+} parts[] = {
+  {
+  "image/jpeg", "0123456789"}, {
+  "image/jpeg", "abcdefghij"}, {
+  "image/jpeg", "a longer part"}, {
+  "image/jpeg", "9876543210"}, {
+  "image/png", "9876543210"}, {
+  "image/png", "x"}, {
+  "image/jpeg", "0123456789"}
+};
+
+static GstPad *mysrcpad, *mysinkpad;
+static GString *received;
+static gint n_buffers, n_lists;
+static const guint8 *part_data[G_N_ELEMENTS (parts)];
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstBuffer * buf)
+{
+  fail_unless (GST_BUFFER_CAPS (buf) != NULL);
+  g_string_append_len (received, (gchar *) GST_BUFFER_DATA (buf),
+      GST_BUFFER_SIZE (buf));
+  n_buffers++;
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+/* every group holds the header, the data and the footer of one part */
+static GstFlowReturn
+sink_chain_list (GstPad * pad, GstBufferList * list)
+{
+  GstBufferListIterator *it;
+  GstBuffer *buf;
+
+  it = gst_buffer_list_iterate (list);
+  while (gst_buffer_list_iterator_next_group (it)) {
+    fail_unless_equals_int (gst_buffer_list_iterator_n_buffers (it), 3);
+    while ((buf = gst_buffer_list_iterator_next (it))) {
+      fail_unless (GST_BUFFER_CAPS (buf) != NULL);
+      /* the data is not copied */
+      if (n_buffers % 3 == 1)
+        fail_unless (GST_BUFFER_DATA (buf) == part_data[n_lists]);
+      g_string_append_len (received, (gchar *) GST_BUFFER_DATA (buf),
+          GST_BUFFER_SIZE (buf));
+      n_buffers++;
+    }
+    n_lists++;
+  }
+  gst_buffer_list_iterator_free (it);
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+/* the output the element produced before the headers were cached */
+static GString *
+create_stream (void)
+{
+  GString *stream;
+  gint i;
+
+  stream = g_string_new (NULL);
+  for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+    g_string_append_printf (stream, "--%s\r\nContent-Type: %s\r\n"
+        "Content-Length: %u\r\n\r\n", BOUNDARY, parts[i].caps,
+        (guint) strlen (parts[i].data));
+    g_string_append (stream, parts[i].data);
+    g_string_append (stream, "\r\n");
+  }
+
+  return stream;
+}
+
+static void
+check_mux (gboolean buffer_list)
+{
+  GstElement *mux;
+  GstPad *pad, *srcpad;
+  GString *stream;
+  gint i;
+
+  received = g_string_new (NULL);
+  n_buffers = n_lists = 0;
+
+  mux = gst_check_setup_element ("multipartmux");
+  g_object_set (mux, "boundary", BOUNDARY, "buffer-list", buffer_list, NULL);
+
+  mysrcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  gst_pad_set_active (mysrcpad, TRUE);
+  pad = gst_element_get_request_pad (mux, "sink_%d");
+  fail_unless (pad != NULL);
+  fail_unless (gst_pad_link (mysrcpad, pad) == GST_PAD_LINK_OK);
+
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, sink_chain);
+  if (buffer_list)
+    gst_pad_set_chain_list_function (mysinkpad, sink_chain_list);
+  gst_pad_set_active (mysinkpad, TRUE);
+  srcpad = gst_element_get_static_pad (mux, "src");
+  fail_unless (gst_pad_link (srcpad, mysinkpad) == GST_PAD_LINK_OK);
+
+  fail_unless_equals_int (gst_element_set_state (mux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+    GstBuffer *buf;
+    GstCaps *caps;
+    gsize size = strlen (parts[i].data);
+
+    buf = gst_buffer_new_and_alloc (size);
+    memcpy (GST_BUFFER_DATA (buf), parts[i].data, size);
+    part_data[i] = GST_BUFFER_DATA (buf);
+    GST_BUFFER_TIMESTAMP (buf) = i * GST_SECOND;
+    caps = gst_caps_new_simple (parts[i].caps, NULL);
+    gst_buffer_set_caps (buf, caps);
+    gst_caps_unref (caps);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the same bytes as before, in one group per part or three buffers */
+  stream = create_stream ();
+  fail_unless_equals_int (received->len, stream->len);
+  fail_unless (memcmp (received->str, stream->str, stream->len) == 0,
+      "output differs from the old format");
+  fail_unless_equals_int (n_buffers, 3 * G_N_ELEMENTS (parts));
+  fail_unless_equals_int (n_lists, buffer_list ? G_N_ELEMENTS (parts) : 0);
+  g_string_free (stream, TRUE);
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  gst_pad_unlink (srcpad, mysinkpad);
+  gst_object_unref (srcpad);
+  gst_pad_unlink (mysrcpad, pad);
+  gst_element_release_request_pad (mux, pad);
+  gst_object_unref (pad);
+  gst_object_unref (mysrcpad);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_element (mux);
+
+  g_string_free (received, TRUE);
+}
+
+GST_START_TEST (test_multipartmux_buffers)
+{
+  check_mux (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_multipartmux_buffer_list)
+{
+  check_mux (TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+multipartmux_suite (void)
+{
+  Suite *s = suite_create ("multipartmux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_multipartmux_buffers);
+  tcase_add_test (tc_chain, test_multipartmux_buffer_list);
+
+  return s;
+}
+
+GST_CHECK_MAIN (multipartmux);
@@ -0,0 +1,116 @@
+/* GStreamer unit test for the pulsesink element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+/* Waits until the pipeline has played for at least min. Returns FALSE when an
+ * error was posted instead. */
+static gboolean
+wait_for_position (GstElement * pipeline, gint64 min)
+{
+  GstBus *bus;
+  GstMessage *msg;
+  GstFormat format = GST_FORMAT_TIME;
+  gint64 pos = -1;
+  gint i;
+
+  bus = gst_element_get_bus (pipeline);
+  for (i = 0; i < 500; i++) {
+    msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+    if (msg) {
+      gst_message_unref (msg);
+      gst_object_unref (bus);
+      return FALSE;
+    }
+    if (gst_element_query_position (pipeline, &format, &pos) && pos >= min)
+      break;
+    g_usleep (G_USEC_PER_SEC / 100);
+  }
+  gst_object_unref (bus);
+
+  fail_unless (pos >= min, "position stuck at %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (pos));
+  return TRUE;
+}
+
+/* With coalescing, a part of a PulseAudio write block can still be pending
+ * when seeking. Those samples are from before the flush and have to be
+ * dropped, after the seek the sink must play from the new position. */
+GST_START_TEST (test_pulsesink_seek_coalesced)
+{
+  GstElement *pipeline;
+  GstStateChangeReturn ret;
+  GstFormat format = GST_FORMAT_TIME;
+  gint64 pos;
+  gint i;
+
+  pipeline = gst_parse_launch ("audiotestsrc samplesperbuffer=441 ! "
+      "audio/x-raw-int,rate=44100,channels=2 ! "
+      "pulsesink coalesce-segments=8 buffer-time=400000 latency-time=10000",
+      NULL);
+  fail_unless (pipeline != NULL);
+
+  ret = gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  if (ret == GST_STATE_CHANGE_FAILURE ||
+      gst_element_get_state (pipeline, NULL, NULL,
+          5 * GST_SECOND) != GST_STATE_CHANGE_SUCCESS) {
+    GST_INFO ("no PulseAudio server, skipping");
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+    return;
+  }
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 5; i++) {
+    fail_unless (wait_for_position (pipeline, 300 * GST_MSECOND));
+
+    /* segments are held back for a larger write at this point */
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, 0));
+    fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+            5 * GST_SECOND) == GST_STATE_CHANGE_SUCCESS);
+
+    /* playback restarts at the seek position instead of continuing with
+     * the old samples */
+    fail_unless (gst_element_query_position (pipeline, &format, &pos));
+    fail_unless (pos < 300 * GST_MSECOND, "position %" GST_TIME_FORMAT
+        " after seeking to 0", GST_TIME_ARGS (pos));
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+pulsesink_suite (void)
+{
+  Suite *s = suite_create ("pulsesink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_pulsesink_seek_coalesced);
+
+  return s;
+}
+
+GST_CHECK_MAIN (pulsesink);
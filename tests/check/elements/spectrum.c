@@ -536,6 +536,99 @@ GST_START_TEST (test_float64)
 
 GST_END_TEST;
 
+GST_START_TEST (test_int16_threaded_compact)
+{
+  GstElement *spectrum;
+  GstBuffer *inbuffer, *values;
+  GstBus *bus;
+  GstCaps *caps;
+  GstMessage *message;
+  const GstStructure *structure;
+  int i, j, n;
+  gint bands, channels;
+  gint16 *data;
+  const gfloat *level;
+
+  spectrum = setup_spectrum ();
+  g_object_set (spectrum, "post-messages", TRUE, "interval", GST_SECOND / 100,
+      "bands", SPECT_BANDS, "threshold", -80, "overlap", 0.5,
+      "threaded", TRUE, "compact-message", TRUE, NULL);
+  gst_util_set_object_arg (G_OBJECT (spectrum), "window", "hann");
+
+  fail_unless (gst_element_set_state (spectrum,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  bus = gst_bus_new ();
+  gst_element_set_bus (spectrum, bus);
+
+  caps = gst_caps_from_string (SPECT_CAPS_STRING_S16);
+
+  /* push 100 intervals of 10ms with an 11025 Hz sine wave. The message of
+   * each interval is waited for before the next one, so the worker thread
+   * never falls behind and skips FFTs */
+  for (n = 0; n < 100; n++) {
+    inbuffer = gst_buffer_new_and_alloc (441 * sizeof (gint16));
+    data = (gint16 *) GST_BUFFER_DATA (inbuffer);
+    for (j = 0; j < 441; j++) {
+      gint k = (n * 441 + j) % 4;
+
+      data[j] = (k == 1) ? 32767 : ((k == 3) ? -32767 : 0);
+    }
+    GST_BUFFER_TIMESTAMP (inbuffer) = n * GST_SECOND / 100;
+    gst_buffer_set_caps (inbuffer, caps);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+    message = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND,
+        GST_MESSAGE_ELEMENT);
+    fail_unless (message != NULL, "no message for interval %d", n);
+    structure = gst_message_get_structure (message);
+    fail_if (gst_structure_has_field (structure, "skipped"));
+    if (n < 99)
+      gst_message_unref (message);
+  }
+  gst_caps_unref (caps);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  /* one message for every 10ms and no more */
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  /* the FFTs of the last interval see the sine wave only */
+  structure = gst_message_get_structure (message);
+  fail_unless_equals_string ((char *) gst_structure_get_name (structure),
+      "spectrum");
+  fail_unless (gst_structure_get_int (structure, "bands", &bands));
+  fail_unless_equals_int (bands, SPECT_BANDS);
+  fail_unless (gst_structure_get_int (structure, "channels", &channels));
+  fail_unless_equals_int (channels, 1);
+  fail_if (gst_structure_has_field (structure, "phase"));
+
+  values = gst_value_get_buffer (gst_structure_get_value (structure,
+          "magnitude"));
+  fail_unless (values != NULL);
+  fail_unless_equals_int (GST_BUFFER_SIZE (values),
+      SPECT_BANDS * sizeof (gfloat));
+  level = (const gfloat *) GST_BUFFER_DATA (values);
+  for (i = 0; i < SPECT_BANDS; ++i) {
+    GST_DEBUG ("band[%3d] is %.2f", i, level[i]);
+    fail_if ((i == SPECT_BANDS / 2 || i == SPECT_BANDS / 2 - 1)
+        && level[i] < -20.0);
+    fail_if ((i != SPECT_BANDS / 2 && i != SPECT_BANDS / 2 - 1)
+        && level[i] > -20.0);
+  }
+  gst_message_unref (message);
+
+  gst_bus_set_flushing (bus, TRUE);
+  gst_element_set_bus (spectrum, NULL);
+  gst_object_unref (bus);
+  fail_unless (gst_element_set_state (spectrum,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+  ASSERT_OBJECT_REFCOUNT (spectrum, "spectrum", 1);
+  cleanup_spectrum (spectrum);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 spectrum_suite (void)
@@ -548,6 +641,7 @@ spectrum_suite (void)
   tcase_add_test (tc_chain, test_int32);
   tcase_add_test (tc_chain, test_float32);
   tcase_add_test (tc_chain, test_float64);
+  tcase_add_test (tc_chain, test_int16_threaded_compact);
 
   return s;
 }
@@ -0,0 +1,269 @@
+/* GStreamer unit test for the videobox element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <string.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_YUV ("{ AYUV, YUY2 }") ";"
+        GST_VIDEO_CAPS_GRAY8)
+    );
+
+/* One sink template per format, otherwise videobox would prefer a format
+ * with alpha channel on the output */
+static GstStaticPadTemplate sinktemplate_ayuv = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_YUV ("AYUV"))
+    );
+static GstStaticPadTemplate sinktemplate_yuy2 = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_YUV ("YUY2"))
+    );
+static GstStaticPadTemplate sinktemplate_gray8 =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_GRAY8)
+    );
+
+#define WIDTH 64
+#define HEIGHT 48
+
+static GstElement *
+setup_videobox (GstStaticPadTemplate * sinktemplate)
+{
+  GstElement *videobox;
+
+  videobox = gst_check_setup_element ("videobox");
+  mysrcpad = gst_check_setup_src_pad (videobox, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (videobox, sinktemplate, NULL);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  return videobox;
+}
+
+static void
+cleanup_videobox (GstElement * videobox)
+{
+  GST_DEBUG ("cleaning up");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (videobox);
+  gst_check_teardown_sink_pad (videobox);
+  gst_check_teardown_element (videobox);
+}
+
+static GstBuffer *
+create_buffer (GstVideoFormat format)
+{
+  GstBuffer *buf;
+  GstCaps *caps;
+  guint8 *data;
+  gint i, size;
+
+  size = gst_video_format_get_size (format, WIDTH, HEIGHT);
+  buf = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (buf);
+  for (i = 0; i < size; i++)
+    data[i] = (i * 7 + i / 251) & 0xff;
+
+  caps = gst_video_format_new_caps (format, WIDTH, HEIGHT, 0, 1, 1, 1);
+  gst_buffer_set_caps (buf, caps);
+  gst_caps_unref (caps);
+
+  return buf;
+}
+
+static GstBuffer *
+push_buffer (GstElement * videobox, GstBuffer * inbuf)
+{
+  fail_unless_equals_int (gst_element_set_state (videobox, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuf), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  return buffers->data;
+}
+
+GST_START_TEST (test_letterbox_gray8)
+{
+  GstElement *videobox;
+  GstBuffer *inbuf, *outbuf;
+  const guint8 *in, *out;
+  gint stride = GST_ROUND_UP_4 (WIDTH);
+  gint i;
+
+  videobox = setup_videobox (&sinktemplate_gray8);
+  g_object_set (videobox, "top", -3, "bottom", -5, NULL);
+
+  inbuf = create_buffer (GST_VIDEO_FORMAT_GRAY8);
+  in = GST_BUFFER_DATA (inbuf);
+  gst_buffer_ref (inbuf);
+  outbuf = push_buffer (videobox, inbuf);
+  fail_unless_equals_int (GST_BUFFER_SIZE (outbuf), stride * (HEIGHT + 8));
+
+  out = GST_BUFFER_DATA (outbuf);
+  for (i = 0; i < HEIGHT + 8; i++) {
+    if (i < 3 || i >= HEIGHT + 3) {
+      gint j;
+
+      for (j = 0; j < WIDTH; j++)
+        fail_unless (out[i * stride + j] == 16, "line %d is not black", i);
+    } else {
+      fail_unless (memcmp (out + i * stride, in + (i - 3) * stride,
+              WIDTH) == 0, "line %d is not copied", i);
+    }
+  }
+
+  gst_buffer_unref (inbuf);
+  cleanup_videobox (videobox);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_border_ayuv)
+{
+  GstElement *videobox;
+  GstBuffer *inbuf, *outbuf;
+  const guint8 *in, *out;
+  gint out_width = WIDTH + 6, out_height = HEIGHT + 3;
+  gint i, j;
+
+  videobox = setup_videobox (&sinktemplate_ayuv);
+  g_object_set (videobox, "top", -1, "bottom", -2, "left", -4, "right", -2,
+      "alpha", 0.5, "border-alpha", 0.0, "fill", 1, NULL);
+
+  inbuf = create_buffer (GST_VIDEO_FORMAT_AYUV);
+  in = GST_BUFFER_DATA (inbuf);
+  gst_buffer_ref (inbuf);
+  outbuf = push_buffer (videobox, inbuf);
+  fail_unless_equals_int (GST_BUFFER_SIZE (outbuf),
+      out_width * out_height * 4);
+
+  out = GST_BUFFER_DATA (outbuf);
+  for (i = 0; i < out_height; i++) {
+    for (j = 0; j < out_width; j++) {
+      const guint8 *p = out + (i * out_width + j) * 4;
+
+      if (i < 1 || i >= HEIGHT + 1 || j < 4 || j >= WIDTH + 4) {
+        /* green border, transparent */
+        fail_unless (p[0] == 0 && p[1] == 145 && p[2] == 54 && p[3] == 34,
+            "border pixel %d,%d is %d,%d,%d,%d", j, i, p[0], p[1], p[2], p[3]);
+      } else {
+        const guint8 *q = in + ((i - 1) * WIDTH + (j - 4)) * 4;
+
+        fail_unless (p[0] == (q[0] * 128) >> 8 && p[1] == q[1]
+            && p[2] == q[2] && p[3] == q[3], "frame pixel %d,%d is wrong", j,
+            i);
+      }
+    }
+  }
+
+  gst_buffer_unref (inbuf);
+  cleanup_videobox (videobox);
+}
+
+GST_END_TEST;
+
+static void
+check_crop_yuy2 (gint left, gint right, gint top, gint bottom,
+    gboolean subbuffer)
+{
+  GstElement *videobox;
+  GstBuffer *inbuf, *outbuf;
+  const guint8 *in, *out;
+  gint in_stride, out_stride, out_width, out_height;
+  gint i;
+
+  videobox = setup_videobox (&sinktemplate_yuy2);
+  g_object_set (videobox, "left", left, "right", right, "top", top,
+      "bottom", bottom, NULL);
+
+  out_width = WIDTH - left - right;
+  out_height = HEIGHT - top - bottom;
+  in_stride = GST_ROUND_UP_4 (WIDTH * 2);
+  out_stride = GST_ROUND_UP_4 (out_width * 2);
+
+  inbuf = create_buffer (GST_VIDEO_FORMAT_YUY2);
+  in = GST_BUFFER_DATA (inbuf);
+  gst_buffer_ref (inbuf);
+  outbuf = push_buffer (videobox, inbuf);
+  fail_unless_equals_int (GST_BUFFER_SIZE (outbuf), out_stride * out_height);
+
+  out = GST_BUFFER_DATA (outbuf);
+  if (subbuffer)
+    fail_unless (out == in + top * in_stride,
+        "output is not a subbuffer of the input");
+  else
+    fail_unless (out < in || out >= in + GST_BUFFER_SIZE (inbuf),
+        "output unexpectedly shares memory with the input");
+
+  for (i = 0; i < out_height; i++) {
+    fail_unless (memcmp (out + i * out_stride,
+            in + (i + top) * in_stride + left * 2, out_width * 2) == 0,
+        "line %d is not cropped correctly", i);
+  }
+
+  gst_buffer_unref (inbuf);
+  cleanup_videobox (videobox);
+}
+
+GST_START_TEST (test_crop_subbuffer)
+{
+  /* only lines are cropped, the output is a part of the input */
+  check_crop_yuy2 (0, 0, 3, 5, TRUE);
+  check_crop_yuy2 (0, 0, 0, 7, TRUE);
+  /* columns need to be copied */
+  check_crop_yuy2 (2, 4, 3, 5, FALSE);
+}
+
+GST_END_TEST;
+
+static Suite *
+videobox_suite (void)
+{
+  Suite *s = suite_create ("videobox");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_letterbox_gray8);
+  tcase_add_test (tc_chain, test_border_ayuv);
+  tcase_add_test (tc_chain, test_crop_subbuffer);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videobox);
@@ -547,6 +547,78 @@ GST_START_TEST (test_passthrough)
 
 GST_END_TEST;
 
+static void
+check_subbuffer (const gchar * caps_str, gint top, gint bottom,
+    gboolean subbuffer)
+{
+  GstStateChangeReturn state_ret;
+  GstVideoCropTestContext ctx;
+  GstCaps *caps;
+  GstPad *srcpad;
+  GstBuffer *gen_buf = NULL;    /* buffer generated by videotestsrc */
+  const guint8 *gen_data, *out_data;
+
+  videocrop_test_cropping_init_context (&ctx);
+
+  g_object_set (ctx.src, "num-buffers", 1, NULL);
+
+  srcpad = gst_element_get_static_pad (ctx.src, "src");
+  fail_unless (srcpad != NULL);
+  gst_pad_add_buffer_probe (srcpad, G_CALLBACK (buffer_probe_cb), &gen_buf);
+  gst_object_unref (srcpad);
+
+  caps = gst_caps_from_string (caps_str);
+  g_object_set (ctx.filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (ctx.crop, "left", 0, "right", 0, "top", top, "bottom",
+      bottom, NULL);
+
+  state_ret = gst_element_set_state (ctx.pipeline, GST_STATE_PAUSED);
+  fail_unless (state_ret != GST_STATE_CHANGE_FAILURE,
+      "couldn't set pipeline to PAUSED state");
+
+  state_ret = gst_element_get_state (ctx.pipeline, NULL, NULL, -1);
+  fail_unless (state_ret == GST_STATE_CHANGE_SUCCESS,
+      "pipeline failed to go to PAUSED state");
+
+  fail_unless (gen_buf != NULL);
+  fail_unless (ctx.last_buf != NULL);
+
+  gen_data = GST_BUFFER_DATA (gen_buf);
+  out_data = GST_BUFFER_DATA (ctx.last_buf);
+  if (subbuffer) {
+    /* all formats tested here have 2 bytes per pixel */
+    fail_unless (out_data == gen_data + top * GST_ROUND_UP_4 (160 * 2),
+        "output is not a subbuffer of the input");
+    fail_unless_equals_int (GST_BUFFER_SIZE (ctx.last_buf),
+        GST_ROUND_UP_4 (160 * 2) * (120 - top - bottom));
+  } else {
+    fail_unless (out_data < gen_data ||
+        out_data >= gen_data + GST_BUFFER_SIZE (gen_buf),
+        "output unexpectedly shares memory with the input");
+  }
+
+  videocrop_test_cropping_deinit_context (&ctx);
+  gst_buffer_unref (gen_buf);
+}
+
+GST_START_TEST (test_subbuffer)
+{
+  const gchar *yuy2 = "video/x-raw-yuv,format=(fourcc)YUY2,"
+      "width=160,height=120,framerate=1/1";
+  const gchar *i420 = "video/x-raw-yuv,format=(fourcc)I420,"
+      "width=160,height=120,framerate=1/1";
+
+  check_subbuffer (yuy2, 10, 20, TRUE);
+  check_subbuffer (yuy2, 0, 1, TRUE);
+  check_subbuffer (yuy2, 7, 0, TRUE);
+  /* planar formats have to be copied */
+  check_subbuffer (i420, 10, 20, FALSE);
+}
+
+GST_END_TEST;
+
 static gint
 notgst_value_list_get_nth_int (const GValue * list_val, guint n)
 {
@@ -824,6 +896,7 @@ videocrop_suite (void)
   tcase_add_test (tc_chain, test_crop_to_1x1);
   tcase_add_test (tc_chain, test_caps_transform);
   tcase_add_test (tc_chain, test_passthrough);
+  tcase_add_test (tc_chain, test_subbuffer);
   tcase_add_test (tc_chain, test_unit_sizes);
   tcase_add_loop_test (tc_chain, test_cropping, 0, 25);
 
@@ -0,0 +1,143 @@
+/* GStreamer unit test for the videomixer2 element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+#define N_BUFFERS 5
+
+static void
+sink_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GList ** buffers)
+{
+  *buffers = g_list_append (*buffers, gst_buffer_ref (buffer));
+}
+
+/* Mixes a moving, translucent picture over a background one and returns the
+ * output buffers. The overlay is not aligned to the blending stripes. */
+static GList *
+mix_frames (const gchar * format, guint threads)
+{
+  GstElement *pipeline, *mix, *sink;
+  GstPad *pad;
+  GstBus *bus;
+  GstMessage *msg;
+  GList *buffers = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=smpte ! "
+      "video/x-raw-yuv,format=(fourcc)%s,width=320,height=240,"
+      "framerate=25/1 ! videomixer2 name=mix threads=%u ! "
+      "fakesink name=sink signal-handoffs=true "
+      "videotestsrc num-buffers=%d pattern=ball ! "
+      "video/x-raw-yuv,format=(fourcc)%s,width=160,height=120,"
+      "framerate=25/1 ! mix.", N_BUFFERS, format, threads, N_BUFFERS,
+      format);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  mix = gst_bin_get_by_name (GST_BIN (pipeline), "mix");
+  pad = gst_element_get_static_pad (mix, "sink_1");
+  fail_unless (pad != NULL);
+  g_object_set (pad, "xpos", 75, "ypos", 57, "alpha", 0.6, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (mix);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (sink_handoff), &buffers);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return buffers;
+}
+
+static void
+free_buffers (GList * buffers)
+{
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+}
+
+/* The frame is split in stripes that are blended by several threads, the
+ * result must be the same as when it is blended in one go */
+static void
+check_threads (const gchar * format)
+{
+  GList *serial, *threaded, *s, *t;
+
+  serial = mix_frames (format, 1);
+  threaded = mix_frames (format, 4);
+
+  fail_unless_equals_int (g_list_length (serial), N_BUFFERS);
+  fail_unless_equals_int (g_list_length (threaded), N_BUFFERS);
+
+  for (s = serial, t = threaded; s && t; s = s->next, t = t->next) {
+    GstBuffer *sbuf = s->data, *tbuf = t->data;
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (sbuf),
+        GST_BUFFER_TIMESTAMP (tbuf));
+    fail_unless_equals_int (GST_BUFFER_SIZE (sbuf), GST_BUFFER_SIZE (tbuf));
+    fail_unless (memcmp (GST_BUFFER_DATA (sbuf), GST_BUFFER_DATA (tbuf),
+            GST_BUFFER_SIZE (sbuf)) == 0, "threaded output differs");
+  }
+
+  free_buffers (serial);
+  free_buffers (threaded);
+}
+
+GST_START_TEST (test_threads_ayuv)
+{
+  check_threads ("AYUV");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_i420)
+{
+  check_threads ("I420");
+}
+
+GST_END_TEST;
+
+static Suite *
+videomixer_suite (void)
+{
+  Suite *s = suite_create ("videomixer");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_threads_ayuv);
+  tcase_add_test (tc_chain, test_threads_i420);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videomixer);
@@ -0,0 +1,147 @@
+/* GStreamer throughput benchmark for the alpha element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Chroma keys videotestsrc output as fast as possible and prints the
+ * achieved frame rate for every input/output format combination. The
+ * smpte pattern contains the key color and a range of others, so both the
+ * keyed and the unchanged pixel paths are exercised. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdlib.h>
+
+#define ARGB_CAPS "video/x-raw-rgb,bpp=32,depth=32,endianness=4321," \
+    "red_mask=0x00ff0000,green_mask=0x0000ff00,blue_mask=0x000000ff," \
+    "alpha_mask=0xff000000"
+
+static const struct
+{
+  const gchar *name;
+  const gchar *in_caps;
+  const gchar *out_caps;
+} formats[] = {
+  {
+  "I420 -> AYUV", "video/x-raw-yuv,format=(fourcc)I420",
+        "video/x-raw-yuv,format=(fourcc)AYUV"}, {
+  "AYUV -> AYUV", "video/x-raw-yuv,format=(fourcc)AYUV",
+        "video/x-raw-yuv,format=(fourcc)AYUV"}, {
+  "ARGB -> ARGB", ARGB_CAPS, ARGB_CAPS}, {
+  "I420 -> ARGB", "video/x-raw-yuv,format=(fourcc)I420", ARGB_CAPS}, {
+  "YUY2 -> AYUV", "video/x-raw-yuv,format=(fourcc)YUY2",
+        "video/x-raw-yuv,format=(fourcc)AYUV"}
+};
+
+static gint opt_width = 1920;
+static gint opt_height = 1080;
+static gint opt_frames = 100;
+static gchar *opt_method = NULL;
+
+static gdouble
+run_pipeline (const gchar * in_caps, const gchar * out_caps)
+{
+  gchar *desc;
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  gdouble elapsed = -1.0;
+
+  /* the queue runs alpha in its own thread, separate from the source */
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=smpte ! "
+      "%s,width=%d,height=%d,framerate=30/1 ! queue max-size-buffers=%d "
+      "max-size-bytes=0 max-size-time=0 ! alpha method=%s ! %s ! "
+      "fakesink sync=false", opt_frames, in_caps, opt_width, opt_height,
+      opt_frames + 1, opt_method ? opt_method : "green", out_caps);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"width", 'W', 0, G_OPTION_ARG_INT, &opt_width,
+        "width of the video (default: 1920)", NULL},
+    {"height", 'H', 0, G_OPTION_ARG_INT, &opt_height,
+        "height of the video (default: 1080)", NULL},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &opt_frames,
+        "number of frames per run (default: 100)", NULL},
+    {"method", 'm', 0, G_OPTION_ARG_STRING, &opt_method,
+        "alpha method (default: green)", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gint f;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  g_print ("%-14s %10s\n", "formats", "fps");
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    gdouble elapsed;
+
+    elapsed = run_pipeline (formats[f].in_caps, formats[f].out_caps);
+    if (elapsed > 0.0)
+      g_print ("%-14s %10.1f\n", formats[f].name, opt_frames / elapsed);
+    else
+      g_print ("%-14s %10s\n", formats[f].name, "failed");
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/* GStreamer throughput benchmark for the deinterlace element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Deinterlaces interlaced videotestsrc output as fast as possible and prints
+ * the achieved frame rate for every method and format. Formats that a
+ * method does not handle itself are processed by a fallback method, the
+ * type of the method that was actually used is printed along. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdlib.h>
+
+static const gchar *methods[] = {
+  "greedyh", "tomsmocomp", "vfir", "linear", "greedyl"
+};
+
+static const struct
+{
+  const gchar *name;
+  const gchar *caps;
+} formats[] = {
+  {
+  "YUY2", "video/x-raw-yuv,format=(fourcc)YUY2"}, {
+  "I420", "video/x-raw-yuv,format=(fourcc)I420"}, {
+  "YV12", "video/x-raw-yuv,format=(fourcc)YV12"}, {
+  "Y444", "video/x-raw-yuv,format=(fourcc)Y444"}, {
+  "NV12", "video/x-raw-yuv,format=(fourcc)NV12"}
+};
+
+static gint opt_width = 1920;
+static gint opt_height = 1080;
+static gint opt_frames = 100;
+static gint opt_threads = 1;
+
+static gdouble
+run_pipeline (const gchar * method, const gchar * caps, gchar ** used)
+{
+  gchar *desc;
+  GstElement *pipeline, *deinterlace;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  gdouble elapsed = -1.0;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=ball ! "
+      "%s,width=%d,height=%d,framerate=30/1,interlaced=(boolean)true ! "
+      "deinterlace name=deinterlace method=%s fields=all threads=%d ! "
+      "fakesink sync=false", opt_frames, caps, opt_width, opt_height, method,
+      opt_threads);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  /* the method in use is exposed as child object */
+  deinterlace = gst_bin_get_by_name (GST_BIN (pipeline), "deinterlace");
+  if (deinterlace) {
+    GstObject *child;
+
+    child = gst_child_proxy_get_child_by_name (GST_CHILD_PROXY (deinterlace),
+        "method");
+    if (child) {
+      *used = g_strdup (G_OBJECT_TYPE_NAME (child));
+      gst_object_unref (child);
+    }
+    gst_object_unref (deinterlace);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"width", 'W', 0, G_OPTION_ARG_INT, &opt_width,
+        "width of the video (default: 1920)", NULL},
+    {"height", 'H', 0, G_OPTION_ARG_INT, &opt_height,
+        "height of the video (default: 1080)", NULL},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &opt_frames,
+        "number of frames per run (default: 100)", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &opt_threads,
+        "number of deinterlacing threads, 0 for all CPUs (default: 1)", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gint m, f;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  g_print ("%-12s %-8s %10s  %s\n", "method", "format", "fps", "used");
+  for (m = 0; m < G_N_ELEMENTS (methods); m++) {
+    for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+      gchar *used = NULL;
+      gdouble elapsed;
+
+      elapsed = run_pipeline (methods[m], formats[f].caps, &used);
+
+      if (elapsed > 0.0)
+        g_print ("%-12s %-8s %10.1f  %s\n", methods[m], formats[f].name,
+            2 * opt_frames / elapsed, used ? used : "");
+      else
+        g_print ("%-12s %-8s %10s\n", methods[m], formats[f].name, "failed");
+      g_free (used);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/* GStreamer throughput benchmark for the interleave and deinterleave elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Interleaves one audiotestsrc per channel as fast as possible, then
+ * interleaves and deinterleaves again, and prints the achieved throughput in
+ * millions of samples per second for every sample format and channel count.
+ * The time of the sources on their own is measured first and subtracted from
+ * the interleave time, which in turn is subtracted from the deinterleave
+ * time, so the numbers are for each element only. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdlib.h>
+
+static const struct
+{
+  const gchar *name;
+  const gchar *caps;
+} formats[] = {
+  {
+  "s8", "audio/x-raw-int,width=8,depth=8,signed=true"}, {
+  "s16", "audio/x-raw-int,width=16,depth=16,signed=true"}, {
+  "s24", "audio/x-raw-int,width=24,depth=24,signed=true"}, {
+  "s32", "audio/x-raw-int,width=32,depth=32,signed=true"}, {
+  "f32", "audio/x-raw-float,width=32"}, {
+  "f64", "audio/x-raw-float,width=64"}
+};
+
+static const gint channels[] = { 2, 8, 64 };
+
+enum
+{
+  RUN_SOURCES,
+  RUN_INTERLEAVE,
+  RUN_DEINTERLEAVE
+};
+
+static gint opt_buffers = 200;
+static gint opt_samples = 4096;
+static gboolean opt_batch = FALSE;
+
+static gdouble
+run_pipeline (const gchar * caps, gint n_channels, gint mode)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  GString *desc;
+  gdouble elapsed = -1.0;
+  gint i;
+
+  desc = g_string_new (NULL);
+  if (mode == RUN_INTERLEAVE)
+    g_string_append (desc, "interleave name=i ! fakesink sync=false ");
+  else if (mode == RUN_DEINTERLEAVE)
+    g_string_append_printf (desc, "interleave name=i ! "
+        "deinterleave name=d batch-allocation=%s ",
+        opt_batch ? "true" : "false");
+
+  for (i = 0; i < n_channels; i++) {
+    g_string_append_printf (desc, "audiotestsrc num-buffers=%d "
+        "samplesperbuffer=%d freq=%d ! audioconvert ! "
+        "%s,rate=48000,channels=1 ! ", opt_buffers, opt_samples,
+        440 + 10 * i, caps);
+    if (mode == RUN_SOURCES)
+      g_string_append (desc, "fakesink sync=false ");
+    else
+      g_string_append (desc, "i. ");
+  }
+
+  if (mode == RUN_DEINTERLEAVE) {
+    for (i = 0; i < n_channels; i++)
+      g_string_append_printf (desc, "d.src%d ! fakesink sync=false ", i);
+  }
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+static void
+print_rate (const gchar * format, gint n_channels, const gchar * element,
+    gdouble elapsed, gdouble base)
+{
+  gdouble samples;
+
+  samples = (gdouble) opt_buffers * opt_samples * n_channels;
+  if (base > 0.0 && elapsed > base)
+    g_print ("%-8s %-8d %-14s %12.1f\n", format, n_channels, element,
+        samples / (elapsed - base) / 1e6);
+  else
+    g_print ("%-8s %-8d %-14s %12s\n", format, n_channels, element,
+        "failed");
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &opt_buffers,
+        "number of buffers per source (default: 200)", NULL},
+    {"samples", 's', 0, G_OPTION_ARG_INT, &opt_samples,
+        "samples per buffer (default: 4096)", NULL},
+    {"batch-allocation", 'b', 0, G_OPTION_ARG_NONE, &opt_batch,
+        "allocate the deinterleave output buffers in one block", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gint f, c;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  g_print ("%-8s %-8s %-14s %12s\n", "format", "channels", "element",
+      "Msamples/s");
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (c = 0; c < G_N_ELEMENTS (channels); c++) {
+      gdouble sources, interleave, deinterleave;
+
+      sources = run_pipeline (formats[f].caps, channels[c], RUN_SOURCES);
+      interleave = run_pipeline (formats[f].caps, channels[c], RUN_INTERLEAVE);
+      deinterleave = run_pipeline (formats[f].caps, channels[c],
+          RUN_DEINTERLEAVE);
+
+      print_rate (formats[f].name, channels[c], "interleave", interleave,
+          sources);
+      print_rate (formats[f].name, channels[c], "deinterleave", deinterleave,
+          interleave);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
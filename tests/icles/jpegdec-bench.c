@@ -0,0 +1,233 @@
+/* GStreamer throughput benchmark for the jpegdec element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Decodes MJPEG streams as fast as possible and prints the achieved frame
+ * rate for every chroma subsampling and resolution. The streams are encoded
+ * with jpegenc into a temporary directory first, one file per frame, and then
+ * read back with multifilesrc so only the decoding is timed. Use --location
+ * to decode a sequence of your own JPEG files instead. Run it against two
+ * builds to compare decoding implementations. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#if !GLIB_CHECK_VERSION(2,30,0)
+static gchar *
+g_mkdtemp (gchar * template)
+{
+  gchar *tmpdir;
+
+  tmpdir = mkdtemp (template);
+  if (tmpdir == NULL) {
+    g_free (template);
+  }
+  return tmpdir;
+}
+#endif
+
+static const struct
+{
+  const gchar *name;
+  const gchar *caps;
+} formats[] = {
+  {
+  "4:2:0", "video/x-raw-yuv,format=(fourcc)I420"}, {
+  "4:2:2", "video/x-raw-yuv,format=(fourcc)Y42B"}, {
+  "4:4:4", "video/x-raw-yuv,format=(fourcc)Y444"}, {
+  "gray", "video/x-raw-gray,bpp=8,depth=8"}, {
+  "RGB", "video/x-raw-rgb,bpp=24,depth=24,endianness=4321,"
+        "red_mask=0xff0000,green_mask=0x00ff00,blue_mask=0x0000ff"}
+};
+
+/* 1276 is no multiple of the MCU width, so it takes the indirect path */
+static const struct
+{
+  gint width, height;
+} sizes[] = {
+  {
+  320, 240}, {
+  1276, 720}, {
+  1280, 720}, {
+  1920, 1080}
+};
+
+static gint opt_frames = 100;
+static gint opt_threads = 1;
+static gchar *opt_scale = NULL;
+static gchar *opt_location = NULL;
+
+static gdouble
+run_pipeline (const gchar * desc)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  gdouble elapsed = -1.0;
+
+  pipeline = gst_parse_launch (desc, &err);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+static gdouble
+decode (const gchar * location)
+{
+  gchar *desc;
+  gdouble elapsed;
+
+  desc = g_strdup_printf ("multifilesrc location=\"%s\" "
+      "caps=image/jpeg,framerate=30/1 ! jpegdec threads=%d scale=%s ! "
+      "fakesink sync=false", location, opt_threads,
+      opt_scale ? opt_scale : "full");
+  elapsed = run_pipeline (desc);
+  g_free (desc);
+
+  return elapsed;
+}
+
+static gdouble
+encode_and_decode (const gchar * dir, const gchar * caps, gint width,
+    gint height)
+{
+  gchar *location, *desc, *filename;
+  gdouble elapsed = -1.0;
+  gint i;
+
+  location = g_build_filename (dir, "frame%05d.jpg", NULL);
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=smpte ! "
+      "%s,width=%d,height=%d,framerate=30/1 ! jpegenc ! "
+      "multifilesink location=\"%s\"", opt_frames, caps, width, height,
+      location);
+  if (run_pipeline (desc) > 0.0)
+    elapsed = decode (location);
+  g_free (desc);
+
+  for (i = 0; i < opt_frames; i++) {
+    filename = g_strdup_printf (location, i);
+    g_unlink (filename);
+    g_free (filename);
+  }
+  g_free (location);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &opt_frames,
+        "number of frames per run (default: 100)", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &opt_threads,
+        "number of decoding threads, 0 for all CPUs (default: 1)", NULL},
+    {"scale", 's', 0, G_OPTION_ARG_STRING, &opt_scale,
+        "scale of the decoded pictures (default: full)", NULL},
+    {"location", 'l', 0, G_OPTION_ARG_STRING, &opt_location,
+        "decode these JPEG files, e.g. frame%05d.jpg, "
+          "instead of generated ones", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gchar *dir;
+  gint f, s;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (opt_location) {
+    gdouble elapsed = decode (opt_location);
+
+    if (elapsed > 0.0)
+      g_print ("%.3f s\n", elapsed);
+    return elapsed > 0.0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  dir = g_build_filename (g_get_tmp_dir (), "jpegdec-bench-XXXXXX", NULL);
+  dir = g_mkdtemp (dir);
+  if (dir == NULL) {
+    g_printerr ("Could not create temporary directory\n");
+    return EXIT_FAILURE;
+  }
+
+  g_print ("%-12s %-10s %10s\n", "sampling", "size", "fps");
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+      gchar *size;
+      gdouble elapsed;
+
+      elapsed = encode_and_decode (dir, formats[f].caps, sizes[s].width,
+          sizes[s].height);
+
+      size = g_strdup_printf ("%dx%d", sizes[s].width, sizes[s].height);
+      if (elapsed > 0.0)
+        g_print ("%-12s %-10s %10.1f\n", formats[f].name, size,
+            opt_frames / elapsed);
+      else
+        g_print ("%-12s %-10s %10s\n", formats[f].name, size, "failed");
+      g_free (size);
+    }
+  }
+
+  g_rmdir (dir);
+  g_free (dir);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/* GStreamer throughput benchmark for the jpegenc element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Encodes videotestsrc frames as fast as possible and prints the achieved
+ * frame rate for every format, resolution and number of encoding threads.
+ * The time videotestsrc needs on its own is measured first and subtracted,
+ * so the numbers are for the encoding only. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdlib.h>
+
+static const struct
+{
+  const gchar *name;
+  const gchar *caps;
+} formats[] = {
+  {
+  "I420", "video/x-raw-yuv,format=(fourcc)I420"}, {
+  "Y42B", "video/x-raw-yuv,format=(fourcc)Y42B"}, {
+  "YUY2", "video/x-raw-yuv,format=(fourcc)YUY2"}
+};
+
+static const struct
+{
+  gint width, height;
+} sizes[] = {
+  {
+  640, 480}, {
+  1920, 1080}, {
+  3840, 2160}
+};
+
+/* 0 is the number of CPUs */
+static const guint threads[] = { 1, 2, 4, 0 };
+
+static gint opt_frames = 50;
+static gint opt_quality = 85;
+
+static gdouble
+run_pipeline (const gchar * caps, gint width, gint height, gint n_threads)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  gchar *desc, *enc;
+  gdouble elapsed = -1.0;
+
+  /* without an encoder to measure the source */
+  if (n_threads >= 0)
+    enc = g_strdup_printf ("jpegenc quality=%d threads=%d ! ", opt_quality,
+        n_threads);
+  else
+    enc = g_strdup ("");
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=smpte ! "
+      "%s,width=%d,height=%d,framerate=30/1 ! %sfakesink sync=false",
+      opt_frames, caps, width, height, enc);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  g_free (enc);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &opt_frames,
+        "number of frames per run (default: 50)", NULL},
+    {"quality", 'q', 0, G_OPTION_ARG_INT, &opt_quality,
+        "quality of encoding (default: 85)", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gint f, s, t;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  g_print ("%-12s %-10s %-8s %10s\n", "format", "size", "threads", "fps");
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+      gchar *size;
+      gdouble source;
+
+      size = g_strdup_printf ("%dx%d", sizes[s].width, sizes[s].height);
+      source = run_pipeline (formats[f].caps, sizes[s].width,
+          sizes[s].height, -1);
+
+      for (t = 0; t < G_N_ELEMENTS (threads); t++) {
+        gchar *name;
+        gdouble elapsed;
+
+        elapsed = run_pipeline (formats[f].caps, sizes[s].width,
+            sizes[s].height, threads[t]);
+
+        name = threads[t] ? g_strdup_printf ("%u", threads[t]) :
+            g_strdup ("all");
+        if (source > 0.0 && elapsed > source)
+          g_print ("%-12s %-10s %-8s %10.1f\n", formats[f].name, size, name,
+              opt_frames / (elapsed - source));
+        else
+          g_print ("%-12s %-10s %-8s %10s\n", formats[f].name, size, name,
+              "failed");
+        g_free (name);
+      }
+      g_free (size);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
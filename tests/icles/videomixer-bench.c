@@ -0,0 +1,190 @@
+/* GStreamer throughput benchmark for the videomixer2 element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Mixes a number of videotestsrc inputs with alpha into one output as fast as
+ * possible and prints the achieved frame rate for every format and
+ * resolution. Run it against two builds to compare blending implementations.
+ * The checker background exercises the fill_checker functions, the black
+ * background the fill_color functions. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdlib.h>
+
+static const struct
+{
+  const gchar *name;
+  const gchar *caps;
+} formats[] = {
+  {
+  "AYUV", "video/x-raw-yuv,format=(fourcc)AYUV"}, {
+  "I420", "video/x-raw-yuv,format=(fourcc)I420"}, {
+  "YV12", "video/x-raw-yuv,format=(fourcc)YV12"}, {
+  "Y444", "video/x-raw-yuv,format=(fourcc)Y444"}, {
+  "Y42B", "video/x-raw-yuv,format=(fourcc)Y42B"}, {
+  "Y41B", "video/x-raw-yuv,format=(fourcc)Y41B"}, {
+  "YUY2", "video/x-raw-yuv,format=(fourcc)YUY2"}, {
+  "UYVY", "video/x-raw-yuv,format=(fourcc)UYVY"}, {
+  "ARGB", "video/x-raw-rgb,bpp=32,depth=32,endianness=4321,"
+        "red_mask=0x00ff0000,green_mask=0x0000ff00,blue_mask=0x000000ff,"
+        "alpha_mask=0xff000000"}, {
+  "xRGB", "video/x-raw-rgb,bpp=32,depth=24,endianness=4321,"
+        "red_mask=0x00ff0000,green_mask=0x0000ff00,blue_mask=0x000000ff"}, {
+  "RGB", "video/x-raw-rgb,bpp=24,depth=24,endianness=4321,"
+        "red_mask=0xff0000,green_mask=0x00ff00,blue_mask=0x0000ff"}
+};
+
+static const struct
+{
+  gint width, height;
+} sizes[] = {
+  {
+  320, 240}, {
+  1280, 720}, {
+  1920, 1080}
+};
+
+static gint opt_inputs = 4;
+static gint opt_frames = 100;
+static gchar *opt_background = NULL;
+static gint opt_threads = 1;
+
+static gdouble
+run_pipeline (const gchar * caps, gint width, gint height)
+{
+  GString *desc;
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *err = NULL;
+  gdouble elapsed = -1.0;
+  gint i;
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "videomixer2 name=mix background=%s "
+      "threads=%d ! fakesink sync=false ",
+      opt_background ? opt_background : "checker", opt_threads);
+  for (i = 0; i < opt_inputs; i++) {
+    g_string_append_printf (desc, "videotestsrc num-buffers=%d pattern=%d ! "
+        "%s,width=%d,height=%d,framerate=30/1 ! mix.sink_%d ",
+        opt_frames, i % 3, caps, width / 2 + i * 8, height / 2 + i * 8, i);
+  }
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (pipeline == NULL) {
+    g_printerr ("could not construct pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  /* place the inputs over each other with some transparency */
+  for (i = 0; i < opt_inputs; i++) {
+    GstElement *mix;
+    GstPad *pad;
+    gchar *name;
+
+    mix = gst_bin_get_by_name (GST_BIN (pipeline), "mix");
+    name = g_strdup_printf ("sink_%d", i);
+    pad = gst_element_get_static_pad (mix, name);
+    if (pad) {
+      g_object_set (pad, "alpha", 0.7, "xpos", i * 32, "ypos", i * 32, NULL);
+      gst_object_unref (pad);
+    }
+    g_free (name);
+    gst_object_unref (mix);
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+    elapsed = g_timer_elapsed (timer, NULL);
+  else
+    g_printerr ("error while running the pipeline\n");
+  gst_message_unref (msg);
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    {"inputs", 'i', 0, G_OPTION_ARG_INT, &opt_inputs,
+        "number of mixed inputs (default: 4)", NULL},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &opt_frames,
+        "number of frames per run (default: 100)", NULL},
+    {"background", 'b', 0, G_OPTION_ARG_STRING, &opt_background,
+        "background of the mixer (default: checker)", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &opt_threads,
+        "number of compositing threads, 0 for all CPUs (default: 1)", NULL},
+    {NULL, '\0', 0, 0, NULL, NULL, NULL}
+  };
+  GOptionContext *ctx;
+  GError *opt_err = NULL;
+  gint f, s;
+
+#if !GLIB_CHECK_VERSION (2, 31, 0)
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &opt_err)) {
+    g_printerr ("Error parsing command line options: %s\n", opt_err->message);
+    g_error_free (opt_err);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  g_print ("%-12s %-10s %10s\n", "format", "size", "fps");
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+      gchar *size;
+      gdouble elapsed;
+
+      elapsed = run_pipeline (formats[f].caps, sizes[s].width,
+          sizes[s].height);
+
+      size = g_strdup_printf ("%dx%d", sizes[s].width, sizes[s].height);
+      if (elapsed > 0.0)
+        g_print ("%-12s %-10s %10.1f\n", formats[f].name, size,
+            opt_frames / elapsed);
+      else
+        g_print ("%-12s %-10s %10s\n", formats[f].name, size, "failed");
+      g_free (size);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}